@@ -112,6 +112,7 @@ enum {
     EDPVS_PKTSTOLEN     = -25,      /* stolen packet */
     EDPVS_SYSCALL       = -26,      /* system call failed */
     EDPVS_NODEV         = -27,      /* no such device */
+    EDPVS_ABORTED       = -28,      /* aborted, rolled back */
 
     /* positive code for non-error */
     EDPVS_KNICONTINUE   = 1,        /* KNI to continue */
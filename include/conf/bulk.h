@@ -0,0 +1,83 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: control plane only
+ * based on dpvs_sockopt.
+ *
+ * bulk config: a batch of set sockopts (service, dest, laddr, blklst,
+ * route ...) validated and applied in one request, with per-item result.
+ * a batch of get sockopts may be sent in one request as well.
+ */
+#ifndef __DPVS_BULK_CONF_H__
+#define __DPVS_BULK_CONF_H__
+#include <stdint.h>
+
+enum {
+    /* get, for per-item results */
+    SOCKOPT_GET_BULK_APPLY  = 1300,
+    /* get, items are get sockopts, for per-item outputs */
+    SOCKOPT_GET_BULK_GET,
+};
+
+/* all or nothing, applied items are rolled back if any fails */
+#define DPVS_BULK_F_ATOMIC      0x1
+
+#define DPVS_BULK_ALIGN(len)    (((len) + 7) / 8 * 8)
+
+/*
+ * the item may fail without aborting an atomic bulk, e.g., adding the
+ * address of a laddr that is on the device already. it's still rolled
+ * back if it was applied.
+ */
+#define DPVS_BULK_ITEM_F_OPTIONAL   0x1
+
+/* each item is followed by the next one at DPVS_BULK_ALIGN(sizeof + len) */
+struct dp_vs_bulk_item {
+    uint32_t            opt;        /* set sockopt id */
+    uint32_t            len;
+    uint32_t            flags;      /* DPVS_BULK_ITEM_F_XXX */
+    uint32_t            reserved;
+    char                data[0];    /* input of the set/get sockopt */
+};
+
+struct dp_vs_bulk_conf {
+    uint32_t            flags;
+    uint32_t            nitem;
+    char                items[0];
+};
+
+struct dp_vs_bulk_result {
+    uint32_t            nitem;
+    uint32_t            napplied;   /* items in effect */
+    int                 results[0]; /* EDPVS_ABORTED if rolled back or skipped */
+};
+
+/* each reply is followed by the next one at DPVS_BULK_ALIGN(sizeof + len) */
+struct dp_vs_bulk_reply {
+    int32_t             result;
+    uint32_t            len;        /* 0 if the get failed */
+    char                data[0];    /* output of the get sockopt */
+};
+
+struct dp_vs_bulk_replies {
+    uint32_t            nitem;
+    uint32_t            reserved;
+    char                replies[0];
+};
+
+#endif /* __DPVS_BULK_CONF_H__ */
@@ -29,6 +29,9 @@ enum {
     /* set */
     SOCKOPT_SET_NEIGH_ADD,
     SOCKOPT_SET_NEIGH_DEL,
+
+    /* get */
+    SOCKOPT_GET_NEIGH_STATS,
 };
 
 enum {
@@ -56,6 +59,17 @@ struct dp_vs_neigh_conf_array {
     struct dp_vs_neigh_conf addrs[0];
 }__attribute__((__packed__));
 
+/* summed over all lcores */
+struct dp_vs_neigh_stats {
+    uint64_t          lookup_miss;  /* nexthop not found on tx path */
+    uint64_t          unresolved;   /* nexthop found but unresolved on tx path */
+    uint64_t          pinned_miss;  /* pinned nexthop unresolved on tx path */
+    uint64_t          queued;       /* packets queued for resolution */
+    uint64_t          unres_drop;   /* packets dropped waiting for resolution */
+    uint64_t          requests;     /* requests sent to owner lcore */
+    uint64_t          probes;       /* unicast probes for pinned nexthops */
+};
+
 #define sNNO DPVS_NUD_S_NONE
 #define sNSD DPVS_NUD_S_SEND
 #define sNRE DPVS_NUD_S_REACHABLE
@@ -82,5 +96,6 @@ static inline const char *nud_state_name(int state)
 
 #define NEIGHBOUR_HASHED     0x01
 #define NEIGHBOUR_STATIC     0x02
+#define NEIGHBOUR_PINNED     0x04
 
 #endif
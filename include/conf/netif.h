@@ -87,6 +87,10 @@ typedef struct netif_lcore_stats_get
     uint64_t opackets;
     uint64_t obytes;
     uint64_t dropped; // software packet drop
+    uint64_t timer_expired;
+    uint64_t timer_deferred; // expired later than due
+    uint64_t timer_budget_hits;
+    uint64_t timer_max_latency; // ms
 } netif_lcore_stats_get_t;
 
 struct port_id_name
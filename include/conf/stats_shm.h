@@ -0,0 +1,172 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: layout of the shared-memory statistics region, which dpvs
+ * publishes periodically and other processes read without sockopt.
+ *
+ * the region starts with dpvs_stats_shm_hdr, sections follow at the
+ * offsets given by the header. the writer makes @seq odd before updating
+ * and even after, a reader retries if @seq is odd or changes while it's
+ * copying.
+ */
+#ifndef __DPVS_STATS_SHM_CONF_H__
+#define __DPVS_STATS_SHM_CONF_H__
+#include <stdint.h>
+#include "inet.h"
+
+#define DPVS_STATS_SHM_NAME_DEF     "/dpvs_stats"
+#define DPVS_STATS_SHM_MAGIC        0x44505653  /* "DPVS" */
+#define DPVS_STATS_SHM_VERSION      3
+#define DPVS_STATS_SHM_NAMELEN      32
+#define DPVS_STATS_SHM_MATCHLEN     256
+
+/* more entries than the region can hold, the rest are absent */
+#define DPVS_STATS_SHM_F_TRUNC      0x1
+
+struct dpvs_stats_shm_sect {
+    uint32_t            off;        /* from start of region */
+    uint32_t            entsz;      /* size of each entry */
+    uint32_t            max;        /* capacity */
+    uint32_t            num;        /* entries in use */
+};
+
+struct dpvs_stats_shm_hdr {
+    uint32_t            magic;
+    uint32_t            version;
+    uint64_t            size;       /* of the region */
+    volatile uint32_t   seq;
+    uint32_t            flags;
+    uint32_t            interval_ms;
+    uint32_t            pid;        /* of dpvs */
+    uint64_t            updated_us; /* wall clock of last update */
+
+    struct dpvs_stats_shm_sect lcore;   /* dpvs_stats_shm_lcore */
+    struct dpvs_stats_shm_sect port;    /* dpvs_stats_shm_port */
+    struct dpvs_stats_shm_sect svc;     /* dpvs_stats_shm_svc */
+    struct dpvs_stats_shm_sect dest;    /* dpvs_stats_shm_dest */
+    struct dpvs_stats_shm_sect mib;     /* dpvs_stats_shm_mib */
+    struct dpvs_stats_shm_sect inet;    /* dpvs_stats_shm_inet */
+    struct dpvs_stats_shm_sect qsch;    /* dpvs_stats_shm_qsch */
+};
+
+struct dpvs_stats_shm_counters {
+    uint64_t            conns;
+    uint64_t            inpkts;
+    uint64_t            inbytes;
+    uint64_t            outpkts;
+    uint64_t            outbytes;
+};
+
+/* per data-plane lcore, see netif_lcore_stats */
+struct dpvs_stats_shm_lcore {
+    uint32_t            cid;
+    uint32_t            pad;
+    uint64_t            lcore_loop;
+    uint64_t            pktburst;
+    uint64_t            zpktburst;
+    uint64_t            fpktburst;
+    uint64_t            z2hpktburst;
+    uint64_t            h2fpktburst;
+    uint64_t            ipackets;
+    uint64_t            ibytes;
+    uint64_t            opackets;
+    uint64_t            obytes;
+    uint64_t            dropped;
+    struct dpvs_stats_shm_counters ipvs;
+};
+
+/* NIC counters, see rte_eth_stats */
+struct dpvs_stats_shm_port {
+    char                name[DPVS_STATS_SHM_NAMELEN];
+    uint32_t            id;
+    uint32_t            pad;
+    uint64_t            ipackets;
+    uint64_t            opackets;
+    uint64_t            ibytes;
+    uint64_t            obytes;
+    uint64_t            imissed;
+    uint64_t            ierrors;
+    uint64_t            oerrors;
+    uint64_t            rx_nombuf;
+};
+
+struct dpvs_stats_shm_svc {
+    int32_t             af;
+    uint8_t             proto;
+    uint8_t             pad;
+    uint16_t            port;       /* network order */
+    uint32_t            fwmark;
+    uint32_t            flags;
+    union inet_addr     addr;
+    char                match[DPVS_STATS_SHM_MATCHLEN]; /* match service */
+    uint32_t            dest_first; /* index of its first dest */
+    uint32_t            ndest;      /* dests in dest section */
+    struct dpvs_stats_shm_counters stats;   /* sum of its dests */
+};
+
+struct dpvs_stats_shm_dest {
+    int32_t             af;
+    uint16_t            port;       /* network order */
+    uint16_t            pad;
+    union inet_addr     addr;
+    uint32_t            svc;        /* index of its service */
+    uint32_t            flags;
+    int32_t             weight;
+    uint32_t            actconns;
+    uint32_t            inactconns;
+    uint32_t            persistconns;
+    struct dpvs_stats_shm_counters stats;
+};
+
+/* named counter summed over lcores, e.g. dp_vs_estats */
+struct dpvs_stats_shm_mib {
+    char                name[DPVS_STATS_SHM_NAMELEN];
+    uint64_t            value;
+};
+
+/* inet_stats of an address family, summed over lcores */
+struct dpvs_stats_shm_inet {
+    int32_t             af;
+    uint32_t            pad;
+    struct inet_stats   stats;
+};
+
+/* tc qstats and bstats of a qsch, summed over lcores */
+struct dpvs_stats_shm_qsch {
+    char                dev[DPVS_STATS_SHM_NAMELEN];
+    char                kind[DPVS_STATS_SHM_NAMELEN];
+    uint32_t            handle;
+    uint32_t            parent;
+    uint32_t            qlen;
+    uint32_t            backlog;    /* bytes */
+    uint32_t            drops;
+    uint32_t            requeues;
+    uint32_t            overlimits;
+    uint32_t            pad;
+    uint64_t            bytes;
+    uint64_t            packets;
+};
+
+static inline void *dpvs_stats_shm_entry(const struct dpvs_stats_shm_hdr *hdr,
+                                         const struct dpvs_stats_shm_sect *sect,
+                                         uint32_t idx)
+{
+    return (char *)hdr + sect->off + (size_t)idx * sect->entsz;
+}
+
+#endif /* __DPVS_STATS_SHM_CONF_H__ */
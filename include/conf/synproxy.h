@@ -0,0 +1,45 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_SYNPROXY_CONF_H__
+#define __DPVS_SYNPROXY_CONF_H__
+#include <stdint.h>
+
+/* normally given by build flags, see src/config.mk */
+#ifndef DPVS_MAX_LCORE
+#define DPVS_MAX_LCORE  64
+#endif
+
+enum {
+    /* get */
+    SOCKOPT_GET_SYNPROXY_STATS = 1200,
+};
+
+/* client's acks held by synproxy conns waiting for rs's syn-ack */
+struct dp_vs_synproxy_stats {
+    uint64_t    ack_held;       /* acks held now */
+    uint64_t    ack_bytes;      /* mbuf memory of the acks held now */
+    uint64_t    ack_saved;      /* acks ever held */
+    uint64_t    ack_refused;    /* acks dropped as the stash is full */
+};
+
+struct dp_vs_synproxy_stats_param {
+    struct dp_vs_synproxy_stats stats;
+    struct dp_vs_synproxy_stats stats_cpus[DPVS_MAX_LCORE];
+} __attribute__((__packed__));
+
+#endif /* __DPVS_SYNPROXY_CONF_H__ */
@@ -57,6 +57,8 @@ struct tc_qsch_param {
         struct tc_tbf_qopt tbf;
         struct tc_fifo_qopt fifo;
         struct tc_prio_qopt prio;       /* pfifo_fast ... */
+        struct tc_htb_qopt htb;
+        struct tc_fq_codel_qopt fq_codel;
     } qopt;
 
     /* get only */
@@ -49,15 +49,26 @@ typedef enum msg_mode {
 #define DPVS_MSG_F_CALLBACK_FAIL    64
 /* msg timeout */
 #define DPVS_MSG_F_TIMEOUT          128
+/* msg data is struct dpvs_msg_ops, a batch of ops */
+#define DPVS_MSG_F_BATCH            256
 
 struct dpvs_msg_reply {
     uint32_t len;
     void *data;
 };
 
+struct dpvs_msg;
+
+/* called on sender lcore when an async msg finished, dropped or timeout */
+typedef void (*MSG_COMPLETE_CB)(struct dpvs_msg *msg, int err);
+
 /* inter-lcore msg structure */
 struct dpvs_msg {
     struct list_head mq_node;
+    struct list_head pend_node; /* pending for completion on sender */
+    MSG_COMPLETE_CB complete;
+    void *priv;             /* for complete callback */
+    uint64_t deadline;      /* cycles, for completion */
     msgid_t type;
     uint32_t seq;           /* msg sequence number */
     DPVS_MSG_MODE mode;     /* msg mode */
@@ -71,6 +82,13 @@ struct dpvs_msg {
     char data[0];           /* msg data */
 };
 
+/* data of DPVS_MSG_F_BATCH msg */
+struct dpvs_msg_ops {
+    uint32_t nops;
+    uint32_t oplen;         /* length of each op */
+    char ops[0];
+};
+
 static inline uint32_t get_msg_flags(struct dpvs_msg *msg)
 {
     uint32_t flags;
@@ -165,6 +183,75 @@ int multicast_msg_send(struct dpvs_msg *msg,
         uint32_t flags, /* only DPVS_MSG_F_ASYNC supported now */
         struct dpvs_multicast_queue **reply); /* response, use it before msg_destroy */
 
+/*
+ * send msg without waiting, @cb (may be NULL) is called on this lcore when
+ * it's done. the msg is owned by msg manager since then, never destroy it.
+ */
+int msg_send_async(struct dpvs_msg *msg, lcoreid_t cid,
+        MSG_COMPLETE_CB cb, void *priv);
+
+int multicast_msg_send_async(struct dpvs_msg *msg,
+        MSG_COMPLETE_CB cb, void *priv);
+
+/* number of ops carried by msg, 1 if the msg is not a batch */
+static inline uint32_t msg_nops(struct dpvs_msg *msg)
+{
+    if (!test_msg_flags(msg, DPVS_MSG_F_BATCH))
+        return 1;
+    return ((struct dpvs_msg_ops *)msg->data)->nops;
+}
+
+static inline uint32_t msg_oplen(struct dpvs_msg *msg)
+{
+    if (!test_msg_flags(msg, DPVS_MSG_F_BATCH))
+        return msg->len;
+    return ((struct dpvs_msg_ops *)msg->data)->oplen;
+}
+
+static inline void *msg_op(struct dpvs_msg *msg, uint32_t i)
+{
+    struct dpvs_msg_ops *mops = (struct dpvs_msg_ops *)msg->data;
+
+    if (!test_msg_flags(msg, DPVS_MSG_F_BATCH))
+        return msg->data;
+    return mops->ops + i * mops->oplen;
+}
+
+/*
+ * ops of a multicast msg type, sent to all slaves in one async msg when
+ * the batch is full, or it's old enough, or ops are added to any other
+ * batch (so ops are applied in order of adding). the unicast callback of
+ * the msg type walks ops with msg_nops/msg_op. master lcore only.
+ */
+struct dpvs_msg_batch {
+    msgid_t type;
+    uint32_t oplen;         /* length of each op */
+    MSG_COMPLETE_CB complete; /* optional, failure is logged if NULL */
+
+    /* internal use */
+    uint32_t seq;
+    uint32_t nops;
+    uint64_t since;         /* cycles when first op added */
+    struct dpvs_msg *msg;
+    struct list_head list;
+};
+
+int msg_batch_register(struct dpvs_msg_batch *batch);
+int msg_batch_unregister(struct dpvs_msg_batch *batch);
+
+int msg_batch_add(struct dpvs_msg_batch *batch, const void *op);
+int msg_batch_flush(struct dpvs_msg_batch *batch);
+
+/*
+ * ops added to any batch between begin and commit are sent to slaves in
+ * one msg at commit, and applied by each slave in a single pass. a msg
+ * multicast directly in between sends the ops added so far before it.
+ */
+int msg_batch_begin(void);
+int msg_batch_commit(void);
+/* between begin and commit, i.e., a bulk is being applied */
+bool msg_batch_in_txn(void);
+
 /* Master lcore msg process loop */
 int msg_master_process(void); /* Master lcore msg loop */
 
@@ -193,6 +280,7 @@ int msg_type_table_print(char *buf, int len); /* debug */
 #define MSG_TYPE_IPV6_STATS                 16
 #define MSG_TYPE_ROUTE6                     17
 #define MSG_TYPE_NEIGH_GET                  18
+#define MSG_TYPE_BATCH_TXN                  22
 
 #define SOCKOPT_VERSION_MAJOR               1
 #define SOCKOPT_VERSION_MINOR               0
@@ -235,6 +323,11 @@ struct dpvs_sockopts {
     sockoptid_t set_opt_min;
     sockoptid_t set_opt_max;
     int (*set)(sockoptid_t opt, const void *in, size_t inlen);
+    /*
+     * optional, set opt reverting @opt with the same input, 0 if none.
+     * set opts of a module having it reach slaves by msg batches only.
+     */
+    sockoptid_t (*set_undo)(sockoptid_t opt);
     sockoptid_t get_opt_min;
     sockoptid_t get_opt_max;
     int (*get)(sockoptid_t opt, const void *in, size_t inlen, void **out, size_t *outlen);
@@ -68,7 +68,7 @@ int ipv4_unregister_hooks(struct inet_hook_ops *ops, size_t n);
  * Statistics
  */
 #ifdef CONFIG_DPVS_IPV4_STATS
-extern struct ip4_stats ip4_statistics;
+extern struct inet_stats ip4_statistics;
 extern rte_spinlock_t ip4_stats_lock;
 
 #define IP4_INC_STATS(field) \
@@ -113,8 +113,8 @@ extern rte_spinlock_t ip4_stats_lock;
 
 typedef struct inet_stats ip4_stats;
 
-struct ip4_stats;
-int ipv4_get_stats(struct ip4_stats *stats);
+/* EDPVS_NOTSUPP without CONFIG_DPVS_IPV4_STATS */
+int ipv4_get_stats(struct inet_stats *stats);
 int ip4_defrag(struct rte_mbuf *mbuf, int user);
 
 uint32_t ip4_select_id(struct ipv4_hdr *iph);
@@ -81,6 +81,10 @@ int ip6_output(struct rte_mbuf *mbuf);
 
 int ip6_local_out(struct rte_mbuf *mbuf);
 
+/* reassemble in-place, @user is IP_DEFRAG_XXX. mbuf is consumed
+ * unless EDPVS_OK is returned (datagram completed). */
+int ip6_defrag(struct rte_mbuf *mbuf, int user);
+
 int ipv6_register_hooks(struct inet_hook_ops *ops, size_t n);
 int ipv6_unregister_hooks(struct inet_hook_ops *ops, size_t n);
 
@@ -90,6 +94,8 @@ int ipv6_unregister_protocol(struct inet6_protocol *prot,
                              unsigned char protocol);
 
 int ipv6_stats_cpu(struct inet_stats *stats);
+/* sum of all lcores, may be called on any lcore */
+int ipv6_stats_sum(struct inet_stats *stats);
 
 void install_ipv6_keywords(void);
 void ipv6_keyword_value_init(void);
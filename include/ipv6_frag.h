@@ -0,0 +1,36 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_IPV6_FRAG_H__
+#define __DPVS_IPV6_FRAG_H__
+
+#define IP6_FRAG_FREE_DEATH_ROW_INTERVAL 100
+
+int ipv6_frag_init(void);
+int ipv6_frag_term(void);
+int ipv6_reassemble(struct rte_mbuf *mbuf);
+/*
+ * fragment with indirect mbufs referring @mbuf's data, consumes @mbuf and
+ * its route. returns number of fragments sent or EDPVS_XXX error.
+ */
+int ipv6_fragment(struct rte_mbuf *mbuf, unsigned int mtu,
+          int (*output)(struct rte_mbuf *));
+
+void ip6_frag_keyword_value_init(void);
+void install_ip6_frag_keywords(void);
+
+#endif /* __DPVS_IPV6_FRAG_H__ */
@@ -44,6 +44,9 @@ enum {
     DPVS_CONN_F_NOFASTXMIT      = 0x2000,
 };
 
+/* ack packets a synproxy conn may hold before rs's syn-ack arrives */
+#define DP_VS_SYNPROXY_ACK_STASH    8
+
 struct dp_vs_conn_param {
     int                 af;
     uint16_t            proto;
@@ -131,7 +134,7 @@ struct dp_vs_conn {
 
     /* synproxy related members */
     struct dp_vs_seq syn_proxy_seq;     /* seq used in synproxy */
-    struct list_head ack_mbuf;          /* ack mbuf saved in step2 */
+    struct rte_mbuf *ack_mbuf[DP_VS_SYNPROXY_ACK_STASH]; /* ack mbuf saved in step2 */
     uint32_t ack_num;                   /* ack mbuf number stored */
     struct rte_mbuf *syn_mbuf;          /* saved rs syn packet for retransmition */
     rte_atomic32_t syn_retry_max;       /* syn retransmition max packets */
@@ -159,12 +162,6 @@ struct dp_vs_conn {
   
 } __rte_cache_aligned;
 
-/* for syn-proxy to save all ack packet in conn before rs's syn-ack arrives */
-struct dp_vs_synproxy_ack_pakcet {
-    struct list_head list;
-    struct rte_mbuf *mbuf;
-} __rte_cache_aligned;
-
 /* helpers */
 #define tuplehash_in(c)         ((c)->tuplehash[DPVS_CONN_DIR_INBOUND])
 #define tuplehash_out(c)        ((c)->tuplehash[DPVS_CONN_DIR_OUTBOUND])
@@ -26,6 +26,7 @@ enum {
 };
 
 extern int g_defence_udp_drop;
+extern int g_udp_frag_reassemble;
 
 void install_proto_udp_keywords(void);
 void udp_keyword_value_init(void);
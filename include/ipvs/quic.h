@@ -0,0 +1,63 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * QUIC connection ID for udp scheduling, both IETF QUIC (RFC 9000) and
+ * gQUIC headers are understood. connection IDs issued by real servers
+ * may carry a server id as QUIC-LB draft describes, which routes packets
+ * of a migrated connection to the same server without any flow state.
+ */
+#ifndef __DPVS_QUIC_H__
+#define __DPVS_QUIC_H__
+
+#include "common.h"
+#include "dpdk.h"
+#include "inet.h"
+#include "ipvs/dest.h"
+
+#define DP_VS_QUIC_CID_MAXLEN       20
+#define DP_VS_QUIC_LB_SID_MAXLEN    15
+
+enum {
+    DP_VS_QUIC_CID_GQUIC = 1,       /* gQUIC 8-byte cid */
+    DP_VS_QUIC_CID_CLIENT,          /* chosen by client: Initial, 0-RTT */
+    DP_VS_QUIC_CID_SERVER,          /* issued by real server */
+};
+
+struct dp_vs_quic_cid {
+    uint8_t     type;
+    uint8_t     len;
+    uint8_t     data[DP_VS_QUIC_CID_MAXLEN];
+};
+
+/* destination connection ID of a udp packet */
+int dp_vs_quic_get_dcid(int af, struct rte_mbuf *mbuf,
+                        struct dp_vs_quic_cid *cid);
+
+/*
+ * server id encoded in @cid by QUIC-LB config, copied to @sid.
+ * EDPVS_NOTSUPP if QUIC-LB is not configured.
+ */
+int dp_vs_quic_lb_decode(const struct dp_vs_quic_cid *cid, uint8_t *sid);
+
+/* whether @sid is the server id of @dest */
+bool dp_vs_quic_lb_match(const struct dp_vs_dest *dest, const uint8_t *sid);
+
+void quic_lb_keyword_value_init(void);
+void install_quic_lb_keywords(void);
+
+#endif /* __DPVS_QUIC_H__ */
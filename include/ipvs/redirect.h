@@ -41,7 +41,10 @@ struct dp_vs_redirect {
     uint16_t             sport;
     uint16_t             dport;
 
-    struct rte_mempool  *redirect_pool;
+    union {
+        struct rte_mempool    *redirect_pool;
+        struct dp_vs_redirect *gc_next; /* retired, see dp_vs_redirect_free */
+    };
 } __rte_cache_aligned;
 
 struct dp_vs_redirect *dp_vs_redirect_alloc(enum dpvs_fwd_mode fwdmode);
@@ -54,6 +57,7 @@ struct dp_vs_redirect *dp_vs_redirect_get(int af, uint16_t proto,
 void dp_vs_redirect_init(struct dp_vs_conn *conn);
 int dp_vs_redirect_table_init(void);
 int dp_vs_redirect_pkt(struct rte_mbuf *mbuf, lcoreid_t peer_cid);
+void dp_vs_redirect_flush(lcoreid_t cid);
 void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid);
 int dp_vs_redirects_init(void);
 int dp_vs_redirects_term(void);
@@ -38,12 +38,46 @@
 #define DP_VS_SVC_F_PERSISTENT      0x0001      /* peristent port */
 #define DP_VS_SVC_F_HASHED          0x0002      /* hashed entry */
 #define DP_VS_SVC_F_SYNPROXY        0x8000      /* synrpoxy flag */
+#define DP_VS_SVC_F_SYNPROXY_AUTO   0x4000      /* synproxy on syn flood */
+#define DP_VS_SVC_F_SYNPROXY_ACTIVE 0x2000      /* auto synproxy is on, get only */
 
 #define DP_VS_SVC_F_SIP_HASH        0x0100      /* sip hash target */
 #define DP_VS_SVC_F_QID_HASH        0x0200      /* quic cid hash target */
 
 rte_rwlock_t __dp_vs_svc_lock;
 
+/*
+ * a bulk holds the svc write lock across all its items, see
+ * dp_vs_svc_bulk_lock. svc ops on master skip the lock meanwhile.
+ */
+RTE_DECLARE_PER_LCORE(bool, dp_vs_svc_bulk);
+
+static inline void dp_vs_svc_read_lock(void)
+{
+    if (!RTE_PER_LCORE(dp_vs_svc_bulk))
+        rte_rwlock_read_lock(&__dp_vs_svc_lock);
+}
+
+static inline void dp_vs_svc_read_unlock(void)
+{
+    if (!RTE_PER_LCORE(dp_vs_svc_bulk))
+        rte_rwlock_read_unlock(&__dp_vs_svc_lock);
+}
+
+static inline void dp_vs_svc_write_lock(void)
+{
+    if (!RTE_PER_LCORE(dp_vs_svc_bulk))
+        rte_rwlock_write_lock(&__dp_vs_svc_lock);
+}
+
+static inline void dp_vs_svc_write_unlock(void)
+{
+    if (!RTE_PER_LCORE(dp_vs_svc_bulk))
+        rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+}
+
+struct dp_vs_synproxy_auto;
+
 /* virtual service */
 struct dp_vs_service {
     struct list_head    s_list;     /* node for normal service table */
@@ -82,6 +116,9 @@ struct dp_vs_service {
 
     struct dp_vs_stats  *stats;
 
+    /* per-lcore states of DP_VS_SVC_F_SYNPROXY_AUTO */
+    struct dp_vs_synproxy_auto *sp_auto;
+
     /* FNAT only */
     struct list_head    laddr_list; /* local address (LIP) pool */
     struct list_head    *laddr_curr;
@@ -213,11 +250,23 @@ struct dp_vs_service *__dp_vs_svc_fwm_get(int af, uint32_t fwmark);
 int dp_vs_get_service_entries(const struct dp_vs_get_services *get,
         struct dp_vs_get_services *uptr);
 
+/* call @func for each service until it fails, master lcore only */
+int dp_vs_service_walk(int (*func)(struct dp_vs_service *svc, void *arg),
+                       void *arg);
+
 unsigned dp_vs_get_conn_timeout(struct dp_vs_conn *conn);
 
 /* flush all services */
 int dp_vs_flush(void);
 
+/*
+ * workers see services, dests and laddrs changed by a bulk all at once,
+ * master only. no sync msg to slaves is allowed in between, as workers
+ * may be waiting for the lock.
+ */
+void dp_vs_svc_bulk_lock(void);
+void dp_vs_svc_bulk_unlock(void);
+
 int dp_vs_zero_service(struct dp_vs_service *svc);
 
 int dp_vs_zero_all(void);
@@ -88,6 +88,8 @@ enum  dp_vs_estats_type {
     CONN_SCHED_UNREACH,
     SYNPROXY_NO_DEST,
     CONN_EXCEEDED,
+    SYNPROXY_AUTO_ON,
+    SYNPROXY_AUTO_OFF,
     DP_VS_EXT_STAT_LAST
 };
 
@@ -108,6 +110,15 @@ void dp_vs_stats_conn(struct dp_vs_conn *conn);
 void dp_vs_estats_inc(enum dp_vs_estats_type field);
 void dp_vs_estats_clear(void);
 uint64_t dp_vs_estats_get(enum dp_vs_estats_type field);
+const char *dp_vs_estats_name(enum dp_vs_estats_type field);
+
+/*
+ * read per-lcore counters without msg, may be a little stale.
+ * @mibs has DP_VS_EXT_STAT_LAST elements.
+ */
+void dp_vs_stats_lcore(lcoreid_t cid, struct dp_vs_stats *stats);
+void dp_vs_stats_sum(const struct dp_vs_stats *percpu, struct dp_vs_stats *sum);
+void dp_vs_estats_sum(uint64_t *mibs);
 
 int dp_vs_new_stats(struct dp_vs_stats **p);
 void dp_vs_del_stats(struct dp_vs_stats *p);
@@ -54,10 +54,8 @@
 #define DP_VS_SYNPROXY_SND_WSCALE_MASK  ((uint32_t)0xf << DP_VS_SYNPROXY_SND_WSCALE_BITS)
 #define DP_VS_SYNPROXY_WSCALE_MAX       14
 
-extern struct rte_mempool *dp_vs_synproxy_ack_mbufpool[DPVS_MAX_SOCKET];
-#define this_ack_mbufpool (dp_vs_synproxy_ack_mbufpool[rte_socket_id()])
-
 extern int dp_vs_synproxy_ctrl_conn_reuse;
+extern int dp_vs_synproxy_ctrl_syn_fast;
 
 #ifdef CONFIG_SYNPROXY_DEBUG
 extern rte_atomic32_t sp_syn_saved;
@@ -86,14 +84,58 @@ struct dp_vs_synproxy_opt {
     uint16_t mss_clamp;     /* Max mss, negotiated at connectons setup */
 } __rte_cache_aligned;
 
+/*
+ * adaptive synproxy states of a service on one lcore. synproxy is turned on
+ * when syns or uncompleted handshakes in one second exceed the thresholds,
+ * and off when they stay below the thresholds for the cooldown time.
+ */
+struct dp_vs_synproxy_auto {
+    uint32_t    active;         /* synproxy is on */
+    uint32_t    syns;           /* syns in current window */
+    uint32_t    estab;          /* handshakes completed in current window */
+    uint64_t    window_end;     /* cycles */
+    uint64_t    cooldown_end;   /* cycles, synproxy keeps on until then */
+} __rte_cache_aligned;
+
+/*
+ * set up (or reset) svc->sp_auto, master only. workers access it with just
+ * a svc reference, so term is called only when the svc itself is freed.
+ */
+int dp_vs_synproxy_auto_init(struct dp_vs_service *svc);
+void dp_vs_synproxy_auto_term(struct dp_vs_service *svc);
+/* whether synproxy is on for @svc on any lcore */
+bool dp_vs_synproxy_auto_active(const struct dp_vs_service *svc);
+
+/* a handshake to @svc completed on this lcore */
+static inline void dp_vs_synproxy_auto_estab(struct dp_vs_service *svc)
+{
+    if (svc && (svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO) && svc->sp_auto)
+        svc->sp_auto[rte_lcore_id()].estab++;
+}
+
 /* synproxy(syncookies and one-minute-timer) init & cleanup */
 int dp_vs_synproxy_init(void);
 int dp_vs_synproxy_term(void);
 
+/* hold client's ack in @cp's stash until rs's syn-ack arrives */
+int dp_vs_synproxy_ack_stash(struct dp_vs_conn *cp, struct rte_mbuf *mbuf);
+/* free all acks held by @cp */
+void dp_vs_synproxy_ack_flush(struct dp_vs_conn *cp);
+
+/* syncookies of a burst of SYNs, @opts are clamped as the cookies encode */
+void dp_vs_synproxy_cookie_init_bulk(int af, struct rte_mbuf **mbufs,
+                                     struct tcphdr **ths,
+                                     struct dp_vs_synproxy_opt *opts,
+                                     uint32_t *isns, unsigned int n);
+
 /* Syn-proxy step 1 logic: receive client's Syn. */
 int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
         const struct dp_vs_iphdr *iph, int *verdict);
 
+/* Syn-proxy step 1 fast path: answer syns in a rx burst statelessly */
+uint16_t dp_vs_synproxy_syn_fast(struct rte_mbuf **mbufs, uint16_t count,
+                                 uint64_t *bytes);
+
 /* Syn-proxy step 2 logic: receive client's Ack */
 int dp_vs_synproxy_ack_rcv(int af, struct rte_mbuf *mbuf,
         struct tcphdr *th, struct dp_vs_proto *pp,
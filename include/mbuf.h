@@ -119,6 +119,15 @@ int mbuf_may_pull(struct rte_mbuf *mbuf, unsigned int len);
 struct rte_mbuf *mbuf_copy(struct rte_mbuf *md, struct rte_mempool *mp);
 void mbuf_copy_metadata(struct rte_mbuf *mi, struct rte_mbuf *m);
 
+/**
+ * mbuf_l4_csum_sw - finish in software the L4 checksum left to TX offload.
+ *
+ * @mbuf starts at L3 and @mbuf->l3_len is the offset of L4 header, as set
+ * when PKT_TX_TCP_CKSUM/PKT_TX_UDP_CKSUM was requested. it's needed where
+ * the offload can't apply, e.g., the packet is to be fragmented.
+ */
+int mbuf_l4_csum_sw(struct rte_mbuf *mbuf);
+
 #ifdef CONFIG_DPVS_MBUF_DEBUG
 inline void dp_vs_mbuf_dump(const char *msg, int af, const struct rte_mbuf *mbuf);
 #endif
@@ -0,0 +1,35 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * metrics exporter, serves the statistics region (see stats_shm.h) in
+ * Prometheus text format over HTTP on a local unix or TCP socket.
+ * it runs on master lcore and sends no msgs to workers.
+ */
+#ifndef __DPVS_METRICS_H__
+#define __DPVS_METRICS_H__
+
+int metrics_init(void);
+int metrics_term(void);
+
+/* serve scrapers, called in master lcore loop */
+int metrics_ctl(void);
+
+void metrics_keyword_value_init(void);
+void install_metrics_keywords(void);
+
+#endif /* __DPVS_METRICS_H__ */
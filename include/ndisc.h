@@ -29,4 +29,7 @@ void ndisc_send_dad(struct netif_port *dev,
 void ndisc_solicit(struct neighbour_entry *neigh,
                    const struct in6_addr *saddr);
 
+void ndisc_probe(struct neighbour_entry *neigh,
+                 const struct in6_addr *saddr);
+
 #endif /* __DPVS_NDISC_H__ */
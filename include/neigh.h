@@ -39,6 +39,7 @@
 #include <rte_ethdev.h>
 #include <rte_mempool.h>
 #include <rte_byteorder.h>
+#include <rte_atomic.h>
 
 #include "list.h"
 #include "timer.h"
@@ -50,25 +51,36 @@
 #define NEIGH_TAB_SIZE (1 << NEIGH_TAB_BITS)
 #define NEIGH_TAB_MASK (NEIGH_TAB_SIZE - 1)
 
+/*
+ * one neighbour table per numa socket, read lock-free by all lcores of the
+ * socket and written only by the owner (master) lcore. every neighbour has
+ * one replica per socket, @home is the replica carrying the state machine.
+ */
 struct neighbour_entry {
-    int                 af;
     struct list_head    neigh_list;
+    int                 af;
     union inet_addr     ip_addr;
-    struct ether_addr   eth_addr;
     struct netif_port   *port;
+    /* odd while owner is updating @eth_addr/@state, see neigh_read_hw */
+    volatile uint32_t   seq;
+    struct ether_addr   eth_addr;
+    volatile uint32_t   state;
+    uint8_t             flag;
+
+    /* written by slave lcores */
+    volatile uint64_t   confirmed __rte_cache_aligned;
+    rte_atomic16_t      req_pending;
+
+    /* owner only */
+    struct neighbour_entry *home;
+    struct neighbour_entry *replicas[DPVS_MAX_SOCKET];
     struct dpvs_timer   timer;
-    struct list_head    queue_list;
-    uint32_t            que_num;
-    uint32_t            state;
     uint32_t            ts;
-    uint8_t             flag;
+    uint64_t            probed;     /* cycles of unanswered unicast probe */
+    uint64_t            gc_expire;
+    struct list_head    gc_list;
 } __rte_cache_aligned;
 
-enum param_kind {
-    NEIGH_ENTRY,
-    NEIGH_PARAM
-};
-
 /*
  * no matter which kind of ip_addr, just use 32 bit to hash
  * since neighbour table is not a large table
@@ -80,17 +92,10 @@ static inline unsigned int neigh_hashkey(int af,
                              & NEIGH_TAB_MASK;
 }
 
-void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx);
-
 struct neighbour_entry *neigh_lookup_entry(int af, const union inet_addr *key,
                                            const struct netif_port *port,
                                            unsigned int hashkey);
 
-void neigh_send_mbuf_cach(struct neighbour_entry *neighbour);
-
-int neigh_edit(struct neighbour_entry *neighbour,
-               struct ether_addr *eth_addr);
-
 int neigh_init(void);
 
 int neigh_term(void);
@@ -104,10 +109,10 @@ int neigh_output(int af,
                  struct rte_mbuf *mbuf,
                  struct netif_port *port);
 
-struct neighbour_entry *neigh_add_table(int af, const union inet_addr *ipaddr,
-                                        const struct ether_addr *eth_addr,
-                                        struct netif_port *port,
-                                        unsigned int hashkey, int flag);
+/* learn @eth_addr of @ipaddr, may be called on any lcore */
+int neigh_update(int af, const union inet_addr *ipaddr,
+                 const struct ether_addr *eth_addr,
+                 struct netif_port *port);
 
 int neigh_gratuitous_arp(struct in_addr *src, struct netif_port *port);
 
@@ -117,7 +122,14 @@ void neigh_process_ring(void *arg);
 
 void neigh_confirm(int af, union inet_addr *nexthop, struct netif_port *port);
 
-int neigh_sync_core(const void *param, bool add_del, enum param_kind kind);
+/*
+ * keep the nexthop towards @addr resolved and refreshed, so that the
+ * fast path never waits for it. no-op unless "pin_nexthop" is on.
+ * master lcore only.
+ */
+int neigh_pin_addr(int af, const union inet_addr *addr);
+
+int neigh_unpin_addr(int af, const union inet_addr *addr);
 
 static inline void ipv6_mac_mult(const struct in6_addr *mult_target,
                                  struct ether_addr *mult_eth)
@@ -271,10 +271,18 @@ struct netif_port {
 /**************************** lcore API *******************************/
 int netif_xmit(struct rte_mbuf *mbuf, struct netif_port *dev);
 int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev);
+/*
+ * the next @npkts packets xmit by current lcore are a group, e.g., fragments
+ * of a datagram. they're put on one tx queue and sent in one burst if fits.
+ * zero to end the group early.
+ */
+void netif_xmit_group(unsigned int npkts);
 int netif_rcv(struct netif_port *dev, __be16 eth_type, struct rte_mbuf *mbuf);
 int netif_print_lcore_conf(char *buf, int *len, bool is_all, portid_t pid);
 int netif_print_lcore_queue_conf(lcoreid_t cid, char *buf, int *len, bool title);
 void netif_get_slave_lcores(uint8_t *nb, uint64_t *mask);
+/* read counters of lcore @cid without msg, may be a little stale */
+void netif_lcore_stats_read(lcoreid_t cid, struct netif_lcore_stats *stats);
 void netif_update_master_loop_cnt(void);
 // function only for init or termination //
 int netif_register_master_xmit_msg(void);
@@ -308,6 +316,8 @@ int netif_port_stop(struct netif_port *port); // stop nic
 int netif_set_mc_list(struct netif_port *port);
 int __netif_set_mc_list(struct netif_port *port);
 int netif_get_queue(struct netif_port *port, lcoreid_t id, queueid_t *qid);
+int netif_get_rxqs(struct netif_port *port, lcoreid_t cid,
+                   queueid_t *qids, int *nqids);
 int netif_get_link(struct netif_port *dev, struct rte_eth_link *link);
 int netif_get_promisc(struct netif_port *dev, bool *promisc);
 int netif_get_stats(struct netif_port *dev, struct rte_eth_stats *stats);
@@ -0,0 +1,71 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __DPVS_SIPHASH_H__
+#define __DPVS_SIPHASH_H__
+#include <stdint.h>
+
+/*
+ * SipHash-2-4 over whole 64-bit words, a keyed PRF much cheaper than
+ * MD5 for short inputs like packet tuples.
+ * See https://131002.net/siphash/ for the algorithm.
+ */
+struct siphash_key {
+    uint64_t k[2];
+};
+
+#define SIPHASH_ROL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) do { \
+    v0 += v1; v1 = SIPHASH_ROL64(v1, 13); v1 ^= v0; v0 = SIPHASH_ROL64(v0, 32); \
+    v2 += v3; v3 = SIPHASH_ROL64(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = SIPHASH_ROL64(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = SIPHASH_ROL64(v1, 17); v1 ^= v2; v2 = SIPHASH_ROL64(v2, 32); \
+} while (0)
+
+static inline uint64_t siphash_2_4(const uint64_t *in, unsigned int nwords,
+                                   const struct siphash_key *key)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key->k[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key->k[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key->k[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key->k[1];
+    uint64_t b = (uint64_t)(nwords << 3) << 56; /* message length in bytes */
+    unsigned int i;
+
+    for (i = 0; i < nwords; i++) {
+        v3 ^= in[i];
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= in[i];
+    }
+
+    v3 ^= b;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#endif /* __DPVS_SIPHASH_H__ */
@@ -0,0 +1,37 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * publish statistics into shared memory periodically, so that monitors
+ * read them (see conf/stats_shm.h) without sockopt or msgs to workers.
+ * counters are read by master lcore directly.
+ */
+#ifndef __DPVS_STATS_SHM_H__
+#define __DPVS_STATS_SHM_H__
+
+int stats_shm_init(void);
+int stats_shm_term(void);
+
+/* the region for readers in dpvs itself, NULL if disabled. it's updated
+ * by master lcore, so it's consistent when read from master lcore. */
+struct dpvs_stats_shm_hdr;
+const struct dpvs_stats_shm_hdr *stats_shm_region(void);
+
+void stats_shm_keyword_value_init(void);
+void install_stats_shm_keywords(void);
+
+#endif /* __DPVS_STATS_SHM_H__ */
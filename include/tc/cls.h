@@ -26,6 +26,7 @@
 #include "match.h"
 #ifdef __DPVS__
 #include "dpdk.h"
+#include "timer.h"
 #endif /* __DPVS__ */
 
 struct tc_cls_result {
@@ -33,15 +34,56 @@ struct tc_cls_result {
     tc_handle_t             sch_id;
 };
 
+/* action on traffic exceeding police rate */
+enum {
+    TC_POLICE_EXCEED_DROP   = 0,
+    TC_POLICE_EXCEED_MARK,              /* re-mark ipv4 dscp and pass */
+};
+
+/* police matched traffic, see linux act_police */
+struct tc_cls_police {
+    uint32_t                rate;       /* bits per-second, 0 for no police */
+    uint32_t                burst;      /* bytes */
+    uint8_t                 exceed;     /* TC_POLICE_EXCEED_XXX */
+    uint8_t                 dscp;       /* for TC_POLICE_EXCEED_MARK */
+} __attribute__((__packed__));
+
 struct tc_cls_match_copt {
     uint8_t                 proto;      /* IPPROTO_XXX */
     struct dp_vs_match      match;
     struct tc_cls_result    result;
+    struct tc_cls_police    police;
 } __attribute__((__packed__));
 
 #ifdef __DPVS__
 
 struct tc_cls;
+struct iphdr;
+
+/* headers of a packet, parsed once and shared by all classifiers */
+struct tc_cls_pkt {
+    bool                    parsed;
+    bool                    l3_trunc;   /* ipv4 header truncated */
+    bool                    l4_trunc;   /* tcp/udp header truncated */
+    uint8_t                 proto;
+    uint16_t                l3_type;    /* ETH_P_XXX, 802.1q tag skipped */
+    struct iphdr            *iph;
+    /* host byte order */
+    uint32_t                saddr;
+    uint32_t                daddr;
+    uint16_t                sport;
+    uint16_t                dport;
+};
+
+/* ipv4 traffic a classifier may match, to compile classifiers of a Qsch */
+struct tc_cls_key {
+    uint8_t                 proto;      /* 0 for any */
+    /* host byte order, full range for any */
+    uint32_t                daddr_min;
+    uint32_t                daddr_max;
+    uint16_t                dport_min;
+    uint16_t                dport_max;
+};
 
 struct tc_cls_ops {
     char                    name[TCNAMESIZ];
@@ -49,7 +91,11 @@ struct tc_cls_ops {
 
     int                     (*classify)(struct tc_cls *cls,
                                         struct rte_mbuf *mbuf,
+                                        struct tc_cls_pkt *pkt,
                                         struct tc_cls_result *result);
+    /* optional, classifier without key is tried for all packets */
+    void                    (*key)(struct tc_cls *cls,
+                                   struct tc_cls_key *key);
 
     int                     (*init)(struct tc_cls *cls, const void *arg);
     void                    (*destroy)(struct tc_cls *cls);
@@ -69,6 +115,8 @@ struct tc_cls {
     struct tc_cls_ops       *ops;
     __be16                  pkt_type;   /* ETH_P_XXX */
     int                     prio;       /* priority */
+
+    struct dpvs_timer       timer;      /* deferred free */
 };
 
 static inline void *tc_cls_priv(struct tc_cls *cls)
@@ -86,6 +134,21 @@ int tc_cls_change(struct tc_cls *cls, const void *arg);
 
 struct tc_cls *tc_cls_lookup(struct Qsch *sch, tc_handle_t handle);
 
+/* rebuild the lookup table of @sch after its classifiers changed */
+void tc_cls_compile(struct Qsch *sch);
+
+void tc_cls_table_free(struct Qsch *sch);
+
+/*
+ * classify @mbuf by classifiers of @sch in priority order, from the @pos'th
+ * one. returns TC_ACT_OK or TC_ACT_SHOT with @pos set to the classifier
+ * decided, or TC_ACT_RECLASSIFY if nothing matches. @pkt is parsed on
+ * first use, init @pkt->parsed to false for each packet.
+ */
+int tc_classify(struct Qsch *sch, struct rte_mbuf *mbuf, uint16_t pkt_type,
+                struct tc_cls_pkt *pkt, int *pos,
+                struct tc_cls_result *result);
+
 #endif /* __DPVS__ */
 
 #endif /* __DPVS_TC_CLS_H__ */
@@ -25,6 +25,7 @@
 #ifndef __DPVS_TC_SCH_H__
 #define __DPVS_TC_SCH_H__
 #include <assert.h>
+#include <linux/pkt_sched.h>
 #include "common.h"
 #ifdef __DPVS__
 #include "dpdk.h"
@@ -49,6 +50,25 @@ struct qsch_bstats {
     uint32_t                packets;
 };
 
+/* htb class options, rates are bits per-second like tbf */
+struct tc_htb_qopt {
+    struct tc_ratespec      rate;       /* guaranteed rate */
+    struct tc_ratespec      ceil;       /* max rate with borrowing */
+    uint32_t                buffer;     /* burst of rate, bytes */
+    uint32_t                cbuffer;    /* burst of ceil, bytes */
+    uint32_t                limit;      /* queue length, packets */
+    uint32_t                quantum;    /* drr quantum among classes, bytes */
+};
+
+/* fq_codel options, zero for default */
+struct tc_fq_codel_qopt {
+    uint32_t                limit;      /* packets of each lcore */
+    uint32_t                flows;      /* flow queues of each lcore */
+    uint32_t                target;     /* codel target delay, us */
+    uint32_t                interval;   /* codel interval, us */
+    uint32_t                quantum;    /* drr quantum, bytes */
+};
+
 #ifdef __DPVS__
 
 struct Qsch_ops {
@@ -70,6 +90,8 @@ struct Qsch_ops {
     rte_atomic32_t          refcnt;
 };
 
+struct tc_cls_table;
+
 /* queue scheduler, see kernel Qdisc */
 struct Qsch {
     tc_handle_t             handle;
@@ -77,6 +99,7 @@ struct Qsch {
 
     struct list_head        cls_list;   /* classifiers */
     int                     cls_cnt;
+    struct tc_cls_table     *cls_tbl;   /* compiled cls_list */
     struct hlist_node       hlist;      /* netif_tc.qsch_hash node */
     struct netif_tc         *tc;
     rte_atomic32_t          refcnt;
@@ -100,6 +100,10 @@ void tc_cls_ops_put(struct tc_cls_ops *ops);
 struct rte_mbuf *tc_handle_egress(struct netif_tc *tc,
                                   struct rte_mbuf *mbuf, int *ret);
 
+/* classify and police a received burst, return number of mbufs left */
+uint16_t tc_handle_ingress(struct netif_tc *tc,
+                           struct rte_mbuf **mbufs, uint16_t count);
+
 static inline int64_t tc_get_ns(void)
 {
     struct timespec ts;
@@ -48,6 +48,16 @@ struct dpvs_timer {
      * 'interval' for periodic timer.
      */
     dpvs_tick_t         delay;
+    /* tick it's due, locates the wheel slot */
+    dpvs_tick_t         expire;
+};
+
+/* expiry statistics of a timer scheduler (lcore) */
+struct dpvs_timer_stats {
+    uint64_t            expired;        /* timers expired */
+    uint64_t            deferred;       /* timers expired later than due */
+    uint64_t            budget_hits;    /* ticks run out of expire budget */
+    uint64_t            max_latency;    /* max ticks (ms) from due to expired */
 };
 
 int dpvs_timer_init(void);
@@ -60,7 +70,8 @@ int dpvs_timer_term(void);
  * all the time, DO NOT mix up.
  *
  * NOTE: any lcore (including master and slaves) can use global timer,
- * but only slaves can use per-lcore timer.
+ * but only slaves can use per-lcore timer. per-lcore timer is lockless,
+ * it must be operated by the lcore scheduled it, others send msg to it.
  */
 int dpvs_time_now(struct timeval *now, bool global);
 
@@ -88,6 +99,9 @@ int dpvs_timer_update(struct dpvs_timer *timer,
 
 void dpvs_time_rand_delay(struct timeval *tv, long delay_us);
 
+/* @cid is master lcore for global timer */
+int dpvs_timer_stats_get(unsigned int cid, struct dpvs_timer_stats *stats);
+
 /* config file */
 int dpvs_timer_sched_interval_get(void);
 void timer_keyword_value_init(void);
@@ -28,11 +28,14 @@
 #include "ipv4_frag.h"
 #include "ipv6.h"
 #include "ctrl.h"
+#include "stats_shm.h"
+#include "metrics.h"
 #include "sa_pool.h"
 #include "ipvs/conn.h"
 #include "ipvs/proto_tcp.h"
 #include "ipvs/proto_udp.h"
 #include "ipvs/synproxy.h"
+#include "ipvs/quic.h"
 
 typedef void (*sighandler_t)(int);
 
@@ -48,8 +51,11 @@ static void keyword_value_init(void)
     ip4_frag_keyword_value_init();
 
     control_keyword_value_init();
+    stats_shm_keyword_value_init();
+    metrics_keyword_value_init();
     ipvs_conn_keyword_value_init();
     udp_keyword_value_init();
+    quic_lb_keyword_value_init();
     tcp_keyword_value_init();
     synproxy_keyword_value_init();
 
@@ -71,6 +77,8 @@ static vector_t install_keywords(void)
     install_ip4_frag_keywords();
 
     install_control_keywords();
+    install_stats_shm_keywords();
+    install_metrics_keywords();
 
     install_keyword_root("ipvs_defs", NULL);
     install_keyword("conn", NULL, KW_TYPE_NORMAL);
@@ -85,6 +93,7 @@ static vector_t install_keywords(void)
     install_keyword("udp", NULL, KW_TYPE_NORMAL);
     install_sublevel();
     install_proto_udp_keywords();
+    install_quic_lb_keywords();
     install_sublevel_end();
 
     install_ipv6_keywords();
@@ -66,6 +66,7 @@ const char *dpvs_strerror(int err)
         { EDPVS_PKTSTOLEN,      "stolen packet"},
         { EDPVS_SYSCALL,        "system call failed"},
         { EDPVS_NODEV,          "no such device"},
+        { EDPVS_ABORTED,        "aborted"},
 
         { EDPVS_KNICONTINUE,    "kni to continue"},
         { EDPVS_INPROGRESS,     "in progress"},
@@ -23,7 +23,9 @@
 #include <string.h>
 #include <assert.h>
 #include "ctrl.h"
+#include "conf/bulk.h"
 #include "netif.h"
+#include "ipvs/service.h"
 #include "parser/parser.h"
 
 /////////////////////////////////// lcore  msg ///////////////////////////////////////////
@@ -72,6 +74,37 @@ struct multicast_wait_list mc_wait_list;
 /* per-lcore msg queue */
 struct rte_ring *msg_ring[DPVS_MAX_LCORE];
 
+/* per-lcore async msgs waiting for completion */
+#define DPVS_MSG_ASYNC_TIMEOUT_US 1000000
+static struct list_head msg_pending[DPVS_MAX_LCORE];
+static bool msg_completing[DPVS_MAX_LCORE];
+
+/* msg batches (Master lcore only) */
+#define DPVS_MSG_BATCH_OPS_MAX  256
+#define DPVS_MSG_BATCH_DELAY_US 1000
+static struct list_head msg_batch_list;
+/* async batch msgs in mc_wait_list, at most half of it */
+static uint32_t msg_batch_inflight;
+static void msg_batch_flush_all(void);
+
+/*
+ * ops of all batches added within a transaction are kept as records in
+ * one MSG_TYPE_BATCH_TXN msg, so slaves apply them in a single pass.
+ */
+struct msg_txn_rec {
+    msgid_t type;
+    uint32_t oplen;
+    char op[0];
+};
+#define MSG_TXN_REC_LEN(oplen)  RTE_ALIGN(sizeof(struct msg_txn_rec) + (oplen), 8)
+#define MSG_TXN_BUF_INIT        4096
+static bool msg_txn_open;
+static char *msg_txn_buf;
+static uint32_t msg_txn_len;
+static uint32_t msg_txn_size;
+static uint32_t msg_txn_seq;
+static int msg_txn_flush(void);
+
 static inline int mt_hashkey(msgid_t type)
 {
     return type & DPVS_MSG_MASK;
@@ -286,8 +319,9 @@ struct dpvs_msg* msg_make(msgid_t type, uint32_t seq,
     msg->mode = mode;
     msg->cid = cid;
     msg->len = len;
-    if (len)
+    if (len && data)
         memcpy(msg->data, data, len);
+    INIT_LIST_HEAD(&msg->pend_node);
     assert(0 == flags);
 
     rte_atomic16_init(&msg->refcnt);
@@ -433,6 +467,18 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
         return EDPVS_INVAL;
     }
 
+    /*
+     * pending batched ops were added before, don't overtake them. so are
+     * ops collected by an open txn, they go first in a txn msg of their own.
+     */
+    if (!test_msg_flags(msg, DPVS_MSG_F_BATCH)) {
+        if (msg_txn_open && msg_txn_len && msg->type != MSG_TYPE_BATCH_TXN &&
+            msg_txn_flush() != EDPVS_OK)
+            RTE_LOG(WARNING, MSGMGR, "%s: fail to send ops of the open txn\n",
+                    __func__);
+        msg_batch_flush_all();
+    }
+
     /* multicast msg of identical type and seq cannot coexist */
     if (unlikely(mc_queue_get(msg->type, msg->seq) != NULL)) {
         RTE_LOG(WARNING, MSGMGR, "%s: repeated sequence number for multicast msg: "
@@ -442,6 +488,23 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
         return EDPVS_INVAL;
     }
 
+    /* check wait queue before any slave gets the msg */
+    if (mc_wait_list.free_cnt <= 0) {
+        RTE_LOG(WARNING, MSGMGR, "%s: multicast msg wait queue full, "
+                "msg dropped and try later...\n", __func__);
+        add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
+        msg->mode = DPVS_MSG_UNICAST; /* do not free msg queue */
+        return EDPVS_MSG_DROP;
+    }
+
+    mc_msg = rte_zmalloc("mc_msg", sizeof(struct dpvs_multicast_queue), RTE_CACHE_LINE_SIZE);
+    if (unlikely(!mc_msg)) {
+        RTE_LOG(ERR, MSGMGR, "%s: no memory\n", __func__);
+        add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
+        msg->mode = DPVS_MSG_UNICAST; /* do not free msg queue */
+        return EDPVS_NOMEM;
+    }
+
     /* send unicast msgs from master to all alive slaves */
     rte_atomic16_inc(&msg->refcnt); /* refcnt increase by 1 for itself */
     for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
@@ -451,16 +514,19 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
                 RTE_LOG(ERR, MSGMGR, "%s: msg make fail\n", __func__);
                 add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
                 rte_atomic16_dec(&msg->refcnt); /* decrease refcnt by 1 manually */
+                rte_free(mc_msg);
                 return EDPVS_NOMEM;
             }
+            add_msg_flags(new_msg, get_msg_flags(msg) & DPVS_MSG_F_BATCH);
 
-            /* must send F_ASYNC msg as mc_msg has not allocated */
+            /* must send F_ASYNC msg as mc_msg has not queued */
             ret = msg_send(new_msg, ii, DPVS_MSG_F_ASYNC, NULL);
             if (ret < 0) { /* nonblock msg not equeued */
                 RTE_LOG(ERR, MSGMGR, "%s: msg send fail\n", __func__);
                 add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
                 rte_atomic16_dec(&msg->refcnt); /* decrease refcnt by 1 manually */
                 msg_destroy(&new_msg);
+                rte_free(mc_msg);
                 return ret;
             }
             msg_destroy(&new_msg);
@@ -468,25 +534,12 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
         }
     }
 
-    mc_msg = rte_zmalloc("mc_msg", sizeof(struct dpvs_multicast_queue), RTE_CACHE_LINE_SIZE);
-    if (unlikely(!mc_msg)) {
-        RTE_LOG(ERR, MSGMGR, "%s: no memory\n", __func__);
-        add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
-        return EDPVS_NOMEM;
-    }
-
     mc_msg->type = msg->type;
     mc_msg->seq = msg->seq;
     mc_msg->mask = slave_lcore_mask;
     mc_msg->org_msg = msg; /* save original msg */
     INIT_LIST_HEAD(&mc_msg->mq);
 
-    if (mc_wait_list.free_cnt <= 0) {
-        RTE_LOG(WARNING, MSGMGR, "%s: multicast msg wait queue full, "
-                "msg dropped and try later...\n", __func__);
-        add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
-        return EDPVS_MSG_DROP;
-    }
     list_add_tail(&mc_msg->list, &mc_wait_list.list);
     --mc_wait_list.free_cnt;
 
@@ -519,6 +572,324 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
         return EDPVS_MSG_DROP;
 }
 
+static void msg_pend(struct dpvs_msg *msg, MSG_COMPLETE_CB cb, void *priv)
+{
+    msg->complete = cb;
+    msg->priv = priv;
+    msg->deadline = rte_get_timer_cycles() +
+        (uint64_t)DPVS_MSG_ASYNC_TIMEOUT_US * rte_get_timer_hz() / 1E6;
+    list_add_tail(&msg->pend_node, &msg_pending[rte_lcore_id()]);
+}
+
+/* "msg" must be produced by "msg_make", @cb is not called if send fails */
+int msg_send_async(struct dpvs_msg *msg, lcoreid_t cid,
+                   MSG_COMPLETE_CB cb, void *priv)
+{
+    int err;
+
+    if (unlikely(!msg))
+        return EDPVS_INVAL;
+
+    err = msg_send(msg, cid, DPVS_MSG_F_ASYNC, NULL);
+    if (err != EDPVS_OK) {
+        msg_destroy(&msg);
+        return err;
+    }
+
+    msg_pend(msg, cb, priv);
+    return EDPVS_OK;
+}
+
+/* "msg" must be produced by "msg_make", @cb is not called if send fails */
+int multicast_msg_send_async(struct dpvs_msg *msg,
+                             MSG_COMPLETE_CB cb, void *priv)
+{
+    int err;
+
+    if (unlikely(!msg))
+        return EDPVS_INVAL;
+
+    err = multicast_msg_send(msg, DPVS_MSG_F_ASYNC, NULL);
+    if (err != EDPVS_OK) {
+        msg_destroy(&msg);
+        return err;
+    }
+
+    msg_pend(msg, cb, priv);
+    return EDPVS_OK;
+}
+
+/* call back async msgs of this lcore finished, dropped or timeout */
+static void msg_complete_pending(lcoreid_t cid)
+{
+    struct dpvs_msg *msg, *next;
+    uint32_t flags;
+    uint64_t now;
+    int err;
+
+    /* callback may send blockable msg, which processes msg again */
+    if (list_empty(&msg_pending[cid]) || msg_completing[cid])
+        return;
+    msg_completing[cid] = true;
+
+    now = rte_get_timer_cycles();
+    list_for_each_entry_safe(msg, next, &msg_pending[cid], pend_node) {
+        flags = get_msg_flags(msg);
+        if ((flags & DPVS_MSG_F_CALLBACK_FAIL) && (flags & DPVS_MSG_F_STATE_FIN))
+            err = EDPVS_MSG_FAIL;
+        else if (flags & DPVS_MSG_F_STATE_FIN)
+            err = EDPVS_OK;
+        else if (flags & DPVS_MSG_F_STATE_DROP)
+            err = EDPVS_MSG_DROP;
+        else if (now > msg->deadline) {
+            RTE_LOG(WARNING, MSGMGR, "%s: async msg(type:%d, seq:%d, cid:%d) "
+                    "timeout(%d us), drop...\n", __func__, msg->type, msg->seq,
+                    cid, DPVS_MSG_ASYNC_TIMEOUT_US);
+            add_msg_flags(msg, DPVS_MSG_F_TIMEOUT);
+            err = EDPVS_MSG_DROP;
+        } else
+            continue;
+
+        list_del_init(&msg->pend_node);
+        if (msg->complete)
+            msg->complete(msg, err);
+        msg_destroy(&msg);
+    }
+
+    msg_completing[cid] = false;
+}
+
+int msg_batch_register(struct dpvs_msg_batch *batch)
+{
+    if (unlikely(!batch || !batch->oplen))
+        return EDPVS_INVAL;
+
+    batch->seq = 0;
+    batch->nops = 0;
+    batch->msg = NULL;
+    list_add_tail(&batch->list, &msg_batch_list);
+
+    return EDPVS_OK;
+}
+
+int msg_batch_unregister(struct dpvs_msg_batch *batch)
+{
+    int err;
+
+    if (unlikely(!batch))
+        return EDPVS_INVAL;
+
+    err = msg_batch_flush(batch);
+    list_del_init(&batch->list);
+
+    return err;
+}
+
+static void msg_batch_complete(struct dpvs_msg *msg, int err)
+{
+    struct dpvs_msg_batch *batch = msg->priv;
+
+    if (batch->complete) {
+        batch->complete(msg, err);
+        return;
+    }
+
+    if (err != EDPVS_OK)
+        RTE_LOG(WARNING, MSGMGR, "%s: batch msg<type=%d, seq=%d> of %u ops: %s\n",
+                __func__, msg->type, msg->seq, msg_nops(msg), dpvs_strerror(err));
+}
+
+static void msg_batch_complete_async(struct dpvs_msg *msg, int err)
+{
+    msg_batch_inflight--;
+    msg_batch_complete(msg, err);
+}
+
+int msg_batch_flush(struct dpvs_msg_batch *batch)
+{
+    struct dpvs_msg *msg = batch->msg;
+    struct dpvs_msg_ops *mops;
+    int err;
+
+    if (!batch->nops)
+        return EDPVS_OK;
+
+    mops = (struct dpvs_msg_ops *)msg->data;
+    mops->nops = batch->nops;
+    msg->len = sizeof(*mops) + batch->nops * batch->oplen;
+    msg->seq = batch->seq++;
+
+    batch->msg = NULL;
+    batch->nops = 0;
+
+    if (!slave_lcore_mask) {
+        msg->mode = DPVS_MSG_UNICAST; /* not queued */
+        msg_destroy(&msg);
+        return EDPVS_OK;
+    }
+
+    /* too many in flight, wait for this one to leave room for others */
+    if (msg_batch_inflight >= msg_mc_qlen / 2) {
+        msg->priv = batch;
+        err = multicast_msg_send(msg, 0, NULL);
+        msg_batch_complete(msg, err);
+        msg_destroy(&msg);
+        return EDPVS_OK; /* result goes to complete, as async does */
+    }
+
+    err = multicast_msg_send_async(msg, msg_batch_complete_async, batch);
+    if (err == EDPVS_OK)
+        msg_batch_inflight++;
+
+    return err;
+}
+
+static int msg_txn_append(struct dpvs_msg_batch *batch, const void *op)
+{
+    struct msg_txn_rec *rec;
+    uint32_t size;
+    char *buf;
+
+    size = msg_txn_size ? msg_txn_size : MSG_TXN_BUF_INIT;
+    while (msg_txn_len + MSG_TXN_REC_LEN(batch->oplen) > size)
+        size <<= 1;
+
+    if (size != msg_txn_size) {
+        buf = rte_realloc(msg_txn_buf, size, 0);
+        if (unlikely(!buf))
+            return EDPVS_NOMEM;
+        msg_txn_buf = buf;
+        msg_txn_size = size;
+    }
+
+    rec = (struct msg_txn_rec *)(msg_txn_buf + msg_txn_len);
+    rec->type = batch->type;
+    rec->oplen = batch->oplen;
+    memcpy(rec->op, op, batch->oplen);
+    msg_txn_len += MSG_TXN_REC_LEN(batch->oplen);
+
+    return EDPVS_OK;
+}
+
+int msg_batch_add(struct dpvs_msg_batch *batch, const void *op)
+{
+    struct dpvs_msg_batch *other;
+    struct dpvs_msg_ops *mops;
+
+    if (unlikely(rte_lcore_id() != master_lcore))
+        return EDPVS_NOTSUPP;
+
+    if (msg_txn_open)
+        return msg_txn_append(batch, op);
+
+    /* ops of all batches are applied in order of adding */
+    list_for_each_entry(other, &msg_batch_list, list) {
+        if (other != batch && other->nops)
+            msg_batch_flush(other);
+    }
+
+    if (!batch->msg) {
+        batch->msg = msg_make(batch->type, 0, DPVS_MSG_MULTICAST, master_lcore,
+                              sizeof(*mops) + DPVS_MSG_BATCH_OPS_MAX * batch->oplen,
+                              NULL);
+        if (unlikely(!batch->msg))
+            return EDPVS_NOMEM;
+        add_msg_flags(batch->msg, DPVS_MSG_F_BATCH);
+        mops = (struct dpvs_msg_ops *)batch->msg->data;
+        mops->oplen = batch->oplen;
+    }
+
+    mops = (struct dpvs_msg_ops *)batch->msg->data;
+    if (!batch->nops)
+        batch->since = rte_get_timer_cycles();
+    memcpy(mops->ops + batch->nops * batch->oplen, op, batch->oplen);
+
+    if (++batch->nops >= DPVS_MSG_BATCH_OPS_MAX)
+        return msg_batch_flush(batch);
+
+    return EDPVS_OK;
+}
+
+static void msg_batch_flush_all(void)
+{
+    struct dpvs_msg_batch *batch;
+
+    list_for_each_entry(batch, &msg_batch_list, list) {
+        if (batch->nops)
+            msg_batch_flush(batch);
+    }
+}
+
+static void msg_batch_flush_expired(void)
+{
+    struct dpvs_msg_batch *batch;
+    uint64_t now, delay;
+
+    now = rte_get_timer_cycles();
+    delay = (uint64_t)DPVS_MSG_BATCH_DELAY_US * rte_get_timer_hz() / 1E6;
+
+    list_for_each_entry(batch, &msg_batch_list, list) {
+        if (batch->nops && now - batch->since >= delay)
+            msg_batch_flush(batch);
+    }
+}
+
+int msg_batch_begin(void)
+{
+    if (unlikely(rte_lcore_id() != master_lcore))
+        return EDPVS_NOTSUPP;
+    if (unlikely(msg_txn_open))
+        return EDPVS_BUSY;
+
+    /* ops added before go to slaves first */
+    msg_batch_flush_all();
+
+    msg_txn_len = 0;
+    msg_txn_open = true;
+
+    return EDPVS_OK;
+}
+
+bool msg_batch_in_txn(void)
+{
+    return msg_txn_open;
+}
+
+static void msg_txn_complete(struct dpvs_msg *msg, int err)
+{
+    if (err != EDPVS_OK)
+        RTE_LOG(WARNING, MSGMGR, "%s: txn msg<seq=%d> of %u bytes: %s\n",
+                __func__, msg->seq, msg->len, dpvs_strerror(err));
+}
+
+/* send ops collected so far, the txn stays open if it is */
+static int msg_txn_flush(void)
+{
+    struct dpvs_msg *msg;
+
+    if (!msg_txn_len || !slave_lcore_mask) {
+        msg_txn_len = 0;
+        return EDPVS_OK;
+    }
+
+    msg = msg_make(MSG_TYPE_BATCH_TXN, msg_txn_seq++, DPVS_MSG_MULTICAST,
+                   master_lcore, msg_txn_len, msg_txn_buf);
+    msg_txn_len = 0;
+    if (unlikely(!msg))
+        return EDPVS_NOMEM;
+
+    return multicast_msg_send_async(msg, msg_txn_complete, NULL);
+}
+
+int msg_batch_commit(void)
+{
+    if (unlikely(!msg_txn_open))
+        return EDPVS_INVAL;
+    msg_txn_open = false;
+
+    return msg_txn_flush();
+}
+
 /* both unicast msg and multicast msg can be recieved on Master lcore */
 int msg_master_process(void)
 {
@@ -601,6 +972,10 @@ int msg_master_process(void)
         }
         msg_type_put(msg_type);
     }
+
+    msg_batch_flush_expired();
+    msg_complete_pending(master_lcore);
+
     return EDPVS_OK;
 }
 
@@ -668,6 +1043,8 @@ cont:
         msg_type_put(msg_type);
     }
 
+    msg_complete_pending(cid);
+
     return ret;
 }
 
@@ -753,6 +1130,67 @@ static int msg_type_unreg_cb(struct dpvs_msg *msg)
     return EDPVS_OK;
 }
 
+/* apply ops of a txn, consecutive ops of a msg type as one batch msg */
+static int msg_txn_cb(struct dpvs_msg *msg)
+{
+    struct dpvs_msg_type *mt;
+    struct dpvs_msg_ops *mops;
+    struct dpvs_msg *run;
+    struct msg_txn_rec *rec;
+    char *pos = msg->data, *end = msg->data + msg->len;
+    int err = EDPVS_OK;
+
+    /* records are never shorter than ops */
+    run = rte_zmalloc("msg_txn", sizeof(*run) + sizeof(*mops) + msg->len, 0);
+    if (unlikely(!run))
+        return EDPVS_NOMEM;
+
+    rte_spinlock_init(&run->lock);
+    run->seq = msg->seq;
+    run->mode = DPVS_MSG_UNICAST;
+    run->cid = msg->cid;
+    INIT_LIST_HEAD(&run->pend_node);
+    add_msg_flags(run, DPVS_MSG_F_BATCH);
+    mops = (struct dpvs_msg_ops *)run->data;
+
+    while (pos < end) {
+        rec = (struct msg_txn_rec *)pos;
+        run->type = rec->type;
+        mops->oplen = rec->oplen;
+        mops->nops = 0;
+
+        while (pos < end && rec->type == run->type) {
+            memcpy(mops->ops + mops->nops * mops->oplen, rec->op, rec->oplen);
+            mops->nops++;
+            pos += MSG_TXN_REC_LEN(rec->oplen);
+            rec = (struct msg_txn_rec *)pos;
+        }
+        run->len = sizeof(*mops) + mops->nops * mops->oplen;
+
+        mt = msg_type_get(run->type, rte_lcore_id());
+        if (unlikely(!mt || !mt->unicast_msg_cb)) {
+            RTE_LOG(WARNING, MSGMGR, "%s: no handler of msg type %d for txn\n",
+                    __func__, run->type);
+            msg_type_put(mt);
+            err = EDPVS_NOTEXIST;
+            continue;
+        }
+
+        if (mt->unicast_msg_cb(run) != EDPVS_OK)
+            err = EDPVS_MSG_FAIL;
+        msg_type_put(mt);
+
+        if (run->reply.data) {
+            rte_free(run->reply.data);
+            run->reply.data = NULL;
+            run->reply.len = 0;
+        }
+    }
+
+    rte_free(run);
+    return err;
+}
+
 static int register_built_in_msg(void)
 {
     int ii, tret, ret = EDPVS_OK;
@@ -790,6 +1228,15 @@ static int register_built_in_msg(void)
         }
     }
 
+    /* transaction of batched ops on all slave lcores */
+    memset(&mt, 0, sizeof(mt));
+    mt.type = MSG_TYPE_BATCH_TXN;
+    mt.unicast_msg_cb = msg_txn_cb;
+    if (unlikely((tret = msg_type_mc_register(&mt)) < 0)) {
+        RTE_LOG(WARNING, MSGMGR, "%s: fail to register batch-txn msg\n", __func__);
+        ret = tret;
+    }
+
     /* master_xmit_msg msg-type on all slave lcores */
     if (unlikely(tret = netif_register_master_xmit_msg()))
         ret = tret;
@@ -833,6 +1280,15 @@ static int unregister_built_in_msg(void)
         }
     }
 
+    /* batch-txn msg-type */
+    memset(&mt, 0, sizeof(mt));
+    mt.type = MSG_TYPE_BATCH_TXN;
+    mt.unicast_msg_cb = msg_txn_cb;
+    if (unlikely((tret = msg_type_mc_unregister(&mt)) < 0)) {
+        RTE_LOG(WARNING, MSGMGR, "%s: fail to unregister batch-txn msg\n", __func__);
+        ret = tret;
+    }
+
     return ret;
 }
 
@@ -870,6 +1326,12 @@ static inline int msg_init(void)
     mc_wait_list.free_cnt = msg_mc_qlen;
     INIT_LIST_HEAD(&mc_wait_list.list);
 
+    for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
+        INIT_LIST_HEAD(&msg_pending[ii]);
+        msg_completing[ii] = false;
+    }
+    INIT_LIST_HEAD(&msg_batch_list);
+
     /* per-lcore msg queue */
     for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
         snprintf(ring_name, sizeof(ring_name), "msg_ring_%d", ii);
@@ -916,6 +1378,10 @@ static inline int msg_term(void)
     /* unregister built-in msg type */
     unregister_built_in_msg();
 
+    rte_free(msg_txn_buf);
+    msg_txn_buf = NULL;
+    msg_txn_size = 0;
+
     return EDPVS_OK;
 }
 
@@ -1030,6 +1496,285 @@ int sockopt_unregister(struct dpvs_sockopts *sockopts)
     return EDPVS_NOTEXIST;
 }
 
+static struct dpvs_sockopts *sockopts_get_set(sockoptid_t opt)
+{
+    struct dpvs_sockopts *skopt;
+
+    list_for_each_entry(skopt, &sockopt_list, list) {
+        if (skopt->set && judge_id_betw(opt, skopt->set_opt_min, skopt->set_opt_max))
+            return skopt;
+    }
+    return NULL;
+}
+
+static struct dpvs_sockopts *sockopts_get_get(sockoptid_t opt)
+{
+    struct dpvs_sockopts *skopt;
+
+    list_for_each_entry(skopt, &sockopt_list, list) {
+        if (skopt->get && judge_id_betw(opt, skopt->get_opt_min, skopt->get_opt_max))
+            return skopt;
+    }
+    return NULL;
+}
+
+static inline sockoptid_t sockopt_set_undo(struct dpvs_sockopts *skopt,
+                                           sockoptid_t opt)
+{
+    return skopt->set_undo ? skopt->set_undo(opt) : 0;
+}
+
+/*
+ * apply set sockopts of a bulk in order. items are only checked to be
+ * well-formed and to have a set (and undo in atomic mode) handler before
+ * any is applied, the content of an item is checked by its handler when
+ * it's applied. an atomic bulk rolls back items applied before the one
+ * failed, so an item that changed nothing must fail (e.g., EDPVS_EXIST),
+ * unless it's DPVS_BULK_ITEM_F_OPTIONAL.
+ * ops multicast to slaves are sent in one txn, so each slave sees all or
+ * none of the bulk. if all items are of sockopts with set_undo (so none
+ * sends sync msgs to slaves), the svc write lock is held while they are
+ * applied and rolled back, workers see the services, dests and laddrs
+ * before or after the bulk only. otherwise these are changed item by item.
+ */
+static int bulk_sockopt_apply(const void *in, size_t inlen,
+                              void **out, size_t *outlen)
+{
+    const struct dp_vs_bulk_conf *conf = in;
+    const struct dp_vs_bulk_item *item, **items = NULL;
+    struct dpvs_sockopts **skopts = NULL;
+    struct dp_vs_bulk_result *res;
+    sockoptid_t undo;
+    size_t off, size;
+    bool atomic, locked = true, bad = false;
+    int i, j, err;
+
+    if (!conf || inlen < sizeof(*conf) || !out || !outlen)
+        return EDPVS_INVAL;
+    if (conf->nitem > (inlen - sizeof(*conf)) / sizeof(*item))
+        return EDPVS_INVAL;
+    atomic = !!(conf->flags & DPVS_BULK_F_ATOMIC);
+
+    size = sizeof(*res) + conf->nitem * sizeof(int);
+    res = rte_zmalloc("bulk_result", size, 0);
+    if (unlikely(!res))
+        return EDPVS_NOMEM;
+    res->nitem = conf->nitem;
+    if (!conf->nitem)
+        goto out;
+
+    items = rte_zmalloc(NULL, conf->nitem * sizeof(*items), 0);
+    skopts = rte_zmalloc(NULL, conf->nitem * sizeof(*skopts), 0);
+    if (unlikely(!items || !skopts)) {
+        err = EDPVS_NOMEM;
+        goto errout;
+    }
+
+    /* check items are well-formed and supported before applying any */
+    off = sizeof(*conf);
+    for (i = 0; i < conf->nitem; i++) {
+        item = (const struct dp_vs_bulk_item *)((const char *)in + off);
+        if (inlen - off < sizeof(*item) ||
+            inlen - off - sizeof(*item) < item->len) {
+            for (j = i; j < conf->nitem; j++)
+                res->results[j] = EDPVS_INVAL;
+            bad = true;
+            break;
+        }
+        off = RTE_MIN(off + DPVS_BULK_ALIGN(sizeof(*item) + item->len), inlen);
+
+        items[i] = item;
+        skopts[i] = sockopts_get_set(item->opt);
+        if (!skopts[i] || (atomic && !sockopt_set_undo(skopts[i], item->opt))) {
+            res->results[i] = EDPVS_NOTSUPP;
+            bad = true;
+            continue;
+        }
+        if (!skopts[i]->set_undo)
+            locked = false;
+    }
+
+    if (bad) {
+        for (i = 0; i < conf->nitem; i++) {
+            if (res->results[i] == EDPVS_OK)
+                res->results[i] = EDPVS_ABORTED;
+        }
+        goto out;
+    }
+
+    err = msg_batch_begin();
+    if (err != EDPVS_OK)
+        goto errout;
+    if (locked)
+        dp_vs_svc_bulk_lock();
+
+    for (i = 0; i < conf->nitem; i++) {
+        res->results[i] = skopts[i]->set(items[i]->opt, items[i]->data,
+                                         items[i]->len);
+        if (res->results[i] == EDPVS_OK) {
+            res->napplied++;
+            continue;
+        }
+        if (!atomic || (items[i]->flags & DPVS_BULK_ITEM_F_OPTIONAL))
+            continue;
+
+        for (j = i - 1; j >= 0; j--) {
+            if (res->results[j] != EDPVS_OK)
+                continue; /* optional one not applied */
+            undo = sockopt_set_undo(skopts[j], items[j]->opt);
+            err = skopts[j]->set(undo, items[j]->data, items[j]->len);
+            if (err != EDPVS_OK) {
+                RTE_LOG(ERR, MSGMGR, "%s: fail to roll back item %d (opt %u): %s\n",
+                        __func__, j, items[j]->opt, dpvs_strerror(err));
+                continue;
+            }
+            res->results[j] = EDPVS_ABORTED;
+            res->napplied--;
+        }
+        for (j = i + 1; j < conf->nitem; j++)
+            res->results[j] = EDPVS_ABORTED;
+        break;
+    }
+
+    if (locked)
+        dp_vs_svc_bulk_unlock();
+    err = msg_batch_commit();
+    if (err != EDPVS_OK)
+        RTE_LOG(WARNING, MSGMGR, "%s: fail to send bulk to slaves: %s\n",
+                __func__, dpvs_strerror(err));
+
+out:
+    rte_free(items);
+    rte_free(skopts);
+    *out = res;
+    *outlen = size;
+    return EDPVS_OK;
+
+errout:
+    rte_free(items);
+    rte_free(skopts);
+    rte_free(res);
+    return err;
+}
+
+/*
+ * call get sockopts of a bulk in order, e.g., to fetch the dests and
+ * laddrs of all services in one request. an item failed doesn't stop
+ * the others, its reply has the error and no data.
+ */
+static int bulk_sockopt_get_get(const void *in, size_t inlen,
+                                void **out, size_t *outlen)
+{
+    const struct dp_vs_bulk_conf *conf = in;
+    const struct dp_vs_bulk_item *item;
+    struct dp_vs_bulk_replies *res = NULL;
+    struct dp_vs_bulk_reply *rep;
+    struct dpvs_sockopts *skopt;
+    void **outs = NULL;
+    size_t *lens = NULL;
+    int *results = NULL;
+    size_t off, size;
+    int i, err = EDPVS_OK;
+
+    if (!conf || inlen < sizeof(*conf) || !out || !outlen)
+        return EDPVS_INVAL;
+    if (conf->nitem > (inlen - sizeof(*conf)) / sizeof(*item))
+        return EDPVS_INVAL;
+
+    size = sizeof(*res);
+    if (conf->nitem) {
+        outs = rte_zmalloc(NULL, conf->nitem * sizeof(*outs), 0);
+        lens = rte_zmalloc(NULL, conf->nitem * sizeof(*lens), 0);
+        results = rte_zmalloc(NULL, conf->nitem * sizeof(*results), 0);
+        if (unlikely(!outs || !lens || !results)) {
+            err = EDPVS_NOMEM;
+            goto out;
+        }
+    }
+
+    off = sizeof(*conf);
+    for (i = 0; i < conf->nitem; i++) {
+        item = (const struct dp_vs_bulk_item *)((const char *)in + off);
+        if (inlen - off < sizeof(*item) ||
+            inlen - off - sizeof(*item) < item->len) {
+            for (; i < conf->nitem; i++) {
+                results[i] = EDPVS_INVAL;
+                size += DPVS_BULK_ALIGN(sizeof(*rep));
+            }
+            break;
+        }
+        off = RTE_MIN(off + DPVS_BULK_ALIGN(sizeof(*item) + item->len), inlen);
+
+        skopt = sockopts_get_get(item->opt);
+        if (!skopt || judge_id_betw(item->opt, SOCKOPT_GET_BULK_APPLY,
+                                    SOCKOPT_GET_BULK_GET)) {
+            results[i] = EDPVS_NOTSUPP;
+        } else {
+            results[i] = skopt->get(item->opt, item->data, item->len,
+                                    &outs[i], &lens[i]);
+            /* the callback frees its output when it fails */
+            if (results[i] != EDPVS_OK || !outs[i]) {
+                outs[i] = NULL;
+                lens[i] = 0;
+            }
+        }
+        size += DPVS_BULK_ALIGN(sizeof(*rep) + lens[i]);
+    }
+
+    res = rte_zmalloc("bulk_replies", size, 0);
+    if (unlikely(!res)) {
+        err = EDPVS_NOMEM;
+        goto out;
+    }
+    res->nitem = conf->nitem;
+
+    off = sizeof(*res);
+    for (i = 0; i < conf->nitem; i++) {
+        rep = (struct dp_vs_bulk_reply *)((char *)res + off);
+        rep->result = results[i];
+        rep->len = lens[i];
+        if (lens[i])
+            memcpy(rep->data, outs[i], lens[i]);
+        off += DPVS_BULK_ALIGN(sizeof(*rep) + lens[i]);
+    }
+
+out:
+    for (i = 0; outs && i < conf->nitem; i++)
+        rte_free(outs[i]);
+    rte_free(outs);
+    rte_free(lens);
+    rte_free(results);
+    if (err != EDPVS_OK)
+        return err;
+
+    *out = res;
+    *outlen = size;
+    return EDPVS_OK;
+}
+
+static int bulk_sockopt_get(sockoptid_t opt, const void *in, size_t inlen,
+                            void **out, size_t *outlen)
+{
+    switch (opt) {
+    case SOCKOPT_GET_BULK_APPLY:
+        return bulk_sockopt_apply(in, inlen, out, outlen);
+    case SOCKOPT_GET_BULK_GET:
+        return bulk_sockopt_get_get(in, inlen, out, outlen);
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static struct dpvs_sockopts bulk_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_GET_BULK_APPLY,
+    .set_opt_max    = SOCKOPT_GET_BULK_APPLY,
+    .set            = NULL,
+    .get_opt_min    = SOCKOPT_GET_BULK_APPLY,
+    .get_opt_max    = SOCKOPT_GET_BULK_GET,
+    .get            = bulk_sockopt_get,
+};
+
 static inline int sockopt_msg_recv(int clt_fd, struct dpvs_sock_msg **pmsg)
 {
     struct dpvs_sock_msg msg_hdr;
@@ -1151,9 +1896,11 @@ int sockopt_ctl(__rte_unused void *arg)
     skopt = sockopts_get(msg);
     if (skopt) {
         if (msg->type == SOCKOPT_GET)
-            ret = skopt->get(msg->id, msg->data, msg->len, &reply_data, &reply_data_len);
+            ret = skopt->get ? skopt->get(msg->id, msg->data, msg->len,
+                    &reply_data, &reply_data_len) : EDPVS_NOTSUPP;
         else if (msg->type == SOCKOPT_SET)
-            ret = skopt->set(msg->id, msg->data, msg->len);
+            ret = skopt->set ? skopt->set(msg->id, msg->data, msg->len) :
+                    EDPVS_NOTSUPP;
         if (ret < 0) {
             /* assume that reply_data is freed by user when callback fails */
             reply_data = NULL;
@@ -1258,12 +2005,18 @@ int ctrl_init(void)
         RTE_LOG(ERR, MSGMGR, "%s: sockopt module initialization failed!\n", __func__);
         return ret;
     }
+    ret = sockopt_register(&bulk_sockopts);
+    if (unlikely(ret < 0)) {
+        RTE_LOG(ERR, MSGMGR, "%s: bulk sockopt registration failed!\n", __func__);
+        return ret;
+    }
     return EDPVS_OK;
 }
 
 int ctrl_term(void)
 {
     int ret;
+    sockopt_unregister(&bulk_sockopts);
     ret = msg_term();
     if (unlikely(ret < 0)) {
         RTE_LOG(ERR, MSGMGR, "%s: msg module initialization failed!\n", __func__);
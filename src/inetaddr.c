@@ -978,6 +978,18 @@ static int ifa_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
     }
 }
 
+static sockoptid_t ifa_sockopt_set_undo(sockoptid_t opt)
+{
+    switch (opt) {
+    case SOCKOPT_SET_IFADDR_ADD:
+        return SOCKOPT_SET_IFADDR_DEL;
+    case SOCKOPT_SET_IFADDR_DEL:
+        return SOCKOPT_SET_IFADDR_ADD;
+    default:
+        return 0;
+    }
+}
+
 static void ifa_fill_param(int af, struct inet_addr_param *param,
                            const struct inet_ifaddr *ifa)
 {
@@ -1092,6 +1104,7 @@ static struct dpvs_sockopts ifa_sockopts = {
     .set_opt_min    = SOCKOPT_SET_IFADDR_ADD,
     .set_opt_max    = SOCKOPT_SET_IFADDR_FLUSH,
     .set            = ifa_sockopt_set,
+    .set_undo       = ifa_sockopt_set_undo,
     .get_opt_min    = SOCKOPT_GET_IFADDR_SHOW,
     .get_opt_max    = SOCKOPT_GET_IFADDR_SHOW,
     .get            = ifa_sockopt_get,
@@ -97,7 +97,7 @@ static rte_atomic32_t *ip4_idents;
 static uint32_t ip4_id_hashrnd;
 
 #ifdef CONFIG_DPVS_IPV4_STATS
-struct ip4_stats ip4_statistics;
+struct inet_stats ip4_statistics;
 rte_spinlock_t ip4_stats_lock;
 #endif
 
@@ -601,3 +601,18 @@ int ipv4_unregister_protocol(struct inet_protocol *prot,
 
     return err;
 }
+
+int ipv4_get_stats(struct inet_stats *stats)
+{
+    if (!stats)
+        return EDPVS_INVAL;
+
+#ifdef CONFIG_DPVS_IPV4_STATS
+    rte_spinlock_lock(&ip4_stats_lock);
+    memcpy(stats, &ip4_statistics, sizeof(*stats));
+    rte_spinlock_unlock(&ip4_stats_lock);
+    return EDPVS_OK;
+#else
+    return EDPVS_NOTSUPP;
+#endif
+}
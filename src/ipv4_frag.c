@@ -19,6 +19,8 @@
  * fragment and reassemble of IPv4 packet.
  */
 #include <assert.h>
+#include <errno.h>
+#include <netinet/ip.h>
 #include "dpdk.h"
 #include "netif.h"
 #include "ipv4.h"
@@ -31,6 +33,11 @@
 
 #define IP4FRAG_PREFETCH_OFFSET        3
 
+#define IP4_FRAG_MAX_FRAGS          128
+
+#define IP4_FRAG_INDIRECT_POOL_SIZE 8191
+#define IP4_FRAG_INDIRECT_POOL_CACHE 256
+
 struct ipv4_frag {
     struct rte_ip_frag_tbl        *reasm_tbl;
     struct rte_ip_frag_death_row    death_tbl; /* frags to be free */
@@ -163,6 +170,9 @@ void install_ip4_frag_keywords(void)
 static struct ipv4_frag ip4_frags[RTE_MAX_LCORE];
 #define this_ip4_frag    (ip4_frags[rte_lcore_id()])
 
+/* indirect mbufs of fragments, referring data of original packet */
+static struct rte_mempool *ip4_frag_indirect_pool[DPVS_MAX_SOCKET];
+
 /*
  * change mbuf in-place or have to change proto-type
  * for all fun in calling chain to use **mbuf if any func uses
@@ -253,96 +263,176 @@ int ipv4_reassamble(struct rte_mbuf *mbuf)
     return EDPVS_OK;
 }
 
-/* this function consumes mbuf also free route. */
-int ipv4_fragment(struct rte_mbuf *mbuf, unsigned int mtu,
-          int (*output)(struct rte_mbuf *))
+/* options not to be copied are turned into NOPs for non-first frags */
+static void ipv4_frag_options(struct ipv4_hdr *iph, unsigned int hlen)
 {
-    struct ipv4_hdr *iph = ip4_hdr(mbuf);
-    struct route_entry *rt = mbuf->userdata;
-    struct rte_mbuf *frag;
-    unsigned int left, len, hlen;
-    int offset, err, from;
-    void *to;
-    assert(rt);
+    uint8_t *opt = (uint8_t *)(iph + 1);
+    unsigned int i = 0, olen, optlen = hlen - sizeof(struct ipv4_hdr);
 
-    if (iph->fragment_offset & IPV4_HDR_DF_FLAG) {
-        icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED,
-              htonl(mtu));
-        err = EDPVS_FRAG;
-        goto out;
+    while (i < optlen) {
+        if (opt[i] == IPOPT_END)
+            break;
+        if (opt[i] == IPOPT_NOOP) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= optlen || (olen = opt[i + 1]) < 2 || i + olen > optlen)
+            break;
+        if (!IPOPT_COPIED(opt[i]))
+            memset(&opt[i], IPOPT_NOOP, olen);
+        i += olen;
     }
+}
+
+/*
+ * dpdk frag lib assumes the header has no option, so packets with
+ * options are fragmented by copy, with their full header.
+ */
+static int ipv4_fragment_copy(struct rte_mbuf *mbuf, unsigned int hlen,
+                              unsigned int frag_size, struct route_entry *rt,
+                              int (*output)(struct rte_mbuf *))
+{
+    struct ipv4_hdr *iph;
+    struct rte_mbuf *frag;
+    unsigned int left, len, from, offset;
+    int err = EDPVS_OK;
+    void *to;
 
-    hlen = ip4_hdrlen(mbuf);
-    mtu -= hlen; /* IP payload space */
     left = mbuf->pkt_len - hlen;
     from = hlen;
     offset = 0;
 
-    while (left > 0) {
-        len = left < mtu ? left : mtu; /* min(left, mtu) */
+    netif_xmit_group((left + frag_size - 1) / frag_size);
 
-        /* if we are not last frag,
-         * ensure next start on eight byte boundary */
-        if (len < left)
-            len &= ~7;
+    while (left > 0) {
+        len = left < frag_size ? left : frag_size;
 
-        /* mbuf should have enough headroom,
-         * but no way to extend tail room. */
         frag = rte_pktmbuf_alloc(mbuf->pool);
         if (!frag) {
             err = EDPVS_NOMEM;
-            goto out;
+            break;
         }
 
         /* copy metadata from orig pkt */
         route4_get(rt);
-        frag->userdata = rt; /* no need to hold before consume mbuf */
+        frag->userdata = rt;
         frag->port = mbuf->port;
         frag->ol_flags = 0; /* do not offload csum for frag */
         frag->l2_len = mbuf->l2_len;
-        frag->l3_len = mbuf->l3_len;
-
-        /* copy IP header */
-        if (unlikely((to = rte_pktmbuf_append(frag, hlen)) == NULL)
-                || mbuf_copy_bits(mbuf, 0, to, hlen) != 0) {
-            err = EDPVS_NOROOM;
-            route4_put(rt);
-            rte_pktmbuf_free(frag);
-            goto out;
-        }
+        frag->l3_len = hlen;
 
-        /* copy data block */
-        if (unlikely((to = rte_pktmbuf_append(frag, len)) == NULL)
-                || mbuf_copy_bits(mbuf, from, to, len) != 0) {
+        if (unlikely((to = rte_pktmbuf_append(frag, hlen + len)) == NULL)
+                || mbuf_copy_bits(mbuf, 0, to, hlen) != 0
+                || mbuf_copy_bits(mbuf, from, (char *)to + hlen, len) != 0) {
             err = EDPVS_NOROOM;
             route4_put(rt);
             rte_pktmbuf_free(frag);
-            goto out;
+            break;
         }
         left -= len;
 
         /* adjust new IP header fields */
         iph = ip4_hdr(frag);
+        if (offset > 0)
+            ipv4_frag_options(iph, hlen);
         iph->fragment_offset = htons(offset >> 3);
-        /* TODO: if (offset == 0) ip_fragment_options(frag); */
-
         if (left > 0)
             iph->fragment_offset |= htons(IPV4_HDR_MF_FLAG);
-        offset += len;
-        from += len;
-
         iph->total_length = htons(len + hlen);
         ip4_send_csum(iph);
+        offset += len;
+        from += len;
 
         /* consumes frag and it's route */
         err = output(frag);
         if (err != EDPVS_OK)
-            goto out;
+            break;
+
+        IP4_INC_STATS(fragcreates);
+    }
+
+    netif_xmit_group(0);
+    return err;
+}
+
+/*
+ * this function consumes mbuf also free route.
+ *
+ * zero-copy: each fragment is a new IP header chained with indirect mbufs
+ * attached to the data of @mbuf. fragments are xmit as a group, so that
+ * they go out on one tx queue in one burst.
+ */
+int ipv4_fragment(struct rte_mbuf *mbuf, unsigned int mtu,
+          int (*output)(struct rte_mbuf *))
+{
+    struct ipv4_hdr *iph = ip4_hdr(mbuf);
+    struct route_entry *rt = mbuf->userdata;
+    struct rte_mbuf *frags[IP4_FRAG_MAX_FRAGS];
+    struct rte_mempool *indirect_pool;
+    unsigned int hlen, frag_size;
+    int i, nb_frags, err;
+    assert(rt);
+
+    if (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG)) {
+        icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED,
+              htonl(mtu));
+        err = EDPVS_FRAG;
+        goto out;
+    }
+
+    /* if we are not last frag, ensure next start on eight byte boundary */
+    hlen = ip4_hdrlen(mbuf);
+    frag_size = (mtu - hlen) & ~7;
+
+    /* checksum offload can't apply to fragments */
+    err = mbuf_l4_csum_sw(mbuf);
+    if (err != EDPVS_OK)
+        goto out;
+
+    if (unlikely(hlen > sizeof(struct ipv4_hdr))) {
+        err = ipv4_fragment_copy(mbuf, hlen, frag_size, rt, output);
+        goto out;
+    }
+
+    indirect_pool = ip4_frag_indirect_pool[rte_socket_id()];
+    nb_frags = rte_ipv4_fragment_packet(mbuf, frags, IP4_FRAG_MAX_FRAGS,
+                                        hlen + frag_size,
+                                        mbuf->pool, indirect_pool);
+    if (nb_frags < 0) {
+        err = (nb_frags == -ENOMEM) ? EDPVS_NOMEM : EDPVS_FRAG;
+        goto out;
+    }
+
+    for (i = 0; i < nb_frags; i++) {
+        /* copy metadata from orig pkt */
+        route4_get(rt);
+        frags[i]->userdata = rt;
+        frags[i]->port = mbuf->port;
+        frags[i]->ol_flags = 0; /* do not offload csum for frag */
+        frags[i]->l2_len = mbuf->l2_len;
+        frags[i]->l3_len = hlen;
+
+        ip4_send_csum(ip4_hdr(frags[i]));
+    }
+
+    netif_xmit_group(nb_frags);
+
+    for (i = 0; i < nb_frags; i++) {
+        /* consumes frag and it's route */
+        err = output(frags[i]);
+        if (err != EDPVS_OK)
+            break;
 
         IP4_INC_STATS(fragcreates);
     }
 
-    err = EDPVS_OK;
+    netif_xmit_group(0);
+
+    /* free the frags not sent */
+    for (i++; i < nb_frags; i++) {
+        route4_put(rt);
+        rte_pktmbuf_free(frags[i]);
+    }
 
 out:
     route4_put(rt);
@@ -369,7 +459,8 @@ int ipv4_frag_init(void)
     lcoreid_t cid;
     int socket_id; /* NUMA-socket ID */
     uint64_t max_cycles;
-    int err;
+    char poolname[32];
+    int err, i;
     struct ipv4_frag *f4;
 
     if (ip4_frag_bucket_entries <=0 ||
@@ -407,6 +498,18 @@ int ipv4_frag_init(void)
         }
     }
 
+    for (i = 0; i < get_numa_nodes(); i++) {
+        snprintf(poolname, sizeof(poolname), "ip4_frag_indirect_%d", i);
+        /* indirect mbuf has no data room */
+        ip4_frag_indirect_pool[i] = rte_pktmbuf_pool_create(poolname,
+                IP4_FRAG_INDIRECT_POOL_SIZE, IP4_FRAG_INDIRECT_POOL_CACHE,
+                0, 0, i);
+        if (!ip4_frag_indirect_pool[i]) {
+            RTE_LOG(ERR, IP4FRAG, "fail to create indirect pool on socket %d.\n", i);
+            return EDPVS_NOMEM;
+        }
+    }
+
     snprintf(frag_job.name, sizeof(frag_job.name) - 1, "%s", "ipv4_frag");
     frag_job.func = ipv4_frag_job;
     frag_job.data = NULL;
@@ -31,6 +31,7 @@
 #include "mbuf.h"
 #include "inet.h"
 #include "ipv6.h"
+#include "ipv6_frag.h"
 #include "route6.h"
 #include "parser/parser.h"
 #include "neigh.h"
@@ -49,10 +50,15 @@ static bool conf_ipv6_forwarding = false;
 static bool conf_ipv6_disable = false;
 
 /*
- * IPv6 statistics
+ * IPv6 statistics, per-lcore but kept in an array,
+ * so that master can read them without msgs.
  */
-static RTE_DEFINE_PER_LCORE(struct inet_stats, ip6_stats);
-#define this_ip6_stats  RTE_PER_LCORE(ip6_stats)
+struct ip6_lcore_stats {
+    struct inet_stats   stats;
+} __rte_cache_aligned;
+
+static struct ip6_lcore_stats ip6_stats[RTE_MAX_LCORE];
+#define this_ip6_stats  ip6_stats[rte_lcore_id()].stats
 
 #define IP6_INC_STATS(__f__) \
     do { \
@@ -275,14 +281,18 @@ static inline unsigned int ip6_mtu_forward(struct route6 *rt)
 static int ip6_fragment(struct rte_mbuf *mbuf, uint32_t mtu,
                         int (*out)(struct rte_mbuf *))
 {
-    struct route6 *rt = mbuf->userdata;
+    int nfrags;
 
-    /* TODO: */
+    /* consumes mbuf also its route */
+    nfrags = ipv6_fragment(mbuf, mtu, out);
+    if (nfrags < 0) {
+        IP6_INC_STATS(fragfails);
+        return nfrags;
+    }
 
-    IP6_INC_STATS(fragfails);
-    route6_put(rt);
-    rte_pktmbuf_free(mbuf);
-    return EDPVS_FRAG;
+    IP6_ADD_STATS(fragcreates, nfrags);
+    IP6_INC_STATS(fragoks);
+    return EDPVS_OK;
 }
 
 static int ip6_output_fin2(struct rte_mbuf *mbuf)
@@ -621,6 +631,28 @@ static struct pkt_type ip6_pkt_type = {
 /*
  * IPv6 APIs
  */
+int ip6_defrag(struct rte_mbuf *mbuf, int user)
+{
+    int err;
+
+    IP6_INC_STATS(reasmreqds);
+
+    err = ipv6_reassemble(mbuf);
+    switch (err) {
+    case EDPVS_INPROGRESS: /* collecting fragments */
+        break;
+    case EDPVS_OK:
+        IP6_INC_STATS(reasmoks);
+        break;
+    default: /* error happened */
+        rte_pktmbuf_free(mbuf);
+        IP6_INC_STATS(reasmfails);
+        break;
+    }
+
+    return err;
+}
+
 int ipv6_init(void)
 {
     int err;
@@ -631,6 +663,10 @@ int ipv6_init(void)
     if (err)
         return err;
 
+    err = ipv6_frag_init();
+    if (err)
+        goto frag_err;
+
     /* htons, cpu_to_be16 not work when struct initialization :( */
     ip6_pkt_type.type = htons(ETHER_TYPE_IPv6);
 
@@ -644,10 +680,12 @@ int ipv6_init(void)
 
     return EDPVS_OK;
 
-reg_pkt_err:
-    ipv6_exthdrs_term();
 ctrl_err:
     netif_unregister_pkt(&ip6_pkt_type);
+reg_pkt_err:
+    ipv6_frag_term();
+frag_err:
+    ipv6_exthdrs_term();
 
     return err;
 }
@@ -664,6 +702,7 @@ int ipv6_term(void)
     if (err)
         return err;
 
+    ipv6_frag_term();
     ipv6_exthdrs_term();
 
     return EDPVS_OK;
@@ -783,6 +822,20 @@ int ipv6_stats_cpu(struct inet_stats *stats)
     return EDPVS_OK;
 }
 
+int ipv6_stats_sum(struct inet_stats *stats)
+{
+    lcoreid_t cid;
+
+    if (!stats)
+        return EDPVS_INVAL;
+
+    memset(stats, 0, sizeof(*stats));
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++)
+        inet_stats_add(stats, &ip6_stats[cid].stats);
+
+    return EDPVS_OK;
+}
+
 /*
  * configure file
  */
@@ -795,6 +848,7 @@ void ipv6_keyword_value_init(void)
     conf_ipv6_forwarding = false;
     conf_ipv6_disable = false;
 
+    ip6_frag_keyword_value_init();
     route6_keyword_value_init();
 }
 
@@ -804,6 +858,7 @@ void install_ipv6_keywords(void)
     install_keyword("forwarding", ip6_conf_forward, KW_TYPE_NORMAL);
     install_keyword("disable", ip6_conf_disable, KW_TYPE_NORMAL);
 
+    install_ip6_frag_keywords();
     install_route6_keywords();
 }
 
@@ -0,0 +1,471 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * fragment and reassemble of IPv6 packet.
+ * Linux Kernel net/ipv6/reassembly.c and ip6_output.c are referred.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <netinet/ip6.h>
+#include "dpdk.h"
+#include "netif.h"
+#include "ipv6.h"
+#include "ipv6_frag.h"
+#include "route6.h"
+#include "parser/parser.h"
+
+#define IP6FRAG
+#define RTE_LOGTYPE_IP6FRAG RTE_LOGTYPE_USER1
+
+#define IP6FRAG_PREFETCH_OFFSET        3
+
+/* 64 fragments covers a 64K payload at IPV6_MIN_MTU */
+#define IP6_FRAG_MAX_FRAGS          64
+
+#define IP6_FRAG_INDIRECT_POOL_SIZE 8191
+#define IP6_FRAG_INDIRECT_POOL_CACHE 256
+
+struct ipv6_frag {
+    struct rte_ip_frag_tbl          *reasm_tbl;
+    struct rte_ip_frag_death_row    death_tbl; /* frags to be free */
+    uint32_t                        ident;     /* next fragment id */
+};
+
+/* parameters */
+#define IP6_FRAG_BUCKETS_DEF        4096
+#define IP6_FRAG_BUCKETS_MIN        32
+#define IP6_FRAG_BUCKETS_MAX        65536
+
+#define IP6_FRAG_BUCKET_ENTRIES_DEF 16
+#define IP6_FRAG_BUCKET_ENTRIES_MIN 1
+#define IP6_FRAG_BUCKET_ENTRIES_MAX 256
+
+#define IP6_FRAG_TTL_DEF            1
+
+static uint32_t ip6_frag_buckets = IP6_FRAG_BUCKETS_DEF;
+static uint32_t ip6_frag_bucket_entries = IP6_FRAG_BUCKET_ENTRIES_DEF;
+static uint32_t ip6_frag_max_entries = IP6_FRAG_BUCKETS_DEF;
+static uint32_t ip6_frag_ttl = IP6_FRAG_TTL_DEF; /* seconds */
+
+static void frag_bucket_number_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    uint32_t frag_buckets;
+
+    assert(str);
+    frag_buckets = atoi(str);
+    if (frag_buckets >= IP6_FRAG_BUCKETS_MIN && frag_buckets <= IP6_FRAG_BUCKETS_MAX) {
+        RTE_LOG(INFO, IP6FRAG, "ip6_frag_buckets = %d\n", frag_buckets);
+        ip6_frag_buckets = frag_buckets;
+    } else {
+        RTE_LOG(WARNING, IP6FRAG, "invalid ip6_frag_buckets config %s, using default "
+                "%d\n", str, IP6_FRAG_BUCKETS_DEF);
+        ip6_frag_buckets = IP6_FRAG_BUCKETS_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void frag_bucket_entries_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int bucket_entries;
+
+    assert(str);
+    bucket_entries = atoi(str);
+    if (bucket_entries >= IP6_FRAG_BUCKET_ENTRIES_MIN &&
+            bucket_entries <= IP6_FRAG_BUCKET_ENTRIES_MAX) {
+        is_power2(bucket_entries, 0, &bucket_entries);
+        RTE_LOG(INFO, IP6FRAG, "ip6_frag_bucket_entries = %d (round to 2^n)\n",
+                bucket_entries);
+        ip6_frag_bucket_entries = bucket_entries;
+    } else {
+        RTE_LOG(WARNING, IP6FRAG, "invalid ip6_frag_bucket_entries config %s, using "
+                "default %d\n", str, IP6_FRAG_BUCKET_ENTRIES_DEF);
+        ip6_frag_bucket_entries = IP6_FRAG_BUCKET_ENTRIES_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void frag_max_entries_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    uint32_t max_entries;
+
+    assert(str);
+    if ((max_entries = atoi(str)) > 0) {
+        RTE_LOG(INFO, IP6FRAG, "ip6_frag_max_entries = %d\n", max_entries);
+        ip6_frag_max_entries = max_entries;
+    } else {
+        RTE_LOG(WARNING, IP6FRAG, "invalid ip6_frag_max_entries config %s, using "
+                "default %d\n", str, IP6_FRAG_BUCKETS_DEF);
+        ip6_frag_max_entries = IP6_FRAG_BUCKETS_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void frag_ttl_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    uint32_t ttl;
+
+    assert(str);
+    ttl = atoi(str);
+    if (ttl > 0 && ttl < 256) {
+        RTE_LOG(INFO, IP6FRAG, "ip6_frag_ttl = %d\n", ttl);
+        ip6_frag_ttl = ttl;
+    } else {
+        RTE_LOG(WARNING, IP6FRAG, "invalid ip6_frag_ttl %s, using default %d\n",
+                str, IP6_FRAG_TTL_DEF);
+        ip6_frag_ttl = IP6_FRAG_TTL_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+void ip6_frag_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+        ip6_frag_buckets = IP6_FRAG_BUCKETS_DEF;
+        ip6_frag_bucket_entries = IP6_FRAG_BUCKET_ENTRIES_DEF;
+        ip6_frag_max_entries = IP6_FRAG_BUCKETS_DEF;
+        ip6_frag_ttl = IP6_FRAG_TTL_DEF;
+    }
+    /* KW_TYPE_NORMAL keyword */
+}
+
+void install_ip6_frag_keywords(void)
+{
+    install_keyword("fragment", NULL, KW_TYPE_INIT);
+    install_sublevel();
+    install_keyword("bucket_number", frag_bucket_number_handler, KW_TYPE_INIT);
+    install_keyword("bucket_entries", frag_bucket_entries_handler, KW_TYPE_INIT);
+    install_keyword("max_entries", frag_max_entries_handler, KW_TYPE_INIT);
+    install_keyword("ttl", frag_ttl_handler, KW_TYPE_INIT);
+    install_sublevel_end();
+}
+
+/* per-lcore reassemble table, see ipv4_frag.c */
+static struct ipv6_frag ip6_frags[RTE_MAX_LCORE];
+#define this_ip6_frag    (ip6_frags[rte_lcore_id()])
+
+/* indirect mbufs of fragments, referring data of original packet */
+static struct rte_mempool *ip6_frag_indirect_pool[DPVS_MAX_SOCKET];
+
+/*
+ * change mbuf in-place as ipv4_reassamble() does. only the fragment
+ * header right after fixed header is supported, which is what dpdk
+ * frag lib understands.
+ */
+int ipv6_reassemble(struct rte_mbuf *mbuf)
+{
+    struct rte_mbuf *asm_mbuf, *next, *seg, *prev;
+    struct ipv6_hdr *ip6h = rte_pktmbuf_mtod(mbuf, struct ipv6_hdr *);
+    struct ipv6_extension_fragment *fh;
+
+    if (unlikely(mbuf_may_pull(mbuf, sizeof(*ip6h) + sizeof(*fh)) != 0))
+        return EDPVS_INVPKT;
+
+    ip6h = rte_pktmbuf_mtod(mbuf, struct ipv6_hdr *);
+    fh = rte_ipv6_frag_get_ipv6_fragment_header(ip6h);
+    if (unlikely(!fh))
+        return EDPVS_INVPKT;
+
+    /* dpdk frag lib need l3_len to cover the fragment header,
+     * and mbuf->data_off start with l2 header if exist. */
+    mbuf->l3_len = sizeof(*ip6h) + sizeof(*fh);
+    rte_pktmbuf_prepend(mbuf, mbuf->l2_len);
+
+    asm_mbuf = rte_ipv6_frag_reassemble_packet(
+            this_ip6_frag.reasm_tbl,
+            &this_ip6_frag.death_tbl,
+            mbuf, rte_rdtsc(), ip6h, fh);
+
+    if (!asm_mbuf) /* no way to distinguish error and in-progress */
+        return EDPVS_INPROGRESS;
+
+    rte_pktmbuf_adj(asm_mbuf, mbuf->l2_len);
+
+    /* fragment header is removed by frag lib */
+    asm_mbuf->l3_len = sizeof(struct ip6_hdr);
+
+    /* the heading frag arrived last, already in place. */
+    if (asm_mbuf == mbuf)
+        return EDPVS_OK;
+
+    /* now mbuf is a seg of asm_mbuf, replace it with a new seg. */
+    if ((seg = rte_pktmbuf_alloc(mbuf->pool)) == NULL) {
+        RTE_LOG(ERR, IP6FRAG, "%s: no memory.", __func__);
+        rte_pktmbuf_free(asm_mbuf);
+        return EDPVS_NOMEM;
+    }
+    for (prev = asm_mbuf; prev; prev = prev->next)
+        if (prev->next == mbuf)
+            break;
+    if (!prev) {
+        RTE_LOG(ERR, IP6FRAG, "%s: mbuf is not a seg.", __func__);
+        rte_pktmbuf_free(asm_mbuf);
+        rte_pktmbuf_free(seg);
+        return EDPVS_NOMEM;
+    }
+    memcpy(rte_pktmbuf_mtod(seg, void *),
+           rte_pktmbuf_mtod(mbuf, void *), mbuf->data_len);
+    seg->data_len = mbuf->data_len;
+    seg->pkt_len = mbuf->pkt_len;
+    prev->next = seg;
+    seg->next = mbuf->next;
+    mbuf->next = NULL;
+
+    /* make mbuf as heading frag. */
+    if (!rte_pktmbuf_is_contiguous(mbuf)) {
+        RTE_LOG(ERR, IP6FRAG, "%s: mbuf is not linear.", __func__);
+        rte_pktmbuf_free(asm_mbuf);
+        return EDPVS_NOROOM;
+    }
+
+    /* use the headroom of mbuf as asm_mbuf does. */
+    mbuf->data_off = asm_mbuf->data_off;
+    if (mbuf->data_off + asm_mbuf->data_len > mbuf->buf_len) {
+        RTE_LOG(ERR, IP6FRAG, "%s: no room.", __func__);
+        rte_pktmbuf_free(asm_mbuf);
+        return EDPVS_NOROOM;
+    }
+
+    memcpy(rte_pktmbuf_mtod(mbuf, void *),
+           rte_pktmbuf_mtod(asm_mbuf, void *), asm_mbuf->data_len);
+    mbuf->data_len = asm_mbuf->data_len;
+    mbuf->pkt_len = mbuf->data_len;
+    mbuf->l3_len = asm_mbuf->l3_len;
+
+    /* move segs to new heading mbuf. */
+    prev = mbuf;
+    mbuf_foreach_seg_safe(asm_mbuf, next, seg) {
+        assert(asm_mbuf->next == seg);
+
+        asm_mbuf->next = next;
+        asm_mbuf->nb_segs--;
+        asm_mbuf->pkt_len -= seg->data_len;
+
+        prev->next = seg;
+        prev = seg;
+        mbuf->nb_segs++;
+        mbuf->pkt_len += seg->data_len;
+    }
+
+    /* now asm_mbuf has no segs  */
+    rte_pktmbuf_free(asm_mbuf);
+    return EDPVS_OK;
+}
+
+static inline bool ip6_frag_unfragmentable(uint8_t nexthdr)
+{
+    /* frag lib places fragment header right after fixed header */
+    return (nexthdr == NEXTHDR_HOP || nexthdr == NEXTHDR_ROUTING ||
+            nexthdr == NEXTHDR_DEST || nexthdr == NEXTHDR_FRAGMENT);
+}
+
+/*
+ * zero-copy: each fragment is a new fixed header plus fragment header,
+ * chained with indirect mbufs attached to the data of @mbuf.
+ */
+int ipv6_fragment(struct rte_mbuf *mbuf, unsigned int mtu,
+          int (*output)(struct rte_mbuf *))
+{
+    struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+    struct route6 *rt = NULL;
+    struct rte_mbuf *frags[IP6_FRAG_MAX_FRAGS];
+    struct ipv6_extension_fragment *fh;
+    struct rte_mempool *indirect_pool;
+    unsigned int frag_size;
+    uint32_t ident;
+    int i, nb_frags, err;
+
+    /* @userdata is netif_port for multicast, see ip6_output(). */
+    if (!ipv6_addr_is_multicast(&ip6h->ip6_dst))
+        rt = mbuf->userdata;
+
+    if (unlikely(ip6_frag_unfragmentable(ip6h->ip6_nxt))) {
+        err = EDPVS_NOTSUPP;
+        goto out;
+    }
+
+    /*
+     * fragmentable part of each frag must be multiple of 8. frag lib adds
+     * the fragment header on top of "mtu_size - fixed header" of data.
+     */
+    if (mtu < IPV6_MIN_MTU)
+        mtu = IPV6_MIN_MTU;
+    frag_size = (mtu - sizeof(struct ip6_hdr) -
+                 sizeof(struct ipv6_extension_fragment)) & ~7;
+
+    /* checksum offload can't apply to fragments */
+    err = mbuf_l4_csum_sw(mbuf);
+    if (err != EDPVS_OK)
+        goto out;
+
+    indirect_pool = ip6_frag_indirect_pool[rte_socket_id()];
+    nb_frags = rte_ipv6_fragment_packet(mbuf, frags, IP6_FRAG_MAX_FRAGS,
+                                        sizeof(struct ip6_hdr) + frag_size,
+                                        mbuf->pool, indirect_pool);
+    if (nb_frags < 0) {
+        err = (nb_frags == -ENOMEM) ? EDPVS_NOMEM : EDPVS_FRAG;
+        goto out;
+    }
+
+    /* dpdk frag lib leaves identification zero */
+    ident = htonl(this_ip6_frag.ident++);
+
+    for (i = 0; i < nb_frags; i++) {
+        fh = rte_pktmbuf_mtod_offset(frags[i], struct ipv6_extension_fragment *,
+                                     sizeof(struct ip6_hdr));
+        fh->id = ident;
+
+        if (rt)
+            route6_get(rt);
+        frags[i]->userdata = mbuf->userdata;
+        frags[i]->port = mbuf->port;
+        frags[i]->ol_flags = 0;
+        frags[i]->l2_len = mbuf->l2_len;
+        frags[i]->l3_len = sizeof(struct ip6_hdr) + sizeof(*fh);
+    }
+
+    netif_xmit_group(nb_frags);
+
+    for (i = 0; i < nb_frags; i++) {
+        /* consumes frag and it's route */
+        err = output(frags[i]);
+        if (err != EDPVS_OK)
+            break;
+    }
+
+    netif_xmit_group(0);
+
+    if (i < nb_frags) {
+        for (i++; i < nb_frags; i++) {
+            if (rt)
+                route6_put(rt);
+            rte_pktmbuf_free(frags[i]);
+        }
+        goto out;
+    }
+
+    err = nb_frags;
+
+out:
+    if (rt)
+        route6_put(rt);
+    rte_pktmbuf_free(mbuf);
+    return err;
+}
+
+static void ipv6_frag_job(void *arg)
+{
+    struct ipv6_frag *f = &ip6_frags[rte_lcore_id()];
+
+    rte_ip_frag_free_death_row(&f->death_tbl, IP6FRAG_PREFETCH_OFFSET);
+    return;
+}
+
+static struct netif_lcore_loop_job frag_job;
+
+int ipv6_frag_init(void)
+{
+    lcoreid_t cid;
+    int socket_id; /* NUMA-socket ID */
+    uint64_t max_cycles;
+    char poolname[32];
+    int err, i;
+    struct ipv6_frag *f6;
+
+    if (ip6_frag_bucket_entries <=0 ||
+            ip6_frag_max_entries > ip6_frag_buckets * ip6_frag_bucket_entries) {
+        RTE_LOG(WARNING, IP6FRAG, "invalid ip6_frag_max_entries %d (should be no "
+                "bigger than ip6_frag_buckets(%d) * ip6_frag_bucket_entries(%d), using "
+                "%d instead\n", ip6_frag_max_entries,
+                ip6_frag_buckets, ip6_frag_bucket_entries,
+                ip6_frag_buckets * ip6_frag_bucket_entries / 2);
+        ip6_frag_max_entries = ip6_frag_buckets * ip6_frag_bucket_entries / 2;
+    }
+
+    /* this magic expression comes from DPDK ip_reassembly example */
+    max_cycles = (rte_get_tsc_hz() + MS_PER_S - 1) / MS_PER_S *
+             (ip6_frag_ttl * MS_PER_S);
+
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        if (!rte_lcore_is_enabled(cid))
+            continue;
+
+        f6 = &ip6_frags[cid];
+        memset(f6, 0, sizeof(struct ipv6_frag));
+        socket_id = rte_lcore_to_socket_id(cid);
+
+        f6->reasm_tbl = rte_ip_frag_table_create(
+                    ip6_frag_buckets,
+                    ip6_frag_bucket_entries,
+                    ip6_frag_max_entries,
+                    max_cycles,
+                    socket_id);
+        if (!f6->reasm_tbl) {
+            RTE_LOG(ERR, IP6FRAG,
+                "[%d] fail to create frag table.\n", cid);
+            return EDPVS_DPDKAPIFAIL;
+        }
+        f6->ident = (uint32_t)rte_rand();
+    }
+
+    for (i = 0; i < get_numa_nodes(); i++) {
+        snprintf(poolname, sizeof(poolname), "ip6_frag_indirect_%d", i);
+        /* indirect mbuf has no data room */
+        ip6_frag_indirect_pool[i] = rte_pktmbuf_pool_create(poolname,
+                IP6_FRAG_INDIRECT_POOL_SIZE, IP6_FRAG_INDIRECT_POOL_CACHE,
+                0, 0, i);
+        if (!ip6_frag_indirect_pool[i]) {
+            RTE_LOG(ERR, IP6FRAG, "fail to create indirect pool on socket %d.\n", i);
+            return EDPVS_NOMEM;
+        }
+    }
+
+    snprintf(frag_job.name, sizeof(frag_job.name) - 1, "%s", "ipv6_frag");
+    frag_job.func = ipv6_frag_job;
+    frag_job.data = NULL;
+    frag_job.type = NETIF_LCORE_JOB_SLOW;
+    frag_job.skip_loops = IP6_FRAG_FREE_DEATH_ROW_INTERVAL;
+    err = netif_lcore_loop_job_register(&frag_job);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IP6FRAG, "fail to register loop job.\n");
+        return err;
+    }
+
+    return EDPVS_OK;
+}
+
+int ipv6_frag_term(void)
+{
+    int err;
+
+    err = netif_lcore_loop_job_unregister(&frag_job);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IP6FRAG, "fail to unregister loop job.\n");
+        return err;
+    }
+
+    return EDPVS_OK;
+}
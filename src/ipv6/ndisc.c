@@ -345,14 +345,21 @@ void ndisc_solicit(struct neighbour_entry *neigh,
     ndisc_send_ns(dev, target, &mcaddr, saddr);
 }
 
+/* unicast NS to the neighbour, to refresh it before it goes stale */
+void ndisc_probe(struct neighbour_entry *neigh,
+                 const struct in6_addr *saddr)
+{
+    struct in6_addr *target = &neigh->ip_addr.in6;
+
+    ndisc_send_ns(neigh->port, target, target, saddr);
+}
+
 static int ndisc_recv_ns(struct rte_mbuf *mbuf, struct netif_port *dev)
 {
     uint8_t *lladdr = NULL;
     struct ndisc_options ndopts;
-    struct neighbour_entry *neigh;
     struct inet_ifaddr *ifa;
     int inc = 0;
-    int hashkey = 0;
     uint32_t ndoptlen = 0;
 
     struct in6_addr *saddr = &((struct ip6_hdr *)mbuf->userdata)->ip6_src;
@@ -436,23 +443,11 @@ static int ndisc_recv_ns(struct rte_mbuf *mbuf, struct netif_port *dev)
     inet_addr_ifa_put(ifa);
 
     /* update/create neighbour */
-    hashkey = neigh_hashkey(AF_INET6, (union inet_addr *)saddr, dev);
-    neigh = neigh_lookup_entry(AF_INET6, (union inet_addr *)saddr, dev, hashkey);
-    if (neigh && !(neigh->flag & NEIGHBOUR_STATIC)) {
-        neigh_edit(neigh, (struct ether_addr *)lladdr);
-        neigh_entry_state_trans(neigh, 1);
-        neigh_sync_core(neigh, 1, NEIGH_ENTRY);
-    } else {
-        neigh = neigh_add_table(AF_INET6, (union inet_addr *)saddr,
-                      (struct ether_addr *)lladdr, dev, hashkey, 0);
-        if (!neigh){
-            RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
-            return EDPVS_NOMEM;
-        }
-        neigh_entry_state_trans(neigh, 1);
-        neigh_sync_core(neigh, 1, NEIGH_ENTRY);
+    if (neigh_update(AF_INET6, (union inet_addr *)saddr,
+                     (struct ether_addr *)lladdr, dev) == EDPVS_NOMEM) {
+        RTE_LOG(ERR, NEIGHBOUR, "[%s] update neighbour wrong\n", __func__);
+        return EDPVS_NOMEM;
     }
-    neigh_send_mbuf_cach(neigh);
 
     ndisc_send_na(dev, saddr, &msg->target,
                   1, inc, inc);
@@ -464,9 +459,7 @@ static int ndisc_recv_na(struct rte_mbuf *mbuf, struct netif_port *dev)
 {
     uint8_t *lladdr = NULL;
     struct ndisc_options ndopts;
-    struct neighbour_entry *neigh;
     struct inet_ifaddr *ifa;
-    int hashkey;
     struct in6_addr *daddr = &((struct ip6_hdr *)mbuf->userdata)->ip6_dst;
     struct nd_msg *msg = rte_pktmbuf_mtod(mbuf, struct nd_msg *);
     uint32_t ndoptlen = mbuf->data_len - offsetof(struct nd_msg, opt);
@@ -521,23 +514,11 @@ static int ndisc_recv_na(struct rte_mbuf *mbuf, struct netif_port *dev)
 #endif
 
     /* notice: override flag ignored */
-    hashkey = neigh_hashkey(AF_INET6, (union inet_addr *)&msg->target, dev);
-    neigh = neigh_lookup_entry(AF_INET6, (union inet_addr *)&msg->target, dev, hashkey);
-    if (neigh && !(neigh->flag & NEIGHBOUR_STATIC)) {
-        neigh_edit(neigh, (struct ether_addr *)lladdr);
-        neigh_entry_state_trans(neigh, 1);
-        neigh_sync_core(neigh, 1, NEIGH_ENTRY);
-    } else {
-        neigh = neigh_add_table(AF_INET6, (union inet_addr *)&msg->target,
-                       (struct ether_addr *)lladdr, dev, hashkey, 0);
-        if (!neigh) {
-           RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
-           return EDPVS_NOMEM;
-        }
-        neigh_entry_state_trans(neigh, 1);
-        neigh_sync_core(neigh, 1, NEIGH_ENTRY);
+    if (neigh_update(AF_INET6, (union inet_addr *)&msg->target,
+                     (struct ether_addr *)lladdr, dev) == EDPVS_NOMEM) {
+        RTE_LOG(ERR, NEIGHBOUR, "[%s] update neighbour wrong\n", __func__);
+        return EDPVS_NOMEM;
     }
-    neigh_send_mbuf_cach(neigh);
 
     return EDPVS_KNICONTINUE;
 }
@@ -19,6 +19,7 @@
 #include "route6.h"
 #include "linux_ipv6.h"
 #include "ctrl.h"
+#include "neigh.h"
 #include "route6_lpm.h"
 #include "route6_hlist.h"
 #include "parser/parser.h"
@@ -195,15 +196,18 @@ static int rt6_del_lcore(const struct dp_vs_route6_conf *rt6_cfg)
     return g_rt6_method->rt6_del_lcore(rt6_cfg);
 }
 
+/* route6 ops are applied on slaves in batch, see msg_batch_add */
+static struct dpvs_msg_batch rt6_batch = {
+    .type   = MSG_TYPE_ROUTE6,
+    .oplen  = sizeof(struct dp_vs_route6_conf),
+};
+
 /* called on master */
 static int rt6_add_del(const struct dp_vs_route6_conf *cf)
 {
     int err;
-    struct dpvs_msg *msg;
-    lcoreid_t cid;
 
-    cid = rte_lcore_id();
-    assert(cid == rte_get_master_lcore());
+    assert(rte_lcore_id() == rte_get_master_lcore());
 
     /* for master */
     switch (cf->ops) {
@@ -226,20 +230,22 @@ static int rt6_add_del(const struct dp_vs_route6_conf *cf)
         return err;
     }
 
-    /* for slaves */
-    msg = msg_make(MSG_TYPE_ROUTE6, 0, DPVS_MSG_MULTICAST, cid,
-            sizeof(struct dp_vs_route6_conf), cf);
-    if (unlikely(msg == NULL)) {
-        err = EDPVS_NOMEM;
-        goto slave_fail;
+    /* keep the gateway resolved for all lcores */
+    if (!ipv6_addr_any(&cf->gateway)) {
+        union inet_addr gw;
+
+        memset(&gw, 0, sizeof(gw));
+        memcpy(&gw.in6, &cf->gateway, sizeof(gw.in6));
+        if (cf->ops == RT6_OPS_ADD)
+            neigh_pin_addr(AF_INET6, &gw);
+        else
+            neigh_unpin_addr(AF_INET6, &gw);
     }
 
-    err = multicast_msg_send(msg, 0, NULL);
-    if (err != EDPVS_OK) {
-        msg_destroy(&msg);
+    /* for slaves, within a bulk it goes in the same txn as other ops */
+    err = msg_batch_add(&rt6_batch, cf);
+    if (err != EDPVS_OK)
         goto slave_fail;
-    }
-    msg_destroy(&msg);
 
     return EDPVS_OK;
 
@@ -288,17 +294,8 @@ int route6_del(const struct in6_addr *dest, int plen, uint32_t flags,
     return __route6_add_del(dest, plen, flags, gw, dev, src, mtu, false);
 }
 
-static int rt6_msg_process_cb(struct dpvs_msg *msg)
+static int rt6_msg_process_op(const struct dp_vs_route6_conf *cf)
 {
-    struct dp_vs_route6_conf *cf;
-
-    assert(msg && msg->data);
-    if (msg->len != sizeof(struct dp_vs_route6_conf)) {
-        RTE_LOG(WARNING, RT6, "%s: invalid route6 msg!\n", __func__);
-        return EDPVS_INVAL;
-    }
-
-    cf = (struct dp_vs_route6_conf *)msg->data;
     switch (cf->ops) {
         case RT6_OPS_GET:
             /* to be supported */
@@ -312,8 +309,28 @@ static int rt6_msg_process_cb(struct dpvs_msg *msg)
                     __func__, cf->ops);
             return EDPVS_NOTSUPP;
     }
+}
 
-    return EDPVS_OK;
+static int rt6_msg_process_cb(struct dpvs_msg *msg)
+{
+    uint32_t i, nops;
+    int err, ret = EDPVS_OK;
+
+    assert(msg && msg->data);
+    if (msg_oplen(msg) != sizeof(struct dp_vs_route6_conf)) {
+        RTE_LOG(WARNING, RT6, "%s: invalid route6 msg!\n", __func__);
+        return EDPVS_INVAL;
+    }
+
+    /* all ops in one pass */
+    nops = msg_nops(msg);
+    for (i = 0; i < nops; i++) {
+        err = rt6_msg_process_op(msg_op(msg, i));
+        if (err != EDPVS_OK)
+            ret = err;
+    }
+
+    return ret;
 }
 
 static bool rt6_conf_check(const struct dp_vs_route6_conf *rt6_cfg)
@@ -430,6 +447,11 @@ int route6_init(void)
         return err;
     }
 
+    if ((err = msg_batch_register(&rt6_batch)) != EDPVS_OK) {
+        RTE_LOG(ERR, RT6, "%s: fail to register route6 msg batch!\n", __func__);
+        return err;
+    }
+
     if ((err = sockopt_register(&route6_sockopts)) != EDPVS_OK) {
         RTE_LOG(ERR, RT6, "%s: fail to register route6 sockopt!\n", __func__);
         return err;
@@ -449,6 +471,8 @@ int route6_term(void)
     if ((err = sockopt_unregister(&route6_sockopts)) != EDPVS_OK)
         RTE_LOG(WARNING, RT6, "%s: fail to unregister route6 sockopt!\n", __func__);
 
+    msg_batch_unregister(&rt6_batch);
+
     memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
     msg_type.type           = MSG_TYPE_ROUTE6;
     msg_type.mode           = DPVS_MSG_MULTICAST;
@@ -114,12 +114,22 @@ static int dp_vs_blklst_del_lcore(uint8_t proto, const union inet_addr *vaddr,
     return EDPVS_NOTEXIST;
 }
 
+/* blklst ops are applied on slaves in batch, see msg_batch_add */
+static struct dpvs_msg_batch blklst_add_batch = {
+    .type   = MSG_TYPE_BLKLST_ADD,
+    .oplen  = sizeof(struct dp_vs_blklst_conf),
+};
+
+static struct dpvs_msg_batch blklst_del_batch = {
+    .type   = MSG_TYPE_BLKLST_DEL,
+    .oplen  = sizeof(struct dp_vs_blklst_conf),
+};
+
 static int dp_vs_blklst_add(uint8_t proto, const union inet_addr *vaddr,
                             uint16_t vport, const union inet_addr *blklst)
 {
     lcoreid_t cid = rte_lcore_id();
     int err;
-    struct dpvs_msg *msg;
     struct dp_vs_blklst_conf cf;
 
     if (cid != rte_get_master_lcore()) {
@@ -141,17 +151,11 @@ static int dp_vs_blklst_add(uint8_t proto, const union inet_addr *vaddr,
     }
 
     /*set blklst ip on all slave lcores*/
-    msg = msg_make(MSG_TYPE_BLKLST_ADD, 0, DPVS_MSG_MULTICAST,
-                   cid, sizeof(struct dp_vs_blklst_conf), &cf);
-    if (!msg)
-        return EDPVS_NOMEM;
-    err = multicast_msg_send(msg, 0, NULL);
+    err = msg_batch_add(&blklst_add_batch, &cf);
     if (err != EDPVS_OK) {
-        msg_destroy(&msg);
         RTE_LOG(INFO, SERVICE, "[%s] fail to send multicast message\n", __func__);
         return err;
     }
-    msg_destroy(&msg);
 
     return EDPVS_OK;
 }
@@ -161,7 +165,6 @@ static int dp_vs_blklst_del(uint8_t proto, const union inet_addr *vaddr,
 {
     lcoreid_t cid = rte_lcore_id();
     int err;
-    struct dpvs_msg *msg;
     struct dp_vs_blklst_conf cf;
 
     if (cid != rte_get_master_lcore()) {
@@ -183,16 +186,11 @@ static int dp_vs_blklst_del(uint8_t proto, const union inet_addr *vaddr,
     }
 
     /*del blklst ip on all slave lcores*/
-    msg = msg_make(MSG_TYPE_BLKLST_DEL, 0, DPVS_MSG_MULTICAST,
-                   cid, sizeof(struct dp_vs_blklst_conf), &cf);
-    if (!msg)
-        return EDPVS_NOMEM;
-    err = multicast_msg_send(msg, 0, NULL);
+    err = msg_batch_add(&blklst_del_batch, &cf);
     if (err != EDPVS_OK) {
         RTE_LOG(INFO, SERVICE, "[%s] fail to send multicast message\n", __func__);
         return err;
     }
-    msg_destroy(&msg);
 
     return EDPVS_OK;
 }
@@ -234,7 +232,7 @@ static int blklst_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
     const struct dp_vs_blklst_conf *blklst_conf = conf;
     int err;
 
-    if (!conf && size < sizeof(*blklst_conf))
+    if (!conf || size < sizeof(*blklst_conf))
         return EDPVS_INVAL;
 
     switch (opt) {
@@ -297,24 +295,30 @@ static int blklst_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
 static int blklst_msg_process(bool add, struct dpvs_msg *msg)
 {
     struct dp_vs_blklst_conf *cf;
-    int err;
+    uint32_t i, nops;
+    int err, ret = EDPVS_OK;
     assert(msg);
 
-    if (msg->len != sizeof(struct dp_vs_blklst_conf)){
+    if (msg_oplen(msg) != sizeof(struct dp_vs_blklst_conf)){
         RTE_LOG(ERR, SERVICE, "%s: bad message.\n", __func__);
         return EDPVS_INVAL;
     }
 
-    cf = (struct dp_vs_blklst_conf *)msg->data;
-    if (add)
-        err = dp_vs_blklst_add_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
-    else
-        err = dp_vs_blklst_del_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
-    if (err != EDPVS_OK)
-        RTE_LOG(ERR, SERVICE, "%s: fail to %s blklst: %s.\n",
-                __func__, add ? "add" : "del", dpvs_strerror(err));
+    nops = msg_nops(msg);
+    for (i = 0; i < nops; i++) {
+        cf = msg_op(msg, i);
+        if (add)
+            err = dp_vs_blklst_add_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
+        else
+            err = dp_vs_blklst_del_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
+        if (err != EDPVS_OK) {
+            RTE_LOG(ERR, SERVICE, "%s: fail to %s blklst: %s.\n",
+                    __func__, add ? "add" : "del", dpvs_strerror(err));
+            ret = err;
+        }
+    }
 
-    return err;
+    return ret;
 }
 
 inline static int blklst_add_msg_cb(struct dpvs_msg *msg)
@@ -327,11 +331,24 @@ inline static int blklst_del_msg_cb(struct dpvs_msg *msg)
     return blklst_msg_process(false, msg);
 }
 
+static sockoptid_t blklst_sockopt_set_undo(sockoptid_t opt)
+{
+    switch (opt) {
+    case SOCKOPT_SET_BLKLST_ADD:
+        return SOCKOPT_SET_BLKLST_DEL;
+    case SOCKOPT_SET_BLKLST_DEL:
+        return SOCKOPT_SET_BLKLST_ADD;
+    default:
+        return 0;
+    }
+}
+
 static struct dpvs_sockopts blklst_sockopts = {
     .version            = SOCKOPT_VERSION,
     .set_opt_min        = SOCKOPT_SET_BLKLST_ADD,
     .set_opt_max        = SOCKOPT_SET_BLKLST_FLUSH,
     .set                = blklst_sockopt_set,
+    .set_undo           = blklst_sockopt_set_undo,
     .get_opt_min        = SOCKOPT_GET_BLKLST_GETALL,
     .get_opt_max        = SOCKOPT_GET_BLKLST_GETALL,
     .get                = blklst_sockopt_get,
@@ -407,6 +424,10 @@ int dp_vs_blklst_init(void)
         return err;
     }
 
+    if ((err = msg_batch_register(&blklst_add_batch)) != EDPVS_OK ||
+        (err = msg_batch_register(&blklst_del_batch)) != EDPVS_OK)
+        return err;
+
     if ((err = sockopt_register(&blklst_sockopts)) != EDPVS_OK)
         return err;
     dp_vs_blklst_rnd = (uint32_t)random();
@@ -422,6 +443,9 @@ int dp_vs_blklst_term(void)
     if ((err = sockopt_unregister(&blklst_sockopts)) != EDPVS_OK)
         return err;
 
+    msg_batch_unregister(&blklst_add_batch);
+    msg_batch_unregister(&blklst_del_batch);
+
     rte_eal_mp_remote_launch(blklst_lcore_term, NULL, CALL_MASTER);
     RTE_LCORE_FOREACH_SLAVE(cid) {
         if ((err = rte_eal_wait_lcore(cid)) < 0) {
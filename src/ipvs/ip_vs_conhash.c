@@ -22,6 +22,7 @@
 #include "ipv6.h"
 #include "libconhash/conhash.h"
 #include "ipvs/conhash.h"
+#include "ipvs/quic.h"
 
 struct conhash_node {
     struct list_head    list;
@@ -38,47 +39,50 @@ struct conhash_sched_data {
 };
 
 #define REPLICA 160
-#define QUIC_PACKET_8BYTE_CONNECTION_ID  (1 << 3)
 
 /*
  * QUIC CID hash target for quic*
  * QUIC CID(qid) should be configured in UDP service
  */
-static int get_quic_hash_target(int af, const struct rte_mbuf *mbuf,
-                                uint64_t *quic_cid)
+static void get_quic_hash_target(const struct dp_vs_quic_cid *cid,
+                                 char *str, size_t size)
 {
-    uint8_t pub_flags;
-    uint32_t udphoff;
-    char *quic_data;
-    uint32_t quic_len;
-
-    if (af == AF_INET6) {
-        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
-        uint8_t ip6nxt = ip6h->ip6_nxt;
-        udphoff = ip6_skip_exthdr(mbuf, sizeof(struct ip6_hdr), &ip6nxt);
+    uint64_t quic_cid;
+    int i, len = 0;
+
+    /* keep the hash of gQUIC cids as it was */
+    if (cid->type == DP_VS_QUIC_CID_GQUIC) {
+        memcpy(&quic_cid, cid->data, sizeof(quic_cid));
+        snprintf(str, size, "%lu", quic_cid);
+        return;
     }
-    else
-        udphoff = ip4_hdrlen(mbuf);
 
-    quic_len = udphoff + sizeof(struct udp_hdr) +
-               sizeof(pub_flags) + sizeof(*quic_cid);
+    for (i = 0; i < cid->len; i++)
+        len += snprintf(str + len, size - len, "%02x", cid->data[i]);
+}
 
-    if (mbuf_may_pull((struct rte_mbuf *)mbuf, quic_len) != 0)
-        return EDPVS_NOTEXIST;
+/*
+ * real server whose QUIC-LB server id is encoded in the cid, so that
+ * packets of a migrated connection reach the same server.
+ */
+static struct dp_vs_dest *
+dp_vs_conhash_quic_lb_get(struct conhash_sched_data *sched_data,
+                          const struct dp_vs_quic_cid *cid)
+{
+    uint8_t sid[DP_VS_QUIC_LB_SID_MAXLEN];
+    struct conhash_node *p_conhash_node;
+    struct dp_vs_dest *dest;
 
-    quic_data = rte_pktmbuf_mtod_offset(mbuf, char *,
-                                        udphoff + sizeof(struct udp_hdr));
-    pub_flags = *((uint8_t *)quic_data);
+    if (dp_vs_quic_lb_decode(cid, sid) != EDPVS_OK)
+        return NULL;
 
-    if ((pub_flags & QUIC_PACKET_8BYTE_CONNECTION_ID) == 0) {
-        RTE_LOG(WARNING, IPVS, "packet without cid, pub_flag:%u\n", pub_flags);
-        return EDPVS_NOTEXIST;
+    list_for_each_entry(p_conhash_node, &sched_data->nodes, list) {
+        dest = p_conhash_node->node.data;
+        if (dest && dp_vs_quic_lb_match(dest, sid))
+            return dp_vs_dest_is_valid(dest) ? dest : NULL;
     }
 
-    quic_data += sizeof(pub_flags);
-    *quic_cid = *((uint64_t*)quic_data);
-
-    return EDPVS_OK;
+    return NULL;
 }
 
 /*source ip hash target*/
@@ -99,11 +103,13 @@ static int get_sip_hash_target(int af, const struct rte_mbuf *mbuf,
 }
 
 static inline struct dp_vs_dest *
-dp_vs_conhash_get(struct dp_vs_service *svc, struct conhash_s *conhash,
+dp_vs_conhash_get(struct dp_vs_service *svc,
+                  struct conhash_sched_data *sched_data,
                   const struct rte_mbuf *mbuf)
 {
-    char str[40] = {0};
-    uint64_t quic_cid;
+    char str[DP_VS_QUIC_CID_MAXLEN * 2 + 1] = {0};
+    struct dp_vs_quic_cid cid;
+    struct dp_vs_dest *dest;
     uint32_t addr_fold;
     const struct node_s *node;
 
@@ -112,9 +118,12 @@ dp_vs_conhash_get(struct dp_vs_service *svc, struct conhash_s *conhash,
             RTE_LOG(ERR, IPVS, "QUIC cid hash scheduler should only be set in UDP service.\n");
             return NULL;
         }
-        /* try to get CID for hash target first, then source IP. */
-        if (EDPVS_OK == get_quic_hash_target(svc->af, mbuf, &quic_cid)) {
-            snprintf(str, sizeof(str), "%lu", quic_cid);
+        /* try to get server id or CID for hash target first, then source IP. */
+        if (EDPVS_OK == dp_vs_quic_get_dcid(svc->af, (struct rte_mbuf *)mbuf, &cid)) {
+            dest = dp_vs_conhash_quic_lb_get(sched_data, &cid);
+            if (dest)
+                return dest;
+            get_quic_hash_target(&cid, str, sizeof(str));
         } else if (EDPVS_OK == get_sip_hash_target(svc->af, mbuf, &addr_fold)) {
             snprintf(str, sizeof(str), "%u", addr_fold);
         } else {
@@ -133,7 +142,7 @@ dp_vs_conhash_get(struct dp_vs_service *svc, struct conhash_s *conhash,
         return NULL;
     }
 
-    node = conhash_lookup(conhash, str);
+    node = conhash_lookup(sched_data->conhash, str);
     return node == NULL? NULL: node->data;
 }
 
@@ -394,7 +403,7 @@ dp_vs_conhash_schedule(struct dp_vs_service *svc, const struct rte_mbuf *mbuf)
     struct conhash_sched_data *sched_data =
         (struct conhash_sched_data *)(svc->sched_data);
 
-    dest = dp_vs_conhash_get(svc, sched_data->conhash, mbuf);
+    dest = dp_vs_conhash_get(svc, sched_data, mbuf);
 
     return dp_vs_dest_is_valid(dest) ? dest : NULL;
 }
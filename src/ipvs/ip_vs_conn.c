@@ -412,7 +412,6 @@ static int conn_expire(void *priv)
     struct dp_vs_conn *conn = priv;
     struct dp_vs_proto *pp;
     struct rte_mbuf *cloned_syn_mbuf;
-    struct dp_vs_synproxy_ack_pakcet *ack_mbuf, *t_ack_mbuf;
     struct rte_mempool *pool;
     assert(conn);
     assert(conn->af == AF_INET || conn->af == AF_INET6);
@@ -530,13 +529,7 @@ static int conn_expire(void *priv)
         dp_vs_laddr_unbind(conn);
 
         /* free stored ack packet */
-        list_for_each_entry_safe(ack_mbuf, t_ack_mbuf, &conn->ack_mbuf, list) {
-            list_del_init(&ack_mbuf->list);
-            rte_pktmbuf_free(ack_mbuf->mbuf);
-            sp_dbg_stats32_dec(sp_ack_saved);
-            rte_mempool_put(this_ack_mbufpool, ack_mbuf);
-        }
-        conn->ack_num = 0;
+        dp_vs_synproxy_ack_flush(conn);
 
         /* free stored syn mbuf */
         if (conn->syn_mbuf) {
@@ -788,12 +781,10 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
     new->timeout.tv_usec = 0;
 
     /* synproxy */
-    INIT_LIST_HEAD(&new->ack_mbuf);
     rte_atomic32_set(&new->syn_retry_max, 0);
     rte_atomic32_set(&new->dup_ack_cnt, 0);
     if ((flags & DPVS_CONN_F_SYNPROXY) && !(flags & DPVS_CONN_F_TEMPLATE)) {
         struct tcphdr _tcph, *th = NULL;
-        struct dp_vs_synproxy_ack_pakcet *ack_mbuf;
         struct dp_vs_proto *pp;
 
         th = mbuf_header_pointer(mbuf, iph->len, sizeof(_tcph), &_tcph);
@@ -803,14 +794,7 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
         }
 
         /* save ack packet */
-        if (unlikely(rte_mempool_get(this_ack_mbufpool, (void **)&ack_mbuf) != 0)) {
-            RTE_LOG(ERR, IPVS, "%s: no memory\n", __func__);
-            goto unbind_laddr;
-        }
-        ack_mbuf->mbuf = mbuf;
-        list_add_tail(&ack_mbuf->list, &new->ack_mbuf);
-        new->ack_num++;
-        sp_dbg_stats32_inc(sp_ack_saved);
+        dp_vs_synproxy_ack_stash(new, mbuf);
 
         /* save ack_seq - 1 */
         new->syn_proxy_seq.isn =
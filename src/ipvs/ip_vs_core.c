@@ -958,16 +958,9 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
         return INET_ACCEPT;
 
     /*
-     * Defrag ipvs-forwarding TCP/UDP is not supported for some reasons,
-     *
-     * - RSS/flow-director do not support TCP/UDP fragments, means it's
-     *   not able to direct frags to same lcore as original TCP/UDP packets.
-     * - per-lcore conn table will miss if frags reachs wrong lcore.
-     *
-     * If we redirect frags to "correct" lcore, it may cause performance
-     * issue. Also it need to understand RSS algorithm. Moreover, for the
-     * case frags in same flow are not occur in same lcore, a global lock is
-     * needed, which is not a good idea.
+     * Defrag ipvs-forwarding TCP is not supported, and UDP frags are
+     * reassembled in pre-routing if "frag_reassemble" is on, see
+     * __dp_vs_pre_routing. so no frag is expected here.
      */
     if (af == AF_INET && ip4_is_frag(ip4_hdr(mbuf))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag not support.\n", __func__);
@@ -1075,10 +1068,42 @@ static int __dp_vs_pre_routing(void *priv, struct rte_mbuf *mbuf,
     if (EDPVS_OK != dp_vs_fill_iphdr(af, mbuf, &iph))
         return INET_ACCEPT;
 
-    /* Drop all ip fragment except ospf */
-    if ((af == AF_INET) && ip4_is_frag(ip4_hdr(mbuf))) {
-        dp_vs_estats_inc(DEFENCE_IP_FRAG_DROP);
-        return INET_DROP;
+    /*
+     * Drop all ip fragment except ospf and udp to vip.
+     *
+     * RSS hashes fragments by L3 addresses only, so all frags of a datagram
+     * reach the same lcore and can be reassembled there without any lock.
+     * The datagram then finds its conn like other packets, and is redirected
+     * to the owner lcore if the conn lives elsewhere.
+     *
+     * IPv6 frags are handled the same way.
+     */
+    if (unlikely((af == AF_INET) && ip4_is_frag(ip4_hdr(mbuf)))) {
+        if (!g_udp_frag_reassemble || iph.proto != IPPROTO_UDP ||
+                !dp_vs_lookup_vip(af, IPPROTO_UDP, &iph.daddr)) {
+            dp_vs_estats_inc(DEFENCE_IP_FRAG_DROP);
+            return INET_DROP;
+        }
+
+        /* mbuf is consumed unless the datagram is complete */
+        if (ip4_defrag(mbuf, IP_DEFRAG_VS_FWD) != EDPVS_OK)
+            return INET_STOLEN;
+        ip4_send_csum(ip4_hdr(mbuf));
+    } else if (unlikely((af == AF_INET6) && ip6_is_frag(ip6_hdr(mbuf)))) {
+        struct ip6_frag *fh, _fh;
+
+        /* non-first frag has no L4 header, see upper-layer in frag header */
+        fh = mbuf_header_pointer(mbuf, sizeof(struct ip6_hdr), sizeof(_fh), &_fh);
+        if (!g_udp_frag_reassemble || !fh || fh->ip6f_nxt != IPPROTO_UDP ||
+                !dp_vs_lookup_vip(af, IPPROTO_UDP, &iph.daddr)) {
+            dp_vs_estats_inc(DEFENCE_IP_FRAG_DROP);
+            return INET_DROP;
+        }
+
+        if (ip6_defrag(mbuf, IP_DEFRAG_VS_FWD) != EDPVS_OK)
+            return INET_STOLEN;
+        if (EDPVS_OK != dp_vs_fill_iphdr(af, mbuf, &iph))
+            return INET_DROP;
     }
 
     /* Drop udp packet which send to tcp-vip */
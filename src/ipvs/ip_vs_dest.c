@@ -19,6 +19,7 @@
 #include <netinet/in.h>
 #include <assert.h>
 #include "inet.h"
+#include "neigh.h"
 #include "ipvs/service.h"
 #include "ipvs/dest.h"
 #include "ipvs/sched.h"
@@ -227,7 +228,7 @@ dp_vs_add_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
         /* Reset the statistic value */
         dp_svc_stats_clear(dest->stats);
 
-        rte_rwlock_write_lock(&__dp_vs_svc_lock);
+        dp_vs_svc_write_lock();
 
         /*
          * Wait until all other svc users go away.
@@ -242,7 +243,10 @@ dp_vs_add_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
         if (svc->scheduler->update_service)
             svc->scheduler->update_service(svc, dest, DPVS_SO_SET_ADDDEST);
 
-        rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+        dp_vs_svc_write_unlock();
+
+        if (!inet_is_addr_any(dest->af, &dest->addr))
+            neigh_pin_addr(dest->af, &dest->addr);
         return EDPVS_OK;
     }
 
@@ -259,7 +263,7 @@ dp_vs_add_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
      */
     rte_atomic32_inc(&dest->refcnt);
 
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
 
     /*
      * Wait until all other svc users go away.
@@ -274,7 +278,11 @@ dp_vs_add_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
     if (svc->scheduler->update_service)
         svc->scheduler->update_service(svc, dest, DPVS_SO_SET_ADDDEST);
 
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
+
+    /* resolve nexthop of the dest before any connection needs it */
+    if (!inet_is_addr_any(dest->af, &dest->addr))
+        neigh_pin_addr(dest->af, &dest->addr);
 
     return EDPVS_OK;
 }
@@ -315,7 +323,7 @@ dp_vs_edit_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
 
     __dp_vs_update_dest(svc, dest, udest);
 
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
 
     /* Wait until all other svc users go away */
     DPVS_WAIT_WHILE(rte_atomic32_read(&svc->usecnt) > 1);
@@ -335,7 +343,7 @@ dp_vs_edit_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
     if (svc->scheduler->update_service)
         svc->scheduler->update_service(svc, dest, DPVS_SO_SET_EDITDEST);
 
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
 
     return EDPVS_OK;
 }
@@ -381,6 +389,9 @@ void __dp_vs_unlink_dest(struct dp_vs_service *svc,
     list_del(&dest->n_list);
     svc->num_dests--;
 
+    if (!inet_is_addr_any(dest->af, &dest->addr))
+        neigh_unpin_addr(dest->af, &dest->addr);
+
     svc->weight -= rte_atomic16_read(&dest->weight);
     if (svc->weight < 0) {
         struct dp_vs_dest *tdest;
@@ -411,7 +422,7 @@ dp_vs_del_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
         return EDPVS_NOTEXIST;
     }
 
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
 
     /*
      *      Wait until all other svc users go away.
@@ -423,7 +434,7 @@ dp_vs_del_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
      */
     __dp_vs_unlink_dest(svc, dest, 1);
 
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
 
     /*
      *      Delete the destination
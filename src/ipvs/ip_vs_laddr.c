@@ -455,7 +455,7 @@ static int laddr_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
     int err;
     struct dp_vs_match match;
 
-    if (!conf && size < sizeof(*laddr_conf))
+    if (!conf || size < sizeof(*laddr_conf))
         return EDPVS_INVAL;
 
     if (dp_vs_match_parse(laddr_conf->srange, laddr_conf->drange,
@@ -554,11 +554,24 @@ static int laddr_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
     return err;
 }
 
+static sockoptid_t laddr_sockopt_set_undo(sockoptid_t opt)
+{
+    switch (opt) {
+    case SOCKOPT_SET_LADDR_ADD:
+        return SOCKOPT_SET_LADDR_DEL;
+    case SOCKOPT_SET_LADDR_DEL:
+        return SOCKOPT_SET_LADDR_ADD;
+    default:
+        return 0;
+    }
+}
+
 static struct dpvs_sockopts laddr_sockopts = {
     .version            = SOCKOPT_VERSION,
     .set_opt_min        = SOCKOPT_SET_LADDR_ADD,
     .set_opt_max        = SOCKOPT_SET_LADDR_FLUSH,
     .set                = laddr_sockopt_set,
+    .set_undo           = laddr_sockopt_set_undo,
     .get_opt_min        = SOCKOPT_GET_LADDR_GETALL,
     .get_opt_max        = SOCKOPT_GET_LADDR_GETALL,
     .get                = laddr_sockopt_get,
@@ -899,6 +899,12 @@ tcp_state_out:
     conn->old_state = conn->state; // old_state called when connection reused
     conn->state = new_state;
 
+    /* handshakes via synproxy are counted when the cookie is checked */
+    if (new_state == DPVS_TCP_S_ESTABLISHED &&
+            conn->old_state == DPVS_TCP_S_SYN_RECV &&
+            !(conn->flags & DPVS_CONN_F_SYNPROXY) && dest)
+        dp_vs_synproxy_auto_estab(dest->svc);
+
     if (new_state == DPVS_TCP_S_ESTABLISHED) {
         conn_timeout = dp_vs_get_conn_timeout(conn);
         if (unlikely(conn_timeout > 0))
@@ -56,6 +56,7 @@ static int g_uoa_max_trail = UOA_DEF_MAX_TRAIL; /* zero to disable UOA */
 static int g_uoa_mode = UOA_M_OPP; /* by default */
 
 int g_defence_udp_drop = 0;
+int g_udp_frag_reassemble = 0;
 
 static int udp_timeouts[DPVS_UDP_S_LAST + 1] = {
     [DPVS_UDP_S_NORMAL] = 300,
@@ -100,6 +101,14 @@ static inline int udp_send_csum(int af, int iphdrlen, struct udp_hdr *uh,
                 mbuf->ol_flags |= (PKT_TX_UDP_CKSUM | PKT_TX_IPV6);
                 uh->dgram_cksum = ip6_phdr_cksum(ip6h, mbuf->ol_flags,
                         iphdrlen, IPPROTO_UDP);
+            } else if (unlikely(!rte_pktmbuf_is_contiguous(mbuf))) {
+                /* reassembled datagram, may be too long to linearize. */
+                mbuf->l3_len = iphdrlen;
+                mbuf->ol_flags |= PKT_TX_UDP_CKSUM;
+                uh->dgram_cksum = ip6_phdr_cksum(ip6h, mbuf->ol_flags,
+                        iphdrlen, IPPROTO_UDP);
+                if (mbuf_l4_csum_sw(mbuf) != EDPVS_OK)
+                    return EDPVS_INVPKT;
             } else {
                 if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
                     return EDPVS_INVPKT;
@@ -132,6 +141,13 @@ static inline int udp_send_csum(int af, int iphdrlen, struct udp_hdr *uh,
                 mbuf->l4_len = ntohs(iph->total_length) - iphdrlen;
                 mbuf->ol_flags |= (PKT_TX_UDP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
                 uh->dgram_cksum = ip4_phdr_cksum(iph, mbuf->ol_flags);
+            } else if (unlikely(!rte_pktmbuf_is_contiguous(mbuf))) {
+                /* reassembled datagram, may be too long to linearize. */
+                mbuf->l3_len = iphdrlen;
+                mbuf->ol_flags |= PKT_TX_UDP_CKSUM;
+                uh->dgram_cksum = ip4_phdr_cksum(iph, mbuf->ol_flags);
+                if (mbuf_l4_csum_sw(mbuf) != EDPVS_OK)
+                    return EDPVS_INVPKT;
             } else {
                 if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
                     return EDPVS_INVPKT;
@@ -801,6 +817,12 @@ static void defence_udp_drop_handler(vector_t tokens)
     g_defence_udp_drop = 1;
 }
 
+static void frag_reassemble_handler(vector_t tokens)
+{
+    RTE_LOG(INFO, IPVS, "udp frag_reassemble ON\n");
+    g_udp_frag_reassemble = 1;
+}
+
 static void uoa_max_trail_handler(vector_t tokens)
 {
     int max;
@@ -881,6 +903,7 @@ void udp_keyword_value_init(void)
 
     /* KW_TYPE_NORMAL keyword */
     g_defence_udp_drop = 0;
+    g_udp_frag_reassemble = 0;
     g_uoa_max_trail = UOA_DEF_MAX_TRAIL;
 
     udp_timeouts[DPVS_UDP_S_NORMAL] = 300;
@@ -890,6 +913,7 @@ void udp_keyword_value_init(void)
 void install_proto_udp_keywords(void)
 {
     install_keyword("defence_udp_drop", defence_udp_drop_handler, KW_TYPE_NORMAL);
+    install_keyword("frag_reassemble", frag_reassemble_handler, KW_TYPE_NORMAL);
     install_keyword("uoa_max_trail", uoa_max_trail_handler, KW_TYPE_NORMAL);
     install_keyword("uoa_mode", uoa_mode_handler, KW_TYPE_NORMAL);
 
@@ -0,0 +1,336 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <assert.h>
+#include <ctype.h>
+#include <netinet/ip6.h>
+#include <openssl/aes.h>
+#include "ipv4.h"
+#include "ipv6.h"
+#include "mbuf.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/quic.h"
+#include "parser/parser.h"
+
+#define QUIC_HDR_FORM_LONG          0x80
+#define QUIC_HDR_FIXED_BIT          0x40
+#define QUIC_LONG_TYPE_SHIFT        4
+#define QUIC_LONG_TYPE_MASK         0x3
+#define QUIC_LONG_TYPE_INITIAL      0x0
+#define QUIC_LONG_TYPE_0RTT         0x1
+#define QUIC_VERSION_1              0x00000001
+
+#define GQUIC_PACKET_8BYTE_CONNECTION_ID    (1 << 3)
+
+/*
+ * first octet of a QUIC-LB cid: 3 bits config rotation,
+ * 5 bits cid length minus one if self-described.
+ */
+#define QUIC_LB_CONFIG_ID_SHIFT     5
+#define QUIC_LB_CONFIG_ID_MAX       6   /* 7 is for unroutable cids */
+#define QUIC_LB_CID_LEN_MASK        0x1f
+#define QUIC_LB_NONCE_MINLEN        8
+#define QUIC_LB_NONCE_MAXLEN        16
+#define QUIC_LB_KEY_LEN             16
+
+struct quic_lb_conf {
+    uint8_t     config_id;
+    uint8_t     sid_len;        /* zero to disable QUIC-LB */
+    uint8_t     nonce_len;      /* zero for plaintext */
+    uint8_t     cid_len;        /* zero if self-described */
+    bool        key_set;
+    AES_KEY     key;
+};
+
+static struct quic_lb_conf g_quic_lb;
+
+int dp_vs_quic_get_dcid(int af, struct rte_mbuf *mbuf,
+                        struct dp_vs_quic_cid *cid)
+{
+    uint32_t off, len;
+    uint8_t *data;
+
+    if (af == AF_INET6) {
+        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+        uint8_t ip6nxt = ip6h->ip6_nxt;
+        off = ip6_skip_exthdr(mbuf, sizeof(struct ip6_hdr), &ip6nxt);
+    }
+    else
+        off = ip4_hdrlen(mbuf);
+    off += sizeof(struct udp_hdr);
+
+    /* flags, version and dcid length of long header */
+    if (mbuf_may_pull(mbuf, off + 6) != 0)
+        return EDPVS_NOTEXIST;
+    data = rte_pktmbuf_mtod_offset(mbuf, uint8_t *, off);
+
+    if (data[0] & QUIC_HDR_FORM_LONG) {
+        uint32_t version = rte_be_to_cpu_32(*(uint32_t *)&data[1]);
+        uint8_t type = (data[0] >> QUIC_LONG_TYPE_SHIFT) & QUIC_LONG_TYPE_MASK;
+
+        len = data[5];
+        if (len == 0 || len > DP_VS_QUIC_CID_MAXLEN)
+            return EDPVS_NOTEXIST;
+        if (mbuf_may_pull(mbuf, off + 6 + len) != 0)
+            return EDPVS_NOTEXIST;
+        data = rte_pktmbuf_mtod_offset(mbuf, uint8_t *, off + 6);
+
+        /* type bits of other versions are unknown, trust no server id */
+        if (version != QUIC_VERSION_1 || type == QUIC_LONG_TYPE_INITIAL ||
+                type == QUIC_LONG_TYPE_0RTT)
+            cid->type = DP_VS_QUIC_CID_CLIENT;
+        else
+            cid->type = DP_VS_QUIC_CID_SERVER;
+    } else if (data[0] & QUIC_HDR_FIXED_BIT) {
+        /* short header carries no cid length, it's known by QUIC-LB config */
+        if (g_quic_lb.cid_len)
+            len = g_quic_lb.cid_len;
+        else
+            len = (data[1] & QUIC_LB_CID_LEN_MASK) + 1;
+        if (len > DP_VS_QUIC_CID_MAXLEN)
+            return EDPVS_NOTEXIST;
+        if (mbuf_may_pull(mbuf, off + 1 + len) != 0)
+            return EDPVS_NOTEXIST;
+        data = rte_pktmbuf_mtod_offset(mbuf, uint8_t *, off + 1);
+
+        cid->type = DP_VS_QUIC_CID_SERVER;
+    } else if (data[0] & GQUIC_PACKET_8BYTE_CONNECTION_ID) {
+        len = sizeof(uint64_t);
+        if (mbuf_may_pull(mbuf, off + 1 + len) != 0)
+            return EDPVS_NOTEXIST;
+        data = rte_pktmbuf_mtod_offset(mbuf, uint8_t *, off + 1);
+
+        cid->type = DP_VS_QUIC_CID_GQUIC;
+    } else {
+        return EDPVS_NOTEXIST;
+    }
+
+    cid->len = len;
+    memcpy(cid->data, data, len);
+
+    return EDPVS_OK;
+}
+
+/* @out ^= AES-ECB(key, @in padded with zeros) */
+static inline void quic_lb_pass(const uint8_t *in, uint8_t inlen,
+                                uint8_t *out, uint8_t outlen)
+{
+    uint8_t pt[QUIC_LB_KEY_LEN] = { 0 };
+    uint8_t ct[QUIC_LB_KEY_LEN];
+    uint8_t i;
+
+    memcpy(pt, in, inlen);
+    AES_encrypt(pt, ct, &g_quic_lb.key);
+
+    for (i = 0; i < outlen; i++)
+        out[i] ^= ct[i];
+}
+
+/*
+ * stream cipher cid is encrypted in three passes,
+ *   esid   = sid ^ E(nonce)
+ *   enonce = nonce ^ E(esid)
+ *   esid   = esid ^ E(enonce)
+ * undo them in reverse order.
+ */
+static void quic_lb_stream_decrypt(const uint8_t *ecid, uint8_t *sid)
+{
+    const struct quic_lb_conf *conf = &g_quic_lb;
+    uint8_t nonce[QUIC_LB_NONCE_MAXLEN];
+    const uint8_t *enonce = ecid;
+    const uint8_t *esid = ecid + conf->nonce_len;
+
+    memcpy(sid, esid, conf->sid_len);
+    quic_lb_pass(enonce, conf->nonce_len, sid, conf->sid_len);
+
+    memcpy(nonce, enonce, conf->nonce_len);
+    quic_lb_pass(sid, conf->sid_len, nonce, conf->nonce_len);
+
+    quic_lb_pass(nonce, conf->nonce_len, sid, conf->sid_len);
+}
+
+int dp_vs_quic_lb_decode(const struct dp_vs_quic_cid *cid, uint8_t *sid)
+{
+    const struct quic_lb_conf *conf = &g_quic_lb;
+
+    if (!conf->sid_len || (conf->nonce_len && !conf->key_set))
+        return EDPVS_NOTSUPP;
+
+    if (cid->type != DP_VS_QUIC_CID_SERVER ||
+            cid->len < 1 + conf->sid_len + conf->nonce_len ||
+            (cid->data[0] >> QUIC_LB_CONFIG_ID_SHIFT) != conf->config_id)
+        return EDPVS_NOTEXIST;
+
+    if (conf->nonce_len)
+        quic_lb_stream_decrypt(&cid->data[1], sid);
+    else
+        memcpy(sid, &cid->data[1], conf->sid_len);
+
+    return EDPVS_OK;
+}
+
+/*
+ * server id of a real server is the low bytes of its address,
+ * zero extended if server id is longer than the address.
+ */
+bool dp_vs_quic_lb_match(const struct dp_vs_dest *dest, const uint8_t *sid)
+{
+    const uint8_t *addr = (const uint8_t *)&dest->addr;
+    uint8_t addrlen = dest->af == AF_INET6 ? 16 : 4;
+    uint8_t sid_len = g_quic_lb.sid_len;
+    uint8_t i;
+
+    if (sid_len <= addrlen)
+        return memcmp(sid, addr + addrlen - sid_len, sid_len) == 0;
+
+    for (i = 0; i < sid_len - addrlen; i++) {
+        if (sid[i])
+            return false;
+    }
+    return memcmp(sid + i, addr, addrlen) == 0;
+}
+
+static void config_id_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int id;
+
+    assert(str);
+    id = atoi(str);
+    if (id >= 0 && id <= QUIC_LB_CONFIG_ID_MAX) {
+        RTE_LOG(INFO, IPVS, "quic_lb config_id = %d\n", id);
+        g_quic_lb.config_id = id;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid quic_lb config_id %s, using default 0\n", str);
+        g_quic_lb.config_id = 0;
+    }
+
+    FREE_PTR(str);
+}
+
+static void server_id_len_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int len;
+
+    assert(str);
+    len = atoi(str);
+    if (len >= 0 && len <= DP_VS_QUIC_LB_SID_MAXLEN) {
+        RTE_LOG(INFO, IPVS, "quic_lb server_id_len = %d\n", len);
+        g_quic_lb.sid_len = len;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid quic_lb server_id_len %s, "
+                "QUIC-LB disabled\n", str);
+        g_quic_lb.sid_len = 0;
+    }
+
+    FREE_PTR(str);
+}
+
+static void nonce_len_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int len;
+
+    assert(str);
+    len = atoi(str);
+    if (len == 0 || (len >= QUIC_LB_NONCE_MINLEN && len <= QUIC_LB_NONCE_MAXLEN)) {
+        RTE_LOG(INFO, IPVS, "quic_lb nonce_len = %d\n", len);
+        g_quic_lb.nonce_len = len;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid quic_lb nonce_len %s, using plaintext\n", str);
+        g_quic_lb.nonce_len = 0;
+    }
+
+    FREE_PTR(str);
+}
+
+static void cid_len_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int len;
+
+    assert(str);
+    len = atoi(str);
+    if (len == 0 || (len > 1 && len <= DP_VS_QUIC_CID_MAXLEN)) {
+        RTE_LOG(INFO, IPVS, "quic_lb cid_len = %d\n", len);
+        g_quic_lb.cid_len = len;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid quic_lb cid_len %s, "
+                "using self-described length\n", str);
+        g_quic_lb.cid_len = 0;
+    }
+
+    FREE_PTR(str);
+}
+
+static void key_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    uint8_t key[QUIC_LB_KEY_LEN];
+    unsigned int byte;
+    int i;
+
+    assert(str);
+    g_quic_lb.key_set = false;
+
+    if (strlen(str) != QUIC_LB_KEY_LEN * 2)
+        goto invalid;
+    for (i = 0; i < QUIC_LB_KEY_LEN; i++) {
+        if (!isxdigit(str[i * 2]) || !isxdigit(str[i * 2 + 1]) ||
+                sscanf(&str[i * 2], "%2x", &byte) != 1)
+            goto invalid;
+        key[i] = byte;
+    }
+
+    AES_set_encrypt_key(key, QUIC_LB_KEY_LEN * 8, &g_quic_lb.key);
+    g_quic_lb.key_set = true;
+    RTE_LOG(INFO, IPVS, "quic_lb key set\n");
+    FREE_PTR(str);
+    return;
+
+invalid:
+    RTE_LOG(WARNING, IPVS, "invalid quic_lb key, %d hex digits expected\n",
+            QUIC_LB_KEY_LEN * 2);
+    FREE_PTR(str);
+}
+
+void quic_lb_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+    }
+
+    /* KW_TYPE_NORMAL keyword */
+    g_quic_lb.config_id = 0;
+    g_quic_lb.sid_len = 0;
+    g_quic_lb.nonce_len = 0;
+    g_quic_lb.cid_len = 0;
+    g_quic_lb.key_set = false;
+}
+
+void install_quic_lb_keywords(void)
+{
+    install_keyword("quic_lb", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_keyword("config_id", config_id_handler, KW_TYPE_NORMAL);
+    install_keyword("server_id_len", server_id_len_handler, KW_TYPE_NORMAL);
+    install_keyword("nonce_len", nonce_len_handler, KW_TYPE_NORMAL);
+    install_keyword("cid_len", cid_len_handler, KW_TYPE_NORMAL);
+    install_keyword("key", key_handler, KW_TYPE_NORMAL);
+    install_sublevel_end();
+}
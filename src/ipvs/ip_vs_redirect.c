@@ -30,6 +30,40 @@ static struct rte_mempool *dp_vs_cr_cache[DPVS_MAX_SOCKET];
 
 static struct rte_ring    *dp_vs_redirect_ring[DPVS_MAX_LCORE][DPVS_MAX_LCORE];
 
+/* per-lcore redirect states, only accessed by its own lcore */
+struct dp_vs_redirect_lcore {
+    /* mbufs to peers, flushed at the end of each rx batch */
+    uint64_t               staged;  /* bitmap of peers with mbufs staged */
+    uint16_t               nstage[DPVS_MAX_LCORE];
+    struct rte_mbuf       *stage[DPVS_MAX_LCORE][NETIF_MAX_PKT_BURST];
+
+    /* freed redirects, gc[1] is returned to mempool once all other
+     * lcores passed a quiescent state since gc_qs was taken */
+    struct dp_vs_redirect *gc[2];
+    uint64_t               gc_qs[DPVS_MAX_LCORE];
+} __rte_cache_aligned;
+
+/*
+ * a lookup holds the redirect only until the lcore loops again, @qs is
+ * increased by the lcore at the start of each loop. redirects freed on
+ * other lcores are pushed to @remote of their owner.
+ */
+struct dp_vs_redirect_qs {
+    volatile uint64_t      qs;
+    struct dp_vs_redirect *remote;
+} __rte_cache_aligned;
+
+/* bit @peer of lcore's doorbell is set if dp_vs_redirect_ring[lcore][peer]
+ * may have mbufs, so that consumer only touches non-empty rings. */
+struct dp_vs_redirect_doorbell {
+    volatile uint64_t      bits;
+} __rte_cache_aligned;
+
+static struct dp_vs_redirect_lcore    dp_vs_cr_lcore[DPVS_MAX_LCORE];
+static struct dp_vs_redirect_doorbell dp_vs_cr_doorbell[DPVS_MAX_LCORE];
+static struct dp_vs_redirect_qs       dp_vs_cr_qs[DPVS_MAX_LCORE];
+static uint64_t                       dp_vs_cr_lcore_mask; /* doing lookups */
+
 #ifdef CONFIG_DPVS_IPVS_DEBUG
 static inline void
 dp_vs_redirect_show(struct dp_vs_redirect *r, const char *action)
@@ -81,18 +115,99 @@ dp_vs_redirect_alloc(enum dpvs_fwd_mode fwdmode)
 
     memset(r, 0, sizeof(struct dp_vs_redirect));
     r->redirect_pool = this_cr_cache;
+    r->cid = rte_lcore_id();
 
     return r;
 }
 
+/*
+ * other lcores may be walking through the redirect without lock, so
+ * it's retired on the owner lcore and reused after they all quiesced.
+ */
 void dp_vs_redirect_free(struct dp_vs_conn *conn)
 {
-    if (conn->redirect) {
+    struct dp_vs_redirect *r = conn->redirect;
+    struct dp_vs_redirect_lcore *rl;
+    struct dp_vs_redirect_qs *owner;
+
+    if (!r)
+        return;
+
 #ifdef CONFIG_DPVS_IPVS_DEBUG
-        dp_vs_redirect_show(conn->redirect, "free");
+    dp_vs_redirect_show(r, "free");
 #endif
-        rte_mempool_put(this_cr_cache, conn->redirect);
-        conn->redirect = NULL;
+    conn->redirect = NULL;
+
+    if (likely(r->cid == rte_lcore_id())) {
+        rl = &dp_vs_cr_lcore[r->cid];
+        r->gc_next = rl->gc[0];
+        rl->gc[0] = r;
+        return;
+    }
+
+    owner = &dp_vs_cr_qs[r->cid];
+    r->gc_next = __atomic_load_n(&owner->remote, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&owner->remote, &r->gc_next, r, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+}
+
+static inline bool dp_vs_redirect_quiesced(const struct dp_vs_redirect_lcore *rl,
+                                           lcoreid_t cid)
+{
+    uint64_t mask = dp_vs_cr_lcore_mask & ~(1ULL << cid);
+    lcoreid_t peer;
+
+    while (mask) {
+        peer = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (dp_vs_cr_qs[peer].qs == rl->gc_qs[peer])
+            return false;
+    }
+    return true;
+}
+
+static inline void dp_vs_redirect_gc(lcoreid_t cid)
+{
+    struct dp_vs_redirect_lcore *rl = &dp_vs_cr_lcore[cid];
+    struct dp_vs_redirect_qs *qs = &dp_vs_cr_qs[cid];
+    struct dp_vs_redirect *r, *next;
+    uint64_t mask;
+    lcoreid_t peer;
+
+    /* no redirect got in last loop is referred any longer */
+    qs->qs++;
+
+    if (unlikely(qs->remote)) {
+        r = __atomic_exchange_n(&qs->remote, NULL, __ATOMIC_ACQUIRE);
+        for (; r; r = next) {
+            next = r->gc_next;
+            r->gc_next = rl->gc[0];
+            rl->gc[0] = r;
+        }
+    }
+
+    if (likely(!rl->gc[0] && !rl->gc[1]))
+        return;
+
+    if (rl->gc[1]) {
+        if (!dp_vs_redirect_quiesced(rl, cid))
+            return;
+
+        for (r = rl->gc[1]; r; r = next) {
+            next = r->gc_next;
+            rte_mempool_put(this_cr_cache, r);
+        }
+    }
+
+    rl->gc[1] = rl->gc[0];
+    rl->gc[0] = NULL;
+
+    mask = dp_vs_cr_lcore_mask;
+    while (mask) {
+        peer = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        rl->gc_qs[peer] = dp_vs_cr_qs[peer].qs;
     }
 }
 
@@ -110,8 +225,13 @@ void dp_vs_redirect_hash(struct dp_vs_conn *conn)
                     &tuplehash_out(conn).daddr, tuplehash_out(conn).dport,
                     DPVS_CR_TBL_MASK);
 
+    /* lookups don't lock, publish the redirect before linking it */
     rte_spinlock_lock(&dp_vs_cr_lock[hash]);
-    list_add(&r->list, &dp_vs_cr_tbl[hash]);
+    r->list.next = dp_vs_cr_tbl[hash].next;
+    r->list.prev = &dp_vs_cr_tbl[hash];
+    rte_smp_wmb();
+    dp_vs_cr_tbl[hash].next->prev = &r->list;
+    dp_vs_cr_tbl[hash].next = &r->list;
     rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
 
     dp_vs_conn_set_redirect_hashed(conn);
@@ -128,8 +248,9 @@ void dp_vs_redirect_unhash(struct dp_vs_conn *conn)
                                   &r->daddr, r->dport,
                                   DPVS_CR_TBL_MASK);
 
+        /* keep r->list.next for lookups walking through it */
         rte_spinlock_lock(&dp_vs_cr_lock[hash]);
-        list_del(&r->list);
+        __list_del(r->list.prev, r->list.next);
         rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
 
         dp_vs_conn_clear_redirect_hashed(conn);
@@ -181,7 +302,8 @@ void dp_vs_redirect_init(struct dp_vs_conn *conn)
  *
  *  <af, proto, saddr, sport, daddr, dport>.
  *
- * return r if found or NULL if not exist.
+ * return r if found or NULL if not exist. it's lock-free, @r is valid
+ * until the caller returns to the lcore loop.
  */
 struct dp_vs_redirect *
 dp_vs_redirect_get(int af, uint16_t proto,
@@ -197,7 +319,6 @@ dp_vs_redirect_get(int af, uint16_t proto,
 
     hash = dp_vs_conn_hashkey(af, saddr, sport, daddr, dport, DPVS_CR_TBL_MASK);
 
-    rte_spinlock_lock(&dp_vs_cr_lock[hash]);
     list_for_each_entry(r, &dp_vs_cr_tbl[hash], list) {
         if (r->af == af
             && r->proto == proto
@@ -208,13 +329,10 @@ dp_vs_redirect_get(int af, uint16_t proto,
             goto found;
         }
     }
-    rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
 
     return NULL;
 
 found:
-    rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
-
 #ifdef CONFIG_DPVS_IPVS_DEBUG
     dp_vs_redirect_show(r, "get");
 #endif
@@ -222,36 +340,75 @@ found:
     return r;
 }
 
+static void dp_vs_redirect_flush_peer(struct dp_vs_redirect_lcore *rl,
+                                      lcoreid_t cid, lcoreid_t peer_cid)
+{
+    unsigned int n = rl->nstage[peer_cid], sent, i;
+
+    sent = rte_ring_enqueue_burst(dp_vs_redirect_ring[peer_cid][cid],
+                                  (void **)rl->stage[peer_cid], n, NULL);
+    if (likely(sent > 0))
+        __sync_fetch_and_or(&dp_vs_cr_doorbell[peer_cid].bits, 1ULL << cid);
+
+    if (unlikely(sent < n)) {
+        RTE_LOG(ERR, IPVS,
+                "%s: [%d] failed to enqueue %u mbufs to redirect_ring[%d][%d]\n",
+                __func__, cid, n - sent, peer_cid, cid);
+        for (i = sent; i < n; i++)
+            rte_pktmbuf_free(rl->stage[peer_cid][i]);
+    }
+
+#ifdef CONFIG_DPVS_IPVS_DEBUG
+    RTE_LOG(DEBUG, IPVS,
+            "%s: [%d] enqueued %u mbufs to redirect_ring[%d][%d]\n",
+            __func__, cid, sent, peer_cid, cid);
+#endif
+
+    rl->nstage[peer_cid] = 0;
+    rl->staged &= ~(1ULL << peer_cid);
+}
+
 /**
  * Forward the packet to the found redirect owner core.
+ * it's staged and sent in burst by dp_vs_redirect_flush().
  */
 int dp_vs_redirect_pkt(struct rte_mbuf *mbuf, lcoreid_t peer_cid)
 {
     lcoreid_t cid = rte_lcore_id();
-    int ret;
+    struct dp_vs_redirect_lcore *rl = &dp_vs_cr_lcore[cid];
 
-    ret = rte_ring_enqueue(dp_vs_redirect_ring[peer_cid][cid], mbuf);
-    if (ret < 0) {
-        RTE_LOG(ERR, IPVS,
-                "%s: [%d] failed to enqueue mbuf to redirect_ring[%d][%d]\n",
-                __func__, cid, peer_cid, cid);
+    if (unlikely(!dp_vs_redirect_ring[peer_cid][cid]))
         return INET_DROP;
-    }
 
-#ifdef CONFIG_DPVS_IPVS_DEBUG
-    RTE_LOG(DEBUG, IPVS,
-            "%s: [%d] enqueued mbuf to redirect_ring[%d][%d]\n",
-            __func__, cid, peer_cid, cid);
-#endif
+    rl->stage[peer_cid][rl->nstage[peer_cid]++] = mbuf;
+    rl->staged |= (1ULL << peer_cid);
+
+    if (rl->nstage[peer_cid] >= NETIF_MAX_PKT_BURST)
+        dp_vs_redirect_flush_peer(rl, cid, peer_cid);
 
     return INET_STOLEN;
 }
 
+/* send staged mbufs to peers, at the end of each rx batch */
+void dp_vs_redirect_flush(lcoreid_t cid)
+{
+    struct dp_vs_redirect_lcore *rl = &dp_vs_cr_lcore[cid];
+    uint64_t staged = rl->staged;
+    lcoreid_t peer_cid;
+
+    while (staged) {
+        peer_cid = __builtin_ctzll(staged);
+        staged &= staged - 1;
+        dp_vs_redirect_flush_peer(rl, cid, peer_cid);
+    }
+}
+
 void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid)
 {
     struct rte_mbuf *mbufs[NETIF_MAX_PKT_BURST];
-    uint16_t nb_rb;
+    unsigned int nb_rb, avail;
     lcoreid_t peer_cid;
+    uint64_t bells;
 
     if (dp_vs_redirect_disable) {
         return;
@@ -259,14 +416,27 @@ void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid)
 
     cid = rte_lcore_id();
 
-    for (peer_cid = 0; peer_cid < DPVS_MAX_LCORE; peer_cid++) {
-        if (dp_vs_redirect_ring[cid][peer_cid]) {
-            nb_rb = rte_ring_dequeue_burst(dp_vs_redirect_ring[cid][peer_cid],
-                                           (void**)mbufs,
-                                           NETIF_MAX_PKT_BURST, NULL);
-            if (nb_rb > 0) {
-                lcore_process_packets(qconf, mbufs, cid, nb_rb, 1);
-            }
+    dp_vs_redirect_gc(cid);
+
+    if (likely(!dp_vs_cr_doorbell[cid].bits)) {
+        return;
+    }
+
+    bells = __sync_lock_test_and_set(&dp_vs_cr_doorbell[cid].bits, 0);
+
+    while (bells) {
+        peer_cid = __builtin_ctzll(bells);
+        bells &= bells - 1;
+
+        nb_rb = rte_ring_dequeue_burst(dp_vs_redirect_ring[cid][peer_cid],
+                                       (void**)mbufs,
+                                       NETIF_MAX_PKT_BURST, &avail);
+        /* more left, ring the bell again for next round */
+        if (avail > 0) {
+            __sync_fetch_and_or(&dp_vs_cr_doorbell[cid].bits, 1ULL << peer_cid);
+        }
+        if (nb_rb > 0) {
+            lcore_process_packets(qconf, mbufs, cid, nb_rb, 1);
         }
     }
 }
@@ -362,6 +532,7 @@ static int dp_vs_redirect_ring_create(void)
         if (cid == rte_get_master_lcore() || netif_lcore_is_idle(cid)) {
             continue;
         }
+        dp_vs_cr_lcore_mask |= (1ULL << cid);
 
         for (peer_cid = 0; peer_cid < DPVS_MAX_LCORE; peer_cid++) {
             if (netif_lcore_is_idle(peer_cid)
@@ -25,6 +25,7 @@
 #include "ipvs/sched.h"
 #include "ipvs/laddr.h"
 #include "ipvs/blklst.h"
+#include "ipvs/synproxy.h"
 #include "ctrl.h"
 #include "route.h"
 #include "route6.h"
@@ -35,6 +36,8 @@
 
 static int dp_vs_num_services = 0;
 
+RTE_DEFINE_PER_LCORE(bool, dp_vs_svc_bulk);
+
 /**
  * hash table for svc
  */
@@ -398,7 +401,7 @@ struct dp_vs_service *dp_vs_service_lookup(int af, uint16_t protocol,
 {
     struct dp_vs_service *svc = NULL;
 
-    rte_rwlock_read_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_read_lock();
 
     if (fwmark && (svc = __dp_vs_svc_fwm_get(af, fwmark)))
         goto out;
@@ -414,7 +417,7 @@ struct dp_vs_service *dp_vs_service_lookup(int af, uint16_t protocol,
         svc = __dp_vs_svc_match_get(af, mbuf, outwall);
 
 out:
-    rte_rwlock_read_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_read_unlock();
 #ifdef CONFIG_DPVS_MBUF_DEBUG
     if (!svc && mbuf)
         dp_vs_mbuf_dump("found service failed.", af, mbuf);
@@ -429,7 +432,7 @@ struct dp_vs_service *dp_vs_lookup_vip(int af, uint16_t protocol,
     struct dp_vs_service *svc;
     unsigned hash;
 
-    rte_rwlock_read_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_read_lock();
 
     hash = dp_vs_svc_hashkey(af, protocol, vaddr);
     list_for_each_entry(svc, &dp_vs_svc_table[hash], s_list) {
@@ -437,12 +440,12 @@ struct dp_vs_service *dp_vs_lookup_vip(int af, uint16_t protocol,
             && inet_addr_equal(af, &svc->addr, vaddr)
             && (svc->proto == protocol)) {
             /* HIT */
-            rte_rwlock_read_unlock(&__dp_vs_svc_lock);
+            dp_vs_svc_read_unlock();
             return svc;
         }
     }
 
-    rte_rwlock_read_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_read_unlock();
     return NULL;
 }
 
@@ -460,6 +463,7 @@ void __dp_vs_unbind_svc(struct dp_vs_dest *dest)
     dest->svc = NULL;
     if (rte_atomic32_dec_and_test(&svc->refcnt)) {
         dp_vs_del_stats(svc->stats);
+        dp_vs_synproxy_auto_term(svc);
         if (svc->match)
             rte_free(svc->match);
         rte_free(svc);
@@ -500,7 +504,7 @@ int dp_vs_add_service(struct dp_vs_service_conf *u,
     svc->addr = u->addr;
     svc->port = u->port;
     svc->fwmark = u->fwmark;
-    svc->flags = u->flags;
+    svc->flags = u->flags & ~DP_VS_SVC_F_SYNPROXY_ACTIVE;
     svc->timeout = u->timeout;
     svc->conn_timeout = u->conn_timeout;
     svc->bps = u->bps;
@@ -534,11 +538,17 @@ int dp_vs_add_service(struct dp_vs_service_conf *u,
     if(ret)
         goto out_err;
 
+    if (svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO) {
+        ret = dp_vs_synproxy_auto_init(svc);
+        if (ret)
+            goto out_err;
+    }
+
     dp_vs_num_services++;
 
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
     dp_vs_svc_hash(svc);
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
 
     *svc_p = svc;
     return EDPVS_OK;
@@ -548,6 +558,7 @@ out_err:
         if (svc->scheduler)
             dp_vs_unbind_scheduler(svc);
         dp_vs_del_stats(svc->stats);
+        dp_vs_synproxy_auto_term(svc);
         if (svc->match)
             rte_free(svc->match);
         rte_free(svc);
@@ -576,7 +587,7 @@ dp_vs_edit_service(struct dp_vs_service *svc, struct dp_vs_service_conf *u)
         goto out;
     }
 
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
 
     /*
      * Wait until all other svc users go away.
@@ -584,9 +595,16 @@ dp_vs_edit_service(struct dp_vs_service *svc, struct dp_vs_service_conf *u)
     DPVS_WAIT_WHILE(rte_atomic32_read(&svc->usecnt) > 1);
 
     /*
-     * Set the flags and timeout value
+     * Set the flags and timeout value. workers may still hold
+     * svc->sp_auto, it's kept until svc is freed, init just resets
+     * it when adaptive synproxy is turned on again.
      */
-    svc->flags = u->flags | DP_VS_SVC_F_HASHED;
+    if ((u->flags & DP_VS_SVC_F_SYNPROXY_AUTO) &&
+        !(svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO)) {
+        if ((ret = dp_vs_synproxy_auto_init(svc)) != EDPVS_OK)
+            goto out_unlock;
+    }
+    svc->flags = (u->flags & ~DP_VS_SVC_F_SYNPROXY_ACTIVE) | DP_VS_SVC_F_HASHED;
     svc->timeout = u->timeout;
     svc->conn_timeout = u->conn_timeout;
     svc->netmask = u->netmask;
@@ -624,7 +642,7 @@ dp_vs_edit_service(struct dp_vs_service *svc, struct dp_vs_service_conf *u)
     }
 
 out_unlock:
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
 out:
     return ret;
 }
@@ -658,6 +676,7 @@ static void __dp_vs_del_service(struct dp_vs_service *svc)
      */
     if (rte_atomic32_dec_and_test(&svc->refcnt)) {
         dp_vs_del_stats(svc->stats);
+        dp_vs_synproxy_auto_term(svc);
         if (svc->match)
             rte_free(svc->match);
         rte_free(svc);
@@ -672,7 +691,7 @@ int dp_vs_del_service(struct dp_vs_service *svc)
     /*
      * Unhash it from the service table
      */
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
 
     dp_vs_svc_unhash(svc);
 
@@ -683,7 +702,7 @@ int dp_vs_del_service(struct dp_vs_service *svc)
 
     __dp_vs_del_service(svc);
 
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
 
     return EDPVS_OK;
 }
@@ -703,6 +722,8 @@ dp_vs_copy_service(struct dp_vs_service_entry *dst, struct dp_vs_service *src)
     snprintf(dst->sched_name, sizeof(dst->sched_name),
              "%s", src->scheduler->name);
     dst->flags = src->flags;
+    if (dp_vs_synproxy_auto_active(src))
+        dst->flags |= DP_VS_SVC_F_SYNPROXY_ACTIVE;
     dst->timeout = src->timeout;
     dst->conn_timeout = src->conn_timeout;
     dst->netmask = src->netmask;
@@ -766,6 +787,33 @@ out:
     return ret;
 }
 
+int dp_vs_service_walk(int (*func)(struct dp_vs_service *svc, void *arg),
+                       void *arg)
+{
+    int idx, err;
+    struct dp_vs_service *svc;
+
+    for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
+        list_for_each_entry(svc, &dp_vs_svc_table[idx], s_list) {
+            if ((err = func(svc, arg)) != EDPVS_OK)
+                return err;
+        }
+    }
+
+    for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
+        list_for_each_entry(svc, &dp_vs_svc_fwm_table[idx], f_list) {
+            if ((err = func(svc, arg)) != EDPVS_OK)
+                return err;
+        }
+    }
+
+    list_for_each_entry(svc, &dp_vs_svc_match_list, m_list) {
+        if ((err = func(svc, arg)) != EDPVS_OK)
+            return err;
+    }
+
+    return EDPVS_OK;
+}
 
 unsigned dp_vs_get_conn_timeout(struct dp_vs_conn *conn)
 {
@@ -788,14 +836,14 @@ int dp_vs_flush(void)
     for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
         list_for_each_entry_safe(svc, nxt, &dp_vs_svc_table[idx],
                      s_list) {
-            rte_rwlock_write_lock(&__dp_vs_svc_lock);
+            dp_vs_svc_write_lock();
             dp_vs_svc_unhash(svc);
             /*
              * Wait until all the svc users go away.
              */
             DPVS_WAIT_WHILE(rte_atomic32_read(&svc->usecnt) > 0);
             __dp_vs_del_service(svc);
-            rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+            dp_vs_svc_write_unlock();
         }
     }
 
@@ -805,43 +853,60 @@ int dp_vs_flush(void)
     for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
         list_for_each_entry_safe(svc, nxt,
                      &dp_vs_svc_fwm_table[idx], f_list) {
-            rte_rwlock_write_lock(&__dp_vs_svc_lock);
+            dp_vs_svc_write_lock();
             dp_vs_svc_unhash(svc);
             /*
              * Wait until all the svc users go away.
              */
             DPVS_WAIT_WHILE(rte_atomic32_read(&svc->usecnt) > 0);
             __dp_vs_del_service(svc);
-            rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+            dp_vs_svc_write_unlock();
         }
     }
 
     list_for_each_entry_safe(svc, nxt,
                     &dp_vs_svc_match_list, m_list) {
-        rte_rwlock_write_lock(&__dp_vs_svc_lock);
+        dp_vs_svc_write_lock();
         dp_vs_svc_unhash(svc);
         /*
          * Wait until all the svc users go away.
          */
         DPVS_WAIT_WHILE(rte_atomic32_read(&svc->usecnt) > 0);
         __dp_vs_del_service(svc);
-        rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+        dp_vs_svc_write_unlock();
     }
 
     return EDPVS_OK;
 }
 
+void dp_vs_svc_bulk_lock(void)
+{
+    assert(rte_lcore_id() == rte_get_master_lcore());
+    assert(!RTE_PER_LCORE(dp_vs_svc_bulk));
+
+    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    RTE_PER_LCORE(dp_vs_svc_bulk) = true;
+}
+
+void dp_vs_svc_bulk_unlock(void)
+{
+    assert(RTE_PER_LCORE(dp_vs_svc_bulk));
+
+    RTE_PER_LCORE(dp_vs_svc_bulk) = false;
+    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+}
+
 int dp_vs_zero_service(struct dp_vs_service *svc)
 {
     struct dp_vs_dest *dest;
 
-    rte_rwlock_write_lock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_lock();
 
     list_for_each_entry(dest, &svc->dests, n_list) {
         dp_svc_stats_clear(dest->stats);
     }
     dp_svc_stats_clear(svc->stats);
-    rte_rwlock_write_unlock(&__dp_vs_svc_lock);
+    dp_vs_svc_write_unlock();
     return EDPVS_OK;
 }
 
@@ -944,6 +1009,8 @@ static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
     if (opt == DPVS_SO_SET_FLUSH)
         return dp_vs_flush();
 
+    if (len > sizeof(arg))
+        return EDPVS_INVAL;
     memcpy(arg, user, len);
     usvc_compat = (struct dp_vs_service_user *)arg;
     udest_compat = (struct dp_vs_dest_user *)(usvc_compat + 1);
@@ -1180,11 +1247,25 @@ static int dp_vs_get_svc(sockoptid_t opt, const void *user, size_t len, void **o
     return ret; 
 }
 
+/* a deleted service or dest can't be restored from the input alone */
+static sockoptid_t dp_vs_set_svc_undo(sockoptid_t opt)
+{
+    switch (opt) {
+    case DPVS_SO_SET_ADD:
+        return DPVS_SO_SET_DEL;
+    case DPVS_SO_SET_ADDDEST:
+        return DPVS_SO_SET_DELDEST;
+    default:
+        return 0;
+    }
+}
+
 struct dpvs_sockopts sockopts_svc = {
     .version        = SOCKOPT_VERSION,
     .set_opt_min    = SOCKOPT_SVC_BASE,
     .set_opt_max    = SOCKOPT_SVC_SET_CMD_MAX,
     .set            = dp_vs_set_svc,
+    .set_undo       = dp_vs_set_svc_undo,
     .get_opt_min    = SOCKOPT_SVC_BASE,
     .get_opt_max    = SOCKOPT_SVC_GET_CMD_MAX,
     .get            = dp_vs_get_svc,
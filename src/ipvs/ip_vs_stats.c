@@ -284,6 +284,106 @@ uint64_t dp_vs_estats_get(enum dp_vs_estats_type field)
     return this_dpvs_estats.mibs[field];
 }
 
+const char *dp_vs_estats_name(enum dp_vs_estats_type field)
+{
+    static const char *names[DP_VS_EXT_STAT_LAST] = {
+        [FULLNAT_ADD_TOA_OK]                = "fullnat_add_toa_ok",
+        [FULLNAT_ADD_TOA_FAIL_LEN]          = "fullnat_add_toa_fail_len",
+        [FULLNAT_ADD_TOA_HEAD_FULL]         = "fullnat_add_toa_head_full",
+        [FULLNAT_ADD_TOA_FAIL_MEM]          = "fullnat_add_toa_fail_mem",
+        [FULLNAT_ADD_TOA_FAIL_PROTO]        = "fullnat_add_toa_fail_proto",
+        [FULLNAT_CONN_REUSED]               = "fullnat_conn_reused",
+        [FULLNAT_CONN_REUSED_CLOSE]         = "fullnat_conn_reused_close",
+        [FULLNAT_CONN_REUSED_TIMEWAIT]      = "fullnat_conn_reused_timewait",
+        [FULLNAT_CONN_REUSED_FINWAIT]       = "fullnat_conn_reused_finwait",
+        [FULLNAT_CONN_REUSED_CLOSEWAIT]     = "fullnat_conn_reused_closewait",
+        [FULLNAT_CONN_REUSED_LASTACK]       = "fullnat_conn_reused_lastack",
+        [FULLNAT_CONN_REUSED_ESTAB]         = "fullnat_conn_reused_estab",
+        [SYNPROXY_RS_ERROR]                 = "synproxy_rs_error",
+        [SYNPROXY_NULL_ACK]                 = "synproxy_null_ack",
+        [SYNPROXY_BAD_ACK]                  = "synproxy_bad_ack",
+        [SYNPROXY_OK_ACK]                   = "synproxy_ok_ack",
+        [SYNPROXY_SYN_CNT]                  = "synproxy_syn_cnt",
+        [SYNPROXY_ACK_STORM]                = "synproxy_ack_storm",
+        [SYNPROXY_SYNSEND_QLEN]             = "synproxy_synsend_qlen",
+        [SYNPROXY_CONN_REUSED]              = "synproxy_conn_reused",
+        [SYNPROXY_CONN_REUSED_CLOSE]        = "synproxy_conn_reused_close",
+        [SYNPROXY_CONN_REUSED_TIMEWAIT]     = "synproxy_conn_reused_timewait",
+        [SYNPROXY_CONN_REUSED_FINWAIT]      = "synproxy_conn_reused_finwait",
+        [SYNPROXY_CONN_REUSED_CLOSEWAIT]    = "synproxy_conn_reused_closewait",
+        [SYNPROXY_CONN_REUSED_LASTACK]      = "synproxy_conn_reused_lastack",
+        [DEFENCE_IP_FRAG_DROP]              = "defence_ip_frag_drop",
+        [DEFENCE_TCP_DROP]                  = "defence_tcp_drop",
+        [DEFENCE_UDP_DROP]                  = "defence_udp_drop",
+        [FAST_XMIT_REJECT]                  = "fast_xmit_reject",
+        [FAST_XMIT_PASS]                    = "fast_xmit_pass",
+        [FAST_XMIT_SKB_COPY]                = "fast_xmit_skb_copy",
+        [FAST_XMIT_NO_MAC]                  = "fast_xmit_no_mac",
+        [FAST_XMIT_SYNPROXY_SAVE]           = "fast_xmit_synproxy_save",
+        [FAST_XMIT_DEV_LOST]                = "fast_xmit_dev_lost",
+        [FAST_XMIT_REJECT_INSIDE]           = "fast_xmit_reject_inside",
+        [FAST_XMIT_PASS_INSIDE]             = "fast_xmit_pass_inside",
+        [FAST_XMIT_SYNPROXY_SAVE_INSIDE]    = "fast_xmit_synproxy_save_inside",
+        [RST_IN_SYN_SENT]                   = "rst_in_syn_sent",
+        [RST_OUT_SYN_SENT]                  = "rst_out_syn_sent",
+        [RST_IN_ESTABLISHED]                = "rst_in_established",
+        [RST_OUT_ESTABLISHED]               = "rst_out_established",
+        [GRO_PASS]                          = "gro_pass",
+        [LRO_REJECT]                        = "lro_reject",
+        [XMIT_UNEXPECTED_MTU]               = "xmit_unexpected_mtu",
+        [CONN_SCHED_UNREACH]                = "conn_sched_unreach",
+        [SYNPROXY_NO_DEST]                  = "synproxy_no_dest",
+        [CONN_EXCEEDED]                     = "conn_exceeded",
+        [SYNPROXY_AUTO_ON]                  = "synproxy_auto_on",
+        [SYNPROXY_AUTO_OFF]                 = "synproxy_auto_off",
+    };
+
+    if (field >= DP_VS_EXT_STAT_LAST)
+        return NULL;
+    return names[field];
+}
+
+void dp_vs_stats_lcore(lcoreid_t cid, struct dp_vs_stats *stats)
+{
+    assert(cid < DPVS_MAX_LCORE);
+    memcpy(stats, &dpvs_stats[cid], sizeof(*stats));
+}
+
+void dp_vs_stats_sum(const struct dp_vs_stats *percpu, struct dp_vs_stats *sum)
+{
+    uint8_t nlcore, i;
+    uint64_t lcore_mask;
+
+    netif_get_slave_lcores(&nlcore, &lcore_mask);
+
+    for (i = 0; i < DPVS_MAX_LCORE; i++) {
+        if (!(lcore_mask & (1L<<i)))
+            continue;
+        sum->conns      += percpu[i].conns;
+        sum->inpkts     += percpu[i].inpkts;
+        sum->inbytes    += percpu[i].inbytes;
+        sum->outpkts    += percpu[i].outpkts;
+        sum->outbytes   += percpu[i].outbytes;
+    }
+}
+
+void dp_vs_estats_sum(uint64_t *mibs)
+{
+    uint8_t nlcore, i;
+    uint64_t lcore_mask;
+    int field;
+
+    netif_get_slave_lcores(&nlcore, &lcore_mask);
+
+    memset(mibs, 0, sizeof(uint64_t) * DP_VS_EXT_STAT_LAST);
+    for (i = 0; i < DPVS_MAX_LCORE; i++) {
+        if (!(lcore_mask & (1L<<i)))
+            continue;
+        for (field = 0; field < DP_VS_EXT_STAT_LAST; field++)
+            mibs[field] += dpvs_estats[i].mibs[field];
+    }
+}
+
 int dp_vs_stats_init(void)
 {
     dp_vs_stats_clear();
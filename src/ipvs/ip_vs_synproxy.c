@@ -18,18 +18,20 @@
 #include <assert.h>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
-#include <openssl/md5.h>
 #include "common.h"
 #include "dpdk.h"
 #include "ipvs/ipvs.h"
 #include "ipvs/synproxy.h"
 #include "timer.h"
+#include "siphash.h"
 #include "ipv4.h"
 #include "ipv6.h"
 #include "ipvs/proto.h"
 #include "ipvs/proto_tcp.h"
 #include "ipvs/blklst.h"
 #include "parser/parser.h"
+#include "ctrl.h"
+#include "conf/synproxy.h"
 
 /* synproxy controll variables */
 /* syn-proxy ctrl variables */
@@ -63,10 +65,19 @@ int dp_vs_synproxy_ctrl_conn_reuse_la = DP_VS_SYNPROXY_CONN_REUSE_LA_DEFAULT;
 int dp_vs_synproxy_ctrl_dup_ack_thresh = DP_VS_SYNPROXY_DUP_ACK_DEFAULT;
 int dp_vs_synproxy_ctrl_max_ack_saved = DP_VS_SYNPROXY_MAX_ACK_SAVED_DEFAULT;
 int dp_vs_synproxy_ctrl_syn_retry = DP_VS_SYNPROXY_SYN_RETRY_DEFAULT;
+int dp_vs_synproxy_ctrl_syn_fast = 0;
 
-#define DP_VS_SYNPROXY_ACK_MBUFPOOL_SIZE        1048575  // 2^20 - 1
-#define DP_VS_SYNPROXY_ACK_CACHE_SIZE           256
-struct rte_mempool *dp_vs_synproxy_ack_mbufpool[DPVS_MAX_SOCKET];
+/* adaptive synproxy thresholds, per lcore per second */
+#define DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT    10000
+#define DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT   2000
+#define DP_VS_SYNPROXY_AUTO_COOLDOWN_DEFAULT    30
+static int dp_vs_synproxy_auto_syn_rate = DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT;
+static int dp_vs_synproxy_auto_half_open = DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT;
+static int dp_vs_synproxy_auto_cooldown = DP_VS_SYNPROXY_AUTO_COOLDOWN_DEFAULT;
+
+/* written by the owner lcore only, read by master for sockopt */
+static struct dp_vs_synproxy_stats dp_vs_synproxy_stats[DPVS_MAX_LCORE];
+#define this_synproxy_stats (dp_vs_synproxy_stats[rte_lcore_id()])
 
 #ifdef CONFIG_SYNPROXY_DEBUG
 rte_atomic32_t sp_syn_saved;
@@ -76,16 +87,48 @@ static struct dpvs_timer g_second_timer;
 #endif
 
 /*
- * syncookies using digest function from openssl libray,
- * a little difference from kernel, which uses md5_transform
- * */
-static uint32_t g_net_secret[2][MD5_LBLOCK];
+ * This (misnamed) value is the age of syncookie which is permitted.
+ * Its ideal value should be dependent on TCP_TIMEOUT_INIT and
+ * sysctl_tcp_retries. It's a rather complicated formula (exponetional
+ * backoff) to compute at runtime so it's currently hardcoded here.
+ */
+#define DP_VS_SYNPROXY_COUNTER_TRIES 4
+
+/*
+ * syncookies using SipHash-2-4 keyed by secrets.
+ * g_cookie_key0 hashes the tuple, g_cookie_key1 hashes the tuple and count.
+ * count increases every minute, and key1 is renewed every 2^KEY_EPOCH_BITS
+ * minutes, the key of each epoch of count is g_cookie_key1[epoch & 1].
+ */
+#define DP_VS_SYNPROXY_KEY_EPOCH_BITS   3
+#define DP_VS_SYNPROXY_KEY_EPOCH_MASK   ((1 << DP_VS_SYNPROXY_KEY_EPOCH_BITS) - 1)
+#define cookie_key1(count) \
+    (&g_cookie_key1[((count) >> DP_VS_SYNPROXY_KEY_EPOCH_BITS) & 1])
+
+static struct siphash_key g_cookie_key0;
+static struct siphash_key g_cookie_key1[2];
 static struct dpvs_timer g_minute_timer;
 static rte_atomic32_t g_minute_count;
 
+static inline void cookie_key_init(struct siphash_key *key)
+{
+    key->k[0] = rte_rand();
+    key->k[1] = rte_rand();
+}
+
 static int minute_timer_expire( void *priv)
 {
     struct timeval tv;
+    uint32_t count = rte_atomic32_read(&g_minute_count) + 1;
+
+    /*
+     * cookies of last epoch are too old to be accepted now,
+     * renew its key for the next epoch before anyone uses it.
+     */
+    if ((count & DP_VS_SYNPROXY_KEY_EPOCH_MASK) == DP_VS_SYNPROXY_COUNTER_TRIES) {
+        cookie_key_init(cookie_key1(count + DP_VS_SYNPROXY_KEY_EPOCH_MASK + 1));
+        rte_smp_wmb();
+    }
 
     rte_atomic32_inc(&g_minute_count);
 
@@ -114,36 +157,67 @@ static int second_timer_expire(void *priv)
 }
 #endif
 
+static int synproxy_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                                void **out, size_t *outsize)
+{
+    struct dp_vs_synproxy_stats_param *param;
+    struct dp_vs_synproxy_stats *cpu;
+    lcoreid_t cid;
+
+    if (opt != SOCKOPT_GET_SYNPROXY_STATS)
+        return EDPVS_NOTSUPP;
+
+    if (!out || !outsize)
+        return EDPVS_INVAL;
+
+    param = rte_zmalloc(NULL, sizeof(*param), 0);
+    if (!param)
+        return EDPVS_NOMEM;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        cpu = &param->stats_cpus[cid];
+        *cpu = dp_vs_synproxy_stats[cid];
+
+        param->stats.ack_held += cpu->ack_held;
+        param->stats.ack_bytes += cpu->ack_bytes;
+        param->stats.ack_saved += cpu->ack_saved;
+        param->stats.ack_refused += cpu->ack_refused;
+    }
+
+    *out = param;
+    *outsize = sizeof(*param);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts synproxy_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_GET_SYNPROXY_STATS,
+    .set_opt_max    = SOCKOPT_GET_SYNPROXY_STATS,
+    .set            = NULL,
+
+    .get_opt_min    = SOCKOPT_GET_SYNPROXY_STATS,
+    .get_opt_max    = SOCKOPT_GET_SYNPROXY_STATS,
+    .get            = synproxy_sockopt_get,
+};
+
 int dp_vs_synproxy_init(void)
 {
-    int i;
-    char ack_mbufpool_name[32];
+    int err;
     struct timeval tv;
 
-    for (i = 0; i < MD5_LBLOCK; i++) {
-        g_net_secret[0][i] = (uint32_t)random();
-        g_net_secret[1][i] = (uint32_t)random();
-    }
+    cookie_key_init(&g_cookie_key0);
+    cookie_key_init(&g_cookie_key1[0]);
+    cookie_key_init(&g_cookie_key1[1]);
 
     rte_atomic32_set(&g_minute_count, (uint32_t)random());
     tv.tv_sec = 60; /* one minute timer */
     tv.tv_usec = 0;
     dpvs_timer_sched(&g_minute_timer, &tv, minute_timer_expire, NULL, true);
 
-    /* allocate NUMA-aware ACK list cache */
-    for (i = 0; i < get_numa_nodes(); i++) {
-        snprintf(ack_mbufpool_name, sizeof(ack_mbufpool_name), "ack_mbufpool_%d", i);
-        dp_vs_synproxy_ack_mbufpool[i] = rte_mempool_create(ack_mbufpool_name,
-                DP_VS_SYNPROXY_ACK_MBUFPOOL_SIZE,
-                sizeof(struct dp_vs_synproxy_ack_pakcet),
-                DP_VS_SYNPROXY_ACK_CACHE_SIZE,
-                0, NULL, NULL, NULL, NULL,
-                i, 0);
-        if (!dp_vs_synproxy_ack_mbufpool[i]) {
-            for (i = i - 1; i >= 0; i--)
-                rte_mempool_free(dp_vs_synproxy_ack_mbufpool[i]);
-            return EDPVS_NOMEM;
-        }
+    err = sockopt_register(&synproxy_sockopts);
+    if (err != EDPVS_OK) {
+        dpvs_timer_cancel(&g_minute_timer, true);
+        return err;
     }
 
 #ifdef CONFIG_SYNPROXY_DEBUG
@@ -160,37 +234,70 @@ int dp_vs_synproxy_init(void)
 
 int dp_vs_synproxy_term(void)
 {
-    int i;
     dpvs_timer_cancel(&g_minute_timer, true);
+    sockopt_unregister(&synproxy_sockopts);
+
+    return EDPVS_OK;
+}
+
+/*
+ * acks live in the conn itself and are accounted on the conn's lcore,
+ * it's where the conn is created, stashes and expires.
+ */
+int dp_vs_synproxy_ack_stash(struct dp_vs_conn *cp, struct rte_mbuf *mbuf)
+{
+    if (unlikely(cp->ack_num >= DP_VS_SYNPROXY_ACK_STASH)) {
+        this_synproxy_stats.ack_refused++;
+        sp_dbg_stats64_inc(sp_ack_refused);
+        return EDPVS_NOROOM;
+    }
 
-    for (i = 0; i < get_numa_nodes(); i++)
-        rte_mempool_free(dp_vs_synproxy_ack_mbufpool[i]);
+    cp->ack_mbuf[cp->ack_num++] = mbuf;
+
+    this_synproxy_stats.ack_held++;
+    this_synproxy_stats.ack_bytes += mbuf->buf_len;
+    this_synproxy_stats.ack_saved++;
+    sp_dbg_stats32_inc(sp_ack_saved);
 
     return EDPVS_OK;
 }
 
+/* drop the accounting of @cp's acks, the mbufs are handed to the caller */
+static inline void syn_proxy_ack_release(struct dp_vs_conn *cp)
+{
+    uint32_t i;
+
+    for (i = 0; i < cp->ack_num; i++) {
+        this_synproxy_stats.ack_held--;
+        this_synproxy_stats.ack_bytes -= cp->ack_mbuf[i]->buf_len;
+        sp_dbg_stats32_dec(sp_ack_saved);
+    }
+    cp->ack_num = 0;
+}
+
+void dp_vs_synproxy_ack_flush(struct dp_vs_conn *cp)
+{
+    uint32_t i;
+
+    for (i = 0; i < cp->ack_num; i++)
+        rte_pktmbuf_free(cp->ack_mbuf[i]);
+    syn_proxy_ack_release(cp);
+}
+
 #define COOKIEBITS 24 /* Upper bits store count */
 #define COOKIEMASK (((uint32_t)1 << COOKIEBITS) - 1)
 
-static uint32_t
+static inline uint32_t
 cookie_hash(uint32_t saddr, uint32_t daddr,
             uint16_t sport, uint16_t dport,
-            uint32_t count, int c)
+            uint32_t count, const struct siphash_key *key)
 {
-    unsigned char hash[MD5_DIGEST_LENGTH];
-    uint32_t data[5];
-    uint32_t hvalue;
-
-    data[0] = saddr;
-    data[1] = daddr;
-    data[2] = (sport << 16) + dport;
-    data[3] = count;
-    data[4] = g_net_secret[c][0];
+    uint64_t data[2];
 
-    MD5((unsigned char *)data, sizeof(data), hash);
-    memcpy(&hvalue, hash, sizeof(hvalue));
+    data[0] = ((uint64_t)daddr << 32) | saddr;
+    data[1] = ((uint64_t)count << 32) | ((uint32_t)sport << 16) | dport;
 
-    return hvalue;
+    return (uint32_t)siphash_2_4(data, 2, key);
 }
 
 static uint32_t
@@ -208,9 +315,10 @@ secure_tcp_syn_cookie(uint32_t saddr, uint32_t daddr,
      * As an extra hack, we add a small "data" value that encodes the MSS into
      * the second hash value.
      */
-    return (cookie_hash(saddr, daddr, sport, dport, 0, 0) +
+    return (cookie_hash(saddr, daddr, sport, dport, 0, &g_cookie_key0) +
         sseq + (count << COOKIEBITS) +
-        ((cookie_hash(saddr, daddr, sport, dport, count, 1) + data) & COOKIEMASK));
+        ((cookie_hash(saddr, daddr, sport, dport, count, cookie_key1(count))
+          + data) & COOKIEMASK));
 }
 
 static uint32_t
@@ -232,42 +340,32 @@ check_tcp_syn_cookie(uint32_t cookie,
     uint32_t diff;
 
     /* Strip away the layers from the cookie */
-    cookie -= cookie_hash(saddr, daddr, sport, dport, 0, 0) + sseq;
+    cookie -= cookie_hash(saddr, daddr, sport, dport, 0, &g_cookie_key0) + sseq;
 
     /* Cookie is now reduced to (count * 2^24) ^ (hash % 2^24) */
     diff = (count - (cookie >> COOKIEBITS)) & ((uint32_t) -1 >> COOKIEBITS);
     if (diff >= maxdiff)
         return (uint32_t) -1;
 
-    return (cookie - cookie_hash(saddr, daddr, sport, dport, count - diff, 1))
+    count -= diff;
+    return (cookie - cookie_hash(saddr, daddr, sport, dport, count,
+                                 cookie_key1(count)))
         & COOKIEMASK; /* Leaving the data behind */
 }
 
-static uint32_t
+static inline uint32_t
 cookie_hash_v6(const struct in6_addr *saddr,
                const struct in6_addr *daddr,
                uint16_t sport, uint16_t dport,
-               uint32_t count, int c)
+               uint32_t count, const struct siphash_key *key)
 {
-    int i;
-    uint32_t hvalue, data[MD5_LBLOCK];
-    unsigned char hash[MD5_DIGEST_LENGTH];
-
-    for (i = 0; i < 4; i++)
-        data[i] = g_net_secret[c][i] + ((uint32_t *)saddr)[i];
-    for (i = 4; i < 8; i++)
-        data[i] = g_net_secret[c][i] + ((uint32_t *)daddr)[i-4];
-
-    data[8] = g_net_secret[c][8] + ((sport << 16) + dport);
-    data[9] = g_net_secret[c][9] + count;
-
-    for (i = 10; i < MD5_LBLOCK; i++)
-        data[i] = g_net_secret[c][i];
+    uint64_t data[5];
 
-    MD5((unsigned char*)data, sizeof(data), hash);
-    memcpy(&hvalue, hash, sizeof(hvalue));
+    memcpy(&data[0], saddr, sizeof(*saddr));
+    memcpy(&data[2], daddr, sizeof(*daddr));
+    data[4] = ((uint64_t)count << 32) | ((uint32_t)sport << 16) | dport;
 
-    return hvalue;
+    return (uint32_t)siphash_2_4(data, 5, key);
 }
 
 static uint32_t
@@ -277,10 +375,10 @@ secure_tcp_syn_cookie_v6(const struct in6_addr *saddr,
                       uint32_t sseq, uint32_t count,
                       uint32_t data)
 {
-    return (cookie_hash_v6(saddr, daddr, sport, dport, 0, 0)
+    return (cookie_hash_v6(saddr, daddr, sport, dport, 0, &g_cookie_key0)
             + sseq + (count << COOKIEBITS)
-            + ((cookie_hash_v6(saddr, daddr, sport, dport, count, 1)
-                    + data) & COOKIEMASK));
+            + ((cookie_hash_v6(saddr, daddr, sport, dport, count,
+                               cookie_key1(count)) + data) & COOKIEMASK));
 }
 
 static uint32_t
@@ -293,14 +391,15 @@ check_tcp_syn_cookie_v6(uint32_t cookie,
 {
     uint32_t diff;
 
-    cookie -= cookie_hash_v6(saddr, daddr, sport, dport, 0, 0) + sseq;
+    cookie -= cookie_hash_v6(saddr, daddr, sport, dport, 0, &g_cookie_key0) + sseq;
 
     diff = (count - (cookie >> COOKIEBITS)) & ((uint32_t) -1 >> COOKIEBITS);
     if (diff >= maxdiff)
         return (uint32_t) -1;
 
+    count -= diff;
     return (cookie - cookie_hash_v6(saddr, daddr, sport, dport,
-                count - diff, 1)) & COOKIEMASK;
+                count, cookie_key1(count))) & COOKIEMASK;
 }
 
 /* This table has to be sorted and terminated with (uint16_t)-1.
@@ -324,14 +423,6 @@ static uint16_t const msstab[] = {
 /* The number doesn't include the -1 terminator */
 #define NUM_MSS (NELEMS(msstab) - 1)
 
-/*
- * This (misnamed) value is the age of syncookie which is permitted.
- * Its ideal value should be dependent on TCP_TIMEOUT_INIT and
- * sysctl_tcp_retries. It's a rather complicated formula (exponetional
- * backoff) to compute at runtime so it's currently hardcoded here.
- */
-#define DP_VS_SYNPROXY_COUNTER_TRIES 4
-
 /*
  * Generate a syncookie for dp_vs module.
  * Besides mss, we store additional tcp options in cookie "data".
@@ -343,12 +434,9 @@ static uint16_t const msstab[] = {
  * [19-16] snd_wscale
  * [15-12] MSSIND
  */
-static uint32_t
-syn_proxy_cookie_v4_init_sequence(struct rte_mbuf *mbuf,
-                                  const struct tcphdr *th,
-                                  struct dp_vs_synproxy_opt *opts)
+static inline uint32_t
+syn_proxy_cookie_data(struct dp_vs_synproxy_opt *opts)
 {
-    const struct iphdr *iph = (struct iphdr*)ip4_hdr(mbuf);
     int mssind;
     const uint16_t mss = opts->mss_clamp;
     uint32_t data;
@@ -363,9 +451,20 @@ syn_proxy_cookie_v4_init_sequence(struct rte_mbuf *mbuf,
     data |= opts->tstamp_ok << DP_VS_SYNPROXY_TSOK_BIT;
     data |= ((opts->snd_wscale & 0xf) << DP_VS_SYNPROXY_SND_WSCALE_BITS);
 
+    return data;
+}
+
+static uint32_t
+syn_proxy_cookie_v4_init_sequence(struct rte_mbuf *mbuf,
+                                  const struct tcphdr *th,
+                                  struct dp_vs_synproxy_opt *opts)
+{
+    const struct iphdr *iph = (struct iphdr*)ip4_hdr(mbuf);
+
     return secure_tcp_syn_cookie(iph->saddr, iph->daddr,
             th->source, th->dest, ntohl(th->seq),
-            rte_atomic32_read(&g_minute_count), data);
+            rte_atomic32_read(&g_minute_count),
+            syn_proxy_cookie_data(opts));
 }
 
 static uint32_t
@@ -374,23 +473,53 @@ syn_proxy_cookie_v6_init_sequence(struct rte_mbuf *mbuf,
                                   struct dp_vs_synproxy_opt *opts)
 {
     const struct ip6_hdr *ip6h = ip6_hdr(mbuf);
-    int mssind;
-    const uint16_t mss = opts->mss_clamp;
-    uint32_t data;
-
-    /* XXX sort msstab[] by probability? Binary serarch? */
-    for (mssind = 0; mss > msstab[mssind + 1]; mssind++)
-        ;
-    opts->mss_clamp = msstab[mssind] + 1;
-
-    data = ((mssind & 0x0f) << DP_VS_SYNPROXY_MSS_BITS);
-    data |= opts->sack_ok << DP_VS_SYNPROXY_SACKOK_BIT;
-    data |= opts->tstamp_ok << DP_VS_SYNPROXY_TSOK_BIT;
-    data |= ((opts->snd_wscale & 0xf) << DP_VS_SYNPROXY_SND_WSCALE_BITS);
 
     return secure_tcp_syn_cookie_v6(&ip6h->ip6_src, &ip6h->ip6_dst,
             th->source, th->dest, ntohl(th->seq),
-            rte_atomic32_read(&g_minute_count), data);
+            rte_atomic32_read(&g_minute_count),
+            syn_proxy_cookie_data(opts));
+}
+
+/*
+ * Generate syncookies for a burst of SYNs, count and keys are
+ * loaded once for the burst and hashes of one packet don't depend
+ * on each other, so they are computed back to back.
+ */
+void dp_vs_synproxy_cookie_init_bulk(int af, struct rte_mbuf **mbufs,
+                                     struct tcphdr **ths,
+                                     struct dp_vs_synproxy_opt *opts,
+                                     uint32_t *isns, unsigned int n)
+{
+    const uint32_t count = rte_atomic32_read(&g_minute_count);
+    const struct siphash_key key0 = g_cookie_key0;
+    const struct siphash_key key1 = *cookie_key1(count);
+    const struct tcphdr *th;
+    uint32_t h0, h1, data;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        th = ths[i];
+        data = syn_proxy_cookie_data(&opts[i]);
+
+        if (AF_INET6 == af) {
+            const struct ip6_hdr *ip6h = ip6_hdr(mbufs[i]);
+
+            h0 = cookie_hash_v6(&ip6h->ip6_src, &ip6h->ip6_dst,
+                                th->source, th->dest, 0, &key0);
+            h1 = cookie_hash_v6(&ip6h->ip6_src, &ip6h->ip6_dst,
+                                th->source, th->dest, count, &key1);
+        } else {
+            const struct iphdr *iph = (struct iphdr *)ip4_hdr(mbufs[i]);
+
+            h0 = cookie_hash(iph->saddr, iph->daddr,
+                             th->source, th->dest, 0, &key0);
+            h1 = cookie_hash(iph->saddr, iph->daddr,
+                             th->source, th->dest, count, &key1);
+        }
+
+        isns[i] = h0 + ntohl(th->seq) + (count << COOKIEBITS)
+                  + ((h1 + data) & COOKIEMASK);
+    }
 }
 
 /*
@@ -569,38 +698,15 @@ static void syn_proxy_parse_set_opts(struct rte_mbuf *mbuf, struct tcphdr *th,
     }
 }
 
-/* Reuse mbuf for syn proxy, called by syn_proxy_syn_rcv().
- * do following things:
- * 1) set tcp options,
- * 2) compute seq with cookie func,
- * 3) set tcp seq and ack_seq,
- * 4) exchange ip addr and tcp port,
- * 5) compute iphdr and tcp check (HW xmit checksum offload not support for syn).
+/* Turn the syn into syn-ack with seq @isn, called by syn_proxy_reuse_mbuf().
+ * 1) set tcp seq and ack_seq,
+ * 2) exchange ip addr and tcp port,
+ * 3) compute iphdr and tcp check (HW xmit checksum offload not support for syn).
  */
-static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
-                                 struct tcphdr *th,
-                                 struct dp_vs_synproxy_opt *opt)
+static void syn_proxy_synack_mbuf(int af, struct rte_mbuf *mbuf,
+                                  struct tcphdr *th, int iphlen, uint32_t isn)
 {
-    uint32_t isn;
     uint16_t tmpport;
-    int iphlen;
-
-    if (AF_INET6 == af)
-        iphlen = sizeof(struct ip6_hdr);
-    else
-        iphlen = ip4_hdrlen(mbuf);
-
-    if (mbuf_may_pull(mbuf, iphlen + (th->doff << 2)) != 0)
-        return;
-
-    /* deal with tcp options */
-    syn_proxy_parse_set_opts(mbuf, th, opt);
-
-    /* get cookie */
-    if (AF_INET6 == af)
-        isn = syn_proxy_cookie_v6_init_sequence(mbuf, th, opt);
-    else
-        isn = syn_proxy_cookie_v4_init_sequence(mbuf, th, opt);
 
     /* set syn-ack flag */
     ((uint8_t *)th)[13] = 0x12;
@@ -662,6 +768,39 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
     }
 }
 
+/* Reuse mbuf for syn proxy, called by syn_proxy_syn_rcv().
+ * do following things:
+ * 1) set tcp options,
+ * 2) compute seq with cookie func,
+ * 3) make syn-ack of the syn.
+ */
+static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
+                                 struct tcphdr *th,
+                                 struct dp_vs_synproxy_opt *opt)
+{
+    uint32_t isn;
+    int iphlen;
+
+    if (AF_INET6 == af)
+        iphlen = sizeof(struct ip6_hdr);
+    else
+        iphlen = ip4_hdrlen(mbuf);
+
+    if (mbuf_may_pull(mbuf, iphlen + (th->doff << 2)) != 0)
+        return;
+
+    /* deal with tcp options */
+    syn_proxy_parse_set_opts(mbuf, th, opt);
+
+    /* get cookie */
+    if (AF_INET6 == af)
+        isn = syn_proxy_cookie_v6_init_sequence(mbuf, th, opt);
+    else
+        isn = syn_proxy_cookie_v4_init_sequence(mbuf, th, opt);
+
+    syn_proxy_synack_mbuf(af, mbuf, th, iphlen, isn);
+}
+
 /* Syn-proxy step 1 logic: receive client's Syn.
  * Check if synproxy is enabled for this skb, and send syn/ack back
  *
@@ -673,6 +812,157 @@ static void syn_proxy_reuse_mbuf(int af, struct rte_mbuf *mbuf,
  * @return 0 means the caller should return at once and use
  * verdict as return value, return 1 for nothing.
  */
+/*
+ *  Adaptive synproxy
+ */
+int dp_vs_synproxy_auto_init(struct dp_vs_service *svc)
+{
+    /* drop stale states, never free it while workers may be using it */
+    if (svc->sp_auto) {
+        memset(svc->sp_auto, 0,
+               sizeof(struct dp_vs_synproxy_auto) * DPVS_MAX_LCORE);
+        return EDPVS_OK;
+    }
+
+    svc->sp_auto = rte_zmalloc("synproxy_auto",
+            sizeof(struct dp_vs_synproxy_auto) * DPVS_MAX_LCORE,
+            RTE_CACHE_LINE_SIZE);
+    if (!svc->sp_auto)
+        return EDPVS_NOMEM;
+
+    return EDPVS_OK;
+}
+
+void dp_vs_synproxy_auto_term(struct dp_vs_service *svc)
+{
+    if (svc->sp_auto) {
+        rte_free(svc->sp_auto);
+        svc->sp_auto = NULL;
+    }
+}
+
+bool dp_vs_synproxy_auto_active(const struct dp_vs_service *svc)
+{
+    lcoreid_t cid;
+
+    if (!(svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO) || !svc->sp_auto)
+        return false;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (svc->sp_auto[cid].active)
+            return true;
+    }
+
+    return false;
+}
+
+static inline bool syn_proxy_auto_hot(const struct dp_vs_synproxy_auto *sa)
+{
+    return sa->syns >= (uint32_t)dp_vs_synproxy_auto_syn_rate ||
+        (sa->syns > sa->estab &&
+         sa->syns - sa->estab >= (uint32_t)dp_vs_synproxy_auto_half_open);
+}
+
+static void syn_proxy_auto_set(struct dp_vs_service *svc,
+                               struct dp_vs_synproxy_auto *sa, bool on)
+{
+    char vbuf[64];
+
+    sa->active = on;
+    dp_vs_estats_inc(on ? SYNPROXY_AUTO_ON : SYNPROXY_AUTO_OFF);
+
+    RTE_LOG(INFO, IPVS, "%s: [%d] synproxy %s for %s:%u, syns %u established %u\n",
+            __func__, rte_lcore_id(), on ? "on" : "off",
+            inet_ntop(svc->af, &svc->addr, vbuf, sizeof(vbuf)) ? vbuf : "::",
+            ntohs(svc->port), sa->syns, sa->estab);
+}
+
+/* start a new window if current one is over, synproxy may be turned off */
+static inline void syn_proxy_auto_window(struct dp_vs_service *svc,
+                                         struct dp_vs_synproxy_auto *sa,
+                                         uint64_t now)
+{
+    uint64_t hz = rte_get_timer_hz();
+
+    if (likely(now < sa->window_end))
+        return;
+
+    if (syn_proxy_auto_hot(sa))
+        sa->cooldown_end = now + hz * dp_vs_synproxy_auto_cooldown;
+    else if (sa->active && now >= sa->cooldown_end)
+        syn_proxy_auto_set(svc, sa, false);
+
+    sa->syns = 0;
+    sa->estab = 0;
+    sa->window_end = now + hz;
+}
+
+/* count a syn to @svc and tell whether synproxy is on for it */
+static bool syn_proxy_auto_syn(struct dp_vs_service *svc)
+{
+    struct dp_vs_synproxy_auto *sa = &svc->sp_auto[rte_lcore_id()];
+    uint64_t now = rte_get_timer_cycles();
+    uint64_t hz = rte_get_timer_hz();
+
+    syn_proxy_auto_window(svc, sa, now);
+
+    sa->syns++;
+
+    if (unlikely(!sa->active) && syn_proxy_auto_hot(sa)) {
+        sa->cooldown_end = now + hz * dp_vs_synproxy_auto_cooldown;
+        syn_proxy_auto_set(svc, sa, true);
+    }
+
+    return sa->active;
+}
+
+/*
+ * fast path of adaptive synproxy: count the syn only if synproxy is still
+ * on for @svc, otherwise leave it to dp_vs_synproxy_syn_rcv() uncounted,
+ * so that every syn is counted once.
+ */
+static inline bool syn_proxy_auto_fast(struct dp_vs_service *svc)
+{
+    struct dp_vs_synproxy_auto *sa;
+
+    if (!(svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO) || !svc->sp_auto)
+        return false;
+
+    sa = &svc->sp_auto[rte_lcore_id()];
+    if (!sa->active)
+        return false;
+
+    syn_proxy_auto_window(svc, sa, rte_get_timer_cycles());
+    if (!sa->active)
+        return false;
+
+    sa->syns++;
+    return true;
+}
+
+/* whether syns to @svc go synproxy, counted for adaptive synproxy */
+static inline bool syn_proxy_svc_enabled(struct dp_vs_service *svc)
+{
+    if (svc->flags & DP_VS_SVC_F_SYNPROXY)
+        return true;
+
+    if ((svc->flags & DP_VS_SVC_F_SYNPROXY_AUTO) && svc->sp_auto)
+        return syn_proxy_auto_syn(svc);
+
+    return false;
+}
+
+static inline void syn_proxy_set_tx_offload(int af, struct rte_mbuf *mbuf,
+                                            const struct netif_port *dev)
+{
+    if (likely(dev->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD)) {
+        if (af == AF_INET)
+            mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
+        else
+            mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IPV6);
+    }
+}
+
 int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
         const struct dp_vs_iphdr *iph, int *verdict)
 {
@@ -691,7 +981,7 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
     if (th->syn && !th->ack && !th->rst && !th->fin &&
             (svc = dp_vs_service_lookup(af, iph->proto, 
                                         &iph->daddr, th->dest, 0, NULL, NULL, NULL)) &&
-            (svc->flags & DP_VS_SVC_F_SYNPROXY)) {
+            syn_proxy_svc_enabled(svc)) {
         /* if service's weight is zero (non-active realserver),
          * do noting and drop the packet */
         if (svc->weight == 0) {
@@ -728,12 +1018,7 @@ int dp_vs_synproxy_syn_rcv(int af, struct rte_mbuf *mbuf,
                 __func__, mbuf->port);
         goto syn_rcv_out;
     }
-    if (likely(dev && (dev->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD))) {
-        if (af == AF_INET)
-            mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
-        else
-            mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IPV6);
-    }
+    syn_proxy_set_tx_offload(af, mbuf, dev);
 
     /* reuse mbuf */
     syn_proxy_reuse_mbuf(af, mbuf, th, &tcp_opt);
@@ -767,6 +1052,238 @@ syn_rcv_out:
     return 0;
 }
 
+/* syns of one af answered by dp_vs_synproxy_syn_fast() */
+struct syn_proxy_fast_burst {
+    int                         af;
+    uint16_t                    n;
+    struct rte_mbuf             *mbufs[NETIF_MAX_PKT_BURST];
+    struct tcphdr               *ths[NETIF_MAX_PKT_BURST];
+    struct netif_port           *devs[NETIF_MAX_PKT_BURST];
+    uint32_t                    isns[NETIF_MAX_PKT_BURST];
+    struct dp_vs_synproxy_opt   opts[NETIF_MAX_PKT_BURST];
+};
+
+/*
+ * Check if the raw ether frame @mbuf is a pure syn to synproxy service.
+ * return af if so, 0 if not, or -1 if it's to be dropped.
+ */
+static inline int syn_proxy_fast_match(struct rte_mbuf *mbuf,
+                                       struct netif_port **devp,
+                                       struct tcphdr **thp)
+{
+    struct netif_port *dev = netif_port_get(mbuf->port);
+    struct dp_vs_service *svc;
+    union inet_addr saddr, daddr;
+    struct ether_hdr *eth;
+    struct tcphdr *th;
+    uint32_t hlen, len;
+    uint16_t csum;
+    int af, weight;
+
+    if (unlikely(!dev))
+        return 0;
+    if (dev->type == PORT_TYPE_BOND_SLAVE)
+        dev = dev->bond->slave.master;
+
+    /* let slow path do vlan and packet capture */
+    if ((dev->flag & NETIF_PORT_FLAG_FORWARD2KNI) ||
+        (mbuf->ol_flags & PKT_RX_VLAN_STRIPPED))
+        return 0;
+
+    eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    if (!eth_addr_equal(&dev->addr, &eth->d_addr))
+        return 0;
+
+    if (eth->ether_type == htons(ETHER_TYPE_IPv4)) {
+        struct ipv4_hdr *iph = (struct ipv4_hdr *)(eth + 1);
+
+        if (rte_pktmbuf_data_len(mbuf) < sizeof(*eth) + sizeof(*iph))
+            return 0;
+
+        hlen = (iph->version_ihl & 0xf) << 2;
+        if ((iph->version_ihl >> 4) != 4 || hlen < sizeof(*iph) ||
+            iph->next_proto_id != IPPROTO_TCP || ip4_is_frag(iph) ||
+            rte_pktmbuf_data_len(mbuf) < sizeof(*eth) + hlen)
+            return 0;
+
+        if (dev->flag & NETIF_PORT_FLAG_RX_IP_CSUM_OFFLOAD) {
+            if (unlikely((mbuf->ol_flags & PKT_RX_IP_CKSUM_MASK) ==
+                         PKT_RX_IP_CKSUM_BAD))
+                return -1;
+        } else if (unlikely(rte_raw_cksum(iph, hlen) != 0xFFFF)) {
+            return 0;
+        }
+
+        af = AF_INET;
+        len = ntohs(iph->total_length);
+        saddr.in.s_addr = iph->src_addr;
+        daddr.in.s_addr = iph->dst_addr;
+    } else if (eth->ether_type == htons(ETHER_TYPE_IPv6)) {
+        struct ip6_hdr *ip6h = (struct ip6_hdr *)(eth + 1);
+
+        hlen = sizeof(*ip6h);
+        if (rte_pktmbuf_data_len(mbuf) < sizeof(*eth) + hlen)
+            return 0;
+
+        /* syn with extension headers goes slow path */
+        if ((ip6h->ip6_vfc >> 4) != 6 || ip6h->ip6_nxt != IPPROTO_TCP)
+            return 0;
+
+        af = AF_INET6;
+        len = ntohs(ip6h->ip6_plen) + hlen;
+        saddr.in6 = ip6h->ip6_src;
+        daddr.in6 = ip6h->ip6_dst;
+    } else {
+        return 0;
+    }
+
+    /* tcp header and options should be in the first segment */
+    th = (struct tcphdr *)((char *)(eth + 1) + hlen);
+    if (rte_pktmbuf_data_len(mbuf) < sizeof(*eth) + hlen + sizeof(*th))
+        return 0;
+    if (!th->syn || th->ack || th->rst || th->fin)
+        return 0;
+    if (th->doff < 5 || len < hlen + (th->doff << 2) ||
+        mbuf->pkt_len < sizeof(*eth) + len ||
+        rte_pktmbuf_data_len(mbuf) < sizeof(*eth) + hlen + (th->doff << 2))
+        return 0;
+
+    svc = dp_vs_service_lookup(af, IPPROTO_TCP, &daddr, th->dest,
+                               0, NULL, NULL, NULL);
+    if (!svc)
+        return 0;
+    /* syns not to be proxied are counted by dp_vs_synproxy_syn_rcv() */
+    if (!(svc->flags & DP_VS_SVC_F_SYNPROXY) && !syn_proxy_auto_fast(svc)) {
+        dp_vs_service_put(svc);
+        return 0;
+    }
+    weight = svc->weight;
+    dp_vs_service_put(svc);
+
+    if (weight == 0) {
+        dp_vs_estats_inc(SYNPROXY_NO_DEST);
+        return -1;
+    }
+    if (dp_vs_blklst_lookup(IPPROTO_TCP, &daddr, th->dest, &saddr))
+        return -1;
+
+    /* never answer a corrupted syn, verify it if NIC didn't */
+    switch (mbuf->ol_flags & PKT_RX_L4_CKSUM_MASK) {
+    case PKT_RX_L4_CKSUM_GOOD:
+        break;
+    case PKT_RX_L4_CKSUM_BAD:
+        return -1;
+    default:
+        if (rte_pktmbuf_data_len(mbuf) < sizeof(*eth) + len)
+            return 0;
+        if (af == AF_INET)
+            csum = ip4_udptcp_cksum((struct ipv4_hdr *)(eth + 1), th);
+        else
+            csum = ip6_udptcp_cksum((struct ip6_hdr *)(eth + 1), th,
+                                    hlen, IPPROTO_TCP);
+        if (unlikely(csum != 0xFFFF))
+            return -1;
+        break;
+    }
+
+    /* trim padding */
+    if (mbuf->pkt_len > sizeof(*eth) + len &&
+        rte_pktmbuf_trim(mbuf, mbuf->pkt_len - sizeof(*eth) - len) != 0)
+        return 0;
+
+    *devp = dev;
+    *thp = th;
+    return af;
+}
+
+static inline void syn_proxy_fast_xmit(struct syn_proxy_fast_burst *b)
+{
+    struct ether_addr ethaddr;
+    struct ether_hdr *eth;
+    struct rte_mbuf *mbuf;
+    int i, iphlen;
+
+    if (!b->n)
+        return;
+
+    dp_vs_synproxy_cookie_init_bulk(b->af, b->mbufs, b->ths, b->opts,
+                                    b->isns, b->n);
+
+    for (i = 0; i < b->n; i++) {
+        mbuf = b->mbufs[i];
+
+        if (AF_INET6 == b->af)
+            iphlen = sizeof(struct ip6_hdr);
+        else
+            iphlen = ip4_hdrlen(mbuf);
+        syn_proxy_synack_mbuf(b->af, mbuf, b->ths[i], iphlen, b->isns[i]);
+
+        eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf, mbuf->l2_len);
+        ether_addr_copy(&eth->s_addr, &ethaddr);
+        ether_addr_copy(&eth->d_addr, &eth->s_addr);
+        ether_addr_copy(&ethaddr, &eth->d_addr);
+
+        /* queued to tx buffer of this lcore, and sent in burst */
+        netif_xmit(mbuf, b->devs[i]);
+    }
+}
+
+/*
+ * Stateless syn-proxy ahead of L2/L3 processing. Pure syns to synproxy
+ * services are turned into syn-acks in place and sent back where they
+ * came from, with no conn/route lookup nor inet hooks. Other packets are
+ * left in @mbufs in order, and the number of them is returned.
+ */
+uint16_t dp_vs_synproxy_syn_fast(struct rte_mbuf **mbufs, uint16_t count,
+                                 uint64_t *bytes)
+{
+    struct syn_proxy_fast_burst bursts[2] = {
+        { .af = AF_INET, .n = 0 }, { .af = AF_INET6, .n = 0 } };
+    struct syn_proxy_fast_burst *b;
+    struct netif_port *dev = NULL;
+    struct tcphdr *th = NULL;
+    struct rte_mbuf *mbuf;
+    uint16_t i, nleft = 0;
+    int af;
+
+    if (!dp_vs_synproxy_ctrl_syn_fast)
+        return count;
+
+    for (i = 0; i < count; i++) {
+        mbuf = mbufs[i];
+
+        af = syn_proxy_fast_match(mbuf, &dev, &th);
+        if (af == 0) {
+            mbufs[nleft++] = mbuf;
+            continue;
+        }
+
+        *bytes += mbuf->pkt_len;
+        if (af < 0) {
+            rte_pktmbuf_free(mbuf);
+            continue;
+        }
+
+        dp_vs_estats_inc(SYNPROXY_SYN_CNT);
+
+        mbuf->l2_len = sizeof(struct ether_hdr);
+        rte_pktmbuf_adj(mbuf, mbuf->l2_len);
+        syn_proxy_set_tx_offload(af, mbuf, dev);
+
+        b = &bursts[af == AF_INET6];
+        syn_proxy_parse_set_opts(mbuf, th, &b->opts[b->n]);
+        b->mbufs[b->n] = mbuf;
+        b->ths[b->n] = th;
+        b->devs[b->n] = dev;
+        b->n++;
+    }
+
+    syn_proxy_fast_xmit(&bursts[0]);
+    syn_proxy_fast_xmit(&bursts[1]);
+
+    return nleft;
+}
+
 /* Check if mbuf has user data */
 static inline int syn_proxy_ack_has_data(struct rte_mbuf *mbuf,
         const struct dp_vs_iphdr *iph, struct tcphdr *th)
@@ -992,6 +1509,7 @@ int dp_vs_synproxy_ack_rcv(int af, struct rte_mbuf *mbuf,
 
         /* Update statistics */
         dp_vs_estats_inc(SYNPROXY_OK_ACK);
+        dp_vs_synproxy_auto_estab(svc);
 
         /* Let the virtual server select a real server for the incoming connetion,
          * and create a connection entry */
@@ -1201,8 +1719,8 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
         struct dp_vs_proto *pp, int th_offset, int *verdict)
 {
     struct tcphdr _tcph, *th;
-    struct dp_vs_synproxy_ack_pakcet *tmbuf, *tmbuf2;
-    struct list_head save_mbuf;
+    struct rte_mbuf *save_mbuf[DP_VS_SYNPROXY_ACK_STASH];
+    uint32_t i, save_num;
     struct dp_vs_dest *dest = cp->dest;
     unsigned conn_timeout = 0;
 
@@ -1221,8 +1739,6 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
             cp->flags & DPVS_CONN_F_SYNPROXY, cp->state);
 #endif
 
-    INIT_LIST_HEAD(&save_mbuf);
-
     if ((th->syn) && (th->ack) && (!th->rst) &&
             (cp->flags & DPVS_CONN_F_SYNPROXY) &&
             (cp->state == DPVS_TCP_S_SYN_SENT)) {
@@ -1261,7 +1777,7 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
             sp_dbg_stats32_dec(sp_syn_saved);
         }
 
-        if (list_empty(&cp->ack_mbuf)) {
+        if (cp->ack_num == 0) {
             /*
              * FIXME: Maybe a bug here, print err msg and go.
              * Attention: cp->state has been changed and we
@@ -1282,20 +1798,13 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
         if (cp->ack_num == 1)
             syn_proxy_send_window_update(tuplehash_out(cp).af, mbuf, cp, pp, th);
 
-        list_for_each_entry_safe(tmbuf, tmbuf2, &cp->ack_mbuf, list) {
-            list_del_init(&tmbuf->list);
-            cp->ack_num--;
-            list_add_tail(&tmbuf->list, &save_mbuf);
-        }
-        assert(cp->ack_num == 0);
+        save_num = cp->ack_num;
+        rte_memcpy(save_mbuf, cp->ack_mbuf, save_num * sizeof(save_mbuf[0]));
+        syn_proxy_ack_release(cp);
 
-        list_for_each_entry_safe(tmbuf, tmbuf2, &save_mbuf, list) {
-            list_del_init(&tmbuf->list);
+        for (i = 0; i < save_num; i++) {
             /* syn_mbuf will be freed correctly if xmit failed */
-            cp->packet_xmit(pp, cp, tmbuf->mbuf);
-            /* free dp_vs_synproxy_ack_pakcet */
-            rte_mempool_put(this_ack_mbufpool, tmbuf);
-            sp_dbg_stats32_dec(sp_ack_saved);
+            cp->packet_xmit(pp, cp, save_mbuf[i]);
         }
 
         *verdict = INET_DROP;
@@ -1324,17 +1833,8 @@ static inline int __syn_proxy_reuse_conn(struct dp_vs_conn *cp,
         struct rte_mbuf *ack_mbuf,
         struct tcphdr *th, struct dp_vs_proto *pp)
 {
-    struct dp_vs_synproxy_ack_pakcet *tmbuf, *tmbuf2;
-
     /* Free stored ack packet */
-    list_for_each_entry_safe(tmbuf, tmbuf2, &cp->ack_mbuf, list) {
-        list_del_init(&tmbuf->list);
-        cp->ack_num--;
-        rte_pktmbuf_free(tmbuf->mbuf);
-        sp_dbg_stats32_dec(sp_ack_saved);
-        rte_mempool_put(this_ack_mbufpool, tmbuf) ;
-    }
-    assert(cp->ack_num == 0);
+    dp_vs_synproxy_ack_flush(cp);
 
     /* Free stored syn mbuf */
     if (cp->syn_mbuf) {
@@ -1344,15 +1844,8 @@ static inline int __syn_proxy_reuse_conn(struct dp_vs_conn *cp,
     }
 
     /* Store new ack_mbuf */
-    assert(list_empty(&cp->ack_mbuf));
-    INIT_LIST_HEAD(&cp->ack_mbuf);
-
-    if (unlikely(rte_mempool_get(this_ack_mbufpool, (void **)&tmbuf) != 0))
-        return EDPVS_NOMEM;
-    tmbuf->mbuf = ack_mbuf;
-    list_add_tail(&tmbuf->list, &cp->ack_mbuf);
-    sp_dbg_stats32_inc(sp_ack_saved);
-    cp->ack_num++;
+    if (unlikely(dp_vs_synproxy_ack_stash(cp, ack_mbuf) != EDPVS_OK))
+        return EDPVS_NOROOM;
 
     /* Save ack_seq - 1 */
     cp->syn_proxy_seq.isn = htonl((uint32_t)((ntohl(th->ack_seq) - 1)));
@@ -1522,7 +2015,6 @@ int dp_vs_synproxy_filter_ack(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
         const struct dp_vs_iphdr *iph, int *verdict)
 {
     struct tcphdr _tcph, *th;
-    struct dp_vs_synproxy_ack_pakcet *ack_mbuf;
 
     th = mbuf_header_pointer(mbuf, iph->len, sizeof(_tcph), &_tcph);
     if (unlikely(!th)) {
@@ -1539,27 +2031,23 @@ int dp_vs_synproxy_filter_ack(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
             return 0;
         }
 
-        /* the length of ack list should be limited to avoid pktpool resource drained
+        /* the length of ack stash should be limited to avoid pktpool resource drained
          * when we does not recieve rs's reply to our syn in no time */
         if (dp_vs_synproxy_ctrl_max_ack_saved < cp->ack_num) {
             dp_vs_estats_inc(SYNPROXY_SYNSEND_QLEN);
+            this_synproxy_stats.ack_refused++;
             sp_dbg_stats64_inc(sp_ack_refused);
             *verdict = INET_DROP;
             return 0;
         }
 
         /* Store ack mbuf */
-        if (unlikely(rte_mempool_get(this_ack_mbufpool, (void **)&ack_mbuf) != 0)) {
-            RTE_LOG(ERR, IPVS, "%s: no memory\n", __func__);
+        if (unlikely(dp_vs_synproxy_ack_stash(cp, mbuf) != EDPVS_OK)) {
+            dp_vs_estats_inc(SYNPROXY_SYNSEND_QLEN);
             *verdict = INET_DROP;
             return 0;
         }
 
-        ack_mbuf->mbuf = mbuf;
-        list_add_tail(&ack_mbuf->list, &cp->ack_mbuf);
-        cp->ack_num++;
-        sp_dbg_stats32_inc(sp_ack_saved);
-
         *verdict = INET_STOLEN;
         return 0;
     }
@@ -1674,7 +2162,8 @@ static void max_ack_saved_handler(vector_t tokens)
     assert(str);
 
     max_ack = atoi(str);
-    if (max_ack > 0 && max_ack < 64) {
+    /* one more ack than max_ack_saved may be held, see filter_ack */
+    if (max_ack > 0 && max_ack < DP_VS_SYNPROXY_ACK_STASH) {
         RTE_LOG(INFO, IPVS, "max_ack_saved = %d\n", max_ack);
         dp_vs_synproxy_ctrl_max_ack_saved = max_ack;
     } else {
@@ -1686,6 +2175,69 @@ static void max_ack_saved_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void syn_fast_path_handler(vector_t tokens)
+{
+    RTE_LOG(INFO, IPVS, "synproxy_syn_fast_path ON\n");
+    dp_vs_synproxy_ctrl_syn_fast = 1;
+}
+
+static void auto_syn_rate_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int rate;
+
+    assert(str);
+    rate = atoi(str);
+    if (rate > 0) {
+        RTE_LOG(INFO, IPVS, "synproxy auto syn_rate = %d\n", rate);
+        dp_vs_synproxy_auto_syn_rate = rate;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid synproxy auto syn_rate %s, using default %d\n",
+                str, DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT);
+        dp_vs_synproxy_auto_syn_rate = DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT;
+    }
+
+    FREE_PTR(str);
+}
+
+static void auto_half_open_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int half_open;
+
+    assert(str);
+    half_open = atoi(str);
+    if (half_open > 0) {
+        RTE_LOG(INFO, IPVS, "synproxy auto half_open = %d\n", half_open);
+        dp_vs_synproxy_auto_half_open = half_open;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid synproxy auto half_open %s, using default %d\n",
+                str, DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT);
+        dp_vs_synproxy_auto_half_open = DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT;
+    }
+
+    FREE_PTR(str);
+}
+
+static void auto_cooldown_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int cooldown;
+
+    assert(str);
+    cooldown = atoi(str);
+    if (cooldown > 0 && cooldown <= 3600) {
+        RTE_LOG(INFO, IPVS, "synproxy auto cooldown = %d\n", cooldown);
+        dp_vs_synproxy_auto_cooldown = cooldown;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid synproxy auto cooldown %s, using default %d\n",
+                str, DP_VS_SYNPROXY_AUTO_COOLDOWN_DEFAULT);
+        dp_vs_synproxy_auto_cooldown = DP_VS_SYNPROXY_AUTO_COOLDOWN_DEFAULT;
+    }
+
+    FREE_PTR(str);
+}
+
 static void conn_reuse_handler(vector_t tokens)
 {
     RTE_LOG(INFO, IPVS, "synproxy_conn_reuse ON\n");
@@ -1742,6 +2294,10 @@ void synproxy_keyword_value_init(void)
     dp_vs_synproxy_ctrl_dup_ack_thresh = DP_VS_SYNPROXY_DUP_ACK_DEFAULT;
     dp_vs_synproxy_ctrl_max_ack_saved = DP_VS_SYNPROXY_MAX_ACK_SAVED_DEFAULT;
     dp_vs_synproxy_ctrl_syn_retry = DP_VS_SYNPROXY_SYN_RETRY_DEFAULT;
+    dp_vs_synproxy_ctrl_syn_fast = 0;
+    dp_vs_synproxy_auto_syn_rate = DP_VS_SYNPROXY_AUTO_SYN_RATE_DEFAULT;
+    dp_vs_synproxy_auto_half_open = DP_VS_SYNPROXY_AUTO_HALF_OPEN_DEFAULT;
+    dp_vs_synproxy_auto_cooldown = DP_VS_SYNPROXY_AUTO_COOLDOWN_DEFAULT;
 }
 
 void install_synproxy_keywords(void)
@@ -1763,6 +2319,14 @@ void install_synproxy_keywords(void)
     install_keyword("rs_syn_max_retry", rs_syn_max_retry_handler, KW_TYPE_NORMAL);
     install_keyword("ack_storm_thresh", ack_storm_thresh_handler, KW_TYPE_NORMAL);
     install_keyword("max_ack_saved", max_ack_saved_handler, KW_TYPE_NORMAL);
+    install_keyword("syn_fast_path", syn_fast_path_handler, KW_TYPE_NORMAL);
+
+    install_keyword("auto", NULL, KW_TYPE_NORMAL);
+    install_sublevel();
+    install_keyword("syn_rate", auto_syn_rate_handler, KW_TYPE_NORMAL);
+    install_keyword("half_open", auto_half_open_handler, KW_TYPE_NORMAL);
+    install_keyword("cooldown", auto_cooldown_handler, KW_TYPE_NORMAL);
+    install_sublevel_end();
 
     install_keyword("conn_reuse_state", conn_reuse_handler, KW_TYPE_NORMAL);
     install_sublevel();
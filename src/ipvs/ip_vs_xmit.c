@@ -33,6 +33,16 @@
 static bool fast_xmit_close = false;
 static bool xmit_ttl = false;
 
+/*
+ * IPv6 has no fragmentation on path, but a datagram reassembled in
+ * pre-routing (non-linear mbuf) was fragmented by its source already,
+ * so it's fragmented again on output rather than PACKET_TOO_BIG.
+ */
+static inline bool dp_vs_xmit6_too_big(const struct rte_mbuf *mbuf, int mtu)
+{
+    return mbuf->pkt_len > mtu && rte_pktmbuf_is_contiguous(mbuf);
+}
+
 static int __dp_vs_fast_xmit_fnat4(struct dp_vs_proto *proto,
                                    struct dp_vs_conn *conn,
                                    struct rte_mbuf *mbuf)
@@ -151,6 +161,10 @@ static int dp_vs_fast_xmit_fnat(int af,
                                 struct dp_vs_conn *conn,
                                 struct rte_mbuf *mbuf)
 {
+    /* reassembled datagram may need fragmenting, take the slow path */
+    if (unlikely(!rte_pktmbuf_is_contiguous(mbuf)))
+        return EDPVS_NOTSUPP;
+
     return af == AF_INET ? __dp_vs_fast_xmit_fnat4(proto, conn, mbuf)
         : __dp_vs_fast_xmit_fnat6(proto, conn, mbuf);
 }
@@ -538,7 +552,7 @@ static int __dp_vs_xmit_fnat6(struct dp_vs_proto *proto,
 
     // check mtu
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (dp_vs_xmit6_too_big(mbuf, mtu)) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, mtu);
 
@@ -1302,7 +1316,7 @@ static int __dp_vs_xmit_dr6(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt6(conn, rt6, true);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (dp_vs_xmit6_too_big(mbuf, mtu)) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
@@ -1595,6 +1609,10 @@ static int dp_vs_fast_xmit_nat(struct dp_vs_proto *proto,
     struct ether_hdr *eth;
     int err;
 
+    /* reassembled datagram may need fragmenting, take the slow path */
+    if (unlikely(!rte_pktmbuf_is_contiguous(mbuf)))
+        return EDPVS_NOTSUPP;
+
     if (unlikely(conn->in_dev == NULL))
         return EDPVS_NOROUTE;
 
@@ -1870,7 +1888,7 @@ static int __dp_vs_xmit_nat6(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt6(conn, rt6, true);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (dp_vs_xmit6_too_big(mbuf, mtu)) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
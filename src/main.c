@@ -35,6 +35,8 @@
 #include "ip_tunnel.h"
 #include "sys_time.h"
 #include "route6.h"
+#include "stats_shm.h"
+#include "metrics.h"
 
 #define DPVS    "dpvs"
 #define RTE_LOGTYPE_DPVS RTE_LOGTYPE_USER1
@@ -238,6 +240,14 @@ int main(int argc, char *argv[])
         rte_exit(EXIT_FAILURE, "Fail to init netif_ctrl: %s\n",
                  dpvs_strerror(err));
 
+    if ((err = stats_shm_init()) != EDPVS_OK)
+        rte_exit(EXIT_FAILURE, "Fail to init stats_shm: %s\n",
+                 dpvs_strerror(err));
+
+    if ((err = metrics_init()) != EDPVS_OK)
+        rte_exit(EXIT_FAILURE, "Fail to init metrics: %s\n",
+                 dpvs_strerror(err));
+
     /* config and start all available dpdk ports */
     nports = rte_eth_dev_count();
     for (pid = 0; pid < nports; pid++) {
@@ -276,6 +286,8 @@ int main(int argc, char *argv[])
         try_reload();
         /* IPC loop */
         sockopt_ctl(NULL);
+        /* metrics scrapers */
+        metrics_ctl();
         /* msg loop */
         msg_master_process();
 
@@ -295,6 +307,10 @@ int main(int argc, char *argv[])
 
 end:
     dpvs_state_set(DPVS_STATE_FINISH);
+    if ((err = metrics_term()) != EDPVS_OK)
+        RTE_LOG(ERR, DPVS, "Fail to term metrics: %s\n", dpvs_strerror(err));
+    if ((err = stats_shm_term()) != EDPVS_OK)
+        RTE_LOG(ERR, DPVS, "Fail to term stats_shm: %s\n", dpvs_strerror(err));
     if ((err = netif_ctrl_term()) !=0 )
         rte_exit(EXIT_FAILURE, "Fail to term netif_ctrl: %s\n",
                  dpvs_strerror(err));
@@ -147,6 +147,43 @@ struct rte_mbuf *mbuf_copy(struct rte_mbuf *md, struct rte_mempool *mp)
     return mc;
 }
 
+int mbuf_l4_csum_sw(struct rte_mbuf *mbuf)
+{
+    uint64_t l4_flag = mbuf->ol_flags & PKT_TX_L4_MASK;
+    uint32_t off, csum_off;
+    uint16_t csum;
+
+    switch (l4_flag) {
+    case PKT_TX_L4_NO_CKSUM:
+        return EDPVS_OK;
+    case PKT_TX_TCP_CKSUM:
+        csum_off = offsetof(struct tcp_hdr, cksum);
+        break;
+    case PKT_TX_UDP_CKSUM:
+        csum_off = offsetof(struct udp_hdr, dgram_cksum);
+        break;
+    default:
+        return EDPVS_NOTSUPP;
+    }
+
+    /* pseudo header sum is already in checksum field */
+    off = mbuf->l3_len;
+    if (unlikely(off + csum_off + sizeof(csum) > mbuf->data_len))
+        return EDPVS_INVPKT;
+
+    if (rte_raw_cksum_mbuf(mbuf, off, mbuf->pkt_len - off, &csum) != 0)
+        return EDPVS_INVPKT;
+
+    csum = ~csum;
+    if (csum == 0 && l4_flag == PKT_TX_UDP_CKSUM)
+        csum = 0xffff;
+
+    *rte_pktmbuf_mtod_offset(mbuf, uint16_t *, off + csum_off) = csum;
+    mbuf->ol_flags &= ~PKT_TX_L4_MASK;
+
+    return EDPVS_OK;
+}
+
 #ifdef CONFIG_DPVS_MBUF_DEBUG
 inline void dp_vs_mbuf_dump(const char *msg, int af, const struct rte_mbuf *mbuf)
 {
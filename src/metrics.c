@@ -0,0 +1,1006 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "common.h"
+#include "dpdk.h"
+#include "inet.h"
+#include "netif.h"
+#include "parser/parser.h"
+#include "stats_shm.h"
+#include "metrics.h"
+#include "conf/stats_shm.h"
+#include "conf/tc.h"
+
+#define RTE_LOGTYPE_METRICS         RTE_LOGTYPE_USER1
+
+#define METRICS_LISTEN_DEF          "127.0.0.1:9525"
+#define METRICS_REQ_MAX             2048
+#define METRICS_HDR_ROOM            256     /* for HTTP response header */
+#define METRICS_BUF_INIT            (1 << 20)
+#define METRICS_LABEL_LEN           384
+#define METRICS_CLIENT_TIMEOUT      5       /* seconds */
+
+static bool metrics_enable;
+static char metrics_listen[108];    /* "ip:port" or unix socket path */
+
+static int metrics_srv_fd = -1;
+static uint64_t metrics_render_us;  /* time taken by last render */
+
+/* one scraper served at a time, others wait in listen backlog */
+static struct metrics_client {
+    int             fd;
+    bool            replying;
+    uint64_t        deadline;       /* in timer cycles */
+    size_t          reqlen;
+    char            req[METRICS_REQ_MAX];
+    const char      *out;
+    size_t          outlen;
+    size_t          sent;
+} metrics_clt = { .fd = -1 };
+
+struct metrics_buf {
+    char            *data;
+    size_t          len;
+    size_t          size;
+    bool            nomem;
+};
+
+static struct metrics_buf metrics_out;
+
+struct metrics_label {
+    uint16_t        len;
+    char            str[METRICS_LABEL_LEN];
+};
+
+/* labels of lcore, port, mib, inet, qsch, service and dest entries in turn */
+static struct metrics_label *metrics_labels;
+static uint32_t metrics_nlabel;
+
+enum {
+    METRICS_U32,
+    METRICS_S32,
+    METRICS_U64,
+};
+
+/* one metric family, whose value is a field of region entries */
+struct metrics_field {
+    const char      *name;
+    const char      *type;
+    const char      *help;
+    uint32_t        off;
+    uint32_t        kind;
+};
+
+#define METRICS_FIELD(name, type, help, st, member, kind) \
+    { name, type, help, offsetof(st, member), kind }
+
+static const struct metrics_field metrics_lcore_fields[] = {
+    METRICS_FIELD("dpvs_lcore_loops_total", "counter", "Loops of data-plane lcore.",
+                  struct dpvs_stats_shm_lcore, lcore_loop, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_rx_packets_total", "counter", "Packets received by lcore.",
+                  struct dpvs_stats_shm_lcore, ipackets, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_rx_bytes_total", "counter", "Bytes received by lcore.",
+                  struct dpvs_stats_shm_lcore, ibytes, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_tx_packets_total", "counter", "Packets sent by lcore.",
+                  struct dpvs_stats_shm_lcore, opackets, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_tx_bytes_total", "counter", "Bytes sent by lcore.",
+                  struct dpvs_stats_shm_lcore, obytes, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_dropped_total", "counter", "Packets dropped by lcore.",
+                  struct dpvs_stats_shm_lcore, dropped, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_conns_total", "counter", "Connections scheduled by lcore.",
+                  struct dpvs_stats_shm_lcore, ipvs.conns, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_in_packets_total", "counter", "Inbound packets forwarded by lcore.",
+                  struct dpvs_stats_shm_lcore, ipvs.inpkts, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_in_bytes_total", "counter", "Inbound bytes forwarded by lcore.",
+                  struct dpvs_stats_shm_lcore, ipvs.inbytes, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_out_packets_total", "counter", "Outbound packets forwarded by lcore.",
+                  struct dpvs_stats_shm_lcore, ipvs.outpkts, METRICS_U64),
+    METRICS_FIELD("dpvs_lcore_out_bytes_total", "counter", "Outbound bytes forwarded by lcore.",
+                  struct dpvs_stats_shm_lcore, ipvs.outbytes, METRICS_U64),
+};
+
+static const struct metrics_field metrics_port_fields[] = {
+    METRICS_FIELD("dpvs_port_rx_packets_total", "counter", "Packets received by port.",
+                  struct dpvs_stats_shm_port, ipackets, METRICS_U64),
+    METRICS_FIELD("dpvs_port_tx_packets_total", "counter", "Packets sent by port.",
+                  struct dpvs_stats_shm_port, opackets, METRICS_U64),
+    METRICS_FIELD("dpvs_port_rx_bytes_total", "counter", "Bytes received by port.",
+                  struct dpvs_stats_shm_port, ibytes, METRICS_U64),
+    METRICS_FIELD("dpvs_port_tx_bytes_total", "counter", "Bytes sent by port.",
+                  struct dpvs_stats_shm_port, obytes, METRICS_U64),
+    METRICS_FIELD("dpvs_port_rx_missed_total", "counter", "Packets dropped by port for full rx queue.",
+                  struct dpvs_stats_shm_port, imissed, METRICS_U64),
+    METRICS_FIELD("dpvs_port_rx_errors_total", "counter", "Erroneous packets received by port.",
+                  struct dpvs_stats_shm_port, ierrors, METRICS_U64),
+    METRICS_FIELD("dpvs_port_tx_errors_total", "counter", "Packets failed to send by port.",
+                  struct dpvs_stats_shm_port, oerrors, METRICS_U64),
+    METRICS_FIELD("dpvs_port_rx_nombuf_total", "counter", "Rx mbuf allocation failures of port.",
+                  struct dpvs_stats_shm_port, rx_nombuf, METRICS_U64),
+};
+
+static const struct metrics_field metrics_mib_fields[] = {
+    METRICS_FIELD("dpvs_ipvs_ext_stats_total", "counter", "Extended ipvs counters.",
+                  struct dpvs_stats_shm_mib, value, METRICS_U64),
+};
+
+#define METRICS_INET_FIELD(name, help, member) \
+    METRICS_FIELD(name, "counter", help, struct dpvs_stats_shm_inet, \
+                  stats.member, METRICS_U64)
+
+static const struct metrics_field metrics_inet_fields[] = {
+    METRICS_INET_FIELD("dpvs_ip_in_packets_total", "IP packets received.", inpkts),
+    METRICS_INET_FIELD("dpvs_ip_in_bytes_total", "IP bytes received.", inoctets),
+    METRICS_INET_FIELD("dpvs_ip_in_delivers_total", "IP packets delivered to upper layers.", indelivers),
+    METRICS_INET_FIELD("dpvs_ip_out_forward_packets_total", "IP packets forwarded.", outforwdatagrams),
+    METRICS_INET_FIELD("dpvs_ip_out_packets_total", "IP packets sent.", outpkts),
+    METRICS_INET_FIELD("dpvs_ip_out_bytes_total", "IP bytes sent.", outoctets),
+    METRICS_INET_FIELD("dpvs_ip_in_header_errors_total", "IP packets with header errors.", inhdrerrors),
+    METRICS_INET_FIELD("dpvs_ip_in_too_big_errors_total", "IP packets too big to forward.", intoobigerrors),
+    METRICS_INET_FIELD("dpvs_ip_in_no_routes_total", "IP packets without a route.", innoroutes),
+    METRICS_INET_FIELD("dpvs_ip_in_addr_errors_total", "IP packets with invalid destination.", inaddrerrors),
+    METRICS_INET_FIELD("dpvs_ip_in_unknown_protos_total", "IP packets of unknown protocols.", inunknownprotos),
+    METRICS_INET_FIELD("dpvs_ip_in_truncated_total", "IP packets truncated.", intruncatedpkts),
+    METRICS_INET_FIELD("dpvs_ip_in_discards_total", "IP packets discarded on receive.", indiscards),
+    METRICS_INET_FIELD("dpvs_ip_out_discards_total", "IP packets discarded on send.", outdiscards),
+    METRICS_INET_FIELD("dpvs_ip_out_no_routes_total", "IP packets sent without a route.", outnoroutes),
+    METRICS_INET_FIELD("dpvs_ip_reasm_timeouts_total", "IP reassembly timeouts.", reasmtimeout),
+    METRICS_INET_FIELD("dpvs_ip_reasm_requests_total", "IP fragments needing reassembly.", reasmreqds),
+    METRICS_INET_FIELD("dpvs_ip_reasm_oks_total", "IP packets reassembled.", reasmoks),
+    METRICS_INET_FIELD("dpvs_ip_reasm_fails_total", "IP reassembly failures.", reasmfails),
+    METRICS_INET_FIELD("dpvs_ip_frag_oks_total", "IP packets fragmented.", fragoks),
+    METRICS_INET_FIELD("dpvs_ip_frag_fails_total", "IP fragmentation failures.", fragfails),
+    METRICS_INET_FIELD("dpvs_ip_frag_creates_total", "IP fragments created.", fragcreates),
+    METRICS_INET_FIELD("dpvs_ip_in_csum_errors_total", "IP packets with checksum errors.", csumerrors),
+};
+
+static const struct metrics_field metrics_qsch_fields[] = {
+    METRICS_FIELD("dpvs_qsch_sent_bytes_total", "counter", "Bytes sent by queue scheduler.",
+                  struct dpvs_stats_shm_qsch, bytes, METRICS_U64),
+    METRICS_FIELD("dpvs_qsch_sent_packets_total", "counter", "Packets sent by queue scheduler.",
+                  struct dpvs_stats_shm_qsch, packets, METRICS_U64),
+    METRICS_FIELD("dpvs_qsch_drops_total", "counter", "Packets dropped by queue scheduler.",
+                  struct dpvs_stats_shm_qsch, drops, METRICS_U32),
+    METRICS_FIELD("dpvs_qsch_overlimits_total", "counter", "Overlimit events of queue scheduler.",
+                  struct dpvs_stats_shm_qsch, overlimits, METRICS_U32),
+    METRICS_FIELD("dpvs_qsch_requeues_total", "counter", "Packets requeued by queue scheduler.",
+                  struct dpvs_stats_shm_qsch, requeues, METRICS_U32),
+    METRICS_FIELD("dpvs_qsch_queue_packets", "gauge", "Packets queued in queue scheduler.",
+                  struct dpvs_stats_shm_qsch, qlen, METRICS_U32),
+    METRICS_FIELD("dpvs_qsch_backlog_bytes", "gauge", "Bytes queued in queue scheduler.",
+                  struct dpvs_stats_shm_qsch, backlog, METRICS_U32),
+};
+
+static const struct metrics_field metrics_svc_fields[] = {
+    METRICS_FIELD("dpvs_service_conns_total", "counter", "Connections scheduled by service.",
+                  struct dpvs_stats_shm_svc, stats.conns, METRICS_U64),
+    METRICS_FIELD("dpvs_service_in_packets_total", "counter", "Inbound packets of service.",
+                  struct dpvs_stats_shm_svc, stats.inpkts, METRICS_U64),
+    METRICS_FIELD("dpvs_service_in_bytes_total", "counter", "Inbound bytes of service.",
+                  struct dpvs_stats_shm_svc, stats.inbytes, METRICS_U64),
+    METRICS_FIELD("dpvs_service_out_packets_total", "counter", "Outbound packets of service.",
+                  struct dpvs_stats_shm_svc, stats.outpkts, METRICS_U64),
+    METRICS_FIELD("dpvs_service_out_bytes_total", "counter", "Outbound bytes of service.",
+                  struct dpvs_stats_shm_svc, stats.outbytes, METRICS_U64),
+    METRICS_FIELD("dpvs_service_dests", "gauge", "Real servers of service.",
+                  struct dpvs_stats_shm_svc, ndest, METRICS_U32),
+};
+
+static const struct metrics_field metrics_dest_fields[] = {
+    METRICS_FIELD("dpvs_dest_conns_total", "counter", "Connections scheduled to real server.",
+                  struct dpvs_stats_shm_dest, stats.conns, METRICS_U64),
+    METRICS_FIELD("dpvs_dest_in_packets_total", "counter", "Inbound packets of real server.",
+                  struct dpvs_stats_shm_dest, stats.inpkts, METRICS_U64),
+    METRICS_FIELD("dpvs_dest_in_bytes_total", "counter", "Inbound bytes of real server.",
+                  struct dpvs_stats_shm_dest, stats.inbytes, METRICS_U64),
+    METRICS_FIELD("dpvs_dest_out_packets_total", "counter", "Outbound packets of real server.",
+                  struct dpvs_stats_shm_dest, stats.outpkts, METRICS_U64),
+    METRICS_FIELD("dpvs_dest_out_bytes_total", "counter", "Outbound bytes of real server.",
+                  struct dpvs_stats_shm_dest, stats.outbytes, METRICS_U64),
+    METRICS_FIELD("dpvs_dest_weight", "gauge", "Weight of real server.",
+                  struct dpvs_stats_shm_dest, weight, METRICS_S32),
+    METRICS_FIELD("dpvs_dest_active_conns", "gauge", "Active connections of real server.",
+                  struct dpvs_stats_shm_dest, actconns, METRICS_U32),
+    METRICS_FIELD("dpvs_dest_inactive_conns", "gauge", "Inactive connections of real server.",
+                  struct dpvs_stats_shm_dest, inactconns, METRICS_U32),
+    METRICS_FIELD("dpvs_dest_persist_conns", "gauge", "Persistent connections of real server.",
+                  struct dpvs_stats_shm_dest, persistconns, METRICS_U32),
+};
+
+/*
+ * output is appended piece by piece, snprintf is avoided on the per-sample
+ * path for output of 10k services to be rendered fast. on allocation
+ * failure the buffer stops growing and the render fails.
+ */
+static bool metrics_grow(struct metrics_buf *b, size_t n)
+{
+    size_t size = b->size ? b->size : METRICS_BUF_INIT;
+    char *data;
+
+    if (b->nomem)
+        return false;
+
+    while (size < b->len + n)
+        size <<= 1;
+
+    data = rte_realloc(b->data, size, 0);
+    if (!data) {
+        b->nomem = true;
+        return false;
+    }
+
+    b->data = data;
+    b->size = size;
+    return true;
+}
+
+static inline void metrics_put(struct metrics_buf *b, const char *s, size_t n)
+{
+    if (unlikely(b->len + n > b->size) && !metrics_grow(b, n))
+        return;
+
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static inline void metrics_puts(struct metrics_buf *b, const char *s)
+{
+    metrics_put(b, s, strlen(s));
+}
+
+static inline void metrics_put_u64(struct metrics_buf *b, uint64_t v)
+{
+    char tmp[20];
+    int i = sizeof(tmp);
+
+    do {
+        tmp[--i] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+
+    metrics_put(b, tmp + i, sizeof(tmp) - i);
+}
+
+/* seconds with fraction from microseconds */
+static void metrics_put_seconds(struct metrics_buf *b, uint64_t us)
+{
+    char tmp[32];
+    int len;
+
+    len = snprintf(tmp, sizeof(tmp), "%lu.%06lu", us / 1000000, us % 1000000);
+    metrics_put(b, tmp, len);
+}
+
+static void metrics_put_family(struct metrics_buf *b, const char *name,
+                               const char *type, const char *help)
+{
+    metrics_puts(b, "# HELP ");
+    metrics_puts(b, name);
+    metrics_put(b, " ", 1);
+    metrics_puts(b, help);
+    metrics_puts(b, "\n# TYPE ");
+    metrics_puts(b, name);
+    metrics_put(b, " ", 1);
+    metrics_puts(b, type);
+    metrics_put(b, "\n", 1);
+}
+
+static inline void metrics_put_value(struct metrics_buf *b, const void *val,
+                                     uint32_t kind)
+{
+    int32_t s32;
+
+    switch (kind) {
+    case METRICS_U32:
+        metrics_put_u64(b, *(const uint32_t *)val);
+        break;
+    case METRICS_S32:
+        s32 = *(const int32_t *)val;
+        if (s32 < 0) {
+            metrics_put(b, "-", 1);
+            metrics_put_u64(b, -(int64_t)s32);
+        } else {
+            metrics_put_u64(b, s32);
+        }
+        break;
+    default:
+        metrics_put_u64(b, *(const uint64_t *)val);
+        break;
+    }
+}
+
+/* name{label} or name_suffix{label,le="x"}, without value */
+static inline void metrics_put_series(struct metrics_buf *b,
+                                      const char *name, size_t nlen,
+                                      const char *suffix,
+                                      const struct metrics_label *label,
+                                      const char *le)
+{
+    metrics_put(b, name, nlen);
+    if (suffix)
+        metrics_puts(b, suffix);
+    metrics_put(b, "{", 1);
+    metrics_put(b, label->str, label->len);
+    if (le) {
+        metrics_puts(b, ",le=\"");
+        metrics_puts(b, le);
+        metrics_put(b, "\"", 1);
+    }
+    metrics_put(b, "} ", 2);
+}
+
+/* render each field of each entry in @sect as a metric family */
+static void metrics_put_sect(struct metrics_buf *b,
+                             const struct dpvs_stats_shm_hdr *hdr,
+                             const struct dpvs_stats_shm_sect *sect,
+                             const struct metrics_label *labels,
+                             const struct metrics_field *fields, int nfield)
+{
+    const struct metrics_field *f;
+    const char *ent;
+    size_t nlen;
+    uint32_t idx;
+    int i;
+
+    for (i = 0; i < nfield; i++) {
+        f = &fields[i];
+        nlen = strlen(f->name);
+
+        metrics_put_family(b, f->name, f->type, f->help);
+        for (idx = 0; idx < sect->num; idx++) {
+            ent = dpvs_stats_shm_entry(hdr, sect, idx);
+            metrics_put_series(b, f->name, nlen, NULL, &labels[idx], NULL);
+            metrics_put_value(b, ent + f->off, f->kind);
+            metrics_put(b, "\n", 1);
+        }
+    }
+}
+
+/*
+ * one histogram series, @bucket[i] counts observations <= @le[i].
+ * the last bound is "+Inf", whose count is also the _count.
+ * _sum is left out if @sum is NULL.
+ */
+static void metrics_put_histogram(struct metrics_buf *b, const char *name,
+                                  const struct metrics_label *label,
+                                  const char *const *le, const uint64_t *bucket,
+                                  int nbucket, const uint64_t *sum)
+{
+    size_t nlen = strlen(name);
+    int i;
+
+    for (i = 0; i < nbucket; i++) {
+        metrics_put_series(b, name, nlen, "_bucket", label, le[i]);
+        metrics_put_u64(b, bucket[i]);
+        metrics_put(b, "\n", 1);
+    }
+
+    if (sum) {
+        metrics_put_series(b, name, nlen, "_sum", label, NULL);
+        metrics_put_u64(b, *sum);
+        metrics_put(b, "\n", 1);
+    }
+
+    metrics_put_series(b, name, nlen, "_count", label, NULL);
+    metrics_put_u64(b, bucket[nbucket - 1]);
+    metrics_put(b, "\n", 1);
+}
+
+/*
+ * rx burst sizes from netif_lcore_stats, which classifies bursts as empty,
+ * up to half of NETIF_MAX_PKT_BURST, and beyond. netif doesn't sum burst
+ * sizes, so there's no _sum.
+ */
+static void metrics_put_lcore_bursts(struct metrics_buf *b,
+                                     const struct dpvs_stats_shm_hdr *hdr,
+                                     const struct metrics_label *labels)
+{
+    static const char *name = "dpvs_lcore_rx_burst_size";
+    char half[8], full[8];
+    const char *le[4] = { "0", half, full, "+Inf" };
+    const struct dpvs_stats_shm_lcore *ent;
+    uint64_t bucket[4];
+    uint32_t idx;
+
+    snprintf(half, sizeof(half), "%d", NETIF_MAX_PKT_BURST / 2);
+    snprintf(full, sizeof(full), "%d", NETIF_MAX_PKT_BURST - 1);
+
+    metrics_put_family(b, name, "histogram", "Packets per rx burst of lcore.");
+    for (idx = 0; idx < hdr->lcore.num; idx++) {
+        ent = dpvs_stats_shm_entry(hdr, &hdr->lcore, idx);
+        bucket[0] = ent->zpktburst;
+        bucket[1] = ent->z2hpktburst;
+        bucket[2] = ent->pktburst - ent->fpktburst;
+        bucket[3] = ent->pktburst;
+        metrics_put_histogram(b, name, &labels[idx], le, bucket, 4, NULL);
+    }
+}
+
+/*
+ * append name="value" to @lb. backslash, double-quote and line feed in the
+ * value are escaped as the text format requires. a value too long for @lb
+ * is cut, but never inside an escape sequence.
+ */
+static void metrics_label_add(struct metrics_label *lb, const char *name,
+                              const char *val, size_t vlen)
+{
+    char *p = lb->str + lb->len, *end = lb->str + sizeof(lb->str) - 1;
+    size_t nlen = strlen(name), i;
+    bool esc;
+
+    if (p + (lb->len ? 1 : 0) + nlen + 3 > end)
+        return;
+
+    if (lb->len)
+        *p++ = ',';
+    memcpy(p, name, nlen);
+    p += nlen;
+    *p++ = '=';
+    *p++ = '"';
+
+    for (i = 0; i < vlen && val[i]; i++) {
+        esc = val[i] == '\\' || val[i] == '"' || val[i] == '\n';
+        if (p + (esc ? 2 : 1) > end - 1)
+            break;
+        if (esc) {
+            *p++ = '\\';
+            *p++ = val[i] == '\n' ? 'n' : val[i];
+        } else {
+            *p++ = val[i];
+        }
+    }
+
+    *p++ = '"';
+    *p = '\0';
+    lb->len = p - lb->str;
+}
+
+static inline void metrics_label_adds(struct metrics_label *lb,
+                                      const char *name, const char *val)
+{
+    metrics_label_add(lb, name, val, strlen(val));
+}
+
+static void metrics_label_addu(struct metrics_label *lb, const char *name,
+                               uint32_t val)
+{
+    char tmp[16];
+
+    snprintf(tmp, sizeof(tmp), "%u", val);
+    metrics_label_adds(lb, name, tmp);
+}
+
+static inline const char *metrics_af_name(int af)
+{
+    return af == AF_INET6 ? "ipv6" : "ipv4";
+}
+
+static void metrics_label_svc(struct metrics_label *lb,
+                              const struct dpvs_stats_shm_svc *svc)
+{
+    char addr[64];
+
+    lb->len = 0;
+
+    if (svc->fwmark) {
+        metrics_label_adds(lb, "af", metrics_af_name(svc->af));
+        metrics_label_addu(lb, "fwmark", svc->fwmark);
+        return;
+    }
+
+    /* no vip:vport, the match pattern tells one from another */
+    if (svc->match[0]) {
+        metrics_label_adds(lb, "af", metrics_af_name(svc->af));
+        metrics_label_add(lb, "match", svc->match, sizeof(svc->match));
+        return;
+    }
+
+    if (!inet_ntop(svc->af, &svc->addr, addr, sizeof(addr)))
+        snprintf(addr, sizeof(addr), "unknown");
+
+    metrics_label_adds(lb, "proto", inet_proto_name(svc->proto));
+    metrics_label_adds(lb, "vip", addr);
+    metrics_label_addu(lb, "vport", ntohs(svc->port));
+}
+
+static void metrics_label_dest(struct metrics_label *lb,
+                               const struct metrics_label *svc_lb,
+                               const struct dpvs_stats_shm_dest *dest)
+{
+    char addr[64];
+
+    if (!inet_ntop(dest->af, &dest->addr, addr, sizeof(addr)))
+        snprintf(addr, sizeof(addr), "unknown");
+
+    /* service labels are escaped already */
+    memcpy(lb->str, svc_lb->str, svc_lb->len + 1);
+    lb->len = svc_lb->len;
+    metrics_label_adds(lb, "rip", addr);
+    metrics_label_addu(lb, "rport", ntohs(dest->port));
+}
+
+static void metrics_label_qsch(struct metrics_label *lb,
+                               const struct dpvs_stats_shm_qsch *qsch)
+{
+    char handle[16];
+
+    lb->len = 0;
+    metrics_label_add(lb, "dev", qsch->dev, sizeof(qsch->dev));
+    metrics_label_adds(lb, "handle",
+                       tc_handle_itoa(qsch->handle, handle, sizeof(handle)));
+    metrics_label_adds(lb, "parent",
+                       tc_handle_itoa(qsch->parent, handle, sizeof(handle)));
+    metrics_label_add(lb, "kind", qsch->kind, sizeof(qsch->kind));
+}
+
+/*
+ * labels are formatted once per render, then shared by all families of
+ * the entry. returns where labels of each section start.
+ */
+static int metrics_build_labels(const struct dpvs_stats_shm_hdr *hdr,
+                                struct metrics_label **lcore,
+                                struct metrics_label **port,
+                                struct metrics_label **mib,
+                                struct metrics_label **inet,
+                                struct metrics_label **qsch,
+                                struct metrics_label **svc,
+                                struct metrics_label **dest)
+{
+    const struct dpvs_stats_shm_lcore *lent;
+    const struct dpvs_stats_shm_port *pent;
+    const struct dpvs_stats_shm_mib *ment;
+    const struct dpvs_stats_shm_inet *ient;
+    const struct dpvs_stats_shm_dest *dent;
+    struct metrics_label *lb;
+    uint32_t num, idx;
+
+    num = hdr->lcore.num + hdr->port.num + hdr->mib.num + hdr->inet.num +
+          hdr->qsch.num + hdr->svc.num + hdr->dest.num;
+    if (num > metrics_nlabel) {
+        lb = rte_realloc(metrics_labels, (size_t)num * sizeof(*lb), 0);
+        if (!lb)
+            return EDPVS_NOMEM;
+        metrics_labels = lb;
+        metrics_nlabel = num;
+    }
+
+    lb = metrics_labels;
+
+    *lcore = lb;
+    for (idx = 0; idx < hdr->lcore.num; idx++, lb++) {
+        lent = dpvs_stats_shm_entry(hdr, &hdr->lcore, idx);
+        lb->len = 0;
+        metrics_label_addu(lb, "lcore", lent->cid);
+    }
+
+    *port = lb;
+    for (idx = 0; idx < hdr->port.num; idx++, lb++) {
+        pent = dpvs_stats_shm_entry(hdr, &hdr->port, idx);
+        lb->len = 0;
+        metrics_label_add(lb, "port", pent->name, sizeof(pent->name));
+    }
+
+    *mib = lb;
+    for (idx = 0; idx < hdr->mib.num; idx++, lb++) {
+        ment = dpvs_stats_shm_entry(hdr, &hdr->mib, idx);
+        lb->len = 0;
+        metrics_label_add(lb, "mib", ment->name, sizeof(ment->name));
+    }
+
+    *inet = lb;
+    for (idx = 0; idx < hdr->inet.num; idx++, lb++) {
+        ient = dpvs_stats_shm_entry(hdr, &hdr->inet, idx);
+        lb->len = 0;
+        metrics_label_adds(lb, "af", metrics_af_name(ient->af));
+    }
+
+    *qsch = lb;
+    for (idx = 0; idx < hdr->qsch.num; idx++, lb++)
+        metrics_label_qsch(lb, dpvs_stats_shm_entry(hdr, &hdr->qsch, idx));
+
+    *svc = lb;
+    for (idx = 0; idx < hdr->svc.num; idx++, lb++)
+        metrics_label_svc(lb, dpvs_stats_shm_entry(hdr, &hdr->svc, idx));
+
+    *dest = lb;
+    for (idx = 0; idx < hdr->dest.num; idx++, lb++) {
+        dent = dpvs_stats_shm_entry(hdr, &hdr->dest, idx);
+        if (dent->svc >= hdr->svc.num)
+            return EDPVS_INVAL;
+        metrics_label_dest(lb, &(*svc)[dent->svc], dent);
+    }
+
+    return EDPVS_OK;
+}
+
+/*
+ * render body into metrics_out after METRICS_HDR_ROOM bytes, leaving room
+ * for the response header. the region is written by master lcore too, so
+ * reading it here needs no seqlock.
+ */
+static int metrics_render(void)
+{
+    const struct dpvs_stats_shm_hdr *hdr = stats_shm_region();
+    struct metrics_buf *b = &metrics_out;
+    struct metrics_label *lcore, *port, *mib, *inet, *qsch, *svc, *dest;
+    uint64_t start;
+    int err;
+
+    if (!hdr)
+        return EDPVS_NOTEXIST;
+
+    start = rte_get_timer_cycles();
+
+    err = metrics_build_labels(hdr, &lcore, &port, &mib, &inet, &qsch,
+                               &svc, &dest);
+    if (err != EDPVS_OK)
+        return err;
+
+    b->nomem = false;
+    b->len = 0;
+    if (b->size < METRICS_HDR_ROOM && !metrics_grow(b, METRICS_HDR_ROOM))
+        return EDPVS_NOMEM;
+    b->len = METRICS_HDR_ROOM;
+
+    metrics_put_family(b, "dpvs_stats_updated_seconds", "gauge",
+                       "Wall clock of last statistics update.");
+    metrics_puts(b, "dpvs_stats_updated_seconds ");
+    metrics_put_seconds(b, hdr->updated_us);
+    metrics_put(b, "\n", 1);
+
+    metrics_put_family(b, "dpvs_stats_truncated", "gauge",
+                       "Whether some entries are left out of the stats region.");
+    metrics_puts(b, "dpvs_stats_truncated ");
+    metrics_puts(b, hdr->flags & DPVS_STATS_SHM_F_TRUNC ? "1\n" : "0\n");
+
+    metrics_put_family(b, "dpvs_metrics_render_seconds", "gauge",
+                       "Time taken to render the previous scrape.");
+    metrics_puts(b, "dpvs_metrics_render_seconds ");
+    metrics_put_seconds(b, metrics_render_us);
+    metrics_put(b, "\n", 1);
+
+    metrics_put_sect(b, hdr, &hdr->lcore, lcore, metrics_lcore_fields,
+                     NELEMS(metrics_lcore_fields));
+    metrics_put_lcore_bursts(b, hdr, lcore);
+    metrics_put_sect(b, hdr, &hdr->port, port, metrics_port_fields,
+                     NELEMS(metrics_port_fields));
+    metrics_put_sect(b, hdr, &hdr->mib, mib, metrics_mib_fields,
+                     NELEMS(metrics_mib_fields));
+    metrics_put_sect(b, hdr, &hdr->inet, inet, metrics_inet_fields,
+                     NELEMS(metrics_inet_fields));
+    metrics_put_sect(b, hdr, &hdr->qsch, qsch, metrics_qsch_fields,
+                     NELEMS(metrics_qsch_fields));
+    metrics_put_sect(b, hdr, &hdr->svc, svc, metrics_svc_fields,
+                     NELEMS(metrics_svc_fields));
+    metrics_put_sect(b, hdr, &hdr->dest, dest, metrics_dest_fields,
+                     NELEMS(metrics_dest_fields));
+
+    if (b->nomem)
+        return EDPVS_NOMEM;
+
+    metrics_render_us = (rte_get_timer_cycles() - start) * 1000000 /
+                        rte_get_timer_hz();
+    return EDPVS_OK;
+}
+
+static void metrics_client_close(void)
+{
+    close(metrics_clt.fd);
+    metrics_clt.fd = -1;
+    metrics_clt.replying = false;
+    metrics_clt.reqlen = 0;
+    metrics_clt.out = NULL;
+    metrics_clt.outlen = 0;
+    metrics_clt.sent = 0;
+}
+
+static void metrics_reply_status(const char *status)
+{
+    static char resp[128];
+
+    metrics_clt.outlen = snprintf(resp, sizeof(resp),
+                                  "HTTP/1.0 %s\r\nContent-Length: 0\r\n"
+                                  "Connection: close\r\n\r\n", status);
+    metrics_clt.out = resp;
+}
+
+static void metrics_reply(void)
+{
+    struct metrics_buf *b = &metrics_out;
+    char hdr[METRICS_HDR_ROOM];
+    char *req = metrics_clt.req;
+    int hlen, err;
+
+    metrics_clt.replying = true;
+    metrics_clt.sent = 0;
+
+    if (strncmp(req, "GET ", 4) != 0) {
+        metrics_reply_status("405 Method Not Allowed");
+        return;
+    }
+
+    if (strncmp(req + 4, "/metrics", 8) != 0 ||
+        (req[12] != ' ' && req[12] != '?' && req[12] != '\r')) {
+        metrics_reply_status("404 Not Found");
+        return;
+    }
+
+    err = metrics_render();
+    if (err != EDPVS_OK) {
+        RTE_LOG(WARNING, METRICS, "%s: fail to render metrics: %s\n",
+                __func__, dpvs_strerror(err));
+        metrics_reply_status("503 Service Unavailable");
+        return;
+    }
+
+    hlen = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                    b->len - METRICS_HDR_ROOM);
+    assert(hlen < METRICS_HDR_ROOM);
+
+    memcpy(b->data + METRICS_HDR_ROOM - hlen, hdr, hlen);
+    metrics_clt.out = b->data + METRICS_HDR_ROOM - hlen;
+    metrics_clt.outlen = b->len - METRICS_HDR_ROOM + hlen;
+}
+
+/*
+ * nonblocking, never waits for scrapers: each call accepts, reads the
+ * request or writes part of the response as far as the socket allows.
+ */
+int metrics_ctl(void)
+{
+    struct metrics_client *clt = &metrics_clt;
+    ssize_t n;
+    int fd;
+
+    if (metrics_srv_fd < 0)
+        return EDPVS_OK;
+
+    if (clt->fd < 0) {
+        fd = accept(metrics_srv_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EWOULDBLOCK && errno != EAGAIN)
+                RTE_LOG(WARNING, METRICS, "%s: fail to accept: %s\n",
+                        __func__, strerror(errno));
+            return EDPVS_IO;
+        }
+
+        if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+            close(fd);
+            return EDPVS_IO;
+        }
+
+        clt->fd = fd;
+        clt->deadline = rte_get_timer_cycles() +
+                        METRICS_CLIENT_TIMEOUT * rte_get_timer_hz();
+    }
+
+    if (rte_get_timer_cycles() > clt->deadline) {
+        RTE_LOG(DEBUG, METRICS, "%s: scraper timed out\n", __func__);
+        metrics_client_close();
+        return EDPVS_IO;
+    }
+
+    if (!clt->replying) {
+        n = recv(clt->fd, clt->req + clt->reqlen,
+                 sizeof(clt->req) - 1 - clt->reqlen, 0);
+        if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
+            return EDPVS_OK;
+        if (n <= 0) {
+            metrics_client_close();
+            return n < 0 ? EDPVS_IO : EDPVS_OK;
+        }
+
+        clt->reqlen += n;
+        clt->req[clt->reqlen] = '\0';
+
+        /* request line is all we need, and we don't wait for body */
+        if (!strstr(clt->req, "\r\n\r\n") && !strstr(clt->req, "\n\n") &&
+            clt->reqlen < sizeof(clt->req) - 1)
+            return EDPVS_OK;
+
+        metrics_reply();
+    }
+
+    n = send(clt->fd, clt->out + clt->sent, clt->outlen - clt->sent,
+             MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
+        return EDPVS_OK;
+    if (n < 0) {
+        metrics_client_close();
+        return EDPVS_IO;
+    }
+
+    clt->sent += n;
+    if (clt->sent >= clt->outlen)
+        metrics_client_close();
+
+    return EDPVS_OK;
+}
+
+/* "ip:port" for TCP, or absolute path for unix socket */
+static int metrics_parse_listen(const char *str, struct sockaddr_storage *ss,
+                                socklen_t *sslen)
+{
+    struct sockaddr_un *sun = (struct sockaddr_un *)ss;
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+    char ip[INET_ADDRSTRLEN];
+    const char *colon;
+    int port;
+
+    memset(ss, 0, sizeof(*ss));
+
+    if (str[0] == '/') {
+        if (strlen(str) >= sizeof(sun->sun_path))
+            return EDPVS_INVAL;
+        sun->sun_family = AF_UNIX;
+        snprintf(sun->sun_path, sizeof(sun->sun_path), "%s", str);
+        *sslen = sizeof(*sun);
+        return EDPVS_OK;
+    }
+
+    colon = strrchr(str, ':');
+    if (!colon || (size_t)(colon - str) >= sizeof(ip))
+        return EDPVS_INVAL;
+
+    memcpy(ip, str, colon - str);
+    ip[colon - str] = '\0';
+    port = atoi(colon + 1);
+    if (port <= 0 || port > 65535)
+        return EDPVS_INVAL;
+
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &sin->sin_addr) <= 0)
+        return EDPVS_INVAL;
+    *sslen = sizeof(*sin);
+
+    return EDPVS_OK;
+}
+
+int metrics_init(void)
+{
+    struct sockaddr_storage ss;
+    socklen_t sslen;
+    int fd, on = 1;
+
+    if (!metrics_enable)
+        return EDPVS_OK;
+
+    if (!stats_shm_region()) {
+        RTE_LOG(ERR, METRICS, "%s: metrics needs stats_shm enabled\n", __func__);
+        return EDPVS_INVAL;
+    }
+
+    if (metrics_parse_listen(metrics_listen, &ss, &sslen) != EDPVS_OK)
+        return EDPVS_INVAL;
+
+    fd = socket(ss.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        RTE_LOG(ERR, METRICS, "%s: fail to create socket: %s\n",
+                __func__, strerror(errno));
+        return EDPVS_IO;
+    }
+
+    if (ss.ss_family == AF_UNIX)
+        unlink(metrics_listen);
+    else
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0 ||
+        bind(fd, (struct sockaddr *)&ss, sslen) < 0 ||
+        listen(fd, 16) < 0) {
+        RTE_LOG(ERR, METRICS, "%s: fail to listen on %s: %s\n",
+                __func__, metrics_listen, strerror(errno));
+        close(fd);
+        return EDPVS_IO;
+    }
+
+    metrics_srv_fd = fd;
+
+    RTE_LOG(INFO, METRICS, "%s: serving metrics on %s\n", __func__, metrics_listen);
+    return EDPVS_OK;
+}
+
+int metrics_term(void)
+{
+    if (metrics_srv_fd < 0)
+        return EDPVS_OK;
+
+    if (metrics_clt.fd >= 0)
+        metrics_client_close();
+
+    close(metrics_srv_fd);
+    metrics_srv_fd = -1;
+    if (metrics_listen[0] == '/')
+        unlink(metrics_listen);
+
+    rte_free(metrics_out.data);
+    memset(&metrics_out, 0, sizeof(metrics_out));
+    rte_free(metrics_labels);
+    metrics_labels = NULL;
+    metrics_nlabel = 0;
+
+    return EDPVS_OK;
+}
+
+static void metrics_enable_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+
+    assert(str);
+
+    if (strcasecmp(str, "on") == 0)
+        metrics_enable = true;
+    else if (strcasecmp(str, "off") == 0)
+        metrics_enable = false;
+    else
+        RTE_LOG(WARNING, METRICS, "invalid metrics:enable %s\n", str);
+
+    RTE_LOG(INFO, METRICS, "metrics:enable = %s\n", metrics_enable ? "on" : "off");
+
+    FREE_PTR(str);
+}
+
+static void metrics_listen_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    struct sockaddr_storage ss;
+    socklen_t sslen;
+
+    assert(str);
+
+    if (strlen(str) < sizeof(metrics_listen) &&
+        metrics_parse_listen(str, &ss, &sslen) == EDPVS_OK) {
+        RTE_LOG(INFO, METRICS, "metrics:listen = %s\n", str);
+        snprintf(metrics_listen, sizeof(metrics_listen), "%s", str);
+    } else {
+        RTE_LOG(WARNING, METRICS, "invalid metrics:listen %s, using default %s\n",
+                str, METRICS_LISTEN_DEF);
+        snprintf(metrics_listen, sizeof(metrics_listen), "%s", METRICS_LISTEN_DEF);
+    }
+
+    FREE_PTR(str);
+}
+
+void metrics_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+        metrics_enable = false;
+        snprintf(metrics_listen, sizeof(metrics_listen), "%s", METRICS_LISTEN_DEF);
+    }
+    /* KW_TYPE_NORMAL keyword */
+}
+
+/* sub-keywords of ctrl_defs */
+void install_metrics_keywords(void)
+{
+    install_keyword("metrics", NULL, KW_TYPE_INIT);
+    install_sublevel();
+    install_keyword("enable", metrics_enable_handler, KW_TYPE_INIT);
+    install_keyword("listen", metrics_listen_handler, KW_TYPE_INIT);
+    install_sublevel_end();
+}
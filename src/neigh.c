@@ -28,6 +28,7 @@
 #include "neigh.h"
 #include "common.h"
 #include "route.h"
+#include "route6.h"
 #include "ctrl.h"
 #include "ndisc.h"
 #include "conf/neigh.h"
@@ -40,20 +41,50 @@
 #define DPVS_NEIGH_TIMEOUT_MIN 1
 #define DPVS_NEIGH_TIMEOUT_MAX 3600
 
-static int neigh_nums[DPVS_MAX_LCORE] = {0};
+/* max unresolved nexthops with packets queued, per lcore */
+#define NEIGH_PENDING_SLOTS    32
 
-struct neighbour_mbuf_entry {
-    struct rte_mbuf   *m;
-    struct list_head  neigh_mbuf_list;
-} __rte_cache_aligned;
+/* seconds a removed entry stays readable before it's freed */
+#define NEIGH_GC_DELAY         2
+
+/* seconds between re-resolving routes of pinned addresses */
+#define NEIGH_PIN_INTERVAL     5
+
+/* neighbours known by owner lcore */
+static int neigh_nums = 0;
+
+enum {
+    NEIGH_REQ_UPDATE = 0,   /* hw address learned from arp/nd */
+    NEIGH_REQ_RESOLVE,      /* nexthop missed on some lcore */
+    NEIGH_REQ_PROBE,        /* stale nexthop used on some lcore */
+};
 
+/* request from slave lcores to the owner of neighbour tables */
 struct raw_neigh {
     int               af;
     union inet_addr   ip_addr;
     struct ether_addr eth_addr;
     struct netif_port *port;
-    bool              add;
-    uint8_t           flag;
+    uint8_t           op;
+} __rte_cache_aligned;
+
+/*
+ * per-lcore queue of mbufs waiting for nexthop resolution, mbufs are
+ * chained through @userdata and no memory is allocated for queueing.
+ */
+struct neigh_pending {
+    int               af;
+    union inet_addr   ip_addr;
+    struct netif_port *port;    /* NULL if slot is free */
+    struct rte_mbuf   *head;
+    struct rte_mbuf   *tail;
+    uint32_t          qlen;
+    uint64_t          expire;
+};
+
+struct neigh_pending_queue {
+    uint32_t             npending;
+    struct neigh_pending slots[NEIGH_PENDING_SLOTS];
 } __rte_cache_aligned;
 
 struct nud_state {
@@ -82,7 +113,36 @@ static struct nud_state nud_states[] = {
 /* params from config file */
 static int arp_unres_qlen = NEIGH_ENTRY_BUFF_SIZE_DEF;
 
-static struct rte_ring *neigh_ring[DPVS_MAX_LCORE];
+static struct rte_ring *neigh_ring;
+static struct rte_mempool *neigh_req_pool;
+
+static struct neigh_pending_queue neigh_pendings[DPVS_MAX_LCORE];
+
+struct neigh_lcore_stats {
+    struct dp_vs_neigh_stats stats;
+} __rte_cache_aligned;
+
+static struct neigh_lcore_stats neigh_stats[DPVS_MAX_LCORE];
+
+#define NEIGH_STATS_ADD(field, n) (neigh_stats[rte_lcore_id()].stats.field += (n))
+#define NEIGH_STATS_INC(field)    NEIGH_STATS_ADD(field, 1)
+
+/*
+ * address (dest or gateway) whose nexthop is kept resolved, owner only.
+ * routes may change, so the nexthop is re-resolved periodically.
+ */
+struct neigh_pin {
+    struct list_head  list;
+    int               af;
+    union inet_addr   addr;
+    union inet_addr   nexthop;
+    struct netif_port *port;    /* NULL if no route yet */
+    uint32_t          refcnt;
+};
+
+static bool neigh_pin_enable = false;
+static struct list_head neigh_pin_table[NEIGH_TAB_SIZE];
+static struct dpvs_timer neigh_pin_timer;
 
 static void unres_qlen_handler(vector_t tokens)
 {
@@ -123,12 +183,31 @@ static void timeout_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void pin_nexthop_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+
+    assert(str);
+
+    if (strcasecmp(str, "on") == 0)
+        neigh_pin_enable = true;
+    else if (strcasecmp(str, "off") == 0)
+        neigh_pin_enable = false;
+    else
+        RTE_LOG(WARNING, NEIGHBOUR, "invalid neigh:pin_nexthop %s\n", str);
+
+    RTE_LOG(INFO, NEIGHBOUR, "neigh:pin_nexthop = %s\n", neigh_pin_enable ? "on" : "off");
+
+    FREE_PTR(str);
+}
+
 void neigh_keyword_value_init(void)
 {
     if (dpvs_state_get() == DPVS_STATE_INIT) {
         /* KW_TYPE_INIT keyword */
         arp_unres_qlen = NEIGH_ENTRY_BUFF_SIZE_DEF;
         nud_timeouts[DPVS_NUD_S_REACHABLE] = DPVS_NEIGH_TIMEOUT_DEF;
+        neigh_pin_enable = false;
     }
     /* KW_TYPE_NORMAL keyword */
 }
@@ -138,16 +217,23 @@ void install_neighbor_keywords(void)
     install_keyword_root("neigh_defs", NULL);
     install_keyword("unres_queue_length", unres_qlen_handler, KW_TYPE_INIT);
     install_keyword("timeout", timeout_handler, KW_TYPE_INIT);
+    install_keyword("pin_nexthop", pin_nexthop_handler, KW_TYPE_INIT);
 }
 
 static lcoreid_t master_cid = 0;
+static int master_socket = 0;
+
+static struct list_head neigh_table[DPVS_MAX_SOCKET][NEIGH_TAB_SIZE];
 
-static struct list_head neigh_table[DPVS_MAX_LCORE][NEIGH_TAB_SIZE];
+/* removed entries waiting for readers to leave, owner only */
+static struct list_head neigh_gc_list;
 
-static struct raw_neigh* neigh_ring_clone_entry(const struct neighbour_entry* neighbour,
-                                                bool add);
+static int neigh_send_arp(struct netif_port *port, uint32_t src_ip, uint32_t dst_ip,
+                          const struct ether_addr *dmac);
 
-static int neigh_send_arp(struct netif_port *port, uint32_t src_ip, uint32_t dst_ip);
+static void neigh_state_confirm(struct neighbour_entry *neighbour);
+
+static void neigh_probe(struct neighbour_entry *neighbour);
 
 static inline char *eth_addr_itoa(const struct ether_addr *src, char *dst, size_t size)
 {
@@ -191,31 +277,47 @@ static inline void dump_arp_hdr(const char *msg, const struct arp_hdr *ah, porti
 }
 #endif
 
-static inline int neigh_hash(struct neighbour_entry *neighbour, unsigned int hashkey)
+static inline bool neigh_is_owner(void)
 {
-    lcoreid_t cid = rte_lcore_id();
-    if(!(neighbour->flag & NEIGHBOUR_HASHED)){
-        list_add(&neighbour->neigh_list, &neigh_table[cid][hashkey]);
-        neighbour->flag |= NEIGHBOUR_HASHED;
-        return EDPVS_OK;
-    }
+    return rte_lcore_id() == master_cid;
+}
 
-    return EDPVS_EXIST;
+static inline bool neigh_state_valid(uint32_t state)
+{
+    return state == DPVS_NUD_S_REACHABLE ||
+           state == DPVS_NUD_S_PROBE ||
+           state == DPVS_NUD_S_DELAY;
 }
 
-static inline int neigh_unhash(struct neighbour_entry *neighbour)
+/*
+ * lock-free readers only follow @next, so publish the entry completely
+ * before linking it, and never poison @next on removal.
+ */
+static inline void neigh_hash(struct neighbour_entry *neighbour, int sid,
+                              unsigned int hashkey)
 {
-    int err;
-    if((neighbour->flag & NEIGHBOUR_HASHED)){
-        list_del(&neighbour->neigh_list);
-        neighbour->flag &= ~NEIGHBOUR_HASHED;
-        err = EDPVS_OK;
-    } else {
-        err = EDPVS_NOTEXIST;
-    }
-    if (unlikely(err == EDPVS_NOTEXIST))
+    struct list_head *head = &neigh_table[sid][hashkey];
+
+    if (neighbour->flag & NEIGHBOUR_HASHED)
+        return;
+
+    neighbour->neigh_list.next = head->next;
+    neighbour->neigh_list.prev = head;
+    rte_smp_wmb();
+    head->next->prev = &neighbour->neigh_list;
+    head->next = &neighbour->neigh_list;
+    neighbour->flag |= NEIGHBOUR_HASHED;
+}
+
+static inline void neigh_unhash(struct neighbour_entry *neighbour)
+{
+    if (!(neighbour->flag & NEIGHBOUR_HASHED)) {
         RTE_LOG(DEBUG, NEIGHBOUR, "%s: neighbour entry not hashed.\n", __func__);
-    return err;
+        return;
+    }
+
+    __list_del(neighbour->neigh_list.prev, neighbour->neigh_list.next);
+    neighbour->flag &= ~NEIGHBOUR_HASHED;
 }
 
 static inline bool neigh_key_cmp(int af, const struct neighbour_entry *neighbour,
@@ -227,29 +329,126 @@ static inline bool neigh_key_cmp(int af, const struct neighbour_entry *neighbour
            (neighbour->af == af);
 }
 
-static int neigh_entry_expire(struct neighbour_entry *neighbour)
+/* consistent snapshot of hw address and state, for any lcore */
+static inline uint32_t neigh_read_hw(const struct neighbour_entry *neighbour,
+                                     struct ether_addr *eth_addr)
+{
+    uint32_t seq, state;
+
+    do {
+        seq = neighbour->seq;
+        rte_smp_rmb();
+        ether_addr_copy(&neighbour->eth_addr, eth_addr);
+        state = neighbour->state;
+        rte_smp_rmb();
+    } while (unlikely((seq & 1) || seq != neighbour->seq));
+
+    return state;
+}
+
+/* owner only: update hw address and/or state of all replicas */
+static void neigh_write_hw(struct neighbour_entry *neighbour,
+                           const struct ether_addr *eth_addr, uint32_t state)
+{
+    struct neighbour_entry *rep;
+    int sid;
+
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        rep = neighbour->home->replicas[sid];
+        if (!rep)
+            continue;
+
+        rep->seq++;
+        rte_smp_wmb();
+        if (eth_addr)
+            ether_addr_copy(eth_addr, &rep->eth_addr);
+        rep->state = state;
+        rte_smp_wmb();
+        rep->seq++;
+    }
+}
+
+static inline void neigh_clear_req(struct neighbour_entry *neighbour)
+{
+    int sid;
+
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        if (neighbour->home->replicas[sid])
+            rte_atomic16_clear(&neighbour->home->replicas[sid]->req_pending);
+    }
+}
+
+static void neigh_flag_set(struct neighbour_entry *neighbour, uint8_t flag, bool on)
+{
+    struct neighbour_entry *rep;
+    int sid;
+
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        rep = neighbour->home->replicas[sid];
+        if (!rep)
+            continue;
+        if (on)
+            rep->flag |= flag;
+        else
+            rep->flag &= ~flag;
+    }
+}
+
+/* latest confirmation (in cycles) seen by any lcore */
+static inline uint64_t neigh_confirmed(const struct neighbour_entry *neighbour)
 {
-    struct neighbour_mbuf_entry *mbuf, *mbuf_next;
-    lcoreid_t cid = rte_lcore_id();
-
-    dpvs_timer_cancel(&neighbour->timer, false);
-    neigh_unhash(neighbour);
-        //release pkts saved in neighbour entry
-    list_for_each_entry_safe(mbuf,mbuf_next,
-              &neighbour->queue_list,neigh_mbuf_list){
-        list_del(&mbuf->neigh_mbuf_list);
-        rte_pktmbuf_free(mbuf->m);
-        rte_free(mbuf);
+    uint64_t confirmed = 0;
+    int sid;
+
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        if (neighbour->home->replicas[sid] &&
+            neighbour->home->replicas[sid]->confirmed > confirmed)
+            confirmed = neighbour->home->replicas[sid]->confirmed;
     }
 
-    rte_free(neighbour);
-    assert(cid != master_cid);
-    neigh_nums[cid]--;
+    return confirmed;
+}
+
+static void neigh_entry_expire(struct neighbour_entry *neighbour)
+{
+    struct neighbour_entry *rep;
+    uint64_t expire;
+    int sid;
+
+    neighbour = neighbour->home;
+    assert(neigh_is_owner());
+
+    if (!(neighbour->flag & NEIGHBOUR_STATIC))
+        dpvs_timer_cancel(&neighbour->timer, true);
 
-    return DTIMER_STOP;
+    /* lcores may still be walking through the entries, free them later */
+    expire = rte_get_timer_cycles() + NEIGH_GC_DELAY * rte_get_timer_hz();
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        rep = neighbour->replicas[sid];
+        if (!rep)
+            continue;
+        neigh_unhash(rep);
+        rep->gc_expire = expire;
+        list_add_tail(&rep->gc_list, &neigh_gc_list);
+    }
+
+    neigh_nums--;
 }
 
-void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx)
+static void neigh_gc(void)
+{
+    struct neighbour_entry *neighbour, *next;
+    uint64_t now = rte_get_timer_cycles();
+
+    list_for_each_entry_safe(neighbour, next, &neigh_gc_list, gc_list) {
+        if (neighbour->gc_expire > now)
+            break;
+        list_del(&neighbour->gc_list);
+        rte_free(neighbour);
+    }
+}
+
+static void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx)
 {
     struct timeval timeout;
 
@@ -259,7 +458,7 @@ void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx)
         int old_state = neighbour->state;
         struct timespec now = { 0 };
 
-        neighbour->state = nud_states[idx].next_state[neighbour->state];
+        neigh_write_hw(neighbour, NULL, nud_states[idx].next_state[old_state]);
         if (neighbour->state == old_state) {
             if (likely(clock_gettime(CLOCK_REALTIME_COARSE, &now)) == 0)
                 /* frequent timer updates hurt performance,
@@ -270,7 +469,7 @@ void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx)
 
         timeout.tv_sec = nud_timeouts[neighbour->state];
         timeout.tv_usec = 0;
-        dpvs_timer_update(&neighbour->timer, &timeout, false);
+        dpvs_timer_update(&neighbour->timer, &timeout, true);
         neighbour->ts = now.tv_sec;
 #ifdef CONFIG_DPVS_NEIGH_DEBUG
         RTE_LOG(DEBUG, NEIGHBOUR, "%s trans state to %s.\n",
@@ -279,86 +478,172 @@ void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx)
     }
 }
 
+/*
+ * pinned neighbour is probed by unicast when its reachable time is over,
+ * and stays usable while the probe is in flight.
+ */
+static int neigh_pinned_timer_event(struct neighbour_entry *neighbour)
+{
+    struct timeval delay = { .tv_usec = 0 };
+    bool answered;
+
+    if (!neighbour->probed) {
+        neigh_probe(neighbour);
+        delay.tv_sec = nud_timeouts[DPVS_NUD_S_DELAY];
+        dpvs_timer_update(&neighbour->timer, &delay, true);
+        return DTIMER_OK;
+    }
+
+    /* confirmations are recorded with one second resolution */
+    answered = neigh_confirmed(neighbour) + rte_get_timer_hz() > neighbour->probed;
+    neighbour->probed = 0;
+    if (answered) {
+        delay.tv_sec = nud_timeouts[DPVS_NUD_S_REACHABLE];
+        dpvs_timer_update(&neighbour->timer, &delay, true);
+        return DTIMER_OK;
+    }
+
+    /* no answer, fall back to broadcast */
+    neigh_state_confirm(neighbour);
+    neigh_entry_state_trans(neighbour, 4);
+    return DTIMER_OK;
+}
+
 static int neighbour_timer_event(void *data)
 {
     struct neighbour_entry *neighbour = data;
+    uint64_t timeout;
 
     if (neighbour->state == DPVS_NUD_S_NONE) {
-        return neigh_entry_expire(neighbour);
+        if (neighbour->flag & NEIGHBOUR_PINNED) {
+            /* never give up a pinned nexthop */
+            neigh_state_confirm(neighbour);
+            neigh_entry_state_trans(neighbour, 0);
+            return DTIMER_OK;
+        }
+        neigh_entry_expire(neighbour);
+        return DTIMER_STOP;
+    }
+
+    if ((neighbour->flag & NEIGHBOUR_PINNED) &&
+        neighbour->state == DPVS_NUD_S_REACHABLE)
+        return neigh_pinned_timer_event(neighbour);
+
+    /* lcores confirmed the neighbour while it's in use */
+    timeout = (uint64_t)nud_timeouts[neighbour->state] * rte_get_timer_hz();
+    if (neighbour->state != DPVS_NUD_S_SEND &&
+        neigh_confirmed(neighbour) + timeout > rte_get_timer_cycles()) {
+        struct timeval delay = {
+            .tv_sec  = nud_timeouts[DPVS_NUD_S_REACHABLE],
+            .tv_usec = 0,
+        };
+
+        if (neighbour->state != DPVS_NUD_S_REACHABLE)
+            neigh_write_hw(neighbour, NULL, DPVS_NUD_S_REACHABLE);
+        dpvs_timer_update(&neighbour->timer, &delay, true);
+        return DTIMER_OK;
     }
+
     neigh_entry_state_trans(neighbour, 4);
     return DTIMER_OK;
 }
 
-struct neighbour_entry *neigh_lookup_entry(int af, const union inet_addr *key,
-                                           const struct netif_port* port,
-                                           unsigned int hashkey)
+static inline struct neighbour_entry *
+__neigh_lookup_entry(int sid, int af, const union inet_addr *key,
+                     const struct netif_port* port, unsigned int hashkey)
 {
     struct neighbour_entry *neighbour;
-    lcoreid_t cid = rte_lcore_id();
-    list_for_each_entry(neighbour, &neigh_table[cid][hashkey], neigh_list){
-        if(neigh_key_cmp(af, neighbour, key, port)) {
+
+    list_for_each_entry(neighbour, &neigh_table[sid][hashkey], neigh_list) {
+        if (neigh_key_cmp(af, neighbour, key, port))
             return neighbour;
-        }
     }
 
     return NULL;
 }
 
-int neigh_edit(struct neighbour_entry *neighbour, struct ether_addr *eth_addr)
+/* lock-free lookup in table of current socket */
+struct neighbour_entry *neigh_lookup_entry(int af, const union inet_addr *key,
+                                           const struct netif_port* port,
+                                           unsigned int hashkey)
 {
-    rte_memcpy(&neighbour->eth_addr, eth_addr, 6);
-
-    return EDPVS_OK;
+    return __neigh_lookup_entry(rte_socket_id(), af, key, port, hashkey);
 }
 
-struct neighbour_entry *neigh_add_table(int af, const union inet_addr *ipaddr,
-                                        const struct ether_addr *eth_addr,
-                                        struct netif_port *port,
-                                        unsigned int hashkey, int flag)
+/* owner only */
+static struct neighbour_entry *neigh_add_table(int af, const union inet_addr *ipaddr,
+                                               const struct ether_addr *eth_addr,
+                                               struct netif_port *port,
+                                               unsigned int hashkey, int flag)
 {
-    struct neighbour_entry *new_neighbour=NULL;
+    struct neighbour_entry *home, *rep;
     struct timeval delay;
-    lcoreid_t cid = rte_lcore_id();
+    int sid;
 
-    new_neighbour = rte_zmalloc("new_neighbour_entry",
-                    sizeof(struct neighbour_entry), RTE_CACHE_LINE_SIZE);
-    if(new_neighbour == NULL)
-        return NULL;
+    assert(neigh_is_owner());
 
-    rte_memcpy(&new_neighbour->ip_addr, ipaddr,
-                sizeof(union inet_addr));
-    new_neighbour->flag = flag;
-    new_neighbour->af   = af;
+    home = rte_zmalloc_socket("new_neighbour_entry", sizeof(struct neighbour_entry),
+                              RTE_CACHE_LINE_SIZE, master_socket);
+    if (!home)
+        return NULL;
+    home->home = home;
+    home->replicas[master_socket] = home;
 
-    if(eth_addr){
-        rte_memcpy(&new_neighbour->eth_addr, eth_addr, 6);
-        new_neighbour->state = DPVS_NUD_S_REACHABLE;
-    }
-    else{
-        new_neighbour->state = DPVS_NUD_S_NONE;
+    for (sid = 0; sid < get_numa_nodes(); sid++) {
+        if (sid == master_socket)
+            continue;
+        rep = rte_zmalloc_socket("new_neighbour_entry", sizeof(struct neighbour_entry),
+                                 RTE_CACHE_LINE_SIZE, sid);
+        if (!rep)
+            goto nomem;
+        rep->home = home;
+        home->replicas[sid] = rep;
     }
 
-    new_neighbour->port = port;
-    new_neighbour->que_num = 0;
-    delay.tv_sec = nud_timeouts[new_neighbour->state];
-    delay.tv_usec = 0;
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        rep = home->replicas[sid];
+        if (!rep)
+            continue;
 
-    INIT_LIST_HEAD(&new_neighbour->queue_list);
+        rte_memcpy(&rep->ip_addr, ipaddr, sizeof(union inet_addr));
+        rep->flag = flag & ~NEIGHBOUR_HASHED;
+        rep->af   = af;
+        rep->port = port;
+        if (eth_addr) {
+            rte_memcpy(&rep->eth_addr, eth_addr, 6);
+            rep->state = DPVS_NUD_S_REACHABLE;
+        } else {
+            rep->state = DPVS_NUD_S_NONE;
+        }
+        rte_atomic16_init(&rep->req_pending);
+    }
 
-    if (!(new_neighbour->flag & NEIGHBOUR_STATIC)) {
-        dpvs_timer_sched(&new_neighbour->timer, &delay,
-                neighbour_timer_event, new_neighbour, false);
+    if (!(home->flag & NEIGHBOUR_STATIC)) {
+        delay.tv_sec = nud_timeouts[home->state];
+        delay.tv_usec = 0;
+        dpvs_timer_sched(&home->timer, &delay,
+                neighbour_timer_event, home, true);
     }
 
-    neigh_hash(new_neighbour, hashkey);
-    neigh_nums[cid]++;
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        if (home->replicas[sid])
+            neigh_hash(home->replicas[sid], sid, hashkey);
+    }
+    neigh_nums++;
+
+    return home;
 
-    return new_neighbour;
+nomem:
+    for (sid = 0; sid < DPVS_MAX_SOCKET; sid++) {
+        if (home->replicas[sid] && home->replicas[sid] != home)
+            rte_free(home->replicas[sid]);
+    }
+    rte_free(home);
+    return NULL;
 }
 
 /***********************fill mac hdr before send pkt************************************/
-static void neigh_fill_mac(struct neighbour_entry *neighbour,
+static void neigh_fill_mac(const struct ether_addr *eth_addr,
                            struct rte_mbuf *m,
                            const struct in6_addr *target,
                            struct netif_port *port)
@@ -370,11 +655,11 @@ static void neigh_fill_mac(struct neighbour_entry *neighbour,
     m->l2_len = sizeof(struct ether_hdr);
     eth = (struct ether_hdr *)rte_pktmbuf_prepend(m, (uint16_t)sizeof(struct ether_hdr));
 
-    if (!neighbour && target) {
+    if (!eth_addr && target) {
         ipv6_mac_mult(target, &mult_eth);
         ether_addr_copy(&mult_eth, &eth->d_addr);
     } else {
-        ether_addr_copy(&neighbour->eth_addr, &eth->d_addr);
+        ether_addr_copy(eth_addr, &eth->d_addr);
     }
 
     ether_addr_copy(&port->addr, &eth->s_addr);
@@ -382,35 +667,201 @@ static void neigh_fill_mac(struct neighbour_entry *neighbour,
     eth->ether_type = rte_cpu_to_be_16(pkt_type);
 }
 
-void neigh_send_mbuf_cach(struct neighbour_entry *neighbour)
+/*************************** per-lcore unresolved queues ********************************/
+/*
+ * @udata64 of queued mbuf keeps the prio for tc:pfifo_fast,
+ * park it in @hash.usr while @userdata is used as chain.
+ */
+static inline void neigh_pending_enqueue(struct neigh_pending *pend,
+                                         struct rte_mbuf *m)
 {
-    struct neighbour_mbuf_entry *mbuf, *mbuf_next;
-    struct rte_mbuf *m;
+    m->hash.usr = (uint32_t)m->udata64;
+    m->userdata = NULL;
 
-    list_for_each_entry_safe(mbuf, mbuf_next,
-                             &neighbour->queue_list,neigh_mbuf_list){
-        list_del(&mbuf->neigh_mbuf_list);
-        m = mbuf->m;
-        neigh_fill_mac(neighbour, m, NULL, neighbour->port);
-        netif_xmit(m, neighbour->port);
-        neighbour->que_num--;
-        rte_free(mbuf);
+    if (pend->tail)
+        pend->tail->userdata = m;
+    else
+        pend->head = m;
+    pend->tail = m;
+    pend->qlen++;
+}
+
+static inline void neigh_pending_release(struct neigh_pending_queue *pq,
+                                         struct neigh_pending *pend)
+{
+    pend->port = NULL;
+    pend->head = pend->tail = NULL;
+    pend->qlen = 0;
+    pq->npending--;
+}
+
+static void neigh_pending_drop(struct neigh_pending_queue *pq,
+                               struct neigh_pending *pend)
+{
+    struct rte_mbuf *m, *next;
+
+    for (m = pend->head; m; m = next) {
+        next = m->userdata;
+        rte_pktmbuf_free(m);
+    }
+    NEIGH_STATS_ADD(unres_drop, pend->qlen);
+    neigh_pending_release(pq, pend);
+}
+
+static void neigh_pending_xmit(struct neigh_pending_queue *pq,
+                               struct neigh_pending *pend,
+                               const struct ether_addr *eth_addr)
+{
+    struct rte_mbuf *m, *next;
+    struct netif_port *port = pend->port;
+
+    for (m = pend->head; m; m = next) {
+        next = m->userdata;
+        m->udata64 = m->hash.usr;
+        neigh_fill_mac(eth_addr, m, NULL, port);
+        netif_xmit(m, port);
     }
+    neigh_pending_release(pq, pend);
+}
+
+static inline struct neigh_pending *
+neigh_pending_get(struct neigh_pending_queue *pq, int af,
+                  const union inet_addr *nexthop,
+                  const struct netif_port *port)
+{
+    int i;
+
+    for (i = 0; i < NEIGH_PENDING_SLOTS; i++) {
+        if (pq->slots[i].port == port && pq->slots[i].af == af &&
+            inet_addr_equal(af, &pq->slots[i].ip_addr, nexthop))
+            return &pq->slots[i];
+    }
+
+    return NULL;
+}
+
+/* flush or expire queued mbufs of current lcore */
+static void neigh_pending_process(void)
+{
+    struct neigh_pending_queue *pq = &neigh_pendings[rte_lcore_id()];
+    struct neigh_pending *pend;
+    struct neighbour_entry *neighbour;
+    struct ether_addr eth_addr;
+    uint64_t now;
+    int i;
+
+    if (likely(!pq->npending))
+        return;
+
+    now = rte_get_timer_cycles();
+    for (i = 0; i < NEIGH_PENDING_SLOTS; i++) {
+        pend = &pq->slots[i];
+        if (!pend->port)
+            continue;
+
+        neighbour = neigh_lookup_entry(pend->af, &pend->ip_addr, pend->port,
+                            neigh_hashkey(pend->af, &pend->ip_addr, pend->port));
+        if (neighbour && neigh_state_valid(neigh_read_hw(neighbour, &eth_addr)))
+            neigh_pending_xmit(pq, pend, &eth_addr);
+        else if (now > pend->expire)
+            neigh_pending_drop(pq, pend);
+    }
+}
+
+static int neigh_request(struct neighbour_entry *neighbour, int af,
+                         const union inet_addr *ipaddr,
+                         const struct ether_addr *eth_addr,
+                         struct netif_port *port, uint8_t op);
+
+static int neigh_pending_enqueue_mbuf(int af, union inet_addr *nexthop,
+                                      struct rte_mbuf *m, struct netif_port *port,
+                                      struct neighbour_entry *neighbour)
+{
+    struct neigh_pending_queue *pq = &neigh_pendings[rte_lcore_id()];
+    struct neigh_pending *pend = NULL;
+    int i;
+
+    if (pq->npending)
+        pend = neigh_pending_get(pq, af, nexthop, port);
+
+    if (!pend) {
+        for (i = 0; i < NEIGH_PENDING_SLOTS; i++) {
+            if (!pq->slots[i].port) {
+                pend = &pq->slots[i];
+                break;
+            }
+        }
+        if (!pend) {
+            rte_pktmbuf_free(m);
+            NEIGH_STATS_INC(unres_drop);
+            RTE_LOG(DEBUG, NEIGHBOUR, "%s: too many unresolved nexthops\n", __func__);
+            return EDPVS_DROP;
+        }
+
+        pend->af = af;
+        pend->ip_addr = *nexthop;
+        pend->port = port;
+        pend->head = pend->tail = NULL;
+        pend->qlen = 0;
+        pend->expire = rte_get_timer_cycles() + rte_get_timer_hz() *
+            (nud_timeouts[DPVS_NUD_S_NONE] + nud_timeouts[DPVS_NUD_S_SEND]);
+        pq->npending++;
+
+        neigh_request(neighbour, af, nexthop, NULL, port, NEIGH_REQ_RESOLVE);
+    }
+
+    if (pend->qlen >= arp_unres_qlen) {
+        /*
+         * don't need arp request now,
+         * since neighbour will not be confirmed
+         * and it will be released late
+         */
+        rte_pktmbuf_free(m);
+        NEIGH_STATS_INC(unres_drop);
+        RTE_LOG(ERR, NEIGHBOUR, "[%s] neigh_unres_queue is full, drop packet\n", __func__);
+        return EDPVS_DROP;
+    }
+
+    neigh_pending_enqueue(pend, m);
+    NEIGH_STATS_INC(queued);
+    return EDPVS_OK;
+}
+
+/* packets queued on all lcores, for dpip only */
+static uint32_t neigh_pending_qlen(const struct neighbour_entry *neighbour)
+{
+    struct neigh_pending *pend;
+    uint32_t qlen = 0;
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!neigh_pendings[cid].npending)
+            continue;
+        pend = neigh_pending_get(&neigh_pendings[cid], neighbour->af,
+                                 &neighbour->ip_addr, neighbour->port);
+        if (pend)
+            qlen += pend->qlen;
+    }
+
+    return qlen;
 }
 
 void neigh_confirm(int af, union inet_addr *nexthop, struct netif_port *port)
 {
     struct neighbour_entry *neighbour;
     unsigned int hashkey;
-    lcoreid_t cid = rte_lcore_id();
+    uint64_t now;
+
     /*find nexhop/neighbour to confirm, no matter whether it is the route in*/
     hashkey = neigh_hashkey(af, nexthop, port);
-    list_for_each_entry(neighbour, &neigh_table[cid][hashkey], neigh_list) {
-        if (neigh_key_cmp(af, neighbour, nexthop, port) &&
-            !(neighbour->flag & NEIGHBOUR_STATIC)) {
-            neigh_entry_state_trans(neighbour, 2);
-        }
-    }
+    neighbour = neigh_lookup_entry(af, nexthop, port, hashkey);
+    if (!neighbour || (neighbour->flag & NEIGHBOUR_STATIC))
+        return;
+
+    /* avoid bouncing the cache line, one second resolution is enough */
+    now = rte_get_timer_cycles();
+    if (now - neighbour->confirmed > rte_get_timer_hz())
+        neighbour->confirmed = now;
 }
 
 static void neigh_state_confirm(struct neighbour_entry *neighbour)
@@ -427,7 +878,7 @@ static void neigh_state_confirm(struct neighbour_entry *neighbour)
         }
 
         if (neigh_send_arp(neighbour->port, saddr.in.s_addr,
-                           daddr.in.s_addr) != EDPVS_OK) {
+                           daddr.in.s_addr, NULL) != EDPVS_OK) {
             RTE_LOG(ERR, NEIGHBOUR, "[%s] send arp failed\n", __func__);
         }
     } else if (neighbour->af == AF_INET6) {
@@ -442,14 +893,165 @@ static void neigh_state_confirm(struct neighbour_entry *neighbour)
     }
 }
 
+/* owner only: unicast probe to the known hw address */
+static void neigh_probe(struct neighbour_entry *neighbour)
+{
+    union inet_addr saddr, daddr;
+
+    memset(&saddr, 0, sizeof(saddr));
+    rte_memcpy(&daddr, &neighbour->ip_addr, sizeof(daddr));
+    inet_addr_select(neighbour->af, neighbour->port, &daddr, 0, &saddr);
+
+    if (neighbour->af == AF_INET) {
+        if (neigh_send_arp(neighbour->port, saddr.in.s_addr, daddr.in.s_addr,
+                           &neighbour->eth_addr) != EDPVS_OK)
+            RTE_LOG(ERR, NEIGHBOUR, "[%s] send arp failed\n", __func__);
+    } else if (neighbour->af == AF_INET6) {
+        ndisc_probe(neighbour, &saddr.in6);
+    }
+
+    neighbour->probed = rte_get_timer_cycles();
+    NEIGH_STATS_INC(probes);
+}
+
+/****************************owner core requests*******************************************/
+/* owner only */
+static void neigh_req_handle(const struct raw_neigh *param)
+{
+    struct neighbour_entry *neighbour;
+    unsigned int hash;
+
+    hash = neigh_hashkey(param->af, &param->ip_addr, param->port);
+    neighbour = __neigh_lookup_entry(master_socket, param->af, &param->ip_addr,
+                                     param->port, hash);
+
+    switch (param->op) {
+    case NEIGH_REQ_UPDATE:
+        if (neighbour) {
+            if (neighbour->flag & NEIGHBOUR_STATIC)
+                break;
+            neigh_write_hw(neighbour, &param->eth_addr, neighbour->state);
+        } else {
+            neighbour = neigh_add_table(param->af, &param->ip_addr,
+                                        &param->eth_addr, param->port, hash, 0);
+            if (!neighbour) {
+                RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
+                break;
+            }
+        }
+        neighbour->probed = 0;
+        neigh_entry_state_trans(neighbour, 1);
+        break;
+
+    case NEIGH_REQ_RESOLVE:
+        if (!neighbour) {
+            neighbour = neigh_add_table(param->af, &param->ip_addr,
+                                        NULL, param->port, hash, 0);
+            if (!neighbour) {
+                RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
+                break;
+            }
+        }
+        if (neighbour->state == DPVS_NUD_S_NONE) {
+            neigh_state_confirm(neighbour);
+            neigh_entry_state_trans(neighbour, 0);
+        }
+        break;
+
+    case NEIGH_REQ_PROBE:
+        if (neighbour && neighbour->state == DPVS_NUD_S_PROBE) {
+            neigh_state_confirm(neighbour);
+            neigh_entry_state_trans(neighbour, 0);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (neighbour)
+        neigh_clear_req(neighbour);
+}
+
+/*
+ * ask owner to update the neighbour, @neighbour is the local replica if any,
+ * at most one resolve/probe request per neighbour is in flight.
+ */
+static int neigh_request(struct neighbour_entry *neighbour, int af,
+                         const union inet_addr *ipaddr,
+                         const struct ether_addr *eth_addr,
+                         struct netif_port *port, uint8_t op)
+{
+    struct raw_neigh *param, req;
+    int err;
+
+    if (op != NEIGH_REQ_UPDATE && neighbour &&
+        !rte_atomic16_test_and_set(&neighbour->req_pending))
+        return EDPVS_INPROGRESS;
+
+    if (neigh_is_owner()) {
+        param = &req;
+    } else if (unlikely(rte_mempool_get(neigh_req_pool, (void **)&param) != 0)) {
+        if (neighbour && op != NEIGH_REQ_UPDATE)
+            rte_atomic16_clear(&neighbour->req_pending);
+        return EDPVS_NOMEM;
+    }
+
+    param->af = af;
+    rte_memcpy(&param->ip_addr, ipaddr, sizeof(union inet_addr));
+    if (eth_addr)
+        ether_addr_copy(eth_addr, &param->eth_addr);
+    param->port = port;
+    param->op = op;
+    NEIGH_STATS_INC(requests);
+
+    if (param == &req) {
+        neigh_req_handle(param);
+        return EDPVS_OK;
+    }
+
+    err = rte_ring_enqueue(neigh_ring, param);
+    if (unlikely(err < 0 && err != -EDQUOT)) {
+        rte_mempool_put(neigh_req_pool, param);
+        if (neighbour && op != NEIGH_REQ_UPDATE)
+            rte_atomic16_clear(&neighbour->req_pending);
+        RTE_LOG(WARNING, NEIGHBOUR, "%s: neigh ring enqueue failed\n", __func__);
+        return EDPVS_DPDKAPIFAIL;
+    }
+
+    return EDPVS_OK;
+}
+
+int neigh_update(int af, const union inet_addr *ipaddr,
+                 const struct ether_addr *eth_addr,
+                 struct netif_port *port)
+{
+    struct neighbour_entry *neighbour;
+    struct ether_addr cur;
+    uint32_t state;
+
+    /* skip the request if nothing changes */
+    neighbour = neigh_lookup_entry(af, ipaddr, port,
+                                   neigh_hashkey(af, ipaddr, port));
+    if (neighbour) {
+        if (neighbour->flag & NEIGHBOUR_STATIC)
+            return EDPVS_OK;
+        state = neigh_read_hw(neighbour, &cur);
+        if (state == DPVS_NUD_S_REACHABLE && eth_addr_equal(&cur, eth_addr)) {
+            neigh_confirm(af, (union inet_addr *)ipaddr, port);
+            return EDPVS_OK;
+        }
+    }
+
+    return neigh_request(NULL, af, ipaddr, eth_addr, port, NEIGH_REQ_UPDATE);
+}
+
 /*arp*/
 int neigh_resolve_input(struct rte_mbuf *m, struct netif_port *port)
 {
     struct arp_hdr *arp = rte_pktmbuf_mtod(m, struct arp_hdr *);
     struct ether_hdr *eth;
     uint32_t ipaddr;
-    struct neighbour_entry *neighbour = NULL;
-    unsigned int hashkey;
     struct inet_ifaddr *ifa;
 
     ifa = inet_addr_ifa_get(AF_INET, port, (union inet_addr*)&arp->arp_data.arp_tip);
@@ -457,10 +1059,9 @@ int neigh_resolve_input(struct rte_mbuf *m, struct netif_port *port)
         return EDPVS_KNICONTINUE;
     inet_addr_ifa_put(ifa);
 
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(m,
-                                     (uint16_t)sizeof(struct ether_hdr));
-
     if (rte_be_to_cpu_16(arp->arp_op) == ARP_OP_REQUEST) {
+        eth = (struct ether_hdr *)rte_pktmbuf_prepend(m,
+                                     (uint16_t)sizeof(struct ether_hdr));
         ether_addr_copy(&eth->s_addr, &eth->d_addr);
         rte_memcpy(&eth->s_addr, &port->addr, 6);
         arp->arp_op = rte_cpu_to_be_16(ARP_OP_REPLY);
@@ -479,23 +1080,12 @@ int neigh_resolve_input(struct rte_mbuf *m, struct netif_port *port)
 
     } else if(arp->arp_op == htons(ARP_OP_REPLY)) {
         ipaddr = arp->arp_data.arp_sip;
-        hashkey = neigh_hashkey(AF_INET, (union inet_addr *)&ipaddr, port);
-        neighbour = neigh_lookup_entry(AF_INET, (union inet_addr *)&ipaddr,
-                                       port, hashkey);
-        if (neighbour && !(neighbour->flag & NEIGHBOUR_STATIC)) {
-            neigh_edit(neighbour, &arp->arp_data.arp_sha);
-            neigh_entry_state_trans(neighbour, 1);
-        } else {
-            neighbour = neigh_add_table(AF_INET, (union inet_addr *)&ipaddr,
-                                    &arp->arp_data.arp_sha, port, hashkey, 0);
-            if(!neighbour){
-                RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
-                rte_pktmbuf_free(m);
-                return EDPVS_NOMEM;
-            }
-            neigh_entry_state_trans(neighbour, 1);
+        if (neigh_update(AF_INET, (union inet_addr *)&ipaddr,
+                         &arp->arp_data.arp_sha, port) == EDPVS_NOMEM) {
+            RTE_LOG(ERR, NEIGHBOUR, "[%s] update neighbour wrong\n", __func__);
+            rte_pktmbuf_free(m);
+            return EDPVS_NOMEM;
         }
-        neigh_send_mbuf_cach(neighbour);
         return EDPVS_KNICONTINUE;
     } else {
         rte_pktmbuf_free(m);
@@ -503,7 +1093,9 @@ int neigh_resolve_input(struct rte_mbuf *m, struct netif_port *port)
     }
 }
 
-static int neigh_send_arp(struct netif_port *port, uint32_t src_ip, uint32_t dst_ip)
+/* broadcast request unless @dmac is given */
+static int neigh_send_arp(struct netif_port *port, uint32_t src_ip, uint32_t dst_ip,
+                          const struct ether_addr *dmac)
 {
     struct rte_mbuf *m;
     struct ether_hdr *eth;
@@ -519,7 +1111,10 @@ static int neigh_send_arp(struct netif_port *port, uint32_t src_ip, uint32_t dst
     eth = rte_pktmbuf_mtod(m, struct ether_hdr *);
     arp = (struct arp_hdr *)&eth[1];
 
-    memset(&eth->d_addr,0xFF,6);
+    if (dmac)
+        ether_addr_copy(dmac, &eth->d_addr);
+    else
+        memset(&eth->d_addr,0xFF,6);
     ether_addr_copy(&port->addr, &eth->s_addr);
     eth->ether_type = htons(ETHER_TYPE_ARP);
 
@@ -567,8 +1162,11 @@ int neigh_output(int af, union inet_addr *nexhop,
                  struct rte_mbuf *m, struct netif_port *port)
 {
     struct neighbour_entry *neighbour;
-    struct neighbour_mbuf_entry *m_buf;
+    struct neigh_pending_queue *pq;
+    struct neigh_pending *pend;
+    struct ether_addr eth_addr;
     unsigned int hashkey;
+    uint32_t state;
 
     if (port->flag & NETIF_PORT_FLAG_NO_ARP)
         return netif_xmit(m, port);
@@ -584,87 +1182,40 @@ int neigh_output(int af, union inet_addr *nexhop,
 
     hashkey = neigh_hashkey(af, nexhop, port);
     neighbour = neigh_lookup_entry(af, nexhop, port, hashkey);
+    if (!neighbour) {
+        NEIGH_STATS_INC(lookup_miss);
+        return neigh_pending_enqueue_mbuf(af, nexhop, m, port, NULL);
+    }
 
-    if (neighbour) {
-        if ((neighbour->state == DPVS_NUD_S_NONE) ||
-           (neighbour->state == DPVS_NUD_S_SEND)) {
-            if (neighbour->que_num > arp_unres_qlen) {
-                /*
-                 * don't need arp request now,
-                 * since neighbour will not be confirmed
-                 * and it will be released late
-                 */
-                rte_pktmbuf_free(m);
-                RTE_LOG(ERR, NEIGHBOUR, "[%s] neigh_unres_queue is full, drop packet\n", __func__);
-                return EDPVS_DROP;
-            }
-            m_buf = rte_zmalloc("neigh_new_mbuf",
-                               sizeof(struct neighbour_mbuf_entry), RTE_CACHE_LINE_SIZE);
-            if (!m_buf) {
-                rte_pktmbuf_free(m);
-                return EDPVS_DROP;
-            }
-            m_buf->m = m;
-            list_add_tail(&m_buf->neigh_mbuf_list, &neighbour->queue_list);
-            neighbour->que_num++;
-
-            if (neighbour->state == DPVS_NUD_S_NONE) {
-                neigh_state_confirm(neighbour);
-                neigh_entry_state_trans(neighbour, 0);
-            }
-            return EDPVS_OK;
-        }
-        else if ((neighbour->state == DPVS_NUD_S_REACHABLE) ||
-                 (neighbour->state == DPVS_NUD_S_PROBE) ||
-                 (neighbour->state == DPVS_NUD_S_DELAY)) {
-
-            neigh_fill_mac(neighbour, m, NULL, port);
-            netif_xmit(m, neighbour->port);
-
-            if (neighbour->state == DPVS_NUD_S_PROBE) {
-                neigh_state_confirm(neighbour);
-                neigh_entry_state_trans(neighbour, 0);
-            }
-
-            return EDPVS_OK;
-        }
+    state = neigh_read_hw(neighbour, &eth_addr);
+    if (!neigh_state_valid(state)) {
+        NEIGH_STATS_INC(unresolved);
+        if (neighbour->flag & NEIGHBOUR_PINNED)
+            NEIGH_STATS_INC(pinned_miss);
+        return neigh_pending_enqueue_mbuf(af, nexhop, m, port, neighbour);
+    }
 
-        return EDPVS_IDLE;
+    /* keep the order, send queued packets first */
+    pq = &neigh_pendings[rte_lcore_id()];
+    if (unlikely(pq->npending)) {
+        pend = neigh_pending_get(pq, af, nexhop, port);
+        if (pend)
+            neigh_pending_xmit(pq, pend, &eth_addr);
     }
-    else{
-        neighbour = neigh_add_table(af, nexhop, NULL, port, hashkey, 0);
-        if(!neighbour){
-            RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
-            rte_pktmbuf_free(m);
-            return EDPVS_NOMEM;
-        }
-        if(neighbour->que_num > arp_unres_qlen){
-            rte_pktmbuf_free(m);
-            return EDPVS_DROP;
-        }
-        m_buf = rte_zmalloc("neigh_new_mbuf",
-                           sizeof(struct neighbour_mbuf_entry), RTE_CACHE_LINE_SIZE);
-        if(!m_buf){
-            rte_pktmbuf_free(m);
-            return EDPVS_DROP;
-        }
-        m_buf->m = m;
-        list_add_tail(&m_buf->neigh_mbuf_list, &neighbour->queue_list);
-        neighbour->que_num++;
 
-        if (neighbour->state == DPVS_NUD_S_NONE) {
-            neigh_state_confirm(neighbour);
-            neigh_entry_state_trans(neighbour, 0);
-        }
+    neigh_fill_mac(&eth_addr, m, NULL, port);
+    netif_xmit(m, port);
 
-        return EDPVS_OK;
-    }
+    if (state == DPVS_NUD_S_PROBE)
+        neigh_request(neighbour, af, nexhop, NULL, port, NEIGH_REQ_PROBE);
+
+    return EDPVS_OK;
 }
 
 int neigh_gratuitous_arp(struct in_addr *src_ip, struct netif_port *port)
 {
     uint32_t sip = src_ip->s_addr;
-    return neigh_send_arp(port, sip, sip);
+    return neigh_send_arp(port, sip, sip, NULL);
 }
 
 static struct pkt_type arp_pkt_type = {
@@ -674,206 +1225,299 @@ static struct pkt_type arp_pkt_type = {
 };
 
 
-/****************************master core sync*******************************************/
+/****************************owner core sync*******************************************/
 #define MAC_RING_SIZE 2048
 
 static int neigh_ring_init(void)
 {
-    char name_buf[RTE_RING_NAMESIZE];
-    int socket_id;
-    uint8_t cid;
-    socket_id = rte_socket_id();
-    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        snprintf(name_buf, RTE_RING_NAMESIZE, "neigh_ring_c%d", cid);
-        neigh_ring[cid] = rte_ring_create(name_buf, MAC_RING_SIZE,
-                                          socket_id, RING_F_SC_DEQ);
-        if (neigh_ring[cid] == NULL)
-            rte_panic("create ring:%s failed!\n", name_buf);
-    }
-    return EDPVS_OK;
-}
-
-static struct raw_neigh* neigh_ring_clone_entry(const struct neighbour_entry* neighbour,
-                                                bool add)
-{
-    struct raw_neigh* mac_param;
-    mac_param = rte_zmalloc("mac_entry", sizeof(struct raw_neigh), RTE_CACHE_LINE_SIZE);
-    if (mac_param == NULL)
-        return NULL;
-    mac_param->af = neighbour->af;
-    rte_memcpy(&mac_param->ip_addr, &neighbour->ip_addr, sizeof(union inet_addr));
-    mac_param->flag = neighbour->flag & ~NEIGHBOUR_HASHED;
-    mac_param->port = neighbour->port;
-    mac_param->add = add;
-    /*just copy*/
-    rte_memcpy(&mac_param->eth_addr, &neighbour->eth_addr, 6);
-    return mac_param;
-}
+    neigh_ring = rte_ring_create("neigh_ring", MAC_RING_SIZE,
+                                 rte_socket_id(), RING_F_SC_DEQ);
+    if (neigh_ring == NULL)
+        rte_panic("create ring:%s failed!\n", "neigh_ring");
+
+    neigh_req_pool = rte_mempool_create("neigh_req_pool", MAC_RING_SIZE * 2 - 1,
+                                        sizeof(struct raw_neigh), 64,
+                                        0, NULL, NULL, NULL, NULL,
+                                        SOCKET_ID_ANY, 0);
+    if (neigh_req_pool == NULL)
+        rte_panic("create mempool:%s failed!\n", "neigh_req_pool");
 
-static struct raw_neigh* neigh_ring_clone_param(const struct dp_vs_neigh_conf *param,
-                                                bool add)
-{
-    struct netif_port *port;
-    struct raw_neigh* mac_param;
-    port = netif_port_get_by_name(param->ifname);
-    mac_param = rte_zmalloc("mac_entry", sizeof(struct raw_neigh), RTE_CACHE_LINE_SIZE);
-    if (mac_param == NULL)
-        return NULL;
-    mac_param->af = param->af;
-    rte_memcpy(&mac_param->ip_addr, &param->ip_addr, sizeof(union inet_addr));
-    mac_param->flag = param->flag | NEIGHBOUR_STATIC;
-    mac_param->port = port;
-    mac_param->add = add;
-    rte_memcpy(&mac_param->eth_addr, &param->eth_addr, 6);
-    return mac_param;
+    return EDPVS_OK;
 }
 
 /*
- *1, master core static neighbour sync slave core;
- *2, ipv6 slave core sync slave core when recieve ns/na
+ *1, owner core handles neighbour requests from all lcores;
+ *2, every core sends or expires its unresolved packets.
  */
 void neigh_process_ring(void *arg)
 {
     struct raw_neigh *params[NETIF_MAX_PKT_BURST];
     uint16_t nb_rb;
-    unsigned int hash;
-    struct neighbour_entry *neigh;
-    struct raw_neigh *param;
-    lcoreid_t cid = rte_lcore_id();
-    nb_rb = rte_ring_dequeue_burst(neigh_ring[cid], (void **)params,
-                                   NETIF_MAX_PKT_BURST, NULL);
-    if (nb_rb > 0) {
-       int i;
-       for (i = 0; i < nb_rb; i++) {
-           param = params[i];
-           hash = neigh_hashkey(param->af, &param->ip_addr, param->port);
-           neigh = neigh_lookup_entry(param->af, &param->ip_addr,
-                                      param->port, hash);
-           if (param->add) {
-               if (neigh) {
-                   neigh_edit(neigh, &param->eth_addr);
-                   if (!(param->flag & NEIGHBOUR_STATIC))
-                       neigh_entry_state_trans(neigh, 1);
-               }
-               else {
-                   neigh = neigh_add_table(param->af, &param->ip_addr,
-                                           &param->eth_addr, param->port,
-                                           hash, param->flag);
-                   if (!(param->flag & NEIGHBOUR_STATIC))
-                       neigh_entry_state_trans(neigh, 1);
-               }
-
-               neigh_send_mbuf_cach(neigh);
-
-           } else {
-               if (neigh) {
-                   if (!(neigh->flag & NEIGHBOUR_STATIC))
-                       dpvs_timer_cancel(&neigh->timer, false);
-                   neigh_unhash(neigh);
-
-                   struct neighbour_mbuf_entry *mbuf, *mbuf_next;
-                   list_for_each_entry_safe(mbuf, mbuf_next,
-                                     &neigh->queue_list, neigh_mbuf_list) {
-                       list_del(&mbuf->neigh_mbuf_list);
-                       rte_pktmbuf_free(mbuf->m);
-                       rte_free(mbuf);
-                   }
-                   rte_free(neigh);
-                   neigh_nums[cid]--;
-               }
-               else
-                   RTE_LOG(WARNING, NEIGHBOUR, "%s: not exist\n", __func__);
-           }
-           rte_free(param);
-       }
+    int i;
+
+    if (neigh_is_owner()) {
+        nb_rb = rte_ring_dequeue_burst(neigh_ring, (void **)params,
+                                       NETIF_MAX_PKT_BURST, NULL);
+        for (i = 0; i < nb_rb; i++) {
+            neigh_req_handle(params[i]);
+            rte_mempool_put(neigh_req_pool, params[i]);
+        }
+
+        if (unlikely(!list_empty(&neigh_gc_list)))
+            neigh_gc();
     }
-}
 
+    neigh_pending_process();
+}
 
-/************************** used for dpip neighbour show***********************************/
-static void neigh_fill_param(struct dp_vs_neigh_conf  *param,
-                             const struct neighbour_entry *entry,
-                             lcoreid_t cid)
+/****************************pinned nexthops*******************************************/
+static struct neigh_pin *neigh_pin_lookup(int af, const union inet_addr *addr)
 {
-    param->af      = entry->af;
-    param->ip_addr = entry->ip_addr;
-    param->flag    = entry->flag;
-    ether_addr_copy(&entry->eth_addr, &param->eth_addr);
-    param->que_num = entry->que_num;
-    param->state   = entry->state;
-    param->cid     = cid;
-    memcpy(&param->ifname, entry->port->name, IFNAMSIZ);
+    struct neigh_pin *pin;
+    unsigned int hash = neigh_hashkey(af, addr, NULL);
+
+    list_for_each_entry(pin, &neigh_pin_table[hash], list) {
+        if (pin->af == af && inet_addr_equal(af, &pin->addr, addr))
+            return pin;
+    }
+
+    return NULL;
 }
 
-static void neigh_fill_array(struct netif_port *dev, lcoreid_t cid,
-                             struct dp_vs_neigh_conf_array *array,
-                             size_t neigh_nums)
+/* nexthop and output port towards @addr, routes of owner lcore are used */
+static int neigh_pin_route(int af, const union inet_addr *addr,
+                           union inet_addr *nexthop, struct netif_port **port)
 {
-    int hash, off;
-    struct neighbour_entry *entry;
+    if (af == AF_INET) {
+        struct route_entry *rt;
+        struct flow4 fl4;
+
+        memset(&fl4, 0, sizeof(fl4));
+        fl4.fl4_daddr = addr->in;
+        rt = route4_output(&fl4);
+        if (!rt)
+            return EDPVS_NOROUTE;
+        if (rt->flag & (RTF_LOCALIN | RTF_KNI)) {
+            route4_put(rt);
+            return EDPVS_NOTSUPP;
+        }
+
+        nexthop->in = rt->gw.s_addr ? rt->gw : addr->in;
+        *port = rt->port;
+        route4_put(rt);
+    } else if (af == AF_INET6) {
+        struct route6 *rt6;
+        struct flow6 fl6;
+
+        memset(&fl6, 0, sizeof(fl6));
+        fl6.fl6_daddr = addr->in6;
+        rt6 = route6_output(NULL, &fl6);
+        if (!rt6)
+            return EDPVS_NOROUTE;
+        if (rt6->rt6_flags & (RTF_LOCALIN | RTF_KNI)) {
+            route6_put(rt6);
+            return EDPVS_NOTSUPP;
+        }
+
+        if (ipv6_addr_any(&rt6->rt6_gateway))
+            ipv6_addr_copy(&nexthop->in6, &addr->in6);
+        else
+            ipv6_addr_copy(&nexthop->in6, &rt6->rt6_gateway);
+        *port = rt6->rt6_dev;
+        route6_put(rt6);
+    } else {
+        return EDPVS_NOTSUPP;
+    }
 
-    off = array->neigh_nums;
+    if (!*port || ((*port)->flag & NETIF_PORT_FLAG_NO_ARP))
+        return EDPVS_NOTSUPP;
 
-    if (dev) {
-        for (hash = 0; hash < NEIGH_TAB_SIZE; hash++) {
-            list_for_each_entry(entry, &neigh_table[cid][hash], neigh_list) {
-                if (dev == entry->port) {
-                    if (off >= neigh_nums) {
-                        RTE_LOG(WARNING, NEIGHBOUR, "%s: neigh num not match\n", __func__);
-                        break;
-                    }
+    return EDPVS_OK;
+}
 
-                    neigh_fill_param(&array->addrs[off++], entry, cid);
-                    array->neigh_nums = off;
-                }
-            }
+/* create the nexthop if needed and get it resolved */
+static void neigh_pin_nexthop(int af, const union inet_addr *nexthop,
+                              struct netif_port *port)
+{
+    struct neighbour_entry *neighbour;
+    unsigned int hash;
+
+    hash = neigh_hashkey(af, nexthop, port);
+    neighbour = __neigh_lookup_entry(master_socket, af, nexthop, port, hash);
+    if (!neighbour) {
+        neighbour = neigh_add_table(af, nexthop, NULL, port, hash, NEIGHBOUR_PINNED);
+        if (!neighbour) {
+            RTE_LOG(ERR, NEIGHBOUR, "[%s] add neighbour wrong\n", __func__);
+            return;
         }
-    } else {
-        for (hash = 0; hash < NEIGH_TAB_SIZE; hash++) {
-            list_for_each_entry(entry, &neigh_table[cid][hash], neigh_list) {
-                if (off >= neigh_nums) {
-                    RTE_LOG(WARNING, NEIGHBOUR, "%s: neigh num not match\n", __func__);
-                    break;
-                }
-
-                neigh_fill_param(&array->addrs[off++], entry, cid);
-                array->neigh_nums = off;
-            }
+    } else if (!(neighbour->flag & NEIGHBOUR_PINNED)) {
+        neigh_flag_set(neighbour, NEIGHBOUR_PINNED, true);
+    }
+
+    if (neighbour->state == DPVS_NUD_S_NONE) {
+        neigh_state_confirm(neighbour);
+        neigh_entry_state_trans(neighbour, 0);
+    }
+}
+
+/* let the nexthop age as usual if no one else pins it */
+static void neigh_unpin_nexthop(int af, const union inet_addr *nexthop,
+                                struct netif_port *port)
+{
+    struct neighbour_entry *neighbour;
+    struct neigh_pin *pin;
+    int hash;
+
+    for (hash = 0; hash < NEIGH_TAB_SIZE; hash++) {
+        list_for_each_entry(pin, &neigh_pin_table[hash], list) {
+            if (pin->port == port && pin->af == af &&
+                inet_addr_equal(af, &pin->nexthop, nexthop))
+                return;
         }
     }
+
+    neighbour = __neigh_lookup_entry(master_socket, af, nexthop, port,
+                                     neigh_hashkey(af, nexthop, port));
+    if (neighbour && (neighbour->flag & NEIGHBOUR_PINNED)) {
+        neigh_flag_set(neighbour, NEIGHBOUR_PINNED, false);
+        neighbour->probed = 0;
+    }
 }
 
-static int get_neigh_uc_cb(struct dpvs_msg *msg)
+int neigh_pin_addr(int af, const union inet_addr *addr)
 {
-    struct netif_port *dev = NULL;
-    struct dp_vs_neigh_conf_array *array;
-    int len;
-    lcoreid_t cid = rte_lcore_id();
+    struct neigh_pin *pin;
 
-    if (msg->len)
-        dev = netif_port_get_by_name((char *)msg->data);
+    if (!neigh_pin_enable)
+        return EDPVS_OK;
+    if (!neigh_is_owner())
+        return EDPVS_NOTSUPP;
 
-    len = sizeof(struct dp_vs_neigh_conf_array) +
-          sizeof(struct dp_vs_neigh_conf) * neigh_nums[cid];
-    array = rte_zmalloc("neigh_array", len, RTE_CACHE_LINE_SIZE);
+    pin = neigh_pin_lookup(af, addr);
+    if (pin) {
+        pin->refcnt++;
+        return EDPVS_OK;
+    }
+
+    pin = rte_zmalloc("neigh_pin", sizeof(struct neigh_pin), RTE_CACHE_LINE_SIZE);
+    if (!pin)
+        return EDPVS_NOMEM;
 
-    neigh_fill_array(dev, cid, array, neigh_nums[cid]);
-    msg->reply.len = len;
-    msg->reply.data = (void *)array;
+    pin->af = af;
+    rte_memcpy(&pin->addr, addr, sizeof(union inet_addr));
+    pin->refcnt = 1;
+    list_add(&pin->list, &neigh_pin_table[neigh_hashkey(af, addr, NULL)]);
 
+    /* no route yet, retried by neigh_pin_timer */
+    if (neigh_pin_route(af, addr, &pin->nexthop, &pin->port) != EDPVS_OK) {
+        pin->port = NULL;
+        return EDPVS_OK;
+    }
+
+    neigh_pin_nexthop(af, &pin->nexthop, pin->port);
     return EDPVS_OK;
 }
 
+int neigh_unpin_addr(int af, const union inet_addr *addr)
+{
+    struct neigh_pin *pin;
+
+    if (!neigh_pin_enable)
+        return EDPVS_OK;
+    if (!neigh_is_owner())
+        return EDPVS_NOTSUPP;
+
+    pin = neigh_pin_lookup(af, addr);
+    if (!pin)
+        return EDPVS_NOTEXIST;
+    if (--pin->refcnt)
+        return EDPVS_OK;
+
+    list_del(&pin->list);
+    if (pin->port)
+        neigh_unpin_nexthop(af, &pin->nexthop, pin->port);
+    rte_free(pin);
+
+    return EDPVS_OK;
+}
+
+/* follow route changes, and re-create nexthops removed by user */
+static int neigh_pin_timer_event(void *arg)
+{
+    struct neigh_pin *pin;
+    union inet_addr nexthop;
+    struct netif_port *port, *old_port;
+    int hash;
+
+    for (hash = 0; hash < NEIGH_TAB_SIZE; hash++) {
+        list_for_each_entry(pin, &neigh_pin_table[hash], list) {
+            if (neigh_pin_route(pin->af, &pin->addr, &nexthop, &port) != EDPVS_OK)
+                port = NULL;
+
+            if (pin->port && (pin->port != port ||
+                !inet_addr_equal(pin->af, &pin->nexthop, &nexthop))) {
+                old_port = pin->port;
+                pin->port = NULL;
+                neigh_unpin_nexthop(pin->af, &pin->nexthop, old_port);
+            }
+
+            if (port) {
+                rte_memcpy(&pin->nexthop, &nexthop, sizeof(union inet_addr));
+                pin->port = port;
+                neigh_pin_nexthop(pin->af, &pin->nexthop, port);
+            }
+        }
+    }
+
+    return DTIMER_OK;
+}
+
+/************************** used for dpip neighbour show***********************************/
+static void neigh_fill_param(struct dp_vs_neigh_conf  *param,
+                             const struct neighbour_entry *entry,
+                             lcoreid_t cid)
+{
+    param->af      = entry->af;
+    param->ip_addr = entry->ip_addr;
+    param->flag    = entry->flag;
+    ether_addr_copy(&entry->eth_addr, &param->eth_addr);
+    param->que_num = neigh_pending_qlen(entry);
+    param->state   = entry->state;
+    param->cid     = cid;
+    memcpy(&param->ifname, entry->port->name, IFNAMSIZ);
+}
+
 static int neigh_sockopt_get(sockoptid_t opt, const void *conf,
                       size_t size, void **out, size_t *outsize)
 {
     const struct dp_vs_neigh_conf *cf;
-    struct dp_vs_neigh_conf_array *array, *array_msg;
-    size_t off = 0;
+    struct dp_vs_neigh_conf_array *array;
+    struct neighbour_entry *entry;
     struct netif_port *port = NULL;
-    struct dpvs_msg *msg, *cur;
-    struct dpvs_multicast_queue *reply = NULL;
-    int neigh_nums_g = 0, err;
+    int hash, off = 0;
+
+    if (opt == SOCKOPT_GET_NEIGH_STATS) {
+        struct dp_vs_neigh_stats *stats;
+        lcoreid_t cid;
+
+        stats = rte_calloc(NULL, 1, sizeof(*stats), 0);
+        if (!stats)
+            return EDPVS_NOMEM;
+
+        for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+            stats->lookup_miss += neigh_stats[cid].stats.lookup_miss;
+            stats->unresolved  += neigh_stats[cid].stats.unresolved;
+            stats->pinned_miss += neigh_stats[cid].stats.pinned_miss;
+            stats->queued      += neigh_stats[cid].stats.queued;
+            stats->unres_drop  += neigh_stats[cid].stats.unres_drop;
+            stats->requests    += neigh_stats[cid].stats.requests;
+            stats->probes      += neigh_stats[cid].stats.probes;
+        }
+
+        *out = stats;
+        *outsize = sizeof(*stats);
+        return EDPVS_OK;
+    }
 
     if (conf && size >= sizeof(*cf))
         cf = conf;
@@ -889,83 +1533,26 @@ static int neigh_sockopt_get(sockoptid_t opt, const void *conf,
         }
     }
 
-    msg = msg_make(MSG_TYPE_NEIGH_GET, 0 , DPVS_MSG_MULTICAST, rte_lcore_id(),
-                   port ? sizeof(port->name) : 0, port ? (&port->name) : NULL);
-    if (!msg)
-        return EDPVS_NOMEM;
-    err = multicast_msg_send(msg, 0, &reply);
-    if (err != EDPVS_OK) {
-        msg_destroy(&msg);
-        RTE_LOG(ERR, NEIGHBOUR, "%s: send message fail.\n", __func__);
-        return EDPVS_DROP;
-    }
-
-    /* get neigh_num */
-    list_for_each_entry(cur, &reply->mq, mq_node) {
-        array_msg = (struct dp_vs_neigh_conf_array *)(cur->data);
-        neigh_nums_g += array_msg->neigh_nums;
-    }
-
+    /* sockopt runs on owner lcore, read the tables directly */
     *outsize = sizeof(struct dp_vs_neigh_conf_array) + \
-               neigh_nums_g * sizeof(struct dp_vs_neigh_conf);
+               neigh_nums * sizeof(struct dp_vs_neigh_conf);
     *out = rte_calloc(NULL, 1, *outsize, RTE_CACHE_LINE_SIZE);
-    if (!(*out)) {
-        msg_destroy(&msg);
+    if (!(*out))
         return EDPVS_NOMEM;
-    }
     array = *out;
 
-    /* copy neigh_array*/
-    array->neigh_nums = neigh_nums_g;
-    list_for_each_entry(cur, &reply->mq, mq_node) {
-        array_msg = (struct dp_vs_neigh_conf_array *)(cur->data);
-        memcpy(&array->addrs[off], &array_msg->addrs,
-               array_msg->neigh_nums * sizeof(struct dp_vs_neigh_conf));
-        off += array_msg->neigh_nums;
-    }
-
-    msg_destroy(&msg);
-
-    return EDPVS_OK;
-}
-
-int neigh_sync_core(const void *param, bool add_del, enum param_kind kind)
-{
-    struct raw_neigh *mac_param;
-    int ret = 0;
-    lcoreid_t cid, i;
-    cid = rte_lcore_id();
-
-    for (i = 0; i < DPVS_MAX_LCORE; i++) {
-        if ((i == cid) || (!is_lcore_id_valid(i)) || (i == master_cid))
-            continue;
-        switch (kind) {
-        case NEIGH_ENTRY:
-            mac_param = neigh_ring_clone_entry(param, add_del);
-            break;
-        case NEIGH_PARAM:
-            mac_param = neigh_ring_clone_param(param, add_del);
-            break;
-        default:
-            return EDPVS_NOTSUPP;
-        }
-
-        if (mac_param) {
-            ret = rte_ring_enqueue(neigh_ring[i], mac_param);
-            if (unlikely(-EDQUOT == ret)) {
-                RTE_LOG(WARNING, NEIGHBOUR, "%s: neigh ring quota exceeded\n",
-                __func__);
-            } else if (ret < 0) {
-                rte_free(mac_param);
-                RTE_LOG(WARNING, NEIGHBOUR, "%s: neigh ring enqueue failed\n",
-                __func__);
-                return EDPVS_DPDKAPIFAIL;
+    for (hash = 0; hash < NEIGH_TAB_SIZE; hash++) {
+        list_for_each_entry(entry, &neigh_table[master_socket][hash], neigh_list) {
+            if (port && port != entry->port)
+                continue;
+            if (off >= neigh_nums) {
+                RTE_LOG(WARNING, NEIGHBOUR, "%s: neigh num not match\n", __func__);
+                break;
             }
-        } else {
-            RTE_LOG(WARNING, NEIGHBOUR, "%s: clone mac faild\n", __func__);
-            return EDPVS_NOMEM;
+            neigh_fill_param(&array->addrs[off++], entry, master_cid);
         }
     }
+    array->neigh_nums = off;
 
     return EDPVS_OK;
 }
@@ -973,7 +1560,10 @@ int neigh_sync_core(const void *param, bool add_del, enum param_kind kind)
 static int neigh_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
 {
     const struct dp_vs_neigh_conf *param = conf;
+    struct neighbour_entry *neighbour;
     struct netif_port *port;
+    unsigned int hash;
+    uint8_t flag;
 
     if (!conf || size < sizeof(*param))
         return EDPVS_INVAL;
@@ -988,20 +1578,33 @@ static int neigh_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
         return EDPVS_INVAL;
     }
 
+    hash = neigh_hashkey(param->af, &param->ip_addr, port);
+    neighbour = __neigh_lookup_entry(master_socket, param->af, &param->ip_addr,
+                                     port, hash);
+
     switch (opt) {
     case SOCKOPT_SET_NEIGH_ADD:
-        if (EDPVS_OK != neigh_sync_core(param, 1, NEIGH_PARAM)) {
-            RTE_LOG(WARNING, NEIGHBOUR, "%s: sync failed\n", __func__);
-            return EDPVS_INVAL;
+        flag = (param->flag | NEIGHBOUR_STATIC) & ~NEIGHBOUR_PINNED;
+        /* replace dynamic one, static entry has no timer */
+        if (neighbour) {
+            flag |= neighbour->flag & NEIGHBOUR_PINNED;
+            neigh_entry_expire(neighbour);
+        }
+        neighbour = neigh_add_table(param->af, &param->ip_addr, &param->eth_addr,
+                                    port, hash, flag);
+        if (!neighbour) {
+            RTE_LOG(WARNING, NEIGHBOUR, "%s: add neighbour failed\n", __func__);
+            return EDPVS_NOMEM;
         }
 
         break;
 
     case SOCKOPT_SET_NEIGH_DEL:
-        if (EDPVS_OK != neigh_sync_core(param, 0, NEIGH_PARAM)) {
-            RTE_LOG(WARNING, NEIGHBOUR, "%s: sync failed\n", __func__);
-            return EDPVS_INVAL;
+        if (!neighbour) {
+            RTE_LOG(WARNING, NEIGHBOUR, "%s: not exist\n", __func__);
+            return EDPVS_NOTEXIST;
         }
+        neigh_entry_expire(neighbour);
 
         break;
 
@@ -1015,7 +1618,7 @@ static int neigh_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
 static struct dpvs_sockopts neigh_sockopts = {
     .version     = SOCKOPT_VERSION,
     .get_opt_min = SOCKOPT_GET_NEIGH_SHOW,
-    .get_opt_max = SOCKOPT_GET_NEIGH_SHOW,
+    .get_opt_max = SOCKOPT_GET_NEIGH_STATS,
     .get         = neigh_sockopt_get,
 
     .set_opt_min = SOCKOPT_SET_NEIGH_ADD,
@@ -1030,14 +1633,17 @@ static int arp_init(void)
     int i, j;
     int err;
 
-    for (i = 0; i < DPVS_MAX_LCORE; i++) {
+    for (i = 0; i < DPVS_MAX_SOCKET; i++) {
         for (j = 0; j < NEIGH_TAB_SIZE; j++) {
             INIT_LIST_HEAD(&neigh_table[i][j]);
         }
     }
-
+    INIT_LIST_HEAD(&neigh_gc_list);
+    for (j = 0; j < NEIGH_TAB_SIZE; j++)
+        INIT_LIST_HEAD(&neigh_pin_table[j]);
 
     master_cid = rte_lcore_id();
+    master_socket = rte_socket_id();
 
     arp_pkt_type.type = rte_cpu_to_be_16(ETHER_TYPE_ARP);
     if ((err = netif_register_pkt(&arp_pkt_type)) != EDPVS_OK)
@@ -1047,7 +1653,7 @@ static int arp_init(void)
 
     neigh_ring_init();
 
-    /*get static arp entry from master*/
+    /* flush unresolved packets of slave lcores */
     snprintf(neigh_sync_job.name, sizeof(neigh_sync_job.name) - 1, "%s", "neigh_sync");
     neigh_sync_job.func = neigh_process_ring;
     neigh_sync_job.data = NULL;
@@ -1057,27 +1663,19 @@ static int arp_init(void)
     if (err != EDPVS_OK)
         return err;
 
-    return EDPVS_OK;
-}
+    if (neigh_pin_enable) {
+        struct timeval tv = {
+            .tv_sec  = NEIGH_PIN_INTERVAL,
+            .tv_usec = 0,
+        };
 
-static void register_stats_cb(void)
-{
-    struct dpvs_msg_type mt;
-    memset(&mt, 0 , sizeof(mt));
-    mt.type = MSG_TYPE_NEIGH_GET;
-    mt.unicast_msg_cb = get_neigh_uc_cb;
-    mt.multicast_msg_cb = NULL;
-    assert(msg_type_mc_register(&mt) == 0);
-}
+        err = dpvs_timer_sched_period(&neigh_pin_timer, &tv,
+                                      neigh_pin_timer_event, NULL, true);
+        if (err != EDPVS_OK)
+            return err;
+    }
 
-static void unregister_stats_cb(void)
-{
-    struct dpvs_msg_type mt;
-    memset(&mt, 0, sizeof(mt));
-    mt.type = MSG_TYPE_NEIGH_GET;
-    mt.unicast_msg_cb = get_neigh_uc_cb;
-    mt.multicast_msg_cb = NULL;
-    assert(msg_type_mc_unregister(&mt) == 0);
+    return EDPVS_OK;
 }
 
 int neigh_init(void)
@@ -1086,14 +1684,10 @@ int neigh_init(void)
         return EDPVS_NOMEM;
     }
 
-    register_stats_cb();
-
     return EDPVS_OK;
 }
 
 int neigh_term(void)
 {
-    unregister_stats_cb();
-
     return EDPVS_OK;
 }
@@ -42,6 +42,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ipvs/redirect.h>
+#include <ipvs/synproxy.h>
 
 #define NETIF_PKTPOOL_NB_MBUF_DEF   65535
 #define NETIF_PKTPOOL_NB_MBUF_MIN   1023
@@ -64,8 +65,6 @@ static int netif_pktpool_mbuf_cache = NETIF_PKTPOOL_MBUF_CACHE_DEF;
 #define NETIF_PKT_PREFETCH_OFFSET   3
 #define NETIF_ISOL_RXQ_RING_SZ_DEF  1048576 // 1M bytes
 
-#define ARP_RING_SIZE 2048
-
 /* physical nic id = phy_pid_base + index */
 static portid_t phy_pid_base = 0;
 static portid_t phy_pid_end = -1; // not inclusive
@@ -1121,6 +1120,15 @@ static struct netif_lcore_stats lcore_stats[DPVS_MAX_LCORE];
 /* per-lcore isolated reception queues */
 static struct list_head isol_rxq_tab[DPVS_MAX_LCORE];
 
+/* tx queue pinned for a group of packets, see netif_xmit_group() */
+struct netif_tx_group {
+    unsigned int    left;
+    portid_t        pid;
+    queueid_t       qindex;
+    bool            pinned;
+};
+static struct netif_tx_group tx_groups[DPVS_MAX_LCORE];
+
 /* worker configuration array */
 static struct netif_lcore_conf lcore_conf[DPVS_MAX_LCORE + 1];
 
@@ -1325,6 +1333,12 @@ static inline void netif_copy_lcore_stats(struct netif_lcore_stats *stats)
     memcpy(stats, &lcore_stats[cid], sizeof(struct netif_lcore_stats));
 }
 
+void netif_lcore_stats_read(lcoreid_t cid, struct netif_lcore_stats *stats)
+{
+    assert(cid < DPVS_MAX_LCORE);
+    memcpy(stats, &lcore_stats[cid], sizeof(struct netif_lcore_stats));
+}
+
 static int port_rx_queues_get(portid_t pid)
 {
     int i = 0, j;
@@ -2116,6 +2130,28 @@ int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
     qindex = (((uint32_t) mbuf->buf_physaddr) >> 8) %
         (lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].ntxq);
     //RTE_LOG(DEBUG, NETIF, "tx-queue hash(%x) = %d\n", ((uint32_t)mbuf->buf_physaddr) >> 8, qindex);
+
+    if (unlikely(tx_groups[cid].left > 0)) {
+        struct netif_tx_group *grp = &tx_groups[cid];
+
+        if (grp->pinned && grp->pid == pid) {
+            qindex = grp->qindex;
+        } else {
+            /* first of group, make room for all of it */
+            txq = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].txqs[qindex];
+            if (txq->len + grp->left > NETIF_MAX_PKT_BURST) {
+                netif_tx_burst(cid, pid, qindex);
+                txq->len = 0;
+            }
+            grp->pid = pid;
+            grp->qindex = qindex;
+            grp->pinned = true;
+        }
+
+        if (--grp->left == 0)
+            grp->pinned = false;
+    }
+
     txq = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].txqs[qindex];
 
     if (unlikely(txq->len == NETIF_MAX_PKT_BURST)) {
@@ -2129,6 +2165,17 @@ int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
     return EDPVS_OK;
 }
 
+void netif_xmit_group(unsigned int npkts)
+{
+    lcoreid_t cid = rte_lcore_id();
+
+    if (unlikely(cid >= DPVS_MAX_LCORE))
+        return;
+
+    tx_groups[cid].left = npkts;
+    tx_groups[cid].pinned = false;
+}
+
 int netif_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
 {
     int ret = EDPVS_OK;
@@ -2186,9 +2233,6 @@ int netif_rcv(struct netif_port *dev, __be16 eth_type, struct rte_mbuf *mbuf)
     return pt->func(mbuf, dev);
 }
 
-/*for arp process*/
-static struct rte_ring *arp_ring[DPVS_MAX_LCORE];
-
 static inline int netif_deliver_mbuf(struct rte_mbuf *mbuf,
                                      uint16_t eth_type,
                                      struct netif_port *dev,
@@ -2214,43 +2258,6 @@ static inline int netif_deliver_mbuf(struct rte_mbuf *mbuf,
         return EDPVS_OK;
     }
 
-    /*clone arp pkt to every queue*/
-    if (pt->type == rte_cpu_to_be_16(ETHER_TYPE_ARP) && !pkts_from_ring) {
-        struct rte_mempool *mbuf_pool;
-        struct rte_mbuf *mbuf_clone;
-        uint8_t i;
-        struct arp_hdr *arp;
-        unsigned socket_id;
-
-        socket_id = rte_socket_id();
-        mbuf_pool = pktmbuf_pool[socket_id];
-
-        rte_pktmbuf_adj(mbuf, sizeof(struct ether_hdr));
-        arp = rte_pktmbuf_mtod(mbuf, struct arp_hdr *);
-        rte_pktmbuf_prepend(mbuf,(uint16_t)sizeof(struct ether_hdr));
-        if (rte_be_to_cpu_16(arp->arp_op) == ARP_OP_REPLY) {
-            for (i = 0; i < DPVS_MAX_LCORE; i++) {
-                if ((i == cid) || (!is_lcore_id_fwd(i))
-                     || (i == rte_get_master_lcore()))
-                    continue;
-                /*rte_pktmbuf_clone will not clone pkt.data, just copy pointer!*/
-                mbuf_clone = rte_pktmbuf_clone(mbuf, mbuf_pool);
-                if (mbuf_clone) {
-                    int ret = rte_ring_enqueue(arp_ring[i], mbuf_clone);
-                    if (unlikely(-EDQUOT == ret)) {
-                        RTE_LOG(WARNING, NETIF, "%s: arp ring of lcore %d quota exceeded\n",
-                                __func__, i);
-                    }
-                    else if (ret < 0) {
-                        RTE_LOG(WARNING, NETIF, "%s: arp ring of lcore %d enqueue failed\n",
-                                __func__, i);
-                        rte_pktmbuf_free(mbuf_clone);
-                    }
-                }
-            }
-        }
-    }
-
     mbuf->l2_len = sizeof(struct ether_hdr);
     /* Remove ether_hdr at the beginning of an mbuf */
     data_off = mbuf->data_off;
@@ -2276,24 +2283,6 @@ static inline int netif_deliver_mbuf(struct rte_mbuf *mbuf,
     return EDPVS_OK;
 }
 
-static int netif_arp_ring_init(void)
-{
-    char name_buf[RTE_RING_NAMESIZE];
-    int socket_id;
-    uint8_t cid;
-
-    socket_id = rte_socket_id();
-    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
-        snprintf(name_buf, RTE_RING_NAMESIZE, "arp_ring_c%d", cid);
-        arp_ring[cid] = rte_ring_create(name_buf, ARP_RING_SIZE, socket_id, RING_F_SC_DEQ);
-
-        if (arp_ring[cid] == NULL)
-            rte_panic("create ring:%s failed!\n", name_buf);
-    }
-
-    return EDPVS_OK;
-}
-
 void lcore_process_packets(struct netif_queue_conf *qconf, struct rte_mbuf **mbufs,
                       lcoreid_t cid, uint16_t count, bool pkts_from_ring)
 {
@@ -2385,21 +2374,50 @@ void lcore_process_packets(struct netif_queue_conf *qconf, struct rte_mbuf **mbu
 }
 
 
-static void lcore_process_arp_ring(struct netif_queue_conf *qconf, lcoreid_t cid)
+static void lcore_process_redirect_ring(struct netif_queue_conf *qconf, lcoreid_t cid)
 {
-    struct rte_mbuf *mbufs[NETIF_MAX_PKT_BURST];
-    uint16_t nb_rb;
+    dp_vs_redirect_ring_proc(qconf, cid);
+}
 
-    nb_rb = rte_ring_dequeue_burst(arp_ring[cid], (void**)mbufs, NETIF_MAX_PKT_BURST, NULL);
+/* police the burst by ingress tc before anything else consumes cycles */
+static inline void lcore_process_tc_ingress(struct netif_queue_conf *qconf,
+                                            portid_t pid, lcoreid_t cid)
+{
+    struct netif_port *dev;
+    uint16_t len;
 
-    if (nb_rb > 0) {
-        lcore_process_packets(qconf, mbufs, cid, nb_rb, 1);
-    }
+    if (!qconf->len)
+        return;
+
+    dev = netif_port_get(pid);
+    if (unlikely(!dev))
+        return;
+    if (dev->type == PORT_TYPE_BOND_SLAVE)
+        dev = dev->bond->slave.master;
+
+    if (likely(!(dev->flag & NETIF_PORT_FLAG_TC_INGRESS)))
+        return;
+
+    len = tc_handle_ingress(netif_tc(dev), qconf->mbufs, qconf->len);
+
+    lcore_stats[cid].dropped += qconf->len - len;
+    qconf->len = len;
 }
 
-static void lcore_process_redirect_ring(struct netif_queue_conf *qconf, lcoreid_t cid)
+/* answer syns to synproxy services before the packets go up the stack */
+static inline void lcore_process_syn_fast(struct netif_queue_conf *qconf, lcoreid_t cid)
 {
-    dp_vs_redirect_ring_proc(qconf, cid);
+    uint64_t bytes = 0;
+    uint16_t len;
+
+    if (likely(!dp_vs_synproxy_ctrl_syn_fast) || !qconf->len)
+        return;
+
+    len = dp_vs_synproxy_syn_fast(qconf->mbufs, qconf->len, &bytes);
+
+    lcore_stats[cid].ipackets += qconf->len - len;
+    lcore_stats[cid].ibytes += bytes;
+    qconf->len = len;
 }
 
 static void lcore_job_recv_fwd(void *arg)
@@ -2419,13 +2437,15 @@ static void lcore_job_recv_fwd(void *arg)
         for (j = 0; j < lcore_conf[lcore2index[cid]].pqs[i].nrxq; j++) {
             qconf = &lcore_conf[lcore2index[cid]].pqs[i].rxqs[j];
 
-            lcore_process_arp_ring(qconf, cid);
             lcore_process_redirect_ring(qconf, cid);
             qconf->len = netif_rx_burst(pid, qconf);
 
             lcore_stats_burst(&lcore_stats[cid], qconf->len);
 
+            lcore_process_tc_ingress(qconf, pid, cid);
+            lcore_process_syn_fast(qconf, cid);
             lcore_process_packets(qconf, qconf->mbufs, cid, qconf->len, 0);
+            dp_vs_redirect_flush(cid);
             kni_send2kern_loop(pid, qconf);
         }
     }
@@ -3142,6 +3162,33 @@ int netif_get_queue(struct netif_port *port, lcoreid_t cid, queueid_t *qid)
     return EDPVS_OK;
 }
 
+/* all rx queues of @port polled by lcore @cid */
+int netif_get_rxqs(struct netif_port *port, lcoreid_t cid,
+                   queueid_t *qids, int *nqids)
+{
+    struct netif_port_conf *qconf;
+    int i;
+
+    assert(port && port->netif_ops && qids && nqids);
+
+    if (port->netif_ops->op_get_queue)
+        return EDPVS_NOTSUPP;
+    if (unlikely(cid >= DPVS_MAX_LCORE || rte_lcore_is_enabled(cid) == 0))
+        return EDPVS_INVAL;
+
+    qconf = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][port->id]];
+    if (qconf->id != port->id) {
+        *nqids = 0;
+        return EDPVS_OK;
+    }
+
+    for (i = 0; i < qconf->nrxq && i < *nqids; i++)
+        qids[i] = qconf->rxqs[i].id;
+    *nqids = i;
+
+    return EDPVS_OK;
+}
+
 int netif_get_link(struct netif_port *dev, struct rte_eth_link *link)
 {
     assert(dev && dev->netif_ops && link);
@@ -4174,7 +4221,6 @@ int netif_init(const struct rte_eth_conf *conf)
 {
     cycles_per_sec = rte_get_timer_hz();
     netif_pktmbuf_pool_init();
-    netif_arp_ring_init();
     netif_pkt_type_tab_init();
     netif_lcore_jobs_init();
     // use default port conf if conf=NULL
@@ -4333,6 +4379,7 @@ static int get_lcore_stats(lcoreid_t cid, void **out, size_t *out_len)
 
     netif_lcore_stats_get_t *get;
     struct netif_lcore_stats stats;
+    struct dpvs_timer_stats tstats;
 
     get = rte_zmalloc_socket(NULL, sizeof(struct netif_lcore_stats_get),
             RTE_CACHE_LINE_SIZE, rte_socket_id());
@@ -4381,6 +4428,13 @@ static int get_lcore_stats(lcoreid_t cid, void **out, size_t *out_len)
     get->obytes = stats.obytes;
     get->dropped = stats.dropped;
 
+    if (dpvs_timer_stats_get(cid, &tstats) == EDPVS_OK) {
+        get->timer_expired = tstats.expired;
+        get->timer_deferred = tstats.deferred;
+        get->timer_budget_hits = tstats.budget_hits;
+        get->timer_max_latency = tstats.max_latency;
+    }
+
     *out = get;
     *out_len = sizeof(netif_lcore_stats_get_t);
 
@@ -20,6 +20,7 @@
 #include "route.h"
 #include "conf/route.h"
 #include "ctrl.h"
+#include "neigh.h"
 
 
 #define RTE_LOGTYPE_ROUTE       RTE_LOGTYPE_USER1
@@ -327,6 +328,17 @@ static int route_del_lcore(struct in_addr* dest,uint8_t netmask, uint32_t flag,
     return EDPVS_INVAL;
 }
 
+/* route ops are applied on slaves in batch, see msg_batch_add */
+static struct dpvs_msg_batch route_add_batch = {
+    .type   = MSG_TYPE_ROUTE_ADD,
+    .oplen  = sizeof(struct dp_vs_route_conf),
+};
+
+static struct dpvs_msg_batch route_del_batch = {
+    .type   = MSG_TYPE_ROUTE_DEL,
+    .oplen  = sizeof(struct dp_vs_route_conf),
+};
+
 static int route_add_del(bool add, struct in_addr* dest,
                          uint8_t netmask, uint32_t flag,
                          struct in_addr* gw, struct netif_port *port,
@@ -335,7 +347,6 @@ static int route_add_del(bool add, struct in_addr* dest,
 {
     lcoreid_t cid = rte_lcore_id();
     int err;
-    struct dpvs_msg *msg;
     struct dp_vs_route_conf cf;
 
     if (cid != rte_get_master_lcore()) {
@@ -354,6 +365,25 @@ static int route_add_del(bool add, struct in_addr* dest,
         return err;
     }
 
+    /*
+     * a bulk item adding an existed route created nothing, it must fail
+     * so that the route is not deleted if the bulk rolls back.
+     */
+    if (add && err == EDPVS_EXIST && msg_batch_in_txn())
+        return EDPVS_EXIST;
+
+    /* keep the gateway resolved for all lcores */
+    if (err == EDPVS_OK && gw && gw->s_addr != htonl(INADDR_ANY)) {
+        union inet_addr nexthop;
+
+        memset(&nexthop, 0, sizeof(nexthop));
+        nexthop.in = *gw;
+        if (add)
+            neigh_pin_addr(AF_INET, &nexthop);
+        else
+            neigh_unpin_addr(AF_INET, &nexthop);
+    }
+
     /* set route on all slave lcores */
     memset(&cf, 0, sizeof(struct dp_vs_route_conf));
     if (dest)
@@ -368,22 +398,14 @@ static int route_add_del(bool add, struct in_addr* dest,
     cf.mtu = mtu;
     cf.metric = metric;
 
-    if (add)
-        msg = msg_make(MSG_TYPE_ROUTE_ADD, 0, DPVS_MSG_MULTICAST,
-                       cid, sizeof(struct dp_vs_route_conf), &cf);
-    else
-        msg = msg_make(MSG_TYPE_ROUTE_DEL, 0, DPVS_MSG_MULTICAST,
-                       cid, sizeof(struct dp_vs_route_conf), &cf);
-
-    err = multicast_msg_send(msg, 0/*DPVS_MSG_F_ASYNC*/, NULL);
+    err = msg_batch_add(add ? &route_add_batch : &route_del_batch, &cf);
     if (err != EDPVS_OK) {
-        /* ignore timeout for msg, or keepalived will cause a lot bug.
-         * Timeout error is ok because route can still be set,
-         * no mem is another possible err, but problem will not just be here */
+        /* ignore error for msg, or keepalived will cause a lot bug.
+         * route is set on master anyway, no mem is possible err,
+         * but problem will not just be here */
         RTE_LOG(INFO, ROUTE, "[%s] fail to send multicast message, error code = %d\n",
                                                                       __func__, err);
     }
-    msg_destroy(&msg);
 
     return EDPVS_OK;
 }
@@ -554,6 +576,11 @@ static int route_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
     }
 }
 
+static sockoptid_t route_sockopt_set_undo(sockoptid_t opt)
+{
+    return opt == SOCKOPT_SET_ROUTE_ADD ? SOCKOPT_SET_ROUTE_DEL : 0;
+}
+
 static void route_fill_conf(int af, struct dp_vs_route_conf *cf,
                            const struct route_entry *entry)
 {
@@ -676,29 +703,35 @@ static int route_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
 static int route_msg_process(bool add, struct dpvs_msg *msg)
 {
     struct dp_vs_route_conf *cf;
-    int err;
+    uint32_t i, nops;
+    int err, ret = EDPVS_OK;
 
     assert(msg);
-    if (msg->len != sizeof(struct dp_vs_route_conf)) {
+    if (msg_oplen(msg) != sizeof(struct dp_vs_route_conf)) {
         RTE_LOG(ERR, ROUTE, "%s: bad message.\n", __func__);
         return EDPVS_INVAL;
     }
 
-    /* set route config */
-    cf = (struct dp_vs_route_conf *)msg->data;
-    if (add)
-        err = route_add_lcore(&cf->dst.in, cf->plen, cf->flags,
-                              &cf->via.in, netif_port_get_by_name(cf->ifname),
-                              &cf->src.in, cf->mtu, cf->metric);
-    else
-        err = route_del_lcore(&cf->dst.in, cf->plen, cf->flags,
-                              &cf->via.in, netif_port_get_by_name(cf->ifname),
-                              &cf->src.in, cf->mtu, cf->metric);
-    if (err != EDPVS_OK)
-        RTE_LOG(ERR, ROUTE, "%s: fail to %s route: %s.\n",
-                __func__, add ? "add" : "del", dpvs_strerror(err));
+    /* set route config, all ops in one pass */
+    nops = msg_nops(msg);
+    for (i = 0; i < nops; i++) {
+        cf = msg_op(msg, i);
+        if (add)
+            err = route_add_lcore(&cf->dst.in, cf->plen, cf->flags,
+                                  &cf->via.in, netif_port_get_by_name(cf->ifname),
+                                  &cf->src.in, cf->mtu, cf->metric);
+        else
+            err = route_del_lcore(&cf->dst.in, cf->plen, cf->flags,
+                                  &cf->via.in, netif_port_get_by_name(cf->ifname),
+                                  &cf->src.in, cf->mtu, cf->metric);
+        if (err != EDPVS_OK) {
+            RTE_LOG(ERR, ROUTE, "%s: fail to %s route: %s.\n",
+                    __func__, add ? "add" : "del", dpvs_strerror(err));
+            ret = err;
+        }
+    }
 
-    return err;
+    return ret;
 }
 
 static int route_add_msg_cb(struct dpvs_msg *msg)
@@ -716,6 +749,7 @@ static struct dpvs_sockopts route_sockopts = {
     .set_opt_min    = SOCKOPT_SET_ROUTE_ADD,
     .set_opt_max    = SOCKOPT_SET_ROUTE_FLUSH,
     .set            = route_sockopt_set,
+    .set_undo       = route_sockopt_set_undo,
     .get_opt_min    = SOCKOPT_GET_ROUTE_SHOW,
     .get_opt_max    = SOCKOPT_GET_ROUTE_SHOW,
     .get            = route_sockopt_get,
@@ -784,6 +818,10 @@ int route_init(void)
         return err;
     }
 
+    if ((err = msg_batch_register(&route_add_batch)) != EDPVS_OK ||
+        (err = msg_batch_register(&route_del_batch)) != EDPVS_OK)
+        return err;
+
     if ((err = sockopt_register(&route_sockopts)) != EDPVS_OK)
         return err;
 
@@ -798,6 +836,9 @@ int route_term(void)
     if ((err = sockopt_unregister(&route_sockopts)) != EDPVS_OK)
         return err;
 
+    msg_batch_unregister(&route_add_batch);
+    msg_batch_unregister(&route_del_batch);
+
     rte_eal_mp_remote_launch(route_lcore_term, NULL, CALL_MASTER);
     RTE_LCORE_FOREACH_SLAVE(cid) {
         if ((err = rte_eal_wait_lcore(cid)) < 0) {
@@ -37,6 +37,16 @@
  * when needed, release it after used. no trial needed, it's
  * efficient and all resource available can be used.
  *
+ * for NIC without FDIR, the NIC's Toeplitz hash is calculated in
+ * software with its RSS key and RETA, and a <laddr, lport> is given
+ * only if the reply from the dest lands on a rx queue of current lcore.
+ * the hash is linear (XOR) in its input, so hash of the reply is the
+ * hash of <daddr, dport, laddr> XOR the hash of lport, and ports are
+ * pre-grouped by the RETA index their own hash gives. each pool keeps
+ * a used bitmap in that group order and a free count per group, so a
+ * fetch only looks into groups reaching current lcore and having free
+ * ports.
+ *
  * Lei Chen <raychen@qiyi.com>, June 2017, initial.
  */
 #include <stdint.h>
@@ -54,6 +64,7 @@
 #include "linux_ipv6.h"
 #include "parser/parser.h"
 #include "parser/vector.h"
+#include <rte_thash.h>
 
 #define MAX_PORT            65536
 
@@ -69,40 +80,64 @@
 #define SAPOOL_MIN_HASH_SZ  1
 #define SAPOOL_MAX_HASH_SZ  128
 
-enum {
-    SA_F_USED               = 0x01,
+#define SA_RSS_KEY_LEN      52
+#define SA_RSS_RETA_MAX     ETH_RSS_RETA_SIZE_512
+#define SA_AF_IDX(af)       ((af) == AF_INET6 ? 1 : 0)
+#define SA_RSS_L4_IPV4      (ETH_RSS_NONFRAG_IPV4_TCP | ETH_RSS_NONFRAG_IPV4_UDP)
+#define SA_RSS_L4_IPV6      (ETH_RSS_NONFRAG_IPV6_TCP | ETH_RSS_NONFRAG_IPV6_UDP)
+
+/* software RSS of a device without FDIR, built once on master. */
+struct sa_rss {
+    uint32_t                key[SA_RSS_KEY_LEN / 4]; /* rte_convert_rss_key'ed */
+    uint16_t                reta_mask;
+    bool                    l4[2];      /* lports steer replies, per af */
+
+    /* RETA indexes whose rx queue is polled by each lcore */
+    uint16_t                nidx[DPVS_MAX_LCORE];
+    uint16_t                idx[DPVS_MAX_LCORE][SA_RSS_RETA_MAX];
+
+    /* all ports grouped by RETA index of their own hash, per af.
+     * group g is ports[af][start[af][g] .. start[af][g+1]) */
+    uint32_t                start[2][SA_RSS_RETA_MAX + 1];
+    uint16_t                ports[2][MAX_PORT];
+    /* reverse of ports[], and group of each port */
+    uint16_t                pos[2][MAX_PORT];
+    uint16_t                group[2][MAX_PORT];
 };
 
-/**
- * if really need to to save memory, we can;
- * 1. use hlist_head
- * 2. use uint8_t flag
- * 3. remove sa_entry.addr, and get IP from sa_pool->ifa
- * 4. to __packed__ sa_entry.
- * 5. alloc sa_entries[] for 65536/cpu_num only.
- * 6. create sa_entry_pool only if pool_hash hit.
- *    since when dest (like RS) num may small.
+/*
+ * one lcore owns only the ports "(port & fdir.mask) == port_base", so
+ * instead of an entry per port (65536 for each pool), a pool keeps
+ * the owned ports only: a FIFO of free ports and a bitmap of used
+ * ports, both indexed by "port >> fdir.shift". the address is taken
+ * from sa_pool.ifa since it's the same for all ports.
  */
+struct sa_entry_pool {
+    struct sa_pool          *ap;        /* back-pointer */
 
-/* socket address (sa) is <ip, port> pair. */
-struct sa_entry {
-    struct list_head        list;       /* node of sa_pool. */
-    uint32_t                flags;      /* SA_F_XXX */
-    union inet_addr         addr;
-    __be16                  port;
-};
+    /* free ports in FIFO order, so that a released port is reused
+     * as late as possible. head/tail wrap with sa_pool.ring_mask. */
+    uint16_t                *free_ports;
+    uint32_t                free_head;
+    uint32_t                free_tail;
+
+    /* bit set if port is in use. in RSS mode it's indexed by the
+     * position in sa_rss.ports, ports out of range are set at init. */
+    uint64_t                *used_bits;
+
+    /* RSS mode: free ports and next position to try in each group,
+     * and next RETA index. free_cnt is the sum of rss_free then. */
+    uint16_t                *rss_free;
+    uint16_t                *rss_cursor;
+    uint16_t                rss_next;
 
-struct sa_entry_pool {
-    struct sa_entry         sa_entries[MAX_PORT];
-    struct list_head        used_enties;
-    struct list_head        free_enties;
     /* another way is use total_used/free_cnt in sa_pool,
      * so that we need not travels the hash to get stats.
      * we use cnt here, since we may need per-pool stats. */
-    rte_atomic16_t          used_cnt;
-    rte_atomic16_t          free_cnt;
+    uint32_t                used_cnt;
+    uint32_t                free_cnt;
     uint32_t                miss_cnt;
-};
+} __rte_cache_aligned;
 
 /* no lock needed because inet_ifaddr.sa_pool[]
  * is per-lcore. */
@@ -113,11 +148,19 @@ struct sa_pool {
     uint16_t                high;       /* max port */
     rte_atomic32_t          refcnt;
 
+    /* ports of the lcore, copied from sa_fdir in host order */
+    uint16_t                port_mask;
+    uint16_t                port_base;
+    uint8_t                 shift;
+    uint32_t                ring_mask;
+    struct sa_rss           *rss;       /* NULL if FDIR is used */
+
     /* hashed pools by dest's <ip/port>. if no dest provided,
      * just use first pool. it's not need create/destroy pool
      * for each dest, that'll be too complicated. */
     struct sa_entry_pool    *pool_hash;
     uint8_t                 pool_hash_sz;
+    void                    *pool_mem;  /* rings and bitmaps of pools */
 
     /* fdir filter ID */
     uint32_t                filter_id[MAX_FDIR_PROTO];
@@ -127,6 +170,7 @@ struct sa_fdir {
     /* the ports one lcore can use means
      * "(fdir.mask & port) == port_base" */
     uint16_t                mask;       /* filter's port mask */
+    uint8_t                 shift;      /* bits of mask */
     lcoreid_t               lcore;
     __be16                  port_base;
     uint16_t                soft_id;    /* current unsed soft-id,
@@ -140,6 +184,163 @@ static uint64_t             sa_lcore_mask;
 
 static uint8_t              sa_pool_hash_size   = SAPOOL_DEF_HASH_SZ;
 
+static struct sa_rss        *sa_rss_tab[NETIF_MAX_PORTS];
+
+static inline bool sa_fdir_supported(struct netif_port *dev)
+{
+    return !dev->netif_ops || !dev->netif_ops->op_filter_supported ||
+        dev->netif_ops->op_filter_supported(dev, RTE_ETH_FILTER_FDIR) >= 0;
+}
+
+/* hash of reply <daddr:dport -> laddr:0>, see sa_rss.ports for lport */
+static inline uint32_t sa_rss_hash(const struct sa_rss *rss, int af,
+                                   const union inet_addr *laddr,
+                                   const struct sockaddr_storage *daddr)
+{
+    uint32_t tuple[RTE_THASH_V6_L4_LEN];
+    int i;
+
+    memset(tuple, 0, sizeof(tuple));
+
+    if (af == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)daddr;
+
+        if (sin) {
+            tuple[0] = ntohl(sin->sin_addr.s_addr);
+            tuple[2] = (uint32_t)ntohs(sin->sin_port) << 16;
+        }
+        tuple[1] = ntohl(laddr->in.s_addr);
+
+        return rte_softrss_be(tuple, RTE_THASH_V4_L4_LEN,
+                              (const uint8_t *)rss->key);
+    }
+
+    if (daddr) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)daddr;
+
+        for (i = 0; i < 4; i++)
+            tuple[i] = ntohl(sin6->sin6_addr.s6_addr32[i]);
+        tuple[8] = (uint32_t)ntohs(sin6->sin6_port) << 16;
+    }
+    for (i = 0; i < 4; i++)
+        tuple[4 + i] = ntohl(laddr->in6.s6_addr32[i]);
+
+    return rte_softrss_be(tuple, RTE_THASH_V6_L4_LEN, (const uint8_t *)rss->key);
+}
+
+static void sa_rss_group_ports(struct sa_rss *rss, int af)
+{
+    uint32_t tuple[RTE_THASH_V6_L4_LEN];
+    uint32_t len = (af == AF_INET ? RTE_THASH_V4_L4_LEN : RTE_THASH_V6_L4_LEN);
+    uint32_t *start = rss->start[SA_AF_IDX(af)];
+    uint16_t *ports = rss->ports[SA_AF_IDX(af)];
+    uint16_t *pos = rss->pos[SA_AF_IDX(af)];
+    uint16_t *group = rss->group[SA_AF_IDX(af)];
+    uint32_t port, g, fill[SA_RSS_RETA_MAX];
+
+    memset(tuple, 0, sizeof(tuple));
+    memset(start, 0, sizeof(rss->start[0]));
+
+    /* counting sort by the RETA index of lport's own hash */
+    for (port = 0; port < MAX_PORT; port++) {
+        tuple[len - 1] = port;
+        g = rte_softrss_be(tuple, len, (const uint8_t *)rss->key) & rss->reta_mask;
+        group[port] = (uint16_t)g;
+        start[g + 1]++;
+    }
+    for (g = 0; g <= rss->reta_mask; g++)
+        start[g + 1] += start[g];
+
+    memcpy(fill, start, sizeof(uint32_t) * (rss->reta_mask + 1));
+    for (port = 0; port < MAX_PORT; port++) {
+        g = group[port];
+        pos[port] = (uint16_t)fill[g];
+        ports[fill[g]++] = (uint16_t)port;
+    }
+}
+
+/* get RSS key and RETA of @dev, and which lcore polls each RETA entry */
+static struct sa_rss *sa_rss_get(struct netif_port *dev)
+{
+    struct rte_eth_rss_reta_entry64 reta_conf[SA_RSS_RETA_MAX / RTE_RETA_GROUP_SIZE];
+    struct rte_eth_rss_conf rss_conf;
+    uint32_t key[SA_RSS_KEY_LEN / 4];
+    lcoreid_t owner[NETIF_MAX_QUEUES];
+    queueid_t qids[NETIF_MAX_QUEUES];
+    uint16_t reta_size, queue;
+    struct sa_rss *rss;
+    lcoreid_t cid;
+    int i, nqids;
+
+    if (sa_rss_tab[dev->id])
+        return sa_rss_tab[dev->id];
+
+    reta_size = dev->dev_info.reta_size;
+    if (!reta_size || reta_size > SA_RSS_RETA_MAX || !rte_is_power_of_2(reta_size))
+        return NULL;
+
+    memset(key, 0, sizeof(key));
+    memset(&rss_conf, 0, sizeof(rss_conf));
+    rss_conf.rss_key = (uint8_t *)key;
+    rss_conf.rss_key_len = sizeof(key);
+    if (rte_eth_dev_rss_hash_conf_get(dev->id, &rss_conf) != 0 ||
+        rss_conf.rss_key_len < RTE_THASH_V6_L4_LEN * 4 + 4)
+        return NULL;
+
+    memset(reta_conf, 0, sizeof(reta_conf));
+    for (i = 0; i < reta_size / RTE_RETA_GROUP_SIZE; i++)
+        reta_conf[i].mask = ~0ULL;
+    if (reta_size < RTE_RETA_GROUP_SIZE)
+        reta_conf[0].mask = (1ULL << reta_size) - 1;
+    if (rte_eth_dev_rss_reta_query(dev->id, reta_conf, reta_size) != 0)
+        return NULL;
+
+    for (i = 0; i < NETIF_MAX_QUEUES; i++)
+        owner[i] = DPVS_MAX_LCORE;
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(sa_lcore_mask & (1L << cid)))
+            continue;
+        nqids = NETIF_MAX_QUEUES;
+        if (netif_get_rxqs(dev, cid, qids, &nqids) != EDPVS_OK)
+            return NULL;
+        for (i = 0; i < nqids; i++) {
+            if (qids[i] < NETIF_MAX_QUEUES)
+                owner[qids[i]] = cid;
+        }
+    }
+
+    rss = rte_zmalloc(NULL, sizeof(struct sa_rss), RTE_CACHE_LINE_SIZE);
+    if (!rss)
+        return NULL;
+
+    rte_convert_rss_key(key, rss->key, sizeof(rss->key));
+    rss->reta_mask = reta_size - 1;
+    /* lports are used for both TCP and UDP, the replies of either are
+     * mis-steered if it's not hashed with ports. */
+    rss->l4[SA_AF_IDX(AF_INET)] =
+        (rss_conf.rss_hf & SA_RSS_L4_IPV4) == SA_RSS_L4_IPV4;
+    rss->l4[SA_AF_IDX(AF_INET6)] =
+        (rss_conf.rss_hf & SA_RSS_L4_IPV6) == SA_RSS_L4_IPV6;
+
+    for (i = 0; i < reta_size; i++) {
+        queue = reta_conf[i / RTE_RETA_GROUP_SIZE].reta[i % RTE_RETA_GROUP_SIZE];
+        if (queue >= NETIF_MAX_QUEUES || owner[queue] >= DPVS_MAX_LCORE)
+            continue;
+        cid = owner[queue];
+        rss->idx[cid][rss->nidx[cid]++] = i;
+    }
+
+    sa_rss_group_ports(rss, AF_INET);
+    sa_rss_group_ports(rss, AF_INET6);
+
+    RTE_LOG(INFO, SAPOOL, "%s: software RSS for %s, reta size %u, l4 %s/%s\n",
+            __func__, dev->name, reta_size,
+            rss->l4[0] ? "ipv4" : "-", rss->l4[1] ? "ipv6" : "-");
+
+    sa_rss_tab[dev->id] = rss;
+    return rss;
+}
+
 static int __add_del_filter(int af, struct netif_port *dev, lcoreid_t cid,
                             const union inet_addr *dip, __be16 dport,
                             uint32_t filter_id[MAX_FDIR_PROTO], bool add)
@@ -244,41 +445,99 @@ static inline int sa_del_filter(int af, struct netif_port *dev, lcoreid_t cid,
     return  __add_del_filter(af, dev, cid, dip, dport, filter_id, false);
 }
 
+/* count free ports of each group, and keep ports out of range used */
+static void sa_pool_init_rss(struct sa_entry_pool *pool, uint32_t nwords)
+{
+    struct sa_pool *ap = pool->ap;
+    const struct sa_rss *rss = ap->rss;
+    const uint16_t *ports = rss->ports[SA_AF_IDX(ap->ifa->af)];
+    const uint32_t *start = rss->start[SA_AF_IDX(ap->ifa->af)];
+    uint32_t g, pos;
+
+    pool->rss_free = (uint16_t *)&pool->used_bits[nwords];
+    pool->rss_cursor = pool->rss_free + rss->reta_mask + 1;
+
+    for (g = 0; g <= rss->reta_mask; g++) {
+        for (pos = start[g]; pos < start[g + 1]; pos++) {
+            if (ports[pos] < ap->low || ports[pos] > ap->high) {
+                pool->used_bits[pos / 64] |= (1ULL << (pos % 64));
+            } else {
+                pool->rss_free[g]++;
+                pool->free_cnt++;
+            }
+        }
+    }
+}
+
 static int sa_pool_alloc_hash(struct sa_pool *ap, uint8_t hash_sz,
-                               const struct sa_fdir *fdir)
+                              const struct sa_fdir *fdir, int socket)
 {
     int hash;
     struct sa_entry_pool *pool;
     uint32_t port; /* should be u32 or 65535==0 */
+    uint32_t nports = 0, nwords, ring_size;
+    size_t mem_sz;
+
+    /* with software RSS, any port may be used by the lcore */
+    if (!ap->rss) {
+        ap->port_mask = fdir->mask;
+        ap->port_base = ntohs(fdir->port_base);
+        ap->shift = fdir->shift;
+    }
+
+    for (port = ap->low; port <= ap->high; port++) {
+        if (((uint16_t)port & ap->port_mask) == ap->port_base)
+            nports++;
+    }
+    if (!nports)
+        return EDPVS_INVAL;
 
-    ap->pool_hash = rte_malloc(NULL, sizeof(struct sa_entry_pool) * hash_sz,
-                               RTE_CACHE_LINE_SIZE);
+    nwords = ((MAX_PORT >> ap->shift) + 63) / 64;
+    if (ap->rss) {
+        ap->ring_mask = 0;
+        mem_sz = nwords * sizeof(uint64_t) +
+                 2 * (ap->rss->reta_mask + 1) * sizeof(uint16_t);
+    } else {
+        ring_size = rte_align32pow2(nports);
+        ap->ring_mask = ring_size - 1;
+        mem_sz = nwords * sizeof(uint64_t) + ring_size * sizeof(uint16_t);
+    }
+    mem_sz = RTE_ALIGN(mem_sz, RTE_CACHE_LINE_SIZE);
+
+    ap->pool_hash = rte_zmalloc_socket(NULL, sizeof(struct sa_entry_pool) * hash_sz,
+                                       RTE_CACHE_LINE_SIZE, socket);
     if (!ap->pool_hash)
         return EDPVS_NOMEM;
 
+    ap->pool_mem = rte_zmalloc_socket(NULL, mem_sz * hash_sz,
+                                      RTE_CACHE_LINE_SIZE, socket);
+    if (!ap->pool_mem) {
+        rte_free(ap->pool_hash);
+        ap->pool_hash = NULL;
+        return EDPVS_NOMEM;
+    }
+
     ap->pool_hash_sz = hash_sz;
 
     for (hash = 0; hash < hash_sz; hash++) {
         pool = &ap->pool_hash[hash];
 
-        INIT_LIST_HEAD(&pool->used_enties);
-        INIT_LIST_HEAD(&pool->free_enties);
+        pool->ap = ap;
+        pool->used_bits = (uint64_t *)((char *)ap->pool_mem + mem_sz * hash);
 
-        rte_atomic16_set(&pool->used_cnt, 0);
-        rte_atomic16_set(&pool->free_cnt, 0);
+        if (ap->rss) {
+            sa_pool_init_rss(pool, nwords);
+            continue;
+        }
 
-        for (port = ap->low; port <= ap->high; port++) {
-            struct sa_entry *sa;
+        pool->free_ports = (uint16_t *)&pool->used_bits[nwords];
 
-            if (fdir->mask &&
-                ((uint16_t)port & fdir->mask) != ntohs(fdir->port_base))
+        for (port = ap->low; port <= ap->high; port++) {
+            if (((uint16_t)port & ap->port_mask) != ap->port_base)
                 continue;
 
-            sa = &pool->sa_entries[(uint16_t)port];
-            sa->addr = ap->ifa->addr;
-            sa->port = htons((uint16_t)port);
-            list_add_tail(&sa->list, &pool->free_enties);
-            rte_atomic16_inc(&pool->free_cnt);
+            pool->free_ports[pool->free_tail++] = (uint16_t)port;
+            pool->free_cnt++;
         }
     }
 
@@ -287,7 +546,10 @@ static int sa_pool_alloc_hash(struct sa_pool *ap, uint8_t hash_sz,
 
 static int sa_pool_free_hash(struct sa_pool *ap)
 {
+    rte_free(ap->pool_mem);
     rte_free(ap->pool_hash);
+    ap->pool_mem = NULL;
+    ap->pool_hash = NULL;
     ap->pool_hash_sz = 0;
     return EDPVS_OK;
 }
@@ -295,6 +557,8 @@ static int sa_pool_free_hash(struct sa_pool *ap)
 int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
 {
     struct sa_pool *ap;
+    struct sa_rss *rss = NULL;
+    struct netif_port *dev;
     int err;
     lcoreid_t cid;
 
@@ -306,6 +570,17 @@ int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
         return EDPVS_INVAL;
     }
 
+    /* no FDIR, let lports steer the replies by RSS */
+    dev = ifa->idev->dev;
+    if (dev->nrxq > 1 && !sa_fdir_supported(dev)) {
+        rss = sa_rss_get(dev);
+        if (!rss || !rss->l4[SA_AF_IDX(ifa->af)]) {
+            RTE_LOG(ERR, SAPOOL, "%s: neither FDIR nor TCP and UDP RSS is "
+                    "available on device %s.\n", __func__, dev->name);
+            return EDPVS_NOTSUPP;
+        }
+    }
+
     for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
         uint32_t filtids[MAX_FDIR_PROTO];
         struct sa_fdir *fdir = &sa_fdirs[cid];
@@ -324,14 +599,21 @@ int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
         ap->ifa = ifa;
         ap->low = low;
         ap->high = high;
+        ap->rss = rss;
         rte_atomic32_set(&ap->refcnt, 0);
 
-        err = sa_pool_alloc_hash(ap, sa_pool_hash_size, fdir);
+        err = sa_pool_alloc_hash(ap, sa_pool_hash_size, fdir,
+                                 rte_lcore_to_socket_id(cid));
         if (err != EDPVS_OK) {
             rte_free(ap);
             goto errout;
         }
 
+        if (rss) {
+            ifa->sa_pools[cid] = ap;
+            continue;
+        }
+
         /* if add filter failed, waste some soft-id is acceptable. */
         filtids[0] = fdir->soft_id++;
         filtids[1] = fdir->soft_id++;
@@ -382,8 +664,9 @@ int sa_pool_destroy(struct inet_ifaddr *ifa)
             return EDPVS_BUSY;
         }
 
-        sa_del_filter(ifa->af, ifa->idev->dev, cid, &ifa->addr,
-                      fdir->port_base, ap->filter_id);
+        if (!ap->rss)
+            sa_del_filter(ifa->af, ifa->idev->dev, cid, &ifa->addr,
+                          fdir->port_base, ap->filter_id);
         sa_pool_free_hash(ap);
         rte_free(ap);
         ifa->sa_pools[cid] = NULL;
@@ -427,50 +710,121 @@ sa_pool_hash(const struct sa_pool *ap, const struct sockaddr_storage *ss)
     }
 }
 
+/* first zero bit in [from, to) of @bits, -1 if none */
+static inline int32_t sa_bits_find_zero(const uint64_t *bits,
+                                        uint32_t from, uint32_t to)
+{
+    uint64_t word;
+    uint32_t i;
+
+    while (from < to) {
+        i = from / 64;
+        word = ~bits[i] & (~0ULL << (from % 64));
+        if (to < (i + 1) * 64)
+            word &= (1ULL << (to % 64)) - 1;
+        if (word)
+            return i * 64 + __builtin_ctzll(word);
+        from = (i + 1) * 64;
+    }
+
+    return -1;
+}
+
+/* unused port whose reply to @daddr is received by current lcore */
+static inline int sa_pool_fetch_rss(struct sa_entry_pool *pool,
+                                    const struct sockaddr_storage *daddr,
+                                    uint16_t *lport)
+{
+    struct sa_pool *ap = pool->ap;
+    const struct sa_rss *rss = ap->rss;
+    const uint16_t *ports = rss->ports[SA_AF_IDX(ap->ifa->af)];
+    const uint32_t *start = rss->start[SA_AF_IDX(ap->ifa->af)];
+    lcoreid_t cid = rte_lcore_id();
+    uint32_t hash, i, g, cur;
+    int32_t pos;
+
+    hash = sa_rss_hash(rss, ap->ifa->af, &ap->ifa->addr, daddr);
+
+    /* RETA index of reply is "(hash ^ hash-of-lport) & reta_mask" */
+    for (i = 0; i < rss->nidx[cid]; i++) {
+        g = (hash ^ rss->idx[cid][(pool->rss_next + i) % rss->nidx[cid]])
+            & rss->reta_mask;
+        if (!pool->rss_free[g])
+            continue;
+
+        /* from the cursor on, so that released ports are reused late */
+        cur = start[g] + pool->rss_cursor[g];
+        pos = sa_bits_find_zero(pool->used_bits, cur, start[g + 1]);
+        if (pos < 0)
+            pos = sa_bits_find_zero(pool->used_bits, start[g], cur);
+        assert(pos >= 0);
+
+        pool->used_bits[pos / 64] |= (1ULL << (pos % 64));
+        pool->rss_free[g]--;
+        pool->free_cnt--;
+        pool->rss_cursor[g] = (pos + 1 - start[g]) % (start[g + 1] - start[g]);
+        pool->rss_next++;
+        *lport = ports[pos];
+        return EDPVS_OK;
+    }
+
+    return EDPVS_RESOURCE;
+}
+
 static inline int sa_pool_fetch(struct sa_entry_pool *pool,
+                                const struct sockaddr_storage *daddr,
                                 struct sockaddr_storage *ss)
 {
     assert(pool && ss);
 
-    struct sa_entry *ent;
+    struct sa_pool *ap = pool->ap;
     struct sockaddr_in *sin = (struct sockaddr_in *)ss;
     struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+    uint16_t port, idx;
 #ifdef CONFIG_DPVS_SAPOOL_DEBUG
     char addr[64];
 #endif
 
-    ent = list_first_entry_or_null(&pool->free_enties, struct sa_entry, list);
-    if (!ent) {
+    if (ss->ss_family != AF_INET && ss->ss_family != AF_INET6)
+        return EDPVS_NOTSUPP;
+
+    if (ap->rss) {
+        if (sa_pool_fetch_rss(pool, daddr, &port) != EDPVS_OK) {
+            pool->miss_cnt++;
+            return EDPVS_RESOURCE;
+        }
+    } else {
+        if (!pool->free_cnt) {
 #ifdef CONFIG_DPVS_SAPOOL_DEBUG
-        RTE_LOG(DEBUG, SAPOOL, "%s: no entry (used/free %d/%d)\n", __func__,
-                rte_atomic16_read(&pool->used_cnt),
-                rte_atomic16_read(&pool->free_cnt));
+            RTE_LOG(DEBUG, SAPOOL, "%s: no entry (used/free %d/%d)\n", __func__,
+                    pool->used_cnt, pool->free_cnt);
 #endif
-        pool->miss_cnt++;
-        return EDPVS_RESOURCE;
+            pool->miss_cnt++;
+            return EDPVS_RESOURCE;
+        }
+
+        port = pool->free_ports[pool->free_head++ & ap->ring_mask];
+        pool->free_cnt--;
+
+        idx = port >> ap->shift;
+        pool->used_bits[idx / 64] |= (1ULL << (idx % 64));
     }
+    pool->used_cnt++;
 
     if (ss->ss_family == AF_INET) {
         sin->sin_family = AF_INET;
-        sin->sin_addr.s_addr = ent->addr.in.s_addr;
-        sin->sin_port = ent->port;
-    } else if (ss->ss_family == AF_INET6) {
-        sin6->sin6_family = AF_INET6;
-        sin6->sin6_addr = ent->addr.in6;
-        sin6->sin6_port = ent->port;
+        sin->sin_addr.s_addr = ap->ifa->addr.in.s_addr;
+        sin->sin_port = htons(port);
     } else {
-        return EDPVS_NOTSUPP;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_addr = ap->ifa->addr.in6;
+        sin6->sin6_port = htons(port);
     }
 
-    ent->flags |= SA_F_USED;
-    list_move_tail(&ent->list, &pool->used_enties);
-    rte_atomic16_inc(&pool->used_cnt);
-    rte_atomic16_dec(&pool->free_cnt);
-
 #ifdef CONFIG_DPVS_SAPOOL_DEBUG
     RTE_LOG(DEBUG, SAPOOL, "%s: %s:%d fetched!\n", __func__,
-            inet_ntop(ss->ss_family, &ent->addr, addr, sizeof(addr)) ? : NULL,
-            ntohs(ent->port));
+            inet_ntop(ss->ss_family, &ap->ifa->addr, addr, sizeof(addr)) ? : NULL,
+            port);
 #endif
 
     return EDPVS_OK;
@@ -481,10 +835,10 @@ static inline int sa_pool_release(struct sa_entry_pool *pool,
 {
     assert(pool && ss);
 
-    struct sa_entry *ent;
+    struct sa_pool *ap = pool->ap;
     const struct sockaddr_in *sin = (const struct sockaddr_in *)ss;
     const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)ss;
-    __be16 port;
+    uint16_t port, idx;
 #ifdef CONFIG_DPVS_SAPOOL_DEBUG
     char addr[64];
 #endif
@@ -497,31 +851,37 @@ static inline int sa_pool_release(struct sa_entry_pool *pool,
         return EDPVS_NOTSUPP;
     assert(port > 0 && port < MAX_PORT);
 
-    /* it's too slow to traverse the used_enties list
-     * (by list_for_each_entry_safe) to find the @entry
-     * matchs @sin. */
-    ent = &pool->sa_entries[port];
-    if (!(ent->flags & SA_F_USED)) {
+    if ((port & ap->port_mask) != ap->port_base) {
+        RTE_LOG(WARNING, SAPOOL, "%s: port %d not of this lcore !\n", __func__, port);
+        return EDPVS_INVAL;
+    }
+
+    if (ap->rss)
+        idx = ap->rss->pos[SA_AF_IDX(ss->ss_family)][port];
+    else
+        idx = port >> ap->shift;
+    if (!(pool->used_bits[idx / 64] & (1ULL << (idx % 64)))) {
         RTE_LOG(WARNING, SAPOOL, "%s: port %d not in use !\n", __func__, port);
         return EDPVS_INVAL;
     }
 
     if (ss->ss_family == AF_INET)
-        assert(ent->addr.in.s_addr == sin->sin_addr.s_addr &&
-                ent->port == sin->sin_port);
+        assert(ap->ifa->addr.in.s_addr == sin->sin_addr.s_addr);
     else
-        assert(ipv6_addr_equal(&ent->addr.in6, &sin6->sin6_addr) &&
-                ent->port == sin6->sin6_port);
+        assert(ipv6_addr_equal(&ap->ifa->addr.in6, &sin6->sin6_addr));
 
-    ent->flags &= (~SA_F_USED);
-    list_move_tail(&ent->list, &pool->free_enties);
-    rte_atomic16_dec(&pool->used_cnt);
-    rte_atomic16_inc(&pool->free_cnt);
+    pool->used_bits[idx / 64] &= ~(1ULL << (idx % 64));
+    pool->used_cnt--;
+    if (ap->rss)
+        pool->rss_free[ap->rss->group[SA_AF_IDX(ss->ss_family)][port]]++;
+    else
+        pool->free_ports[pool->free_tail++ & ap->ring_mask] = port;
+    pool->free_cnt++;
 
 #ifdef CONFIG_DPVS_SAPOOL_DEBUG
     RTE_LOG(DEBUG, SAPOOL, "%s: %s:%d released!\n", __func__,
-            inet_ntop(ss->ss_family, &ent->addr, addr, sizeof(addr)) ? : NULL,
-            ntohs(ent->port));
+            inet_ntop(ss->ss_family, &ap->ifa->addr, addr, sizeof(addr)) ? : NULL,
+            port);
 #endif
 
     return EDPVS_OK;
@@ -581,6 +941,7 @@ static int sa4_fetch(struct netif_port *dev,
 
         err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
                             (struct sockaddr_storage *)daddr),
+                            (struct sockaddr_storage *)daddr,
                             (struct sockaddr_storage *)saddr);
         if (err == EDPVS_OK)
             rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
@@ -619,6 +980,7 @@ static int sa4_fetch(struct netif_port *dev,
     /* do fetch socket address */
     err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
                         (struct sockaddr_storage *)daddr),
+                        (struct sockaddr_storage *)daddr,
                         (struct sockaddr_storage *)saddr);
     if (err == EDPVS_OK)
         rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
@@ -655,6 +1017,7 @@ static int sa6_fetch(struct netif_port *dev,
 
         err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
                             (struct sockaddr_storage *)daddr),
+                            (struct sockaddr_storage *)daddr,
                             (struct sockaddr_storage *)saddr);
         if (err == EDPVS_OK)
             rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
@@ -698,6 +1061,7 @@ static int sa6_fetch(struct netif_port *dev,
     /* do fetch socket address */
     err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
                         (struct sockaddr_storage *)daddr),
+                        (struct sockaddr_storage *)daddr,
                         (struct sockaddr_storage *)saddr);
     if (err == EDPVS_OK)
         rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
@@ -809,6 +1173,7 @@ int sa_pool_stats(const struct inet_ifaddr *ifa, struct sa_pool_stats *stats)
 static int sa_msg_get_stats(struct dpvs_msg *msg)
 {
     const struct inet_ifaddr *ifa;
+    const struct sa_rss *rss;
     struct sa_pool_stats *stats;
     struct sa_entry_pool *pool;
     void *ptr;
@@ -825,13 +1190,18 @@ static int sa_msg_get_stats(struct dpvs_msg *msg)
 
     if (!ifa->this_sa_pool)
         goto reply;
+    rss = ifa->this_sa_pool->rss;
 
     for (hash = 0; hash < ifa->this_sa_pool->pool_hash_sz; hash++) {
         pool = &ifa->this_sa_pool->pool_hash[hash];
         assert(pool);
 
-        stats->used_cnt += rte_atomic16_read(&pool->used_cnt);
-        stats->free_cnt += rte_atomic16_read(&pool->free_cnt);
+        stats->used_cnt += pool->used_cnt;
+        if (!rss)
+            stats->free_cnt += pool->free_cnt;
+        else /* share of this lcore, ports are not reserved per lcore */
+            stats->free_cnt += (uint64_t)pool->free_cnt *
+                               rss->nidx[rte_lcore_id()] / (rss->reta_mask + 1);
         stats->miss_cnt += pool->miss_cnt;
     }
 
@@ -869,6 +1239,7 @@ int sa_pool_init(void)
         assert(rte_lcore_is_enabled(cid) && cid != rte_get_master_lcore());
 
         sa_fdirs[cid].mask = ~((~0x0) << shift);
+        sa_fdirs[cid].shift = shift;
         sa_fdirs[cid].lcore = cid;
         sa_fdirs[cid].port_base = htons(port_base);
         sa_fdirs[cid].soft_id = 0;
@@ -0,0 +1,575 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "common.h"
+#include "dpdk.h"
+#include "netif.h"
+#include "timer.h"
+#include "ipv4.h"
+#include "ipv6.h"
+#include "tc/tc.h"
+#include "tc/sch.h"
+#include "parser/parser.h"
+#include "ipvs/service.h"
+#include "ipvs/dest.h"
+#include "ipvs/stats.h"
+#include "stats_shm.h"
+#include "conf/stats_shm.h"
+
+#define RTE_LOGTYPE_STATS_SHM       RTE_LOGTYPE_USER1
+
+#define STATS_SHM_INTERVAL_DEF      1000    /* ms */
+#define STATS_SHM_INTERVAL_MIN      10
+#define STATS_SHM_INTERVAL_MAX      60000
+#define STATS_SHM_SVC_MAX_DEF       8192
+#define STATS_SHM_DEST_MAX_DEF      65536
+#define STATS_SHM_ENTRY_MAX         (1 << 20)
+#define STATS_SHM_PORT_MAX          64
+#define STATS_SHM_QSCH_MAX          1024
+
+static bool stats_shm_enable;
+static char stats_shm_name[64];
+static int stats_shm_interval;
+static int stats_shm_svc_max;
+static int stats_shm_dest_max;
+
+static struct dpvs_stats_shm_hdr *stats_shm;
+static size_t stats_shm_size;
+static struct dpvs_timer stats_shm_timer;
+
+struct stats_shm_walk {
+    struct dpvs_stats_shm_hdr *hdr;
+    uint32_t nsvc;
+    uint32_t ndest;
+    bool trunc;
+};
+
+static inline void stats_shm_counters(struct dpvs_stats_shm_counters *cnt,
+                                      const struct dp_vs_stats *st)
+{
+    cnt->conns      = st->conns;
+    cnt->inpkts     = st->inpkts;
+    cnt->inbytes    = st->inbytes;
+    cnt->outpkts    = st->outpkts;
+    cnt->outbytes   = st->outbytes;
+}
+
+static void stats_shm_fill_lcores(struct dpvs_stats_shm_hdr *hdr)
+{
+    struct dpvs_stats_shm_lcore *ent;
+    struct netif_lcore_stats lst;
+    struct dp_vs_stats st;
+    uint64_t lcore_mask;
+    uint8_t nlcore;
+    lcoreid_t cid;
+    uint32_t num = 0;
+
+    netif_get_slave_lcores(&nlcore, &lcore_mask);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE && num < hdr->lcore.max; cid++) {
+        if (!(lcore_mask & (1L << cid)))
+            continue;
+
+        netif_lcore_stats_read(cid, &lst);
+        dp_vs_stats_lcore(cid, &st);
+
+        ent = dpvs_stats_shm_entry(hdr, &hdr->lcore, num++);
+        ent->cid            = cid;
+        ent->lcore_loop     = lst.lcore_loop;
+        ent->pktburst       = lst.pktburst;
+        ent->zpktburst      = lst.zpktburst;
+        ent->fpktburst      = lst.fpktburst;
+        ent->z2hpktburst    = lst.z2hpktburst;
+        ent->h2fpktburst    = lst.h2fpktburst;
+        ent->ipackets       = lst.ipackets;
+        ent->ibytes         = lst.ibytes;
+        ent->opackets       = lst.opackets;
+        ent->obytes         = lst.obytes;
+        ent->dropped        = lst.dropped;
+        stats_shm_counters(&ent->ipvs, &st);
+    }
+
+    hdr->lcore.num = num;
+}
+
+static void stats_shm_fill_ports(struct dpvs_stats_shm_hdr *hdr)
+{
+    struct dpvs_stats_shm_port *ent;
+    struct netif_port *dev;
+    struct rte_eth_stats est;
+    portid_t pid;
+    uint32_t num = 0;
+
+    for (pid = 0; pid < netif_port_count() && num < hdr->port.max; pid++) {
+        dev = netif_port_get(pid);
+        if (!dev || netif_get_stats(dev, &est) != EDPVS_OK)
+            continue;
+
+        ent = dpvs_stats_shm_entry(hdr, &hdr->port, num++);
+        snprintf(ent->name, sizeof(ent->name), "%s", dev->name);
+        ent->id         = dev->id;
+        ent->ipackets   = est.ipackets;
+        ent->opackets   = est.opackets;
+        ent->ibytes     = est.ibytes;
+        ent->obytes     = est.obytes;
+        ent->imissed    = est.imissed;
+        ent->ierrors    = est.ierrors;
+        ent->oerrors    = est.oerrors;
+        ent->rx_nombuf  = est.rx_nombuf;
+    }
+
+    hdr->port.num = num;
+}
+
+static int stats_shm_fill_svc(struct dp_vs_service *svc, void *arg)
+{
+    struct stats_shm_walk *walk = arg;
+    struct dpvs_stats_shm_hdr *hdr = walk->hdr;
+    struct dpvs_stats_shm_svc *ent;
+    struct dpvs_stats_shm_dest *dent;
+    struct dp_vs_dest *dest;
+    struct dp_vs_stats st;
+
+    if (walk->nsvc >= hdr->svc.max) {
+        walk->trunc = true;
+        return EDPVS_NOROOM;
+    }
+
+    ent = dpvs_stats_shm_entry(hdr, &hdr->svc, walk->nsvc);
+    memset(ent, 0, sizeof(*ent));
+    ent->af         = svc->af;
+    ent->proto      = svc->proto;
+    ent->port       = svc->port;
+    ent->fwmark     = svc->fwmark;
+    ent->flags      = svc->flags;
+    ent->addr       = svc->addr;
+    ent->dest_first = walk->ndest;
+    if (svc->match)
+        dump_match(svc->proto, svc->match, ent->match, sizeof(ent->match));
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (walk->ndest >= hdr->dest.max) {
+            walk->trunc = true;
+            break;
+        }
+
+        memset(&st, 0, sizeof(st));
+        dp_vs_stats_sum(dest->stats, &st);
+
+        dent = dpvs_stats_shm_entry(hdr, &hdr->dest, walk->ndest++);
+        memset(dent, 0, sizeof(*dent));
+        dent->af            = dest->af;
+        dent->port          = dest->port;
+        dent->addr          = dest->addr;
+        dent->svc           = walk->nsvc;
+        dent->flags         = dest->flags;
+        dent->weight        = rte_atomic16_read(&dest->weight);
+        dent->actconns      = rte_atomic32_read(&dest->actconns);
+        dent->inactconns    = rte_atomic32_read(&dest->inactconns);
+        dent->persistconns  = rte_atomic32_read(&dest->persistconns);
+        stats_shm_counters(&dent->stats, &st);
+
+        ent->stats.conns    += st.conns;
+        ent->stats.inpkts   += st.inpkts;
+        ent->stats.inbytes  += st.inbytes;
+        ent->stats.outpkts  += st.outpkts;
+        ent->stats.outbytes += st.outbytes;
+        ent->ndest++;
+    }
+
+    walk->nsvc++;
+    return EDPVS_OK;
+}
+
+static void stats_shm_fill_mibs(struct dpvs_stats_shm_hdr *hdr)
+{
+    uint64_t mibs[DP_VS_EXT_STAT_LAST];
+    struct dpvs_stats_shm_mib *ent;
+    const char *name;
+    uint32_t num = 0;
+    int field;
+
+    dp_vs_estats_sum(mibs);
+
+    for (field = 0; field < DP_VS_EXT_STAT_LAST && num < hdr->mib.max; field++) {
+        name = dp_vs_estats_name(field);
+        if (!name)
+            continue;
+
+        ent = dpvs_stats_shm_entry(hdr, &hdr->mib, num++);
+        snprintf(ent->name, sizeof(ent->name), "%s", name);
+        ent->value = mibs[field];
+    }
+
+    hdr->mib.num = num;
+}
+
+static void stats_shm_fill_inet(struct dpvs_stats_shm_hdr *hdr)
+{
+    struct dpvs_stats_shm_inet *ent;
+    uint32_t num = 0;
+
+    /* ipv4 stats are there only with CONFIG_DPVS_IPV4_STATS */
+    ent = dpvs_stats_shm_entry(hdr, &hdr->inet, num);
+    if (ipv4_get_stats(&ent->stats) == EDPVS_OK) {
+        ent->af = AF_INET;
+        num++;
+    }
+
+    ent = dpvs_stats_shm_entry(hdr, &hdr->inet, num);
+    if (ipv6_stats_sum(&ent->stats) == EDPVS_OK) {
+        ent->af = AF_INET6;
+        num++;
+    }
+
+    hdr->inet.num = num;
+}
+
+/* false if there's no room for @sch */
+static bool stats_shm_fill_qsch_one(struct dpvs_stats_shm_hdr *hdr,
+                                    struct netif_port *dev, struct Qsch *sch)
+{
+    struct dpvs_stats_shm_qsch *ent;
+    lcoreid_t cid;
+
+    if (sch->flags & QSCH_F_INVISIBLE)
+        return true;
+    if (hdr->qsch.num >= hdr->qsch.max)
+        return false;
+
+    ent = dpvs_stats_shm_entry(hdr, &hdr->qsch, hdr->qsch.num++);
+    memset(ent, 0, sizeof(*ent));
+    snprintf(ent->dev, sizeof(ent->dev), "%s", dev->name);
+    snprintf(ent->kind, sizeof(ent->kind), "%s", sch->ops->name);
+    ent->handle = sch->handle;
+    ent->parent = sch->parent;
+
+    /* per-lcore counters are read without msgs, like other sections */
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        ent->qlen       += sch->qstats[cid].qlen;
+        ent->backlog    += sch->qstats[cid].backlog;
+        ent->drops      += sch->qstats[cid].drops;
+        ent->requeues   += sch->qstats[cid].requeues;
+        ent->overlimits += sch->qstats[cid].overlimits;
+        ent->bytes      += sch->bstats[cid].bytes;
+        ent->packets    += sch->bstats[cid].packets;
+    }
+
+    return true;
+}
+
+/* returns false if some qsch are left out */
+static bool stats_shm_fill_qsch(struct dpvs_stats_shm_hdr *hdr)
+{
+    struct netif_port *dev;
+    struct netif_tc *tc;
+    struct Qsch *sch;
+    bool room = true;
+    portid_t pid;
+    int h;
+
+    hdr->qsch.num = 0;
+
+    for (pid = 0; pid < netif_port_count() && room; pid++) {
+        dev = netif_port_get(pid);
+        if (!dev)
+            continue;
+        tc = netif_tc(dev);
+
+        rte_rwlock_read_lock(&tc->lock);
+        if (tc->qsch)
+            room = stats_shm_fill_qsch_one(hdr, dev, tc->qsch);
+        if (room && tc->qsch_ingress)
+            room = stats_shm_fill_qsch_one(hdr, dev, tc->qsch_ingress);
+        for (h = 0; room && h < tc->qsch_hash_size; h++) {
+            hlist_for_each_entry(sch, &tc->qsch_hash[h], hlist) {
+                room = stats_shm_fill_qsch_one(hdr, dev, sch);
+                if (!room)
+                    break;
+            }
+        }
+        rte_rwlock_read_unlock(&tc->lock);
+    }
+
+    return room;
+}
+
+static int stats_shm_update(void *arg)
+{
+    struct dpvs_stats_shm_hdr *hdr = stats_shm;
+    struct stats_shm_walk walk = { .hdr = hdr };
+    struct timeval now;
+
+    hdr->seq++;
+    rte_smp_wmb();
+
+    stats_shm_fill_lcores(hdr);
+    stats_shm_fill_ports(hdr);
+
+    dp_vs_service_walk(stats_shm_fill_svc, &walk);
+    hdr->svc.num = walk.nsvc;
+    hdr->dest.num = walk.ndest;
+
+    stats_shm_fill_mibs(hdr);
+    stats_shm_fill_inet(hdr);
+    if (!stats_shm_fill_qsch(hdr))
+        walk.trunc = true;
+
+    if (walk.trunc)
+        hdr->flags |= DPVS_STATS_SHM_F_TRUNC;
+    else
+        hdr->flags &= ~DPVS_STATS_SHM_F_TRUNC;
+
+    gettimeofday(&now, NULL);
+    hdr->updated_us = now.tv_sec * 1000000UL + now.tv_usec;
+
+    rte_smp_wmb();
+    hdr->seq++;
+
+    return DTIMER_OK;
+}
+
+static void stats_shm_sect_init(struct dpvs_stats_shm_sect *sect,
+                                size_t *off, uint32_t entsz, uint32_t max)
+{
+    sect->off   = *off;
+    sect->entsz = entsz;
+    sect->max   = max;
+    sect->num   = 0;
+
+    *off = RTE_ALIGN(*off + (size_t)entsz * max, RTE_CACHE_LINE_SIZE);
+}
+
+int stats_shm_init(void)
+{
+    struct dpvs_stats_shm_hdr hdr;
+    struct timeval tv;
+    size_t off;
+    void *addr;
+    int fd, err;
+
+    if (!stats_shm_enable)
+        return EDPVS_OK;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic       = DPVS_STATS_SHM_MAGIC;
+    hdr.version     = DPVS_STATS_SHM_VERSION;
+    hdr.interval_ms = stats_shm_interval;
+    hdr.pid         = getpid();
+
+    off = RTE_ALIGN(sizeof(hdr), RTE_CACHE_LINE_SIZE);
+    stats_shm_sect_init(&hdr.lcore, &off, sizeof(struct dpvs_stats_shm_lcore),
+                        DPVS_MAX_LCORE);
+    stats_shm_sect_init(&hdr.port, &off, sizeof(struct dpvs_stats_shm_port),
+                        STATS_SHM_PORT_MAX);
+    stats_shm_sect_init(&hdr.svc, &off, sizeof(struct dpvs_stats_shm_svc),
+                        stats_shm_svc_max);
+    stats_shm_sect_init(&hdr.dest, &off, sizeof(struct dpvs_stats_shm_dest),
+                        stats_shm_dest_max);
+    stats_shm_sect_init(&hdr.mib, &off, sizeof(struct dpvs_stats_shm_mib),
+                        DP_VS_EXT_STAT_LAST);
+    stats_shm_sect_init(&hdr.inet, &off, sizeof(struct dpvs_stats_shm_inet), 2);
+    stats_shm_sect_init(&hdr.qsch, &off, sizeof(struct dpvs_stats_shm_qsch),
+                        STATS_SHM_QSCH_MAX);
+    hdr.size = off;
+
+    fd = shm_open(stats_shm_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        RTE_LOG(ERR, STATS_SHM, "%s: fail to open %s: %s\n",
+                __func__, stats_shm_name, strerror(errno));
+        return EDPVS_SYSCALL;
+    }
+
+    if (ftruncate(fd, off) < 0) {
+        RTE_LOG(ERR, STATS_SHM, "%s: fail to size %s: %s\n",
+                __func__, stats_shm_name, strerror(errno));
+        close(fd);
+        shm_unlink(stats_shm_name);
+        return EDPVS_SYSCALL;
+    }
+
+    addr = mmap(NULL, off, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        RTE_LOG(ERR, STATS_SHM, "%s: fail to map %s: %s\n",
+                __func__, stats_shm_name, strerror(errno));
+        shm_unlink(stats_shm_name);
+        return EDPVS_SYSCALL;
+    }
+
+    stats_shm = addr;
+    stats_shm_size = off;
+    memcpy(stats_shm, &hdr, sizeof(hdr));
+
+    tv.tv_sec = stats_shm_interval / 1000;
+    tv.tv_usec = (stats_shm_interval % 1000) * 1000;
+    err = dpvs_timer_sched_period(&stats_shm_timer, &tv,
+                                  stats_shm_update, NULL, true);
+    if (err != EDPVS_OK) {
+        stats_shm_term();
+        return err;
+    }
+
+    RTE_LOG(INFO, STATS_SHM, "%s: %s of %zu bytes, updated every %d ms\n",
+            __func__, stats_shm_name, stats_shm_size, stats_shm_interval);
+    return EDPVS_OK;
+}
+
+const struct dpvs_stats_shm_hdr *stats_shm_region(void)
+{
+    return stats_shm;
+}
+
+int stats_shm_term(void)
+{
+    if (!stats_shm)
+        return EDPVS_OK;
+
+    dpvs_timer_cancel(&stats_shm_timer, true);
+    munmap(stats_shm, stats_shm_size);
+    shm_unlink(stats_shm_name);
+    stats_shm = NULL;
+    stats_shm_size = 0;
+
+    return EDPVS_OK;
+}
+
+static void stats_shm_enable_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+
+    assert(str);
+
+    if (strcasecmp(str, "on") == 0)
+        stats_shm_enable = true;
+    else if (strcasecmp(str, "off") == 0)
+        stats_shm_enable = false;
+    else
+        RTE_LOG(WARNING, STATS_SHM, "invalid stats_shm:enable %s\n", str);
+
+    RTE_LOG(INFO, STATS_SHM, "stats_shm:enable = %s\n", stats_shm_enable ? "on" : "off");
+
+    FREE_PTR(str);
+}
+
+static void stats_shm_name_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+
+    assert(str);
+
+    if (str[0] == '/' && strlen(str) > 1 && strlen(str) < sizeof(stats_shm_name) &&
+        !strchr(str + 1, '/')) {
+        RTE_LOG(INFO, STATS_SHM, "stats_shm:name = %s\n", str);
+        snprintf(stats_shm_name, sizeof(stats_shm_name), "%s", str);
+    } else {
+        RTE_LOG(WARNING, STATS_SHM, "invalid stats_shm:name %s, using default %s\n",
+                str, DPVS_STATS_SHM_NAME_DEF);
+        snprintf(stats_shm_name, sizeof(stats_shm_name), "%s", DPVS_STATS_SHM_NAME_DEF);
+    }
+
+    FREE_PTR(str);
+}
+
+static void stats_shm_interval_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int interval;
+
+    assert(str);
+    interval = atoi(str);
+    if (interval >= STATS_SHM_INTERVAL_MIN && interval <= STATS_SHM_INTERVAL_MAX) {
+        RTE_LOG(INFO, STATS_SHM, "stats_shm:interval_ms = %d\n", interval);
+        stats_shm_interval = interval;
+    } else {
+        RTE_LOG(WARNING, STATS_SHM, "invalid stats_shm:interval_ms %s, using default %d\n",
+                str, STATS_SHM_INTERVAL_DEF);
+        stats_shm_interval = STATS_SHM_INTERVAL_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void stats_shm_svc_max_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int max;
+
+    assert(str);
+    max = atoi(str);
+    if (max > 0 && max <= STATS_SHM_ENTRY_MAX) {
+        RTE_LOG(INFO, STATS_SHM, "stats_shm:max_services = %d\n", max);
+        stats_shm_svc_max = max;
+    } else {
+        RTE_LOG(WARNING, STATS_SHM, "invalid stats_shm:max_services %s, using default %d\n",
+                str, STATS_SHM_SVC_MAX_DEF);
+        stats_shm_svc_max = STATS_SHM_SVC_MAX_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void stats_shm_dest_max_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int max;
+
+    assert(str);
+    max = atoi(str);
+    if (max > 0 && max <= STATS_SHM_ENTRY_MAX) {
+        RTE_LOG(INFO, STATS_SHM, "stats_shm:max_dests = %d\n", max);
+        stats_shm_dest_max = max;
+    } else {
+        RTE_LOG(WARNING, STATS_SHM, "invalid stats_shm:max_dests %s, using default %d\n",
+                str, STATS_SHM_DEST_MAX_DEF);
+        stats_shm_dest_max = STATS_SHM_DEST_MAX_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+void stats_shm_keyword_value_init(void)
+{
+    if (dpvs_state_get() == DPVS_STATE_INIT) {
+        /* KW_TYPE_INIT keyword */
+        stats_shm_enable = false;
+        snprintf(stats_shm_name, sizeof(stats_shm_name), "%s", DPVS_STATS_SHM_NAME_DEF);
+        stats_shm_interval = STATS_SHM_INTERVAL_DEF;
+        stats_shm_svc_max = STATS_SHM_SVC_MAX_DEF;
+        stats_shm_dest_max = STATS_SHM_DEST_MAX_DEF;
+    }
+    /* KW_TYPE_NORMAL keyword */
+}
+
+/* sub-keywords of ctrl_defs */
+void install_stats_shm_keywords(void)
+{
+    install_keyword("stats_shm", NULL, KW_TYPE_INIT);
+    install_sublevel();
+    install_keyword("enable", stats_shm_enable_handler, KW_TYPE_INIT);
+    install_keyword("name", stats_shm_name_handler, KW_TYPE_INIT);
+    install_keyword("interval_ms", stats_shm_interval_handler, KW_TYPE_INIT);
+    install_keyword("max_services", stats_shm_svc_max_handler, KW_TYPE_INIT);
+    install_keyword("max_dests", stats_shm_dest_max_handler, KW_TYPE_INIT);
+    install_sublevel_end();
+}
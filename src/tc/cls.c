@@ -21,11 +21,54 @@
  * Lei Chen <raychen@qiyi.com>, Aug. 2017, initial.
  */
 #include <assert.h>
+#include <stdlib.h>
 #include <linux/if_ether.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <rte_jhash.h>
+#include "netif.h"
+#include "vlan.h"
 #include "tc/tc.h"
 #include "tc/sch.h"
 #include "tc/cls.h"
 
+/* old table may still be used by datapath for a while */
+/* also the delay to free a deleted classifier, old tables refer to it */
+#define CLS_TBL_FREE_DELAY      1   /* seconds */
+
+/* classifier of tcp/udp traffic to one daddr:dport */
+struct cls_hent {
+    uint32_t                daddr;
+    uint16_t                dport;
+    uint8_t                 proto;
+    int                     idx;
+};
+
+/*
+ * classifiers of a Qsch compiled for lookup. "exact" classifiers are
+ * hashed by daddr:dport, others are indexed by elementary intervals of
+ * their daddr ranges, each interval with a bitmap of classifiers
+ * covering it. the candidates are verified by cls->ops->classify in
+ * priority order, so the first match is the same as a linear scan.
+ */
+struct tc_cls_table {
+    int                     nrules;
+    struct tc_cls           **rules;    /* by priority */
+
+    uint32_t                hmask;
+    uint32_t                *hbkts;     /* hash bucket offsets of hents */
+    struct cls_hent         *hents;     /* sorted by bucket and idx */
+
+    int                     nsegs;
+    int                     nwords;     /* of one bitmap */
+    uint32_t                *bounds;    /* lower bound of each interval */
+    uint64_t                *bitmaps;
+
+    struct dpvs_timer       timer;
+};
+
 static inline tc_handle_t cls_alloc_handle(struct Qsch *sch)
 {
     int i = 0x8000;
@@ -122,6 +165,7 @@ struct tc_cls *tc_cls_create(struct Qsch *sch, const char *kind,
     }
 
     sch->cls_cnt++;
+    tc_cls_compile(sch);
     *errp = EDPVS_OK;
     return cls;
 
@@ -132,27 +176,45 @@ errout:
     return NULL;
 }
 
-void tc_cls_destroy(struct tc_cls *cls)
+static int cls_expire(void *arg)
 {
+    struct tc_cls *cls = arg;
     struct tc_cls_ops *ops = cls->ops;
-    struct Qsch *sch = cls->sch;
-
-    list_del(&cls->list);
-    sch->cls_cnt--;
 
     if (ops->destroy)
         ops->destroy(cls);
 
     tc_cls_ops_put(ops);
     cls_free(cls);
+    return DTIMER_STOP;
+}
+
+void tc_cls_destroy(struct tc_cls *cls)
+{
+    struct Qsch *sch = cls->sch;
+    struct timeval delay = { CLS_TBL_FREE_DELAY, 0 };
+
+    list_del(&cls->list);
+    sch->cls_cnt--;
+    tc_cls_compile(sch);
+
+    /* lcores may still classify by the old table, free it after them */
+    if (dpvs_timer_sched(&cls->timer, &delay, cls_expire, cls,
+                         true) != EDPVS_OK)
+        cls_expire(cls);
 }
 
 int tc_cls_change(struct tc_cls *cls, const void *arg)
 {
+    int err;
+
     if (!cls->ops->change)
         return EDPVS_NOTSUPP;
 
-    return cls->ops->change(cls, arg);
+    err = cls->ops->change(cls, arg);
+    tc_cls_compile(cls->sch);
+
+    return err;
 }
 
 struct tc_cls *tc_cls_lookup(struct Qsch *sch, tc_handle_t handle)
@@ -166,3 +228,375 @@ struct tc_cls *tc_cls_lookup(struct Qsch *sch, tc_handle_t handle)
 
     return NULL;
 }
+
+static inline void cls_get_key(struct tc_cls *cls, struct tc_cls_key *key)
+{
+    key->proto = 0;
+    key->daddr_min = 0;
+    key->daddr_max = UINT32_MAX;
+    key->dport_min = 0;
+    key->dport_max = UINT16_MAX;
+
+    if (cls->ops->key)
+        cls->ops->key(cls, key);
+}
+
+static inline bool cls_key_exact(const struct tc_cls_key *key)
+{
+    return (key->proto == IPPROTO_TCP || key->proto == IPPROTO_UDP) &&
+           key->daddr_min == key->daddr_max &&
+           key->dport_min == key->dport_max;
+}
+
+static inline uint32_t cls_hash(uint32_t daddr, uint16_t dport, uint8_t proto)
+{
+    return rte_jhash_3words(daddr, dport, proto, 0);
+}
+
+static int cls_bound_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static struct tc_cls_table *cls_table_build(struct Qsch *sch)
+{
+    int i, j, s, n = sch->cls_cnt, nh = 0, nbounds = 0, nsegs;
+    struct tc_cls_table *tbl = NULL;
+    struct tc_cls_key *keys;
+    uint32_t *bounds, nbkts, b;
+    struct tc_cls *cls;
+    size_t size;
+    char *p;
+
+    keys = rte_malloc(NULL, n * sizeof(*keys), 0);
+    bounds = rte_malloc(NULL, (2 * n + 1) * sizeof(*bounds), 0);
+    if (!keys || !bounds)
+        goto out;
+
+    bounds[nbounds++] = 0;
+    i = 0;
+    list_for_each_entry(cls, &sch->cls_list, list) {
+        cls_get_key(cls, &keys[i]);
+        if (cls_key_exact(&keys[i])) {
+            nh++;
+        } else {
+            if (keys[i].daddr_min)
+                bounds[nbounds++] = keys[i].daddr_min;
+            if (keys[i].daddr_max != UINT32_MAX)
+                bounds[nbounds++] = keys[i].daddr_max + 1;
+        }
+        i++;
+    }
+
+    qsort(bounds, nbounds, sizeof(*bounds), cls_bound_cmp);
+    for (nsegs = 1, i = 1; i < nbounds; i++) {
+        if (bounds[i] != bounds[nsegs - 1])
+            bounds[nsegs++] = bounds[i];
+    }
+
+    nbkts = rte_align32pow2(nh ? nh : 1);
+
+    size = sizeof(*tbl)
+         + n * sizeof(struct tc_cls *)
+         + nsegs * ((n + 63) / 64) * sizeof(uint64_t)
+         + nh * sizeof(struct cls_hent)
+         + (nbkts + 1) * sizeof(uint32_t)
+         + nsegs * sizeof(uint32_t);
+
+    tbl = rte_zmalloc(NULL, size, RTE_CACHE_LINE_SIZE);
+    if (!tbl)
+        goto out;
+
+    tbl->nrules = n;
+    tbl->hmask = nbkts - 1;
+    tbl->nsegs = nsegs;
+    tbl->nwords = (n + 63) / 64;
+
+    p = (char *)(tbl + 1);
+    tbl->rules = (struct tc_cls **)p;
+    p += n * sizeof(struct tc_cls *);
+    tbl->bitmaps = (uint64_t *)p;
+    p += nsegs * tbl->nwords * sizeof(uint64_t);
+    tbl->hents = (struct cls_hent *)p;
+    p += nh * sizeof(struct cls_hent);
+    tbl->hbkts = (uint32_t *)p;
+    p += (nbkts + 1) * sizeof(uint32_t);
+    tbl->bounds = (uint32_t *)p;
+    memcpy(tbl->bounds, bounds, nsegs * sizeof(uint32_t));
+
+    i = 0;
+    list_for_each_entry(cls, &sch->cls_list, list)
+        tbl->rules[i++] = cls;
+
+    /* counting sort by bucket, stable so each bucket is in priority order */
+    for (i = 0; i < n; i++) {
+        if (cls_key_exact(&keys[i])) {
+            b = cls_hash(keys[i].daddr_min, keys[i].dport_min, keys[i].proto);
+            tbl->hbkts[(b & tbl->hmask) + 1]++;
+        }
+    }
+    for (b = 0; b < nbkts; b++)
+        tbl->hbkts[b + 1] += tbl->hbkts[b];
+
+    for (i = 0; i < n; i++) {
+        if (cls_key_exact(&keys[i])) {
+            b = cls_hash(keys[i].daddr_min, keys[i].dport_min, keys[i].proto);
+            /* hbkts[b] is used as cursor and restored below */
+            j = tbl->hbkts[b & tbl->hmask]++;
+            tbl->hents[j].daddr = keys[i].daddr_min;
+            tbl->hents[j].dport = keys[i].dport_min;
+            tbl->hents[j].proto = keys[i].proto;
+            tbl->hents[j].idx = i;
+            continue;
+        }
+
+        for (s = 0; s < nsegs; s++) {
+            if (tbl->bounds[s] >= keys[i].daddr_min &&
+                tbl->bounds[s] <= keys[i].daddr_max)
+                tbl->bitmaps[s * tbl->nwords + i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    for (b = nbkts; b > 0; b--)
+        tbl->hbkts[b] = tbl->hbkts[b - 1];
+    tbl->hbkts[0] = 0;
+
+out:
+    if (keys)
+        rte_free(keys);
+    if (bounds)
+        rte_free(bounds);
+    return tbl;
+}
+
+static int cls_table_expire(void *arg)
+{
+    rte_free(arg);
+    return DTIMER_STOP;
+}
+
+void tc_cls_compile(struct Qsch *sch)
+{
+    struct tc_cls_table *old = sch->cls_tbl, *tbl = NULL;
+    struct timeval delay = { CLS_TBL_FREE_DELAY, 0 };
+
+    if (sch->cls_cnt) {
+        tbl = cls_table_build(sch);
+        if (!tbl)
+            RTE_LOG(WARNING, TC, "%s: no memory, classify linearly.\n",
+                    __func__);
+    }
+
+    rte_wmb();
+    sch->cls_tbl = tbl;
+
+    if (old && dpvs_timer_sched(&old->timer, &delay, cls_table_expire,
+                                old, true) != EDPVS_OK)
+        rte_free(old);
+}
+
+void tc_cls_table_free(struct Qsch *sch)
+{
+    if (sch->cls_tbl) {
+        rte_free(sch->cls_tbl);
+        sch->cls_tbl = NULL;
+    }
+}
+
+static void tc_cls_parse(struct rte_mbuf *mbuf, struct tc_cls_pkt *pkt)
+{
+    struct ether_hdr *eh = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    int offset = sizeof(*eh);
+    struct iphdr *iph;
+    struct tcphdr *th;
+    struct udphdr *uh;
+
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->parsed = true;
+    pkt->l3_type = ntohs(eh->ether_type);
+
+    if (pkt->l3_type == ETH_P_8021Q) {
+        if (mbuf_may_pull(mbuf, sizeof(struct vlan_ethhdr)) != 0)
+            return;
+        pkt->l3_type = ntohs(rte_pktmbuf_mtod(mbuf, struct vlan_ethhdr *)
+                             ->h_vlan_encapsulated_proto);
+        offset += VLAN_HLEN;
+    }
+
+    if (pkt->l3_type != ETH_P_IP)
+        return;
+
+    if (mbuf_may_pull(mbuf, offset + sizeof(struct iphdr)) != 0) {
+        pkt->l3_trunc = true;
+        return;
+    }
+
+    iph = rte_pktmbuf_mtod_offset(mbuf, struct iphdr *, offset);
+    pkt->iph = iph;
+    pkt->saddr = ntohl(iph->saddr);
+    pkt->daddr = ntohl(iph->daddr);
+    pkt->proto = iph->protocol;
+    offset += (iph->ihl << 2);
+
+    switch (iph->protocol) {
+    case IPPROTO_TCP:
+        if (mbuf_may_pull(mbuf, offset + sizeof(struct tcphdr)) != 0) {
+            pkt->l4_trunc = true;
+            break;
+        }
+        th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, offset);
+        pkt->sport = ntohs(th->source);
+        pkt->dport = ntohs(th->dest);
+        break;
+
+    case IPPROTO_UDP:
+        if (mbuf_may_pull(mbuf, offset + sizeof(struct udphdr)) != 0) {
+            pkt->l4_trunc = true;
+            break;
+        }
+        uh = rte_pktmbuf_mtod_offset(mbuf, struct udphdr *, offset);
+        pkt->sport = ntohs(uh->source);
+        pkt->dport = ntohs(uh->dest);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static inline int cls_try(struct tc_cls *cls, struct rte_mbuf *mbuf,
+                          uint16_t pkt_type, struct tc_cls_pkt *pkt,
+                          struct tc_cls_result *result)
+{
+    int err;
+
+    if (pkt_type != cls->pkt_type && cls->pkt_type != ETH_P_ALL)
+        return TC_ACT_RECLASSIFY;
+
+    err = cls->ops->classify(cls, mbuf, pkt, result);
+    if (err != TC_ACT_OK && err != TC_ACT_SHOT)
+        return TC_ACT_RECLASSIFY;
+
+    return err;
+}
+
+/* without compiled table */
+static int cls_classify_list(struct Qsch *sch, struct rte_mbuf *mbuf,
+                             uint16_t pkt_type, struct tc_cls_pkt *pkt,
+                             int *pos, struct tc_cls_result *result)
+{
+    struct tc_cls *cls;
+    int i = 0, err;
+
+    list_for_each_entry(cls, &sch->cls_list, list) {
+        if (i++ < *pos)
+            continue;
+
+        err = cls_try(cls, mbuf, pkt_type, pkt, result);
+        if (err != TC_ACT_RECLASSIFY) {
+            *pos = i - 1;
+            return err;
+        }
+    }
+
+    return TC_ACT_RECLASSIFY;
+}
+
+static inline int cls_table_seg(const struct tc_cls_table *tbl, uint32_t addr)
+{
+    int lo = 0, hi = tbl->nsegs - 1, mid;
+
+    /* last interval with lower bound <= @addr, bounds[0] is 0 */
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (tbl->bounds[mid] <= addr)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return lo;
+}
+
+static inline int cls_hash_next(const struct tc_cls_table *tbl, uint32_t b,
+                                const struct tc_cls_pkt *pkt, int from)
+{
+    const struct cls_hent *e;
+    uint32_t k;
+
+    for (k = tbl->hbkts[b]; k < tbl->hbkts[b + 1]; k++) {
+        e = &tbl->hents[k];
+        if (e->idx >= from && e->daddr == pkt->daddr &&
+            e->dport == pkt->dport && e->proto == pkt->proto)
+            return e->idx;
+    }
+
+    return tbl->nrules;
+}
+
+static inline int cls_range_next(const struct tc_cls_table *tbl,
+                                 const uint64_t *bitmap, int from)
+{
+    int w = from / 64;
+    uint64_t word;
+
+    if (w >= tbl->nwords)
+        return tbl->nrules;
+
+    word = bitmap[w] & (~0ULL << (from % 64));
+    while (!word) {
+        if (++w >= tbl->nwords)
+            return tbl->nrules;
+        word = bitmap[w];
+    }
+
+    return w * 64 + __builtin_ctzll(word);
+}
+
+int tc_classify(struct Qsch *sch, struct rte_mbuf *mbuf, uint16_t pkt_type,
+                struct tc_cls_pkt *pkt, int *pos,
+                struct tc_cls_result *result)
+{
+    struct tc_cls_table *tbl = sch->cls_tbl;
+    const uint64_t *bitmap = NULL;
+    bool hashed = false;
+    uint32_t b = 0;
+    int i, h, err;
+
+    if (!sch->cls_cnt)
+        return TC_ACT_RECLASSIFY;
+
+    if (!pkt->parsed)
+        tc_cls_parse(mbuf, pkt);
+
+    if (unlikely(!tbl))
+        return cls_classify_list(sch, mbuf, pkt_type, pkt, pos, result);
+
+    /* packets not well parsed are tried by all classifiers */
+    if (pkt->l3_type == ETH_P_IP && !pkt->l3_trunc && !pkt->l4_trunc) {
+        bitmap = &tbl->bitmaps[cls_table_seg(tbl, pkt->daddr) * tbl->nwords];
+
+        if (pkt->proto == IPPROTO_TCP || pkt->proto == IPPROTO_UDP) {
+            hashed = true;
+            b = cls_hash(pkt->daddr, pkt->dport, pkt->proto) & tbl->hmask;
+        }
+    }
+
+    for (i = *pos; i < tbl->nrules; i++) {
+        if (bitmap) {
+            h = hashed ? cls_hash_next(tbl, b, pkt, i) : tbl->nrules;
+            i = RTE_MIN(h, cls_range_next(tbl, bitmap, i));
+            if (i >= tbl->nrules)
+                break;
+        }
+
+        err = cls_try(tbl->rules[i], mbuf, pkt_type, pkt, result);
+        if (err != TC_ACT_RECLASSIFY) {
+            *pos = i;
+            return err;
+        }
+    }
+
+    return TC_ACT_RECLASSIFY;
+}
@@ -22,16 +22,20 @@
  */
 #include <netinet/in.h>
 #include <netinet/ip.h>
-#include <netinet/tcp.h>
-#include <netinet/udp.h>
 #include "netif.h"
+#include "ipv4.h"
 #include "match.h"
-#include "vlan.h"
 #include "tc/tc.h"
 #include "tc/sch.h"
 #include "tc/cls.h"
 #include "conf/tc.h"
 
+/* police token bucket of each lcore, in time like tbf */
+struct match_police_bucket {
+    int64_t                 tokens;
+    int64_t                 t_c;        /* time check-point */
+} __rte_cache_aligned;
+
 struct match_cls_priv {
     struct tc_cls           *cls;
 
@@ -39,141 +43,127 @@ struct match_cls_priv {
     struct dp_vs_match      match;
 
     struct tc_cls_result    result;
+
+    /* compiled from @match, ranges in host order */
+    int                     iif;        /* port id, -1 for any */
+    int                     oif;
+    uint32_t                saddr_min;
+    uint32_t                saddr_max;
+    uint16_t                sport_min;
+    uint16_t                sport_max;
+    struct tc_cls_key       key;        /* proto, daddr and dport */
+
+    /* packets of a flow may reach any lcore (RSS), each lcore polices
+     * with an even share of the rate to avoid locking the bucket. */
+    struct tc_cls_police    police;
+    struct qsch_rate        rate;       /* per-lcore share */
+    int64_t                 buffer;     /* bucket depth, in time */
+    struct match_police_bucket buckets[RTE_MAX_LCORE];
 };
 
+static int match_police(struct tc_cls *cls, struct rte_mbuf *mbuf,
+                        struct iphdr *iph)
+{
+    struct match_cls_priv *priv = tc_cls_priv(cls);
+    struct match_police_bucket *b = &priv->buckets[rte_lcore_id()];
+    int64_t now, toks;
+    uint8_t tos;
+
+    now = tc_get_ns();
+    toks = min_t(int64_t, now - b->t_c, priv->buffer) + b->tokens;
+    if (toks > priv->buffer)
+        toks = priv->buffer;
+    toks -= (int64_t)qsch_l2t_ns(&priv->rate, mbuf->pkt_len);
+
+    if (toks >= 0) {
+        b->t_c = now;
+        b->tokens = toks;
+        return TC_ACT_OK;
+    }
+
+    cls->sch->this_qstats.overlimits++;
+
+    if (priv->police.exceed != TC_POLICE_EXCEED_MARK)
+        return TC_ACT_SHOT;
+
+    tos = (priv->police.dscp << 2) | (iph->tos & 0x3);
+    if (iph->tos != tos) {
+        iph->tos = tos;
+        ip4_send_csum((struct ipv4_hdr *)iph);
+    }
+
+    return TC_ACT_OK;
+}
+
 static int match_classify(struct tc_cls *cls, struct rte_mbuf *mbuf,
+                          struct tc_cls_pkt *pkt,
                           struct tc_cls_result *result)
 {
     struct match_cls_priv *priv = tc_cls_priv(cls);
-    struct dp_vs_match *m = &priv->match;
-    struct ether_hdr *eh = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
-    struct iphdr *iph = NULL;
-    struct tcphdr *th;
-    struct udphdr *uh;
-    int offset = sizeof(*eh);
-    __be16 pkt_type = eh->ether_type;
-    __be16 sport, dport;
-    struct netif_port *idev, *odev;
-    struct vlan_ethhdr *veh;
     int err = TC_ACT_RECLASSIFY; /* by default */
 
-    idev = netif_port_get_by_name(m->iifname);
-    odev = netif_port_get_by_name(m->oifname);
-    sport = dport = 0;
-
-    /* check input device for ingress */
-    if (idev && (cls->sch->flags & QSCH_F_INGRESS)) {
-        if (idev->id != mbuf->port)
+    /* check input device for ingress, or output device for egress */
+    if (cls->sch->flags & QSCH_F_INGRESS) {
+        if (priv->iif >= 0 && priv->iif != mbuf->port)
             goto done;
-    }
-
-    /* check output device for egress */
-    if (odev && !(cls->sch->flags & QSCH_F_INGRESS)) {
-        if (odev->id != mbuf->port)
+    } else {
+        if (priv->oif >= 0 && priv->oif != mbuf->port)
             goto done;
     }
 
     /* support IPv4 and 802.1q/IPv4 */
-l2parse:
-    switch (ntohs(pkt_type)) {
-    case ETH_P_IP:
-        if (mbuf_may_pull(mbuf, offset + sizeof(struct iphdr)) != 0) {
-            err = TC_ACT_SHOT;
-            goto done;
-        }
-
-        iph = rte_pktmbuf_mtod_offset(mbuf, struct iphdr *, offset);
-
-        /* check if source/dest IP in range */
-        if (m->srange.max_addr.in.s_addr != htonl(INADDR_ANY)) {
-            if (ntohl(iph->saddr) < ntohl(m->srange.min_addr.in.s_addr) ||
-                ntohl(iph->saddr) > ntohl(m->srange.max_addr.in.s_addr))
-                goto done;
-        }
-
-        if (m->drange.max_addr.in.s_addr != htonl(INADDR_ANY)) {
-            if (ntohl(iph->daddr) < ntohl(m->drange.min_addr.in.s_addr) ||
-                ntohl(iph->daddr) > ntohl(m->drange.max_addr.in.s_addr))
-                goto done;
-        }
-
-        offset += (iph->ihl << 2);
-        break;
-
-    case ETH_P_8021Q:
-        veh = (struct vlan_ethhdr *)eh;
-        pkt_type = veh->h_vlan_encapsulated_proto;
-        offset += VLAN_HLEN;
-        goto l2parse;
+    if (pkt->l3_type != ETH_P_IP)
+        goto done;
 
-    default:
+    if (pkt->l3_trunc) {
+        err = TC_ACT_SHOT;
         goto done;
     }
 
-    /* check if protocol matches */
-    if (priv->proto && priv->proto != iph->protocol)
+    /* check if source/dest IP in range */
+    if (pkt->saddr < priv->saddr_min || pkt->saddr > priv->saddr_max ||
+        pkt->daddr < priv->key.daddr_min || pkt->daddr > priv->key.daddr_max)
         goto done;
 
-    switch (iph->protocol) {
-    case IPPROTO_TCP:
-        if (mbuf_may_pull(mbuf, offset + sizeof(struct tcphdr)) != 0) {
-            err = TC_ACT_SHOT;
-            goto done;
-        }
-
-        th = rte_pktmbuf_mtod_offset(mbuf, struct tcphdr *, offset);
-        sport = th->source;
-        dport = th->dest;
-        break;
+    /* check if protocol matches */
+    if (priv->proto && priv->proto != pkt->proto)
+        goto done;
 
-    case IPPROTO_UDP:
-        if (mbuf_may_pull(mbuf, offset + sizeof(struct udphdr)) != 0) {
+    /* check if source/dest port in range, tcp and udp only */
+    if (pkt->proto == IPPROTO_TCP || pkt->proto == IPPROTO_UDP) {
+        if (pkt->l4_trunc) {
             err = TC_ACT_SHOT;
             goto done;
         }
 
-        uh = rte_pktmbuf_mtod_offset(mbuf, struct udphdr *, offset);
-        sport = uh->source;
-        dport = uh->dest;
-        break;
-
-    default: /* priv->proto is not assigned */
-        goto match;
-    }
-
-    /* check if source/dest port in range */
-    if (m->srange.max_port) {
-        if (ntohs(sport) < ntohs(m->srange.min_port) ||
-            ntohs(sport) > ntohs(m->srange.max_port))
-            goto done;
-    }
-
-    if (m->drange.max_port) {
-        if (ntohs(dport) < ntohs(m->drange.min_port) ||
-            ntohs(dport) > ntohs(m->drange.max_port))
+        if (pkt->sport < priv->sport_min || pkt->sport > priv->sport_max ||
+            pkt->dport < priv->key.dport_min || pkt->dport > priv->key.dport_max)
             goto done;
     }
 
-match:
     /* all matchs */
     *result = priv->result;
     err = TC_ACT_OK;
 
+    if (priv->police.rate)
+        err = match_police(cls, mbuf, pkt->iph);
+
 done:
 #if defined(CONFIG_TC_DEBUG)
-    if (iph) {
+    if (pkt->iph) {
         char sip[64], dip[64];
         char cls_id[16], qsch_id[16];
 
-        inet_ntop(AF_INET, &iph->saddr, sip, sizeof(sip));
-        inet_ntop(AF_INET, &iph->daddr, dip, sizeof(dip));
+        inet_ntop(AF_INET, &pkt->iph->saddr, sip, sizeof(sip));
+        inet_ntop(AF_INET, &pkt->iph->daddr, dip, sizeof(dip));
         tc_handle_itoa(cls->handle, cls_id, sizeof(cls_id));
         tc_handle_itoa(priv->result.sch_id, qsch_id, sizeof(qsch_id));
 
         RTE_LOG(DEBUG, TC, "cls %s %s %s:%u -> %s:%u %s %s\n",
-                cls_id, inet_proto_name(iph->protocol),
-                sip, sport, dip, dport,
-                (err == TC_ACT_OK ? "target" : "miss"),
+                cls_id, inet_proto_name(pkt->proto),
+                sip, pkt->sport, dip, pkt->dport,
+                (err == TC_ACT_OK ? "target" :
+                    (err == TC_ACT_SHOT ? "shot" : "miss")),
                 (err == TC_ACT_OK ? \
                     (priv->result.drop ? "drop" : qsch_id) : ""));
     }
@@ -182,13 +172,109 @@ done:
     return err;
 }
 
+static void match_key(struct tc_cls *cls, struct tc_cls_key *key)
+{
+    struct match_cls_priv *priv = tc_cls_priv(cls);
+
+    *key = priv->key;
+}
+
+/* resolve devices and convert ranges to host order, on config only */
+static void match_compile(struct match_cls_priv *priv)
+{
+    const struct dp_vs_match *m = &priv->match;
+    struct netif_port *dev;
+
+    /* device not exist is not checked */
+    dev = netif_port_get_by_name(m->iifname);
+    priv->iif = dev ? dev->id : -1;
+    dev = netif_port_get_by_name(m->oifname);
+    priv->oif = dev ? dev->id : -1;
+
+    priv->key.proto = priv->proto;
+
+    if (m->srange.max_addr.in.s_addr != htonl(INADDR_ANY)) {
+        priv->saddr_min = ntohl(m->srange.min_addr.in.s_addr);
+        priv->saddr_max = ntohl(m->srange.max_addr.in.s_addr);
+    } else {
+        priv->saddr_min = 0;
+        priv->saddr_max = UINT32_MAX;
+    }
+
+    if (m->drange.max_addr.in.s_addr != htonl(INADDR_ANY)) {
+        priv->key.daddr_min = ntohl(m->drange.min_addr.in.s_addr);
+        priv->key.daddr_max = ntohl(m->drange.max_addr.in.s_addr);
+    } else {
+        priv->key.daddr_min = 0;
+        priv->key.daddr_max = UINT32_MAX;
+    }
+
+    if (m->srange.max_port) {
+        priv->sport_min = ntohs(m->srange.min_port);
+        priv->sport_max = ntohs(m->srange.max_port);
+    } else {
+        priv->sport_min = 0;
+        priv->sport_max = UINT16_MAX;
+    }
+
+    if (m->drange.max_port) {
+        priv->key.dport_min = ntohs(m->drange.min_port);
+        priv->key.dport_max = ntohs(m->drange.max_port);
+    } else {
+        priv->key.dport_min = 0;
+        priv->key.dport_max = UINT16_MAX;
+    }
+}
+
+static int match_police_init(struct tc_cls *cls,
+                             const struct tc_cls_police *police)
+{
+    struct match_cls_priv *priv = tc_cls_priv(cls);
+    struct qsch_rate rate = {};
+    uint8_t nlcores;
+
+    if (!police->rate) {
+        memset(&priv->police, 0, sizeof(priv->police));
+        return EDPVS_OK;
+    }
+
+    if (police->exceed > TC_POLICE_EXCEED_MARK || police->dscp > 63)
+        return EDPVS_INVAL;
+
+    netif_get_slave_lcores(&nlcores, NULL);
+    if (!nlcores)
+        nlcores = 1;
+
+    /* each lcore's bucket must hold a full sized frame at least */
+    if (police->burst / nlcores < ETHER_MAX_LEN)
+        return EDPVS_INVAL;
+
+    rate.rate_bytes_ps = (uint64_t)police->rate / 8;
+    priv->buffer = qsch_l2t_ns(&rate, police->burst);
+    priv->rate.rate_bytes_ps = rate.rate_bytes_ps / nlcores;
+    if (!priv->rate.rate_bytes_ps)
+        return EDPVS_INVAL;
+
+    priv->police = *police;
+    memset(priv->buckets, 0, sizeof(priv->buckets));
+
+    return EDPVS_OK;
+}
+
 static int match_init(struct tc_cls *cls, const void *arg)
 {
     struct match_cls_priv *priv = tc_cls_priv(cls);
     const struct tc_cls_match_copt *copt = arg;
+    int err;
 
-    if (!arg)
+    if (!arg) {
+        match_compile(priv);
         return EDPVS_OK;
+    }
+
+    err = match_police_init(cls, &copt->police);
+    if (err != EDPVS_OK)
+        return err;
 
     if (copt->proto)
         priv->proto = copt->proto;
@@ -229,6 +315,7 @@ static int match_init(struct tc_cls *cls, const void *arg)
         }
     }
 
+    match_compile(priv);
     return EDPVS_OK;
 }
 
@@ -240,6 +327,7 @@ static int match_dump(struct tc_cls *cls, void *arg)
     copt->proto = priv->proto;
     copt->match = priv->match;
     copt->result = priv->result;
+    copt->police = priv->police;
 
     return EDPVS_OK;
 }
@@ -248,6 +336,7 @@ struct tc_cls_ops match_cls_ops = {
     .name       = "match",
     .priv_size  = sizeof(struct match_cls_priv),
     .classify   = match_classify,
+    .key        = match_key,
     .init       = match_init,
     .change     = match_init,
     .dump       = match_dump,
@@ -0,0 +1,552 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * the Fair Queuing Controlled Delay scheduler of traffic control module.
+ * see linux/net/sched/sch_fq_codel.c and RFC 8289, RFC 8290.
+ *
+ * packets are hashed to flow queues and served by DRR, new flows first.
+ * every flow queue is managed by CoDel according to the sojourn time.
+ *
+ * each lcore has its own flows, so no lock is needed on datapath. mbufs
+ * are linked by mbuf->userdata and stamped (TSC) by mbuf->timestamp,
+ * nothing is allocated per packet.
+ */
+#include <assert.h>
+#include <rte_jhash.h>
+#include "netif.h"
+#include "ipv4.h"
+#include "tc/tc.h"
+#include "tc/sch.h"
+#include "conf/tc.h"
+
+#define FQ_CODEL_LIMIT_DEF      1024        /* packets */
+#define FQ_CODEL_FLOWS_DEF      1024
+#define FQ_CODEL_TARGET_DEF     5000        /* us */
+#define FQ_CODEL_INTERVAL_DEF   100000      /* us */
+
+extern struct Qsch_ops fq_codel_sch_ops;
+
+struct fq_codel_flow {
+    struct rte_mbuf         *head;
+    struct rte_mbuf         *tail;
+    struct list_head        list;       /* new_flows or old_flows */
+    int32_t                 deficit;
+    uint32_t                backlog;    /* bytes */
+
+    /* codel variables */
+    uint32_t                count;      /* packets dropped since dropping */
+    uint32_t                lastcount;
+    bool                    dropping;
+    uint64_t                first_above_time;
+    uint64_t                drop_next;
+};
+
+struct fq_codel_lcore {
+    struct list_head        new_flows;
+    struct list_head        old_flows;
+    uint32_t                qlen;
+    uint32_t                backlog;
+    /* fattest flow seen, dropped from on overlimit */
+    struct fq_codel_flow    *fat;
+    struct fq_codel_flow    flows[0];
+} __rte_cache_aligned;
+
+struct fq_codel_sch_priv {
+    uint32_t                flows;
+    uint32_t                quantum;
+    uint32_t                target_us;
+    uint32_t                interval_us;
+    uint64_t                target;     /* cycles */
+    uint64_t                interval;   /* cycles */
+    uint32_t                mtu;
+    uint32_t                perturb;
+
+    struct fq_codel_lcore   *lcores[RTE_MAX_LCORE];
+};
+
+static uint32_t fq_codel_hash(const struct fq_codel_sch_priv *priv,
+                              struct rte_mbuf *mbuf)
+{
+    struct ether_hdr *eh = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    uint32_t off = sizeof(struct ether_hdr);
+    uint32_t saddr, daddr, ports = 0;
+    uint16_t type = ntohs(eh->ether_type);
+    uint8_t proto;
+
+    if (type == ETHER_TYPE_VLAN) {
+        struct vlan_hdr *vh;
+
+        if (mbuf_may_pull(mbuf, off + sizeof(*vh)) != 0)
+            return 0;
+        vh = rte_pktmbuf_mtod_offset(mbuf, struct vlan_hdr *, off);
+        type = ntohs(vh->eth_proto);
+        off += sizeof(*vh);
+    }
+
+    switch (type) {
+    case ETHER_TYPE_IPv4: {
+        struct ipv4_hdr *iph;
+
+        if (mbuf_may_pull(mbuf, off + sizeof(*iph)) != 0)
+            return 0;
+        iph = rte_pktmbuf_mtod_offset(mbuf, struct ipv4_hdr *, off);
+        saddr = iph->src_addr;
+        daddr = iph->dst_addr;
+        proto = ip4_is_frag(iph) ? 0 : iph->next_proto_id;
+        off += (iph->version_ihl & IPV4_HDR_IHL_MASK) << 2;
+        break;
+    }
+    case ETHER_TYPE_IPv6: {
+        struct ipv6_hdr *ip6h;
+        const uint32_t *s, *d;
+
+        if (mbuf_may_pull(mbuf, off + sizeof(*ip6h)) != 0)
+            return 0;
+        ip6h = rte_pktmbuf_mtod_offset(mbuf, struct ipv6_hdr *, off);
+        s = (const uint32_t *)ip6h->src_addr;
+        d = (const uint32_t *)ip6h->dst_addr;
+        saddr = s[0] ^ s[1] ^ s[2] ^ s[3];
+        daddr = d[0] ^ d[1] ^ d[2] ^ d[3];
+        proto = ip6h->proto;
+        off += sizeof(*ip6h);
+        break;
+    }
+    default:
+        /* non-ip packets share one flow */
+        return 0;
+    }
+
+    if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP)
+            && mbuf_may_pull(mbuf, off + sizeof(ports)) == 0)
+        ports = *rte_pktmbuf_mtod_offset(mbuf, uint32_t *, off);
+
+    return rte_jhash_3words(saddr, daddr, ports, priv->perturb ^ proto);
+}
+
+static inline struct fq_codel_flow *
+fq_codel_classify(const struct fq_codel_sch_priv *priv,
+                  struct fq_codel_lcore *lc, struct rte_mbuf *mbuf)
+{
+    uint32_t hash = fq_codel_hash(priv, mbuf);
+
+    return &lc->flows[((uint64_t)hash * priv->flows) >> 32];
+}
+
+static inline void flow_enqueue_tail(struct Qsch *sch,
+                                     struct fq_codel_lcore *lc,
+                                     struct fq_codel_flow *flow,
+                                     struct rte_mbuf *mbuf)
+{
+    mbuf->userdata = NULL;
+    if (flow->tail)
+        flow->tail->userdata = mbuf;
+    else
+        flow->head = mbuf;
+    flow->tail = mbuf;
+
+    flow->backlog += mbuf->pkt_len;
+    lc->qlen++;
+    lc->backlog += mbuf->pkt_len;
+
+    sch->this_q.qlen++;
+    sch->this_qstats.qlen++;
+    sch->this_qstats.backlog += mbuf->pkt_len;
+}
+
+static inline struct rte_mbuf *flow_dequeue_head(struct Qsch *sch,
+                                                 struct fq_codel_lcore *lc,
+                                                 struct fq_codel_flow *flow)
+{
+    struct rte_mbuf *mbuf = flow->head;
+
+    if (!mbuf)
+        return NULL;
+
+    flow->head = mbuf->userdata;
+    if (!flow->head)
+        flow->tail = NULL;
+    mbuf->userdata = NULL;
+
+    flow->backlog -= mbuf->pkt_len;
+    lc->qlen--;
+    lc->backlog -= mbuf->pkt_len;
+
+    sch->this_q.qlen--;
+    sch->this_qstats.qlen--;
+    sch->this_qstats.backlog -= mbuf->pkt_len;
+
+    return mbuf;
+}
+
+/* square root for codel control law, @x > 0 */
+static inline uint32_t codel_sqrt(uint32_t x)
+{
+    uint32_t res = 0, bit = 1U << 30;
+
+    while (bit > x)
+        bit >>= 2;
+
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return res ? : 1;
+}
+
+static inline uint64_t codel_control_law(uint64_t t, uint64_t interval,
+                                         uint32_t count)
+{
+    return t + interval / codel_sqrt(count);
+}
+
+static bool codel_should_drop(const struct fq_codel_sch_priv *priv,
+                              const struct fq_codel_lcore *lc,
+                              struct fq_codel_flow *flow,
+                              const struct rte_mbuf *mbuf, uint64_t now)
+{
+    if (!mbuf) {
+        flow->first_above_time = 0;
+        return false;
+    }
+
+    /* no drop if less than one MTU is queued, see RFC 8289 */
+    if (now - mbuf->timestamp < priv->target || lc->backlog <= priv->mtu) {
+        flow->first_above_time = 0;
+        return false;
+    }
+
+    if (!flow->first_above_time) {
+        flow->first_above_time = now + priv->interval;
+        return false;
+    }
+
+    return now >= flow->first_above_time;
+}
+
+static struct rte_mbuf *codel_dequeue(struct Qsch *sch,
+                                      struct fq_codel_lcore *lc,
+                                      struct fq_codel_flow *flow)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    uint64_t now = rte_get_tsc_cycles();
+    struct rte_mbuf *mbuf;
+    uint32_t delta;
+    bool drop;
+
+    mbuf = flow_dequeue_head(sch, lc, flow);
+    if (!mbuf) {
+        flow->dropping = false;
+        return NULL;
+    }
+
+    drop = codel_should_drop(priv, lc, flow, mbuf, now);
+
+    if (flow->dropping) {
+        if (!drop) {
+            flow->dropping = false;
+            return mbuf;
+        }
+
+        while (flow->dropping && now >= flow->drop_next) {
+            qsch_drop(sch, mbuf);
+            flow->count++;
+
+            mbuf = flow_dequeue_head(sch, lc, flow);
+            if (!codel_should_drop(priv, lc, flow, mbuf, now))
+                flow->dropping = false;
+            else
+                flow->drop_next = codel_control_law(flow->drop_next,
+                                                    priv->interval,
+                                                    flow->count);
+        }
+    } else if (drop) {
+        qsch_drop(sch, mbuf);
+
+        mbuf = flow_dequeue_head(sch, lc, flow);
+        codel_should_drop(priv, lc, flow, mbuf, now);
+        flow->dropping = true;
+
+        /* resume the drop rate if dropping was entered recently */
+        delta = flow->count - flow->lastcount;
+        if (delta > 1 && (int64_t)(now - flow->drop_next)
+                < (int64_t)(16 * priv->interval))
+            flow->count = delta;
+        else
+            flow->count = 1;
+        flow->lastcount = flow->count;
+        flow->drop_next = codel_control_law(now, priv->interval, flow->count);
+    }
+
+    return mbuf;
+}
+
+static int fq_codel_enqueue(struct Qsch *sch, struct rte_mbuf *mbuf)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    struct fq_codel_lcore *lc = priv->lcores[rte_lcore_id()];
+    struct fq_codel_flow *flow;
+
+    if (unlikely(!lc))
+        return qsch_drop(sch, mbuf);
+
+    flow = fq_codel_classify(priv, lc, mbuf);
+
+    mbuf->timestamp = rte_get_tsc_cycles();
+    flow_enqueue_tail(sch, lc, flow, mbuf);
+
+    if (list_empty(&flow->list)) {
+        list_add_tail(&flow->list, &lc->new_flows);
+        flow->deficit = priv->quantum;
+    }
+
+    if (!lc->fat || flow->backlog > lc->fat->backlog)
+        lc->fat = flow;
+
+    if (likely(lc->qlen <= sch->limit))
+        return EDPVS_OK;
+
+    /* drop from the fattest flow instead of scanning all flows */
+    mbuf = flow_dequeue_head(sch, lc, lc->fat->head ? lc->fat : flow);
+    qsch_drop(sch, mbuf);
+    if (!lc->fat->head)
+        lc->fat = flow;
+
+    return EDPVS_OK;
+}
+
+static struct rte_mbuf *fq_codel_dequeue(struct Qsch *sch)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    struct fq_codel_lcore *lc = priv->lcores[rte_lcore_id()];
+    struct fq_codel_flow *flow;
+    struct list_head *head;
+    struct rte_mbuf *mbuf;
+
+    if (unlikely(!lc) || !sch->this_q.qlen)
+        return NULL;
+
+again:
+    head = &lc->new_flows;
+    if (list_empty(head)) {
+        head = &lc->old_flows;
+        if (list_empty(head))
+            return NULL;
+    }
+
+    flow = list_first_entry(head, struct fq_codel_flow, list);
+
+    if (flow->deficit <= 0) {
+        flow->deficit += priv->quantum;
+        list_move_tail(&flow->list, &lc->old_flows);
+        goto again;
+    }
+
+    mbuf = codel_dequeue(sch, lc, flow);
+    if (!mbuf) {
+        /* force a pass through old_flows to prevent starvation */
+        if (head == &lc->new_flows && !list_empty(&lc->old_flows))
+            list_move_tail(&flow->list, &lc->old_flows);
+        else
+            list_del_init(&flow->list);
+        goto again;
+    }
+
+    flow->deficit -= mbuf->pkt_len;
+    sch->this_bstats.packets++;
+    sch->this_bstats.bytes += mbuf->pkt_len;
+
+    return mbuf;
+}
+
+static struct rte_mbuf *fq_codel_peek(struct Qsch *sch)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    struct fq_codel_lcore *lc = priv->lcores[rte_lcore_id()];
+    struct list_head *head;
+
+    if (unlikely(!lc))
+        return NULL;
+
+    head = list_empty(&lc->new_flows) ? &lc->old_flows : &lc->new_flows;
+    if (list_empty(head))
+        return NULL;
+
+    return list_first_entry(head, struct fq_codel_flow, list)->head;
+}
+
+static void fq_codel_lcore_init(struct fq_codel_lcore *lc, uint32_t nflows)
+{
+    uint32_t i;
+
+    INIT_LIST_HEAD(&lc->new_flows);
+    INIT_LIST_HEAD(&lc->old_flows);
+    lc->qlen = 0;
+    lc->backlog = 0;
+    lc->fat = NULL;
+
+    for (i = 0; i < nflows; i++) {
+        memset(&lc->flows[i], 0, sizeof(lc->flows[i]));
+        INIT_LIST_HEAD(&lc->flows[i].list);
+    }
+}
+
+/* all lcores, called on master when nobody holds @sch */
+static void fq_codel_reset(struct Qsch *sch)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    struct fq_codel_lcore *lc;
+    struct rte_mbuf *mbuf;
+    lcoreid_t cid;
+    uint32_t i;
+
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        lc = priv->lcores[cid];
+        if (!lc)
+            continue;
+
+        for (i = 0; i < priv->flows; i++) {
+            while ((mbuf = lc->flows[i].head) != NULL) {
+                lc->flows[i].head = mbuf->userdata;
+                rte_pktmbuf_free(mbuf);
+                sch->qstats[cid].drops++;
+            }
+        }
+
+        fq_codel_lcore_init(lc, priv->flows);
+        sch->q[cid].qlen = 0;
+        sch->qstats[cid].qlen = 0;
+        sch->qstats[cid].backlog = 0;
+    }
+}
+
+static int fq_codel_change(struct Qsch *sch, const void *arg)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    const struct tc_fq_codel_qopt *qopt = arg;
+    uint64_t hz = rte_get_tsc_hz();
+    uint32_t target_us, interval_us;
+
+    if (!arg)
+        return EDPVS_INVAL;
+
+    /* flow tables are allocated at init */
+    if (qopt->flows && qopt->flows != priv->flows)
+        return EDPVS_NOTSUPP;
+
+    target_us = qopt->target ? : FQ_CODEL_TARGET_DEF;
+    interval_us = qopt->interval ? : FQ_CODEL_INTERVAL_DEF;
+    if (target_us >= interval_us)
+        return EDPVS_INVAL;
+
+    sch->limit = qopt->limit ? : FQ_CODEL_LIMIT_DEF;
+
+    priv->quantum = qopt->quantum ? : priv->mtu;
+    priv->target_us = target_us;
+    priv->interval_us = interval_us;
+    priv->target = hz * priv->target_us / 1000000;
+    priv->interval = hz * priv->interval_us / 1000000;
+
+    return EDPVS_OK;
+}
+
+static void fq_codel_destroy(struct Qsch *sch)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    lcoreid_t cid;
+
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        if (priv->lcores[cid]) {
+            rte_free(priv->lcores[cid]);
+            priv->lcores[cid] = NULL;
+        }
+    }
+}
+
+static int fq_codel_init(struct Qsch *sch, const void *arg)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    const struct tc_fq_codel_qopt *qopt = arg;
+    struct fq_codel_lcore *lc;
+    size_t size;
+    lcoreid_t cid;
+    int err;
+
+    if (!arg)
+        return EDPVS_INVAL;
+
+    priv->flows = qopt->flows ? : FQ_CODEL_FLOWS_DEF;
+    priv->mtu = qsch_dev(sch)->mtu + sizeof(struct ether_hdr);
+    priv->perturb = (uint32_t)rte_rand();
+
+    err = fq_codel_change(sch, arg);
+    if (err != EDPVS_OK)
+        return err;
+
+    size = sizeof(*lc) + priv->flows * sizeof(struct fq_codel_flow);
+
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        if (!rte_lcore_is_enabled(cid))
+            continue;
+
+        lc = rte_zmalloc_socket(NULL, size, RTE_CACHE_LINE_SIZE,
+                                rte_lcore_to_socket_id(cid));
+        if (!lc) {
+            fq_codel_destroy(sch);
+            return EDPVS_NOMEM;
+        }
+
+        fq_codel_lcore_init(lc, priv->flows);
+        priv->lcores[cid] = lc;
+    }
+
+    return EDPVS_OK;
+}
+
+static int fq_codel_dump(struct Qsch *sch, void *arg)
+{
+    struct fq_codel_sch_priv *priv = qsch_priv(sch);
+    struct tc_fq_codel_qopt *qopt = arg;
+
+    memset(qopt, 0, sizeof(*qopt));
+    qopt->limit     = sch->limit;
+    qopt->flows     = priv->flows;
+    qopt->target    = priv->target_us;
+    qopt->interval  = priv->interval_us;
+    qopt->quantum   = priv->quantum;
+
+    return EDPVS_OK;
+}
+
+struct Qsch_ops fq_codel_sch_ops = {
+    .name       = "fq_codel",
+    .priv_size  = sizeof(struct fq_codel_sch_priv),
+    .enqueue    = fq_codel_enqueue,
+    .dequeue    = fq_codel_dequeue,
+    .peek       = fq_codel_peek,
+    .init       = fq_codel_init,
+    .reset      = fq_codel_reset,
+    .destroy    = fq_codel_destroy,
+    .change     = fq_codel_change,
+    .dump       = fq_codel_dump,
+};
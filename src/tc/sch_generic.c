@@ -26,6 +26,7 @@
 #include "netif.h"
 #include "tc/tc.h"
 #include "tc/sch.h"
+#include "tc/cls.h"
 
 /* may configurable in the future. */
 static int dev_tx_weight = 64;
@@ -92,6 +93,7 @@ static void __qsch_destroy(struct Qsch *sch)
     if (ops->destroy)
         ops->destroy(sch);
 
+    tc_cls_table_free(sch);
     tc_qsch_ops_put(ops);
     sch_free(sch);
 }
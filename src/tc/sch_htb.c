@@ -0,0 +1,532 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * the Hierarchical Token Bucket scheduler of traffic control module.
+ * see linux/net/sched/sch_htb.c
+ *
+ * each "htb" Qsch is a class, its parent class is the parent Qsch if it's
+ * htb too. a class sends at its rate, and may borrow the unused rate of
+ * ancestors until its ceil. packets are classified to classes by tc_cls.
+ *
+ * to avoid a global lock on datapath, every lcore accounts tokens by its
+ * own share of rate/ceil. master reconciles the shares periodically,
+ * according to the demand (sent and backlog) of each lcore last period.
+ *
+ * classes under the same top class are served by deficit round robin on
+ * each lcore, a backlogged class joins the ready ring of its top class and
+ * sends up to its quantum each round, so that no sibling is starved by the
+ * order packets arrive.
+ */
+#include <assert.h>
+#include "netif.h"
+#include "tc/tc.h"
+#include "tc/sch.h"
+#include "conf/tc.h"
+
+#define HTB_LIMIT_DEF           1024        /* packets */
+#define HTB_RECONCILE_MS        100
+/* idle lcore keeps 1/N of an even share to start sending */
+#define HTB_IDLE_SHARE_DIV      8
+/* tokens are in bytes * HTB_SCALE, so that no fraction is lost on refill */
+#define HTB_SCALE               1000000000LL
+/* default quantum is rate / HTB_R2Q, like linux htb */
+#define HTB_R2Q                 10
+#define HTB_QUANTUM_MAX         200000      /* bytes */
+/* ready classes of a top class on each lcore */
+#define HTB_READY_MAX           1024
+
+extern struct Qsch_ops htb_sch_ops;
+
+enum {
+    HTB_CAN_SEND,
+    HTB_MAY_BORROW,
+    HTB_CANT_SEND,
+};
+
+struct htb_lcore {
+    /* written by the lcore */
+    int64_t                 tokens;
+    int64_t                 ctokens;
+    int64_t                 t_c;        /* time check-point */
+    uint64_t                sent;       /* bytes */
+    int32_t                 deficit;    /* drr deficit, bytes */
+    bool                    ready;      /* on ready ring of top class */
+
+    /* written by master */
+    uint64_t                rate;       /* share of rate, B/s */
+    uint64_t                ceil;       /* share of ceil, B/s */
+    uint64_t                buffer;     /* share of burst, bytes */
+    uint64_t                cbuffer;    /* share of ceil burst, bytes */
+} __rte_cache_aligned;
+
+/*
+ * classes are kept by handle, a class deleted meanwhile is not found by
+ * qsch_lookup() and simply removed from the ring.
+ */
+struct htb_ready {
+    uint32_t                head;
+    uint32_t                count;
+    tc_handle_t             cls[HTB_READY_MAX];
+} __rte_cache_aligned;
+
+struct htb_sch_priv {
+    struct qsch_rate        rate;
+    struct qsch_rate        ceil;
+    uint32_t                buffer;
+    uint32_t                cbuffer;
+    uint32_t                quantum;
+
+    struct Qsch             *parent;    /* parent class, NULL for top */
+    struct Qsch             *root;      /* top class, itself for top */
+    struct htb_ready        *ready;     /* per-lcore, top class only */
+    struct dpvs_timer       timer;      /* reconcile shares */
+    uint64_t                last_sent[RTE_MAX_LCORE];
+
+    struct htb_lcore        lcores[RTE_MAX_LCORE];
+};
+
+static inline struct Qsch *htb_parent(struct Qsch *sch)
+{
+    return ((struct htb_sch_priv *)qsch_priv(sch))->parent;
+}
+
+static inline struct htb_ready *htb_this_ready(struct Qsch *sch)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    struct htb_sch_priv *rpriv = qsch_priv(priv->root);
+
+    return &rpriv->ready[rte_lcore_id()];
+}
+
+static inline bool htb_ready_push(struct htb_ready *rd, tc_handle_t handle)
+{
+    if (unlikely(rd->count >= HTB_READY_MAX))
+        return false;
+
+    rd->cls[(rd->head + rd->count) % HTB_READY_MAX] = handle;
+    rd->count++;
+    return true;
+}
+
+static inline void htb_ready_pop(struct htb_ready *rd)
+{
+    rd->head = (rd->head + 1) % HTB_READY_MAX;
+    rd->count--;
+}
+
+/* move the first class to the tail */
+static inline void htb_ready_rotate(struct htb_ready *rd)
+{
+    tc_handle_t handle = rd->cls[rd->head];
+
+    htb_ready_pop(rd);
+    htb_ready_push(rd, handle);
+}
+
+/*
+ * tokens after @elapsed ns at @rate, at most @buffer. no more than the time
+ * to refill from -buffer to buffer is counted, elapsed * rate can't overflow.
+ */
+static inline int64_t htb_refill(int64_t tokens, int64_t elapsed,
+                                 uint64_t rate, uint64_t buffer)
+{
+    int64_t max = (int64_t)buffer * HTB_SCALE;
+
+    if (unlikely(!rate))
+        return min_t(int64_t, tokens, max);
+
+    elapsed = min_t(int64_t, elapsed, max / (int64_t)rate * 2 + 1);
+    return min_t(int64_t, tokens + elapsed * (int64_t)rate, max);
+}
+
+static int htb_class_mode(struct Qsch *sch, int64_t now, int64_t cost)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    struct htb_lcore *lc = &priv->lcores[rte_lcore_id()];
+    int64_t elapsed;
+
+    elapsed = now - lc->t_c;
+    if (elapsed > 0) {
+        lc->tokens = htb_refill(lc->tokens, elapsed, lc->rate, lc->buffer);
+        lc->ctokens = htb_refill(lc->ctokens, elapsed, lc->ceil, lc->cbuffer);
+        lc->t_c = now;
+    }
+
+    if (lc->ctokens < cost)
+        return HTB_CANT_SEND;
+    if (lc->tokens < cost)
+        return HTB_MAY_BORROW;
+    return HTB_CAN_SEND;
+}
+
+/* over rate but under ceil, borrow from the nearest ancestor who can send */
+static bool htb_permit(struct Qsch *sch, int64_t now, int64_t cost)
+{
+    struct Qsch *cl;
+
+    for (cl = sch; cl; cl = htb_parent(cl)) {
+        switch (htb_class_mode(cl, now, cost)) {
+        case HTB_CAN_SEND:
+            return true;
+        case HTB_CANT_SEND:
+            return false;
+        default:
+            continue;
+        }
+    }
+
+    return false; /* top class has nobody to borrow from */
+}
+
+/* the class and all its ancestors are charged, as linux htb does */
+static void htb_charge(struct Qsch *sch, uint32_t len)
+{
+    struct htb_sch_priv *priv;
+    struct htb_lcore *lc;
+    int64_t cost = (int64_t)len * HTB_SCALE;
+    struct Qsch *cl;
+
+    for (cl = sch; cl; cl = htb_parent(cl)) {
+        priv = qsch_priv(cl);
+        lc = &priv->lcores[rte_lcore_id()];
+
+        lc->tokens = max_t(int64_t, lc->tokens - cost,
+                           -(int64_t)lc->buffer * HTB_SCALE);
+        lc->ctokens = max_t(int64_t, lc->ctokens - cost,
+                            -(int64_t)lc->cbuffer * HTB_SCALE);
+        lc->sent += len;
+    }
+}
+
+static int htb_enqueue(struct Qsch *sch, struct rte_mbuf *mbuf)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    struct htb_lcore *lc = &priv->lcores[rte_lcore_id()];
+    int err;
+
+    if (unlikely(sch->this_q.qlen >= sch->limit)) {
+#if defined(CONFIG_TC_DEBUG)
+        RTE_LOG(WARNING, TC, "%s: queue is full.\n", __func__);
+#endif
+        return qsch_drop(sch, mbuf);
+    }
+
+    err = qsch_enqueue_tail(sch, mbuf);
+    if (err == EDPVS_OK && !lc->ready &&
+        htb_ready_push(htb_this_ready(sch), sch->handle)) {
+        lc->ready = true;
+        lc->deficit = priv->quantum;
+    }
+
+    return err;
+}
+
+/* send the head packet of a class if tokens permit */
+static struct rte_mbuf *htb_dequeue_class(struct Qsch *cl, int64_t now)
+{
+    struct rte_mbuf *mbuf;
+
+    mbuf = qsch_peek_head(cl);
+    if (unlikely(!mbuf))
+        return NULL;
+
+    if (!htb_permit(cl, now, (int64_t)mbuf->pkt_len * HTB_SCALE)) {
+        cl->this_qstats.overlimits++;
+        return NULL;
+    }
+
+    htb_charge(cl, mbuf->pkt_len);
+    return qsch_dequeue_head(cl);
+}
+
+/* deficit round robin among ready classes of the top class */
+static struct rte_mbuf *htb_dequeue(struct Qsch *sch)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch), *cpriv;
+    struct htb_ready *rd = htb_this_ready(sch);
+    int64_t now = tc_get_ns();
+    struct rte_mbuf *mbuf;
+    struct htb_lcore *lc;
+    uint32_t blocked = 0;
+    struct Qsch *cl;
+
+    /* stop when every ready class is over its ceil */
+    while (rd->count && blocked < rd->count) {
+        cl = qsch_lookup(sch->tc, rd->cls[rd->head]);
+        if (unlikely(!cl || cl->ops != &htb_sch_ops ||
+                     ((struct htb_sch_priv *)qsch_priv(cl))->root !=
+                     priv->root)) {
+            /* deleted, the handle may be reused */
+            if (cl)
+                qsch_put(cl);
+            htb_ready_pop(rd);
+            continue;
+        }
+
+        cpriv = qsch_priv(cl);
+        lc = &cpriv->lcores[rte_lcore_id()];
+
+        if (unlikely(!lc->ready || !cl->this_q.qlen)) {
+            lc->ready = false;
+            htb_ready_pop(rd);
+            qsch_put(cl);
+            continue;
+        }
+
+        if (lc->deficit <= 0) {
+            /* it's not tried yet, count the blocked ones again */
+            lc->deficit += cpriv->quantum;
+            htb_ready_rotate(rd);
+            qsch_put(cl);
+            blocked = 0;
+            continue;
+        }
+
+        mbuf = htb_dequeue_class(cl, now);
+        if (!mbuf) {
+            htb_ready_rotate(rd);
+            qsch_put(cl);
+            blocked++;
+            continue;
+        }
+
+        lc->deficit -= mbuf->pkt_len;
+        if (!cl->this_q.qlen) {
+            lc->ready = false;
+            htb_ready_pop(rd);
+        }
+
+        qsch_put(cl);
+        return mbuf;
+    }
+
+    /* not on the ring if it was full */
+    if (unlikely(!priv->lcores[rte_lcore_id()].ready && sch->this_q.qlen))
+        return htb_dequeue_class(sch, now);
+
+    return NULL;
+}
+
+/* call on master only */
+static void htb_set_shares(struct Qsch *sch, const uint64_t *demand,
+                           uint64_t total)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    uint64_t min_burst = qsch_dev(sch)->mtu + sizeof(struct ether_hdr);
+    struct htb_lcore *lc;
+    uint64_t mask;
+    uint8_t nlcores;
+    lcoreid_t cid;
+    double idle, share;
+
+    netif_get_slave_lcores(&nlcores, &mask);
+    if (!nlcores)
+        return;
+
+    idle = 1.0 / (nlcores * HTB_IDLE_SHARE_DIV);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(mask & (1ULL << cid)))
+            continue;
+        lc = &priv->lcores[cid];
+
+        if (total)
+            share = idle + (1.0 - idle * nlcores) * demand[cid] / total;
+        else
+            share = 1.0 / nlcores;
+
+        lc->rate = priv->rate.rate_bytes_ps * share;
+        lc->ceil = priv->ceil.rate_bytes_ps * share;
+        lc->buffer = max_t(uint64_t, priv->buffer * share, min_burst);
+        lc->cbuffer = max_t(uint64_t, priv->cbuffer * share, min_burst);
+    }
+}
+
+static int htb_reconcile(void *arg)
+{
+    struct Qsch *sch = arg;
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    uint64_t demand[RTE_MAX_LCORE] = { 0 };
+    uint64_t sent, total = 0;
+    lcoreid_t cid;
+
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        sent = *(volatile uint64_t *)&priv->lcores[cid].sent;
+
+        demand[cid] = sent - priv->last_sent[cid] + sch->qstats[cid].backlog;
+        priv->last_sent[cid] = sent;
+        total += demand[cid];
+    }
+
+    htb_set_shares(sch, demand, total);
+    return DTIMER_OK;
+}
+
+static int htb_change(struct Qsch *sch, const void *arg)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    const struct tc_htb_qopt *qopt = arg;
+    struct htb_sch_priv *ppriv;
+    struct qsch_rate rate = {}, ceil = {};
+    uint32_t buffer, cbuffer, quantum, min_quantum;
+
+    if (qopt->rate.rate)
+        rate.rate_bytes_ps = qopt->rate.rate / 8;
+    else
+        rate = priv->rate;
+
+    if (qopt->ceil.rate)
+        ceil.rate_bytes_ps = qopt->ceil.rate / 8;
+    else if (priv->ceil.rate_bytes_ps)
+        ceil = priv->ceil;
+    else
+        ceil = rate;
+
+    buffer = qopt->buffer ? : priv->buffer;
+    cbuffer = qopt->cbuffer ? : (priv->cbuffer ? : buffer);
+
+    min_quantum = qsch_dev(sch)->mtu + sizeof(struct ether_hdr);
+    quantum = qopt->quantum ? : (priv->quantum ? :
+              min_t(uint64_t, max_t(uint64_t, rate.rate_bytes_ps / HTB_R2Q,
+                                    min_quantum), HTB_QUANTUM_MAX));
+
+    /* sanity check */
+    if (!rate.rate_bytes_ps || !buffer || quantum < min_quantum)
+        return EDPVS_INVAL;
+    if (ceil.rate_bytes_ps < rate.rate_bytes_ps)
+        return EDPVS_INVAL;
+    if (priv->parent) {
+        ppriv = qsch_priv(priv->parent);
+        if (ceil.rate_bytes_ps > ppriv->ceil.rate_bytes_ps)
+            return EDPVS_INVAL;
+    }
+
+    if (qopt->limit)
+        sch->limit = qopt->limit;
+    else if (!sch->limit)
+        sch->limit = HTB_LIMIT_DEF;
+
+    priv->rate = rate;
+    priv->ceil = ceil;
+    priv->buffer = buffer;
+    priv->cbuffer = cbuffer;
+    priv->quantum = quantum;
+
+    /* even shares until next reconciliation */
+    htb_set_shares(sch, NULL, 0);
+
+    return EDPVS_OK;
+}
+
+static int htb_init(struct Qsch *sch, const void *arg)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    struct timeval tv = { 0, HTB_RECONCILE_MS * 1000 };
+    struct Qsch *parent;
+    int err;
+
+    if (!arg)
+        return EDPVS_INVAL;
+
+    parent = qsch_lookup(sch->tc, sch->parent);
+    if (parent && parent->ops != &htb_sch_ops) {
+        qsch_put(parent);
+        parent = NULL;
+    }
+    priv->parent = parent;
+
+    if (parent) {
+        priv->root = ((struct htb_sch_priv *)qsch_priv(parent))->root;
+    } else {
+        priv->root = sch;
+        priv->ready = rte_zmalloc(NULL,
+                                  sizeof(struct htb_ready) * RTE_MAX_LCORE,
+                                  RTE_CACHE_LINE_SIZE);
+        if (!priv->ready) {
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
+    }
+
+    err = htb_change(sch, arg);
+    if (err != EDPVS_OK)
+        goto errout;
+
+    err = dpvs_timer_sched_period(&priv->timer, &tv, htb_reconcile, sch, true);
+    if (err != EDPVS_OK)
+        goto errout;
+
+    return EDPVS_OK;
+
+errout:
+    if (priv->ready) {
+        rte_free(priv->ready);
+        priv->ready = NULL;
+    }
+    if (parent)
+        qsch_put(parent);
+    priv->parent = NULL;
+    return err;
+}
+
+static void htb_destroy(struct Qsch *sch)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+
+    dpvs_timer_cancel(&priv->timer, true);
+
+    /* children hold the top class, no one refers to the ring now */
+    if (priv->ready) {
+        rte_free(priv->ready);
+        priv->ready = NULL;
+    }
+
+    if (priv->parent) {
+        qsch_put(priv->parent);
+        priv->parent = NULL;
+    }
+}
+
+static int htb_dump(struct Qsch *sch, void *arg)
+{
+    struct htb_sch_priv *priv = qsch_priv(sch);
+    struct tc_htb_qopt *qopt = arg;
+
+    memset(qopt, 0, sizeof(*qopt));
+    qopt->rate.rate     = priv->rate.rate_bytes_ps * 8;
+    qopt->ceil.rate     = priv->ceil.rate_bytes_ps * 8;
+    qopt->buffer        = priv->buffer;
+    qopt->cbuffer       = priv->cbuffer;
+    qopt->limit         = sch->limit;
+    qopt->quantum       = priv->quantum;
+
+    return EDPVS_OK;
+}
+
+struct Qsch_ops htb_sch_ops = {
+    .name       = "htb",
+    .priv_size  = sizeof(struct htb_sch_priv),
+    .enqueue    = htb_enqueue,
+    .dequeue    = htb_dequeue,
+    .peek       = qsch_peek_head,
+    .init       = htb_init,
+    .reset      = qsch_reset_queue,
+    .destroy    = htb_destroy,
+    .change     = htb_change,
+    .dump       = htb_dump,
+};
@@ -32,6 +32,8 @@ extern struct Qsch_ops pfifo_sch_ops;
 extern struct Qsch_ops bfifo_sch_ops;
 extern struct Qsch_ops pfifo_fast_ops;
 extern struct Qsch_ops tbf_sch_ops;
+extern struct Qsch_ops htb_sch_ops;
+extern struct Qsch_ops fq_codel_sch_ops;
 extern struct tc_cls_ops match_cls_ops;
 
 static struct list_head qsch_ops_base;
@@ -178,10 +180,10 @@ struct rte_mbuf *tc_handle_egress(struct netif_tc *tc,
 {
     int err = EDPVS_OK;
     struct Qsch *sch, *child_sch = NULL;
-    struct tc_cls *cls;
+    struct tc_cls_pkt pkt = { .parsed = false };
     struct tc_cls_result cls_res;
     const int max_reclassify_loop = 8;
-    int limit = 0;
+    int limit = 0, pos;
 
     assert(tc && mbuf && ret);
 
@@ -200,20 +202,12 @@ struct rte_mbuf *tc_handle_egress(struct netif_tc *tc,
      * it no classifier matchs, than use current scheduler.
      */
 again:
-    list_for_each_entry(cls, &sch->cls_list, list) {
-        if (unlikely(mbuf->packet_type != cls->pkt_type &&
-                     cls->pkt_type != htons(ETH_P_ALL)))
-            continue;
-
-        err = cls->ops->classify(cls, mbuf, &cls_res);
-        switch (err) {
-        case TC_ACT_OK:
+    for (pos = 0; ; pos++) {
+        err = tc_classify(sch, mbuf, mbuf->packet_type, &pkt, &pos, &cls_res);
+        if (err == TC_ACT_RECLASSIFY)
             break;
-        case TC_ACT_SHOT:
+        if (err == TC_ACT_SHOT)
             goto drop;
-        default:
-            continue;
-        }
 
         if (unlikely(cls_res.drop))
             goto drop;
@@ -269,6 +263,62 @@ drop:
     return NULL;
 }
 
+/*
+ * there's no queue on ingress, classifiers (with police action) on ingress
+ * Qsch only decide a packet is dropped (TC_ACT_SHOT or "drop" target) or
+ * passed. the first matched classifier wins, children are not supported.
+ */
+static inline bool tc_ingress_pass(struct Qsch *sch, struct rte_mbuf *mbuf)
+{
+    struct ether_hdr *eh = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    struct tc_cls_pkt pkt = { .parsed = false };
+    struct tc_cls_result cls_res;
+    int pos = 0;
+
+    switch (tc_classify(sch, mbuf, ntohs(eh->ether_type), &pkt, &pos,
+                        &cls_res)) {
+    case TC_ACT_OK:
+        return !cls_res.drop;
+    case TC_ACT_SHOT:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/* the whole burst is handled with one Qsch reference. */
+uint16_t tc_handle_ingress(struct netif_tc *tc,
+                           struct rte_mbuf **mbufs, uint16_t count)
+{
+    struct rte_mbuf *mbuf;
+    struct Qsch *sch;
+    uint16_t i, n;
+
+    assert(tc && mbufs);
+
+    sch = tc->qsch_ingress;
+    if (unlikely(!sch || !count))
+        return count;
+
+    qsch_get(sch);
+
+    for (i = 0, n = 0; i < count; i++) {
+        mbuf = mbufs[i];
+
+        if (unlikely(!tc_ingress_pass(sch, mbuf))) {
+            qsch_drop(sch, mbuf);
+            continue;
+        }
+
+        sch->this_bstats.packets++;
+        sch->this_bstats.bytes += mbuf->pkt_len;
+        mbufs[n++] = mbuf;
+    }
+
+    qsch_put(sch);
+    return n;
+}
+
 int tc_init_dev(struct netif_port *dev)
 {
     int hash, size;
@@ -354,6 +404,8 @@ int tc_init(void)
     tc_register_qsch(&bfifo_sch_ops);
     tc_register_qsch(&pfifo_fast_ops);
     tc_register_qsch(&tbf_sch_ops);
+    tc_register_qsch(&htb_sch_ops);
+    tc_register_qsch(&fq_codel_sch_ops);
 
     /* classifier */
     rte_rwlock_init(&cls_ops_lock);
@@ -21,6 +21,8 @@
  * raychen@qiyi.com, Apr 2016, initial.
  * raychen@qiyi.com, Jul 2017, refator with size/level configurable wheels,
  *                             instead of fixed size ms/sec/min wheels.
+ *                             compact cascading wheels indexed by absolute
+ *                             expire tick, lockless per-lcore scheduler.
  */
 #include <unistd.h>
 #include <sys/time.h>
@@ -41,34 +43,56 @@
  * the use case of dpvs timer is huge number of connections has concentrated
  * timeouts like 120s/60s, while other timeout values are not that much.
  *
- * to prevent too many timers need migrated from higher level to lower,
- * which leads to performance issue, timer need a big "first" level wheel
- * (hash) to "cover" most (millions of) connections.
- *
- * we can use different hash size for levels, consider hashs of non-first
- * level can be much smaller. but let's make things easier, pick up same size,
- * just assuming the memory is big enough.
+ * timers are placed by the absolute tick they are due, like classic linux
+ * timer wheels. a slot of higher level wheel is cascaded to lower levels
+ * only when the lower level wraps, each timer is migrated at most once per
+ * level, while concentrated timeouts share slots and are expired in budget.
+ * so the wheels can be small and stay in cache, some KB per lcore instead
+ * of a big "first" level wheel of MBs.
  */
 
 #define DPVS_TIMER_HZ           1000
 
 /*
- * with 1000hz, if LEVEL_SIZE is 2<<18 and LEVEL_DEPTH is 2:
- * it's about 524s for first wheel and 8.7 years for all wheels.
+ * with 1000hz, first wheel has 256 slots of 1 tick (256ms), higher wheels
+ * have 64 slots each: 16s, 17min, 18h and 49 days for all wheels.
  */
-/* __NOTE__: make sure (LEVEL_SIZE ** LEVEL_DEPTH) > TIMER_MAX_TICKS. */
-#define LEVEL_SIZE              (2<<18)
-#define LEVEL_DEPTH             2
+/* __NOTE__: make sure the wheels cover TIMER_MAX_TICKS (32 bits). */
+#define LEVEL0_BITS             8
+#define LEVEL_BITS              6
+#define LEVEL_DEPTH             5
+#define LEVEL0_SIZE             (1 << LEVEL0_BITS)
+#define LEVEL0_MASK             (LEVEL0_SIZE - 1)
+#define LEVEL_SIZE              (1 << LEVEL_BITS)
+#define LEVEL_MASK              (LEVEL_SIZE - 1)
 
 /* about 49 days with 1000hz, see dpvs_tick_t */
 #define TIMER_MAX_TICKS         0xffffffff
 #define TIMER_MAX_SECS          (TIMER_MAX_TICKS / DPVS_TIMER_HZ)
 
+/*
+ * timers of a slot are due at the same tick, for conns created in the same
+ * second it can be millions. they're moved to @expired list and expired
+ * in budget each tick, the leftover is carried to next tick. so that one
+ * tick never takes too long no matter how concentrated the timeouts are.
+ *
+ * per-lcore scheduler is touched by its own lcore only, it's lockless.
+ * other lcores must ask the owner by msg to operate per-lcore timers.
+ * global scheduler can be used by any lcore and is protected by @lock.
+ */
 struct timer_scheduler {
-    /* wheels and cursors */
     rte_spinlock_t      lock;
-    uint32_t            cursors[LEVEL_DEPTH];
-    struct list_head    *hashs[LEVEL_DEPTH];
+    bool                shared;
+
+    /* ticks elapsed and the wheels */
+    dpvs_tick_t         ticks;
+    /* same as @ticks but never wraps, for dpvs_time_now() */
+    uint64_t            clock;
+    struct list_head    wheel0[LEVEL0_SIZE];
+    struct list_head    wheels[LEVEL_DEPTH - 1][LEVEL_SIZE];
+
+    /* due timers not expired yet */
+    struct list_head    expired;
 
     /* leverage dpdk rte_timer to drive us */
     struct rte_timer    rte_tim;
@@ -79,6 +103,13 @@ static RTE_DEFINE_PER_LCORE(struct timer_scheduler, timer_sched);
 /* global timer. */
 static struct timer_scheduler g_timer_sched;
 
+/* expire budget each tick, zero for no limit */
+static uint32_t g_expire_budget;
+static uint64_t g_expire_budget_cycles;
+
+/* written by the owner lcore only, master for global timer */
+static struct dpvs_timer_stats timer_stats[DPVS_MAX_LCORE];
+
 static inline dpvs_tick_t timeval_to_ticks(const struct timeval *tv)
 {
     uint64_t ticks;
@@ -98,16 +129,50 @@ static inline void ticks_to_timeval(const dpvs_tick_t ticks, struct timeval *tv)
     tv->tv_usec = ticks % DPVS_TIMER_HZ * 1000000 / DPVS_TIMER_HZ;
 }
 
-/* ticks for each level's step */
-static inline dpvs_tick_t get_level_ticks(int level)
+static inline void clock_to_timeval(const uint64_t clock, struct timeval *tv)
+{
+    tv->tv_sec = clock / DPVS_TIMER_HZ;
+    tv->tv_usec = clock % DPVS_TIMER_HZ * 1000000 / DPVS_TIMER_HZ;
+}
+
+static inline void timer_sched_lock(struct timer_scheduler *sched)
+{
+    if (sched->shared)
+        rte_spinlock_lock(&sched->lock);
+}
+
+static inline void timer_sched_unlock(struct timer_scheduler *sched)
+{
+    if (sched->shared)
+        rte_spinlock_unlock(&sched->lock);
+}
+
+/* bits of ticks below each level's step */
+static inline int get_level_shift(int level)
 {
-    dpvs_tick_t ticks = 1;
     assert(level >= 0 && level < LEVEL_DEPTH);
 
-    while (--level >= 0)
-        ticks *= LEVEL_SIZE;
+    return level ? LEVEL0_BITS + (level - 1) * LEVEL_BITS : 0;
+}
+
+/* slot for the timer due at tick @expire, never before current tick */
+static struct list_head *timer_slot(struct timer_scheduler *sched,
+                                    dpvs_tick_t expire)
+{
+    dpvs_tick_t delta = expire - sched->ticks;
+    int level, shift;
+
+    if (delta < LEVEL0_SIZE)
+        return &sched->wheel0[expire & LEVEL0_MASK];
 
-    return ticks;
+    for (level = 1; level < LEVEL_DEPTH - 1; level++) {
+        shift = get_level_shift(level);
+        if (delta < (dpvs_tick_t)1 << (shift + LEVEL_BITS))
+            break;
+    }
+
+    shift = get_level_shift(level);
+    return &sched->wheels[level - 1][(expire >> shift) & LEVEL_MASK];
 }
 
 static inline bool timer_pending(const struct dpvs_timer *timer)
@@ -117,14 +182,11 @@ static inline bool timer_pending(const struct dpvs_timer *timer)
             && timer->list.prev != &timer->list);
 }
 
-/* call me with lock */
+/* call me with lock (global timer) */
 static int __dpvs_timer_sched(struct timer_scheduler *sched,
                               struct dpvs_timer *timer, struct timeval *delay,
                               dpvs_timer_cb_t handler, void *arg, bool period)
 {
-    uint32_t off, hash;
-    int level;
-
     assert(timer && delay && handler);
 
     if (timer_pending(timer))
@@ -134,6 +196,7 @@ static int __dpvs_timer_sched(struct timer_scheduler *sched,
     timer->priv = arg;
     timer->is_period = period;
     timer->delay = timeval_to_ticks(delay);
+    timer->expire = sched->ticks + timer->delay;
 
     if (unlikely(timer->delay >= TIMER_MAX_TICKS)) {
         RTE_LOG(WARNING, DTIMER, "exceed timer range\n");
@@ -149,29 +212,14 @@ static int __dpvs_timer_sched(struct timer_scheduler *sched,
         return EDPVS_INVAL;
     }
 
-    /* add to corresponding wheel, from higher level to lower. */
-    for (level = LEVEL_DEPTH - 1; level >= 0; level--) {
-        off = timer->delay / get_level_ticks(level);
-        if (off > 0) {
-            hash = (sched->cursors[level] + off) % LEVEL_SIZE;
-            list_add_tail(&timer->list, &sched->hashs[level][hash]);
-            return EDPVS_OK;
-        }
-    }
-
-    /* not adopted by any wheel (never happend) */
-    return EDPVS_INVAL;
+    list_add_tail(&timer->list, timer_slot(sched, timer->expire));
+    return EDPVS_OK;
 }
 
-/* call me with lock */
+/* call me with lock (global timer) */
 static void __time_now(struct timer_scheduler *sched, struct timeval *now)
 {
-    dpvs_tick_t ticks = 0;
-    int l;
-
-    for (l = LEVEL_DEPTH - 1; l >= 0; l--)
-        ticks += sched->cursors[l] * get_level_ticks(l);
-    ticks_to_timeval(ticks, now);
+    clock_to_timeval(sched->clock, now);
 }
 
 static void timer_expire(struct timer_scheduler *sched, struct dpvs_timer *timer)
@@ -189,9 +237,9 @@ static void timer_expire(struct timer_scheduler *sched, struct dpvs_timer *timer
     if (timer_pending(timer))
         list_del(&timer->list);
 
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
     err = handler(priv);
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
 
     if (err != DTIMER_OK || !timer->is_period)
         return;
@@ -223,6 +271,64 @@ static inline void deviation_measure(void)
 }
 #endif
 
+/* call me with lock (global timer) */
+static void timer_expire_backlog(struct timer_scheduler *sched)
+{
+    struct dpvs_timer_stats *stats = &timer_stats[rte_lcore_id()];
+    struct dpvs_timer *timer;
+    uint64_t deadline = 0;
+    uint32_t n = 0, latency;
+
+    if (g_expire_budget_cycles)
+        deadline = rte_get_timer_cycles() + g_expire_budget_cycles;
+
+    while (!list_empty(&sched->expired)) {
+        if ((g_expire_budget && n >= g_expire_budget) ||
+            (deadline && rte_get_timer_cycles() > deadline)) {
+            stats->budget_hits++;
+            break;
+        }
+
+        /* the handler may cancel others, always take the first one. */
+        timer = list_first_entry(&sched->expired, struct dpvs_timer, list);
+
+        latency = sched->ticks - timer->expire;
+        if ((int32_t)latency > 0) {
+            stats->deferred++;
+            if (latency > stats->max_latency)
+                stats->max_latency = latency;
+        }
+
+        n++;
+        timer_expire(sched, timer);
+    }
+
+    stats->expired += n;
+}
+
+/*
+ * move timers of the current slot of @level to lower levels,
+ * returns the slot index, zero means next level need cascade too.
+ */
+static uint32_t timer_cascade(struct timer_scheduler *sched, int level)
+{
+    struct dpvs_timer *timer, *next;
+    struct list_head *slot;
+    uint32_t index;
+    LIST_HEAD(list);
+
+    index = (sched->ticks >> get_level_shift(level)) & LEVEL_MASK;
+    slot = &sched->wheels[level - 1][index];
+
+    list_splice_init(slot, &list);
+    list_for_each_entry_safe(timer, next, &list, list) {
+        list_del(&timer->list);
+        list_add_tail(&timer->list, timer_slot(sched, timer->expire));
+    }
+
+    return index;
+}
+
 /*
  * it takes exactly one tick between invokations,
  * except system (including time handles) takes more then
@@ -232,11 +338,7 @@ static inline void deviation_measure(void)
 static void rte_timer_tick_cb(struct rte_timer *tim, void *arg)
 {
     struct timer_scheduler *sched = arg;
-    struct dpvs_timer *timer, *next;
-    uint64_t left, hash, off;
-    int level, lower;
-    uint32_t *cursor;
-    bool carry;
+    int level;
 
     assert(tim && sched);
 #ifdef CONFIG_TIMER_MEASURE
@@ -244,77 +346,63 @@ static void rte_timer_tick_cb(struct rte_timer *tim, void *arg)
     return;
 #endif
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
 
-    /* drive timer to move and handle expired timers. */
-    for (level = 0; level < LEVEL_DEPTH; level++) {
-        cursor = &sched->cursors[level];
-        (*cursor)++;
+    sched->ticks++;
+    sched->clock++;
 
-        if (*cursor < LEVEL_SIZE) {
-            carry = false;
-        } else {
-            /* reset the cursor and handle next level later. */
-            *cursor = 0;
-            carry = true;
+    /* first wheel wraps, drop timers of higher levels to lower. */
+    if (!(sched->ticks & LEVEL0_MASK)) {
+        for (level = 1; level < LEVEL_DEPTH; level++) {
+            if (timer_cascade(sched, level))
+                break;
         }
+    }
 
-        list_for_each_entry_safe(timer, next,
-                                 &sched->hashs[level][*cursor], list) {
-            /* is all lower levels ticks empty ? */
-            left = timer->delay % get_level_ticks(level);
-            if (!left) {
-                timer_expire(sched, timer);
-            } else {
-                /* drop to lower level wheel, note it may not drop to
-                 * "next" lower level wheel. */
-                list_del(&timer->list);
-
-                lower = level;
-                while (--lower >= 0) {
-                    off = timer->delay / get_level_ticks(lower);
-                    if (!off)
-                        continue; /* next lower level */
-
-                    hash = (*cursor + off) % LEVEL_SIZE;
-                    list_add_tail(&timer->list, &sched->hashs[lower][hash]);
-                    break;
-                }
-
-                assert(lower >= 0);
-            }
-        }
+    /* all timers of current slot are due, don't touch each of them. */
+    list_splice_tail_init(&sched->wheel0[sched->ticks & LEVEL0_MASK],
+                          &sched->expired);
 
-        if (!carry)
-            break;
-    }
+    timer_expire_backlog(sched);
 
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
     return;
 }
 
-static int timer_init_schedler(struct timer_scheduler *sched, lcoreid_t cid)
+static void timer_sched_lists_init(struct timer_scheduler *sched)
 {
     int i, l;
 
-    rte_spinlock_init(&sched->lock);
+    for (i = 0; i < LEVEL0_SIZE; i++)
+        INIT_LIST_HEAD(&sched->wheel0[i]);
 
+    for (l = 0; l < LEVEL_DEPTH - 1; l++) {
+        for (i = 0; i < LEVEL_SIZE; i++)
+            INIT_LIST_HEAD(&sched->wheels[l][i]);
+    }
 
-    rte_spinlock_lock(&sched->lock);
-    for (l = 0; l < LEVEL_DEPTH; l++) {
-        sched->cursors[l] = 0;
+    INIT_LIST_HEAD(&sched->expired);
+}
 
-        sched->hashs[l] = rte_malloc(NULL,
-                                     sizeof(struct list_head) * LEVEL_SIZE, 0);
-        if (!sched->hashs[l]) {
-            RTE_LOG(ERR, DTIMER, "[%02d] no memory.\n", cid);
-            return EDPVS_NOMEM;
-        }
+static void timer_list_flush(struct list_head *head)
+{
+    struct dpvs_timer *timer, *next;
 
-        for (i = 0; i < LEVEL_SIZE; i++)
-            INIT_LIST_HEAD(&sched->hashs[l][i]);
-    }
-    rte_spinlock_unlock(&sched->lock);
+    list_for_each_entry_safe(timer, next, head, list)
+        list_del(&timer->list);
+}
+
+static int timer_init_schedler(struct timer_scheduler *sched, lcoreid_t cid,
+                               bool shared)
+{
+    rte_spinlock_init(&sched->lock);
+    sched->shared = shared;
+
+    timer_sched_lock(sched);
+    sched->ticks = 0;
+    sched->clock = 0;
+    timer_sched_lists_init(sched);
+    timer_sched_unlock(sched);
 
     rte_timer_init(&sched->rte_tim);
     /* ticks should be exactly same with precision */
@@ -330,25 +418,26 @@ static int timer_init_schedler(struct timer_scheduler *sched, lcoreid_t cid)
 
 static int timer_term_schedler(struct timer_scheduler *sched)
 {
-    struct dpvs_timer *timer, *next;
     int i, l;
 
     rte_timer_stop_sync(&sched->rte_tim);
 
     /* delete all pending timers */
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
 
-    for (l = 0; l < LEVEL_DEPTH; l++) {
-        for (i = 0; i < LEVEL_SIZE; i++) {
-            list_for_each_entry_safe(timer, next, &sched->hashs[l][i], list)
-                list_del(&timer->list);
-        }
+    for (i = 0; i < LEVEL0_SIZE; i++)
+        timer_list_flush(&sched->wheel0[i]);
 
-        rte_free(sched->hashs[l]);
-        sched->cursors[l] = 0;
+    for (l = 0; l < LEVEL_DEPTH - 1; l++) {
+        for (i = 0; i < LEVEL_SIZE; i++)
+            timer_list_flush(&sched->wheels[l][i]);
     }
 
-    rte_spinlock_unlock(&sched->lock);
+    timer_list_flush(&sched->expired);
+    sched->ticks = 0;
+    sched->clock = 0;
+
+    timer_sched_unlock(sched);
 
     return EDPVS_OK;
 }
@@ -358,7 +447,8 @@ static int timer_lcore_init(void *arg)
     if (!rte_lcore_is_enabled(rte_lcore_id()))
         return EDPVS_DISABLED;
 
-    return timer_init_schedler(&RTE_PER_LCORE(timer_sched), rte_lcore_id());
+    return timer_init_schedler(&RTE_PER_LCORE(timer_sched), rte_lcore_id(),
+                               false);
 }
 
 static int timer_lcore_term(void *arg)
@@ -386,7 +476,7 @@ int dpvs_timer_init(void)
     }
 
     /* global timer */
-    return timer_init_schedler(&g_timer_sched, rte_get_master_lcore());
+    return timer_init_schedler(&g_timer_sched, rte_get_master_lcore(), true);
 }
 
 int dpvs_timer_term(void)
@@ -429,9 +519,9 @@ int dpvs_timer_sched(struct dpvs_timer *timer, struct timeval *delay,
             || delay->tv_sec >= TIMER_MAX_SECS)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     err = __dpvs_timer_sched(sched, timer, delay, handler, arg, false);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
 
     return err;
 }
@@ -446,7 +536,7 @@ int dpvs_timer_sched_abs(struct dpvs_timer *timer, struct timeval *expire,
     if (!sched || !timer || !expire || !handler)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     __time_now(sched, &now);
     if (!timercmp(expire, &now, >)) {
         /* consider the diff between user call dpvs_time_now() and NOW,
@@ -454,18 +544,18 @@ int dpvs_timer_sched_abs(struct dpvs_timer *timer, struct timeval *expire,
          * to schedule an 1-tick timer ? no, let's trigger it now.
          * note we cannot call timer_expire() direcly. */
         handler(arg);
-        rte_spinlock_unlock(&sched->lock);
+        timer_sched_unlock(sched);
         return EDPVS_OK;
     } else {
         timersub(expire, &now, &delta);
         if (delta.tv_sec >= TIMER_MAX_SECS) {
-            rte_spinlock_unlock(&sched->lock);
+            timer_sched_unlock(sched);
             return EDPVS_INVAL;
         }
     }
 
     err = __dpvs_timer_sched(sched, timer, &delta, handler, arg, false);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
 
     return err;
 }
@@ -479,9 +569,9 @@ int dpvs_timer_sched_period(struct dpvs_timer *timer, struct timeval *intv,
     if (!sched || !timer || !intv || !handler || intv->tv_sec >= TIMER_MAX_SECS)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     err = __dpvs_timer_sched(sched, timer, intv, handler, arg, true);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
     return err;
 }
 
@@ -492,10 +582,10 @@ int dpvs_timer_cancel(struct dpvs_timer *timer, bool global)
     if (!sched || !timer)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     if (timer_pending(timer))
         list_del(&timer->list);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
     return EDPVS_OK;
 }
 
@@ -508,14 +598,14 @@ int dpvs_timer_reset(struct dpvs_timer *timer, bool global)
     if (!sched || !timer)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     if (timer_pending(timer))
         list_del(&timer->list);
 
     ticks_to_timeval(timer->delay, &delay);
     err = __dpvs_timer_sched(sched, timer, &delay, timer->handler,
                              timer->priv, timer->is_period);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
     return err;
 }
 
@@ -527,12 +617,12 @@ int dpvs_timer_update(struct dpvs_timer *timer, struct timeval *delay, bool glob
     if (!sched || !timer || !delay)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     if (timer_pending(timer))
         list_del(&timer->list);
     err = __dpvs_timer_sched(sched, timer, delay,
             timer->handler, timer->priv, timer->is_period);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
     return err;
 }
 
@@ -542,9 +632,18 @@ int dpvs_time_now(struct timeval *now, bool global)
     if (!sched || !now)
         return EDPVS_INVAL;
 
-    rte_spinlock_lock(&sched->lock);
+    timer_sched_lock(sched);
     __time_now(sched, now);
-    rte_spinlock_unlock(&sched->lock);
+    timer_sched_unlock(sched);
+    return EDPVS_OK;
+}
+
+int dpvs_timer_stats_get(unsigned int cid, struct dpvs_timer_stats *stats)
+{
+    if (cid >= DPVS_MAX_LCORE || !stats)
+        return EDPVS_INVAL;
+
+    *stats = timer_stats[cid];
     return EDPVS_OK;
 }
 
@@ -600,9 +699,61 @@ static void timer_sched_interval_handler(vector_t tokens)
     rte_atomic32_set(&g_sched_interval, sched_interval);
 }
 
+#define TIMER_EXPIRE_BUDGET_DEF     0       /* no limit */
+#define TIMER_EXPIRE_BUDGET_MAX     10000000
+#define TIMER_EXPIRE_BUDGET_US_DEF  200
+#define TIMER_EXPIRE_BUDGET_US_MAX  1000000
+
+static inline uint64_t us_to_cycles(uint32_t us)
+{
+    return (uint64_t)us * rte_get_timer_hz() / 1000000;
+}
+
+static void timer_expire_budget_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int budget;
+
+    if (!str)
+        return;
+
+    budget = atoi(str);
+    FREE_PTR(str);
+
+    if (budget < 0 || budget > TIMER_EXPIRE_BUDGET_MAX) {
+        RTE_LOG(WARNING, DTIMER, "invalid expire_budget config %d, "
+                "using default %d\n", budget, TIMER_EXPIRE_BUDGET_DEF);
+        budget = TIMER_EXPIRE_BUDGET_DEF;
+    }
+    RTE_LOG(INFO, DTIMER, "expire_budget = %d\n", budget);
+    g_expire_budget = budget;
+}
+
+static void timer_expire_budget_us_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int budget_us;
+
+    if (!str)
+        return;
+
+    budget_us = atoi(str);
+    FREE_PTR(str);
+
+    if (budget_us < 0 || budget_us > TIMER_EXPIRE_BUDGET_US_MAX) {
+        RTE_LOG(WARNING, DTIMER, "invalid expire_budget_us config %d, "
+                "using default %d\n", budget_us, TIMER_EXPIRE_BUDGET_US_DEF);
+        budget_us = TIMER_EXPIRE_BUDGET_US_DEF;
+    }
+    RTE_LOG(INFO, DTIMER, "expire_budget_us = %d\n", budget_us);
+    g_expire_budget_cycles = us_to_cycles(budget_us);
+}
+
 void timer_keyword_value_init(void)
 {
     rte_atomic32_set(&g_sched_interval, TIMER_SCHED_INTERVAL_DEF);
+    g_expire_budget = TIMER_EXPIRE_BUDGET_DEF;
+    g_expire_budget_cycles = us_to_cycles(TIMER_EXPIRE_BUDGET_US_DEF);
 }
 
 void install_timer_keywords(void)
@@ -610,4 +761,8 @@ void install_timer_keywords(void)
     install_keyword_root("timer_defs", NULL);
     install_keyword("schedule_interval", timer_sched_interval_handler,
                     KW_TYPE_NORMAL);
+    install_keyword("expire_budget", timer_expire_budget_handler,
+                    KW_TYPE_NORMAL);
+    install_keyword("expire_budget_us", timer_expire_budget_us_handler,
+                    KW_TYPE_NORMAL);
 }
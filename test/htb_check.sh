@@ -0,0 +1,98 @@
+#!/bin/sh
+#
+# htb rate/sharing check on dpdk0 egress.
+#
+# top class 1: is capped at 1g, classes 1:1 and 1:2 are guaranteed 300m
+# each and may borrow up to 1g. traffic to port 5201 goes to 1:1, 5202 to
+# 1:2. run iperf3 servers on $SERVER behind dpvs on both ports, then run
+# this script on a client routed through dpvs:
+#
+#   SERVER=192.168.100.2 DEV=dpdk0 ./htb_check.sh
+#
+# rates are taken from the class byte counters of "dpip -s qsch show",
+# so they include headers as htb charges them. checked:
+#   1) both flows, 64B and 1400B writes: sum 1g +/- 2%, each class gets
+#      its rate and shares are within 10% of each other (same quantum).
+#   2) one flow only: it borrows the idle rate of the other, >= 0.9g.
+#   3) quantum of 1:2 doubled: 1:2 gets about 2/3, 1:1 keeps its rate.
+# exits non-zero if any check fails.
+#
+
+DEV=${DEV:-dpdk0}
+TIME=${TIME:-30}
+RATE=1000           # Mbit/s of top class
+QUANTUM=15140
+
+if [ -z "$SERVER" ]; then
+    echo "SERVER is not set" >&2
+    exit 2
+fi
+
+fail=0
+
+setup() {
+    dpip qsch del dev $DEV root handle 1: 2>/dev/null
+    dpip qsch add dev $DEV root handle 1: htb rate 1g burst 125000
+    dpip qsch add dev $DEV parent 1: handle 1:1 htb rate 300m burst 37500 \
+        ceil 1g cburst 125000 quantum $QUANTUM
+    dpip qsch add dev $DEV parent 1: handle 1:2 htb rate 300m burst 37500 \
+        ceil 1g cburst 125000 quantum $QUANTUM
+
+    dpip cls add dev $DEV qsch 1: handle 1:10 \
+        match pattern 'tcp,to=0.0.0.0-255.255.255.255:5201' target 1:1
+    dpip cls add dev $DEV qsch 1: handle 1:20 \
+        match pattern 'tcp,to=0.0.0.0-255.255.255.255:5202' target 1:2
+}
+
+# bytes sent by class $1
+sent() {
+    dpip -s qsch show dev $DEV | \
+        awk -v h="$1" '$1 == "qsch" { cls = $3 } \
+                       $1 == "Sent" && cls == h { print $2; exit }'
+}
+
+# run iperf3 to the ports given, print Mbit/s of 1:1 and 1:2
+measure() {
+    b1=$(sent 1:1); b2=$(sent 1:2)
+    for port in "$@"; do
+        len=64
+        [ $port = 5202 ] && len=1400
+        iperf3 -c $SERVER -p $port -t $TIME -b 0 -l $len >/dev/null &
+    done
+    wait
+    a1=$(sent 1:1); a2=$(sent 1:2)
+    echo "$b1 $a1 $b2 $a2" | \
+        awk -v t=$TIME '{ printf "%d %d\n", ($2 - $1) * 8 / t / 1000000, \
+                                           ($4 - $3) * 8 / t / 1000000 }'
+}
+
+# check "$desc" "$awk condition on r1, r2"
+check() {
+    if echo "$r1 $r2" | awk "{ r1 = \$1; r2 = \$2; exit !($2) }"; then
+        echo "PASS: $1 (1:1 ${r1}m, 1:2 ${r2}m)"
+    else
+        echo "FAIL: $1 (1:1 ${r1}m, 1:2 ${r2}m)"
+        fail=1
+    fi
+}
+
+setup
+
+set -- $(measure 5201 5202); r1=$1; r2=$2
+check "both flows sum to rate" \
+    "r1 + r2 >= $RATE * 0.98 && r1 + r2 <= $RATE * 1.02"
+check "both flows get their rate" "r1 >= 300 && r2 >= 300"
+check "both flows share evenly" \
+    "r1 - r2 <= (r1 + r2) * 0.1 && r2 - r1 <= (r1 + r2) * 0.1"
+
+set -- $(measure 5201); r1=$1; r2=$2
+check "single flow borrows" "r1 >= $RATE * 0.9"
+
+dpip qsch change dev $DEV parent 1: handle 1:2 htb rate 300m burst 37500 \
+    ceil 1g cburst 125000 quantum $((QUANTUM * 2))
+set -- $(measure 5201 5202); r1=$1; r2=$2
+check "double quantum gets 2/3" \
+    "r2 >= (r1 + r2) * 0.6 && r2 <= (r1 + r2) * 0.73 && r1 >= 300"
+
+dpip qsch del dev $DEV root handle 1:
+exit $fail
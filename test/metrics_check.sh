@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# metrics exporter check with many services.
+#
+# dpvs needs in ctrl_defs:
+#   stats_shm { enable on  max_services 16384  max_dests 65536 }
+#   metrics { enable on }
+#
+# NSVC services with NDEST dests each are added by "ipvsadm -R", then
+# /metrics is scraped. checked:
+#   1) every sample line is "name{labels} value" or "name value".
+#   2) all services and dests are there, none truncated.
+#   3) render time of the previous scrape, dpvs_metrics_render_seconds,
+#      is below MAX_RENDER seconds (0.1 for 10k services by default).
+# exits non-zero if any check fails. services are removed at the end.
+#
+#   URL=http://127.0.0.1:9525/metrics NSVC=10000 ./metrics_check.sh
+#
+
+URL=${URL:-http://127.0.0.1:9525/metrics}
+NSVC=${NSVC:-10000}
+NDEST=${NDEST:-4}
+MAX_RENDER=${MAX_RENDER:-0.1}
+OUT=/tmp/metrics_check.$$
+
+fail=0
+
+result() {
+    if [ $1 -eq 0 ]; then
+        echo "PASS: $2"
+    else
+        echo "FAIL: $2"
+        fail=1
+    fi
+}
+
+# 10.x.y.z:80 services, dests 192.168.x.y:8080+n
+awk -v nsvc=$NSVC -v ndest=$NDEST 'BEGIN {
+    for (i = 0; i < nsvc; i++) {
+        vip = sprintf("10.%d.%d.%d", int(i / 65536) % 256, int(i / 256) % 256, i % 256);
+        printf "-A -t %s:80 -s rr\n", vip;
+        for (j = 0; j < ndest; j++)
+            printf "-a -t %s:80 -r 192.168.%d.%d:%d -b\n", vip,
+                   int(i / 256) % 256, i % 256, 8080 + j;
+    }
+}' | ipvsadm -R || { echo "fail to add services"; exit 2; }
+
+# the region is updated every interval_ms, the render time is of the
+# previous scrape, so scrape twice
+sleep 2
+curl -sf "$URL" >/dev/null
+curl -sf "$URL" >$OUT
+result $? "scrape"
+
+awk '/^#/ || /^$/ { next }
+     !/^[a-zA-Z_:][a-zA-Z0-9_:]*(\{([a-zA-Z_][a-zA-Z0-9_]*="([^"\\]|\\.)*",?)*\})? -?[0-9.e+Inf]+$/ {
+        print "bad line: " $0; bad = 1 }
+     END { exit bad }' $OUT
+result $? "exposition format"
+
+nsvc=$(grep -c '^dpvs_service_conns_total{' $OUT)
+ndest=$(grep -c '^dpvs_dest_conns_total{' $OUT)
+[ $nsvc -ge $NSVC ] && [ $ndest -ge $((NSVC * NDEST)) ] && \
+    grep -q '^dpvs_stats_truncated 0$' $OUT
+result $? "$nsvc services and $ndest dests, not truncated"
+
+render=$(awk '$1 == "dpvs_metrics_render_seconds" { print $2 }' $OUT)
+awk -v r="$render" -v max=$MAX_RENDER 'BEGIN { exit !(r != "" && r < max) }'
+result $? "render ${render}s < ${MAX_RENDER}s, $(wc -c <$OUT) bytes"
+
+ipvsadm -C
+rm -f $OUT
+exit $fail
@@ -46,6 +46,7 @@ static void cls_help(void)
         "\n"
         "Match options:\n"
         "    MATCH_OPTS := pattern PATTERN { target { CHILD_QSCH | drop } }\n"
+        "                  [ police rate RATE burst BYTES [ exceed EXCEED ] ]\n"
         "    PATTERN    := comma seperated of tokens below,\n"
         "                  { PROTO | SRANGE | DRANGE | IIF | OIF }\n"
         "    CHILD_QSCH := child qsch handle of the qsch cls attached.\n"
@@ -55,6 +56,10 @@ static void cls_help(void)
         "    RANGE      := ADDR[-ADDR][:PORT[-PORT]]\n"
         "    IIF        := \"iif=IFNAME\"\n"
         "    OIF        := \"oif=IFNAME\"\n"
+        "    RATE       := raw bits per-second, and possible followed by\n"
+        "                  a SI unit (k, m, g).\n"
+        "    EXCEED     := { drop | dscp DSCP }, action on traffic exceeds\n"
+        "                  the rate, drop (default) or re-mark ipv4 dscp.\n"
         "\n"
         "Examples:\n"
         "    dpip cls show dev dpdk0 qsch 1:\n"
@@ -64,6 +69,10 @@ static void cls_help(void)
         "         match pattern 'tcp,from=192.168.0.1:1-1024,oif=eth1'\\\n"
         "         target 1:1\n"
         "    dpip cls del dev dpdk0 qsch 1: handle 1:10\n"
+        "    dpip qsch add dev dpdk0 ingress pfifo\n"
+        "    dpip cls add dev dpdk0 qsch ffff: \\\n"
+        "         match pattern 'udp,to=192.168.0.1:53' \\\n"
+        "         police rate 100m burst 1000000\n"
         );
 }
 
@@ -89,6 +98,18 @@ static void cls_dump_param(const char *ifname, const union tc_param *param)
 
         printf("%s target %s",
                dump_match(m->proto, &m->match, patt, sizeof(patt)), result);
+
+        if (m->police.rate) {
+            char rate[32];
+
+            printf(" police rate %s burst %uB exceed ",
+                   rate_itoa(m->police.rate, rate, sizeof(rate)),
+                   m->police.burst);
+            if (m->police.exceed == TC_POLICE_EXCEED_MARK)
+                printf("dscp %u", m->police.dscp);
+            else
+                printf("drop");
+        }
     }
 
     printf("\n");
@@ -98,6 +119,7 @@ static int cls_parse(struct dpip_obj *obj, struct dpip_conf *cf)
 {
     struct tc_conf *conf = obj->param;
     struct tc_cls_param *param = &conf->param.cls;
+    bool police = false;
 
     memset(param, 0, sizeof(*param));
 
@@ -149,6 +171,35 @@ static int cls_parse(struct dpip_obj *obj, struct dpip_conf *cf)
                         m->result.drop = true;
                     else
                         m->result.sch_id = tc_handle_atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "police") == 0) {
+                    police = true;
+                } else if (police && strcmp(CURRARG(cf), "rate") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    m->police.rate = rate_atoi(CURRARG(cf));
+                    if (!m->police.rate) {
+                        fprintf(stderr, "invalid rate: `%s'\n", CURRARG(cf));
+                        return EDPVS_INVAL;
+                    }
+                } else if (police && strcmp(CURRARG(cf), "burst") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    m->police.burst = atoi(CURRARG(cf));
+                } else if (police && strcmp(CURRARG(cf), "exceed") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    if (strcmp(CURRARG(cf), "drop") == 0) {
+                        m->police.exceed = TC_POLICE_EXCEED_DROP;
+                    } else if (strcmp(CURRARG(cf), "dscp") == 0) {
+                        NEXTARG_CHECK(cf, CURRARG(cf));
+                        if (atoi(CURRARG(cf)) < 0 || atoi(CURRARG(cf)) > 63) {
+                            fprintf(stderr, "invalid dscp, should be 0-63.\n");
+                            return EDPVS_INVAL;
+                        }
+                        m->police.exceed = TC_POLICE_EXCEED_MARK;
+                        m->police.dscp = atoi(CURRARG(cf));
+                    } else {
+                        fprintf(stderr, "invalid exceed action: `%s'\n",
+                                CURRARG(cf));
+                        return EDPVS_INVAL;
+                    }
                 }
             } else {
                 fprintf(stderr, "invalid/miss cls type: `%s'\n", param->kind);
@@ -162,6 +213,19 @@ static int cls_parse(struct dpip_obj *obj, struct dpip_conf *cf)
     return EDPVS_OK;
 }
 
+static int cls_check_police(const struct tc_cls_police *police)
+{
+    if (!police->rate)
+        return EDPVS_OK;
+
+    if (!police->burst) {
+        fprintf(stderr, "missing burst for police.\n");
+        return EDPVS_INVAL;
+    }
+
+    return EDPVS_OK;
+}
+
 static int cls_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
 {
     const struct tc_conf *conf = obj->param;
@@ -186,6 +250,8 @@ static int cls_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
                 fprintf(stderr, "invalid match pattern.\n");
                 return EDPVS_INVAL;
             }
+            if (cls_check_police(&param->copt.match.police) != EDPVS_OK)
+                return EDPVS_INVAL;
         } else {
             fprintf(stderr, "invalid cls kind.\n");
             return EDPVS_INVAL;
@@ -206,6 +272,8 @@ static int cls_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
                 fprintf(stderr, "invalid match pattern.\n");
                 return EDPVS_INVAL;
             }
+            if (cls_check_police(&param->copt.match.police) != EDPVS_OK)
+                return EDPVS_INVAL;
         } else {
             fprintf(stderr, "invalid cls kind.\n");
             return EDPVS_INVAL;
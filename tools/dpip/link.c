@@ -540,6 +540,13 @@ static int dump_cpu_stats(lcoreid_t cid)
     printf("    %-20lu%-20lu%-20lu%-20lu\n",
             get.ipackets, get.ibytes, get.opackets, get.obytes);
 
+    printf("    %-20s%-20s%-20s%-20s\n",
+            "timer_expired", "timer_deferred", "timer_budget_hits",
+            "timer_max_latency");
+    printf("    %-20lu%-20lu%-20lu%-20lu\n",
+            get.timer_expired, get.timer_deferred, get.timer_budget_hits,
+            get.timer_max_latency);
+
     return EDPVS_OK;
 }
 
@@ -29,7 +29,7 @@ static void neigh_help(void)
 {
     fprintf(stderr,
             "Usage:\n"
-            "    dpip neigh show [ dev DEVICE ]\n"
+            "    dpip [ -s ] neigh show [ dev DEVICE ]\n"
             "    dpip neigh { add | del } ADDR lladdr LLADDR dev DEVICE\n"
             "    dpip neigh help\n"
            );
@@ -99,7 +99,7 @@ static void neigh_dump(struct dp_vs_neigh_conf *neigh)
     char ipaddr[64];
 
     if (neigh->state >= DPVS_NUD_S_REACHABLE)
-        printf("ip: %-48s mac: %02x:%02x:%02x:%02x:%02x:%02x   state: %-12s  dev: %s  core: %d  %s\n",
+        printf("ip: %-48s mac: %02x:%02x:%02x:%02x:%02x:%02x   state: %-12s  dev: %s  core: %d  %s %s\n",
             inet_ntop(neigh->af, &neigh->ip_addr, ipaddr, sizeof(ipaddr)) ? ipaddr : "::",
             neigh->eth_addr.ether_addr_octet[0],
             neigh->eth_addr.ether_addr_octet[1],
@@ -108,15 +108,28 @@ static void neigh_dump(struct dp_vs_neigh_conf *neigh)
             neigh->eth_addr.ether_addr_octet[4],
             neigh->eth_addr.ether_addr_octet[5],
             nud_state_names[neigh->state], neigh->ifname, neigh->cid,
-            (neigh->flag & NEIGHBOUR_STATIC) ? "static" : "");
+            (neigh->flag & NEIGHBOUR_STATIC) ? "static" : "",
+            (neigh->flag & NEIGHBOUR_PINNED) ? "pinned" : "");
     else
-        printf("ip: %-48s mac:incomplate                       state: %-12s   dev: %s  core: %d  %s\n",
+        printf("ip: %-48s mac:incomplate                       state: %-12s   dev: %s  core: %d  %s %s\n",
             inet_ntop(neigh->af, &neigh->ip_addr, ipaddr, sizeof(ipaddr)) ? ipaddr : "::",
             nud_state_names[neigh->state], neigh->ifname, neigh->cid,
-            (neigh->flag & NEIGHBOUR_STATIC) ? "static" : "");
+            (neigh->flag & NEIGHBOUR_STATIC) ? "static" : "",
+            (neigh->flag & NEIGHBOUR_PINNED) ? "pinned" : "");
     return;
 }
 
+static void neigh_stats_dump(const struct dp_vs_neigh_stats *stats)
+{
+    printf("neighbour statistics:\n");
+    printf("    lookup_miss %-16lu unresolved %-16lu pinned_miss %lu\n",
+           stats->lookup_miss, stats->unresolved, stats->pinned_miss);
+    printf("    queued      %-16lu unres_drop %-16lu\n",
+           stats->queued, stats->unres_drop);
+    printf("    requests    %-16lu probes     %-16lu\n",
+           stats->requests, stats->probes);
+}
+
 static inline bool is_mac_valid(const struct ether_addr *ea)
 {
     return (ea->ether_addr_octet[0] || ea->ether_addr_octet[1] ||
@@ -130,6 +143,7 @@ static int neigh_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
 {
     struct dp_vs_neigh_conf neigh;
     struct dp_vs_neigh_conf_array *array;
+    struct dp_vs_neigh_stats *stats;
     size_t size, i;
     int err;
 
@@ -152,6 +166,21 @@ static int neigh_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
         for (i = 0; i < array->neigh_nums; i++)
             neigh_dump(&array->addrs[i]);
         dpvs_sockopt_msg_free(array);
+
+        if (!conf->stats)
+            return EDPVS_OK;
+
+        err = dpvs_getsockopt(SOCKOPT_GET_NEIGH_STATS, NULL, 0,
+                              (void **)&stats, &size);
+        if (err != 0)
+            return err;
+        if (size != sizeof(*stats)) {
+            fprintf(stderr, "corrupted response.\n");
+            dpvs_sockopt_msg_free(stats);
+            return EDPVS_INVAL;
+        }
+        neigh_stats_dump(stats);
+        dpvs_sockopt_msg_free(stats);
         return EDPVS_OK;
 
     case DPIP_CMD_ADD:
@@ -39,79 +39,22 @@ static void qsch_help(void)
         "              [ QSCH_KIND [ QOPTIONS ] ]\n"
         "\n"
         "Parameters:\n"
-        "    QSCH_KIND := { [b|p]fifo | tbf }\n"
-        "    QOPTIONS  := { FIFO_OPTS | TBF_OPTS }\n"
+        "    QSCH_KIND := { [b|p]fifo | tbf | htb | fq_codel }\n"
+        "    QOPTIONS  := { FIFO_OPTS | TBF_OPTS | HTB_OPTS | FQ_CODEL_OPTS }\n"
         "    FIFO_OPTS := [ limit NUMBER ]\n"
         "    TBF_OPTS  := rate RATE burst BYTES { latency MS | limit BYTES }\n"
         "                 [ peakrate RATE mtu BYTES ]\n"
+        "    HTB_OPTS  := rate RATE burst BYTES [ ceil RATE [ cburst BYTES ] ]\n"
+        "                 [ limit NUMBER ] [ quantum BYTES ]\n"
+        "    FQ_CODEL_OPTS := [ limit NUMBER ] [ flows NUMBER ] [ quantum BYTES ]\n"
+        "                 [ target US ] [ interval US ]\n"
         "    RATE      := raw bits per-second, and possible followed by\n"
         "                 a SI unit (k, m, g).\n"
         "    MS        := milliseconds.\n"
+        "    US        := microseconds.\n"
         );
 }
 
-static uint32_t rate_atoi(const char *rate)
-{
-    char r_buf[64], *p;
-    uint64_t r, mul = 1, i;
-
-    if (!rate || !strlen(rate))
-        return 0;
-    snprintf(r_buf, sizeof(r_buf), "%s", rate);
-
-    p = &r_buf[strlen(r_buf) - 1];
-    switch (*p) {
-    case 'k':
-    case 'K':
-        mul = 1000UL;
-        *p = '\0';
-        break;
-    case 'm':
-    case 'M':
-        mul = 1000000UL;
-        *p = '\0';
-        break;
-    case 'g':
-    case 'G':
-        mul = 1000000000UL;
-        *p = '\0';
-        break;
-    default:
-        break;
-    }
-
-    if (!strlen(r_buf))
-        return 0;
-
-    for (i = 0; i < strlen(r_buf); i++)
-        if (!isdigit(r_buf[i]))
-            return 0;
-
-    if (sscanf(r_buf, "%lu", &r) != 1)
-        return 0;
-
-    if (r >= 4294967296 || r * mul >= 4294967296)
-        return 0;
-
-    return r * mul;
-}
-
-static char *rate_itoa(uint32_t rate, char *buf, size_t size)
-{
-    double r = rate;
-
-    if (rate >= 1000000000UL)
-        snprintf(buf, size, "%.2fGbps", r/1000000000);
-    else if (rate >= 1000000UL)
-        snprintf(buf, size, "%.2fMbps", r/1000000);
-    else if (rate >= 1000UL)
-        snprintf(buf, size, "%.2fKbps", r/1000);
-    else
-        snprintf(buf, size, "%ubps", rate);
-
-    return buf;
-}
-
 static uint32_t latency_to_limit(const char *latency, uint32_t rate)
 {
     int64_t lat = atol(latency); /* ms */
@@ -143,7 +86,9 @@ static int qsch_parse(struct dpip_obj *obj, struct dpip_conf *cf)
             param->where = tc_handle_atoi(CURRARG(cf));
         } else if (strcmp(CURRARG(cf), "bfifo") == 0 ||
                    strcmp(CURRARG(cf), "pfifo") == 0 ||
-                   strcmp(CURRARG(cf), "tbf") == 0) {
+                   strcmp(CURRARG(cf), "tbf") == 0 ||
+                   strcmp(CURRARG(cf), "htb") == 0 ||
+                   strcmp(CURRARG(cf), "fq_codel") == 0) {
             snprintf(param->kind, TCNAMESIZ, "%s", CURRARG(cf));
         } else { /* kind must be set ahead then QOPTIONS */
             if (strcmp(&param->kind[1], "fifo") == 0) {
@@ -196,6 +141,59 @@ static int qsch_parse(struct dpip_obj *obj, struct dpip_conf *cf)
                             param->kind, CURRARG(cf));
                     return EDPVS_INVAL;
                 }
+            } else if (strcmp(param->kind, "htb") == 0) {
+                if (strcmp(CURRARG(cf), "rate") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.htb.rate.rate = rate_atoi(CURRARG(cf));
+                    if (!param->qopt.htb.rate.rate) {
+                        fprintf(stderr, "invalid rate: `%s'\n", CURRARG(cf));
+                        return EDPVS_INVAL;
+                    }
+                } else if (strcmp(CURRARG(cf), "ceil") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.htb.ceil.rate = rate_atoi(CURRARG(cf));
+                    if (!param->qopt.htb.ceil.rate) {
+                        fprintf(stderr, "invalid ceil: `%s'\n", CURRARG(cf));
+                        return EDPVS_INVAL;
+                    }
+                } else if (strcmp(CURRARG(cf), "burst") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.htb.buffer = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "cburst") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.htb.cbuffer = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "limit") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.htb.limit = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "quantum") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.htb.quantum = atoi(CURRARG(cf));
+                } else {
+                    fprintf(stderr, "invalid option for %s: `%s'\n",
+                            param->kind, CURRARG(cf));
+                    return EDPVS_INVAL;
+                }
+            } else if (strcmp(param->kind, "fq_codel") == 0) {
+                if (strcmp(CURRARG(cf), "limit") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.fq_codel.limit = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "flows") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.fq_codel.flows = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "quantum") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.fq_codel.quantum = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "target") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.fq_codel.target = atoi(CURRARG(cf));
+                } else if (strcmp(CURRARG(cf), "interval") == 0) {
+                    NEXTARG_CHECK(cf, CURRARG(cf));
+                    param->qopt.fq_codel.interval = atoi(CURRARG(cf));
+                } else {
+                    fprintf(stderr, "invalid option for %s: `%s'\n",
+                            param->kind, CURRARG(cf));
+                    return EDPVS_INVAL;
+                }
             } else {
                 fprintf(stderr, "invalid/miss qsch kind: `%s'\n", param->kind);
                 return EDPVS_INVAL;
@@ -238,6 +236,26 @@ static int qsch_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
                 fprintf(stderr, "missing buffer for tbf.\n");
                 return EDPVS_INVAL;
             }
+        } else if (strcmp(param->kind, "htb") == 0) {
+            if (!param->qopt.htb.rate.rate) {
+                fprintf(stderr, "missing rate for htb.\n");
+                return EDPVS_INVAL;
+            }
+            if (!param->qopt.htb.buffer) {
+                fprintf(stderr, "missing burst for htb.\n");
+                return EDPVS_INVAL;
+            }
+            if (param->qopt.htb.ceil.rate &&
+                param->qopt.htb.ceil.rate < param->qopt.htb.rate.rate) {
+                fprintf(stderr, "ceil is less than rate.\n");
+                return EDPVS_INVAL;
+            }
+        } else if (strcmp(param->kind, "fq_codel") == 0) {
+            if (param->qopt.fq_codel.interval &&
+                param->qopt.fq_codel.target >= param->qopt.fq_codel.interval) {
+                fprintf(stderr, "target must be less than interval.\n");
+                return EDPVS_INVAL;
+            }
         } else {
             fprintf(stderr, "invalid qsch kind.\n");
             return EDPVS_INVAL;
@@ -255,7 +273,9 @@ static int qsch_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
 
         if (strcmp(param->kind, "pfifo") != 0 &&
             strcmp(param->kind, "bfifo") != 0 &&
-            strcmp(param->kind, "tbf") != 0) {
+            strcmp(param->kind, "tbf") != 0 &&
+            strcmp(param->kind, "htb") != 0 &&
+            strcmp(param->kind, "fq_codel") != 0) {
             fprintf(stderr, "invalid qsch kind.\n");
             return EDPVS_INVAL;
         }
@@ -314,6 +334,19 @@ static void qsch_dump_param(const char *ifname, const union tc_param *param,
                    rate_itoa(tbf->peakrate.rate, rate, sizeof(rate)), tbf->mtu);
 
         printf(" limit %uB", tbf->limit);
+    } else if (strcmp(qsch->kind, "htb") == 0) {
+        const struct tc_htb_qopt *htb = &qsch->qopt.htb;
+
+        printf(" rate %s burst %uB",
+               rate_itoa(htb->rate.rate, rate, sizeof(rate)), htb->buffer);
+        printf(" ceil %s cburst %uB",
+               rate_itoa(htb->ceil.rate, rate, sizeof(rate)), htb->cbuffer);
+        printf(" limit %u quantum %uB", htb->limit, htb->quantum);
+    } else if (strcmp(qsch->kind, "fq_codel") == 0) {
+        const struct tc_fq_codel_qopt *fq = &qsch->qopt.fq_codel;
+
+        printf(" limit %u flows %u quantum %uB target %uus interval %uus",
+               fq->limit, fq->flows, fq->quantum, fq->target, fq->interval);
     }
     printf("\n");
 
@@ -0,0 +1,156 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Tool for synproxy statistics.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "common.h"
+#include "dpip.h"
+#include "sockopt.h"
+#include "conf/synproxy.h"
+
+enum {
+    SYNPROXY_STATS_CPU_ALL      = 0xFFFFFFFF,
+    SYNPROXY_STATS_CPU_TOTAL    = 0xFFFFFFFE,
+};
+
+struct synproxy_conf {
+    int stats_cpu;
+};
+
+static struct synproxy_conf synproxy_conf;
+
+static void synproxy_help(void)
+{
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "    dpip synproxy show [ cpu CPU | all | total ]\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Example:\n");
+    fprintf(stderr, "    dpip synproxy show\n");
+    fprintf(stderr, "    dpip synproxy show all\n");
+    fprintf(stderr, "    dpip synproxy show cpu 6\n");
+}
+
+static int synproxy_parse(struct dpip_obj *obj, struct dpip_conf *cf)
+{
+    struct synproxy_conf *conf = obj->param;
+
+    memset(conf, 0, sizeof(*conf));
+    conf->stats_cpu = SYNPROXY_STATS_CPU_TOTAL;
+
+    while (cf->argc > 0) {
+        if (strcmp(CURRARG(cf), "cpu") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+
+            conf->stats_cpu = atoi(CURRARG(cf));
+            if (conf->stats_cpu < 0 || conf->stats_cpu >= DPVS_MAX_LCORE) {
+                fprintf(stderr, "bad cpu id `%s'\n", CURRARG(cf));
+                return EDPVS_INVAL;
+            }
+        } else if (strcmp(CURRARG(cf), "all") == 0) {
+            conf->stats_cpu = SYNPROXY_STATS_CPU_ALL;
+        } else if (strcmp(CURRARG(cf), "total") == 0) {
+            conf->stats_cpu = SYNPROXY_STATS_CPU_TOTAL;
+        } else {
+            fprintf(stderr, "unknow argument `%s'\n", CURRARG(cf));
+            return EDPVS_INVAL;
+        }
+
+        NEXTARG(cf);
+    }
+
+    return EDPVS_OK;
+}
+
+static void synproxy_stats_dump(const char *title, const char *prefix,
+                                struct dp_vs_synproxy_stats st)
+{
+    if (title)
+        printf("%s\n", title);
+
+    printf("%s%-16s %" PRIu64 "\n", prefix, "ack_held", st.ack_held);
+    printf("%s%-16s %" PRIu64 "\n", prefix, "ack_bytes", st.ack_bytes);
+    printf("%s%-16s %" PRIu64 "\n", prefix, "ack_saved", st.ack_saved);
+    printf("%s%-16s %" PRIu64 "\n", prefix, "ack_refused", st.ack_refused);
+}
+
+static int synproxy_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                           struct dpip_conf *conf)
+{
+    struct dp_vs_synproxy_stats_param *stats;
+    struct synproxy_conf *cf = obj->param;
+    char cpu[16];
+    size_t size;
+    int err, i;
+
+    if (cmd != DPIP_CMD_SHOW)
+        return EDPVS_NOTSUPP;
+
+    err = dpvs_getsockopt(SOCKOPT_GET_SYNPROXY_STATS, NULL, 0,
+                          (void **)&stats, &size);
+    if (err != EDPVS_OK)
+        return EDPVS_INVAL;
+
+    if (size != sizeof(*stats)) {
+        fprintf(stderr, "corrupted response.\n");
+        dpvs_sockopt_msg_free(stats);
+        return EDPVS_INVAL;
+    }
+
+    switch (cf->stats_cpu) {
+    case SYNPROXY_STATS_CPU_TOTAL:
+        synproxy_stats_dump(NULL, "", stats->stats);
+        break;
+    case SYNPROXY_STATS_CPU_ALL:
+        synproxy_stats_dump("All", "    ", stats->stats);
+
+        for (i = 0; i < NELEMS(stats->stats_cpus); i++) {
+            snprintf(cpu, sizeof(cpu), "cpu %d", i);
+            synproxy_stats_dump(cpu, "    ", stats->stats_cpus[i]);
+        }
+        break;
+    default:
+        snprintf(cpu, sizeof(cpu), "cpu %d", cf->stats_cpu);
+        synproxy_stats_dump(cpu, "    ", stats->stats_cpus[cf->stats_cpu]);
+        break;
+    }
+
+    dpvs_sockopt_msg_free(stats);
+
+    return EDPVS_OK;
+}
+
+struct dpip_obj dpip_synproxy = {
+    .name   = "synproxy",
+    .param  = &synproxy_conf,
+    .help   = synproxy_help,
+    .parse  = synproxy_parse,
+    .do_cmd = synproxy_do_cmd,
+};
+
+static void __init synproxy_init(void)
+{
+    dpip_register_obj(&dpip_synproxy);
+}
+
+static void __exit synproxy_exit(void)
+{
+    dpip_unregister_obj(&dpip_synproxy);
+}
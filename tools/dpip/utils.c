@@ -15,7 +15,10 @@
  * GNU General Public License for more details.
  *
  */
+#include <stdio.h>
+#include <string.h>
 #include <stdint.h>
+#include <ctype.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "common.h"
@@ -75,3 +78,66 @@ int inet_pton_try(int *af, const char *src, union inet_addr *dst)
 
     return err;
 }
+
+/* bits per-second, possibly followed by a SI unit (k, m, g) */
+uint32_t rate_atoi(const char *rate)
+{
+    char r_buf[64], *p;
+    uint64_t r, mul = 1, i;
+
+    if (!rate || !strlen(rate))
+        return 0;
+    snprintf(r_buf, sizeof(r_buf), "%s", rate);
+
+    p = &r_buf[strlen(r_buf) - 1];
+    switch (*p) {
+    case 'k':
+    case 'K':
+        mul = 1000UL;
+        *p = '\0';
+        break;
+    case 'm':
+    case 'M':
+        mul = 1000000UL;
+        *p = '\0';
+        break;
+    case 'g':
+    case 'G':
+        mul = 1000000000UL;
+        *p = '\0';
+        break;
+    default:
+        break;
+    }
+
+    if (!strlen(r_buf))
+        return 0;
+
+    for (i = 0; i < strlen(r_buf); i++)
+        if (!isdigit(r_buf[i]))
+            return 0;
+
+    if (sscanf(r_buf, "%lu", &r) != 1)
+        return 0;
+
+    if (r >= 4294967296 || r * mul >= 4294967296)
+        return 0;
+
+    return r * mul;
+}
+
+char *rate_itoa(uint32_t rate, char *buf, size_t size)
+{
+    double r = rate;
+
+    if (rate >= 1000000000UL)
+        snprintf(buf, size, "%.2fGbps", r/1000000000);
+    else if (rate >= 1000000UL)
+        snprintf(buf, size, "%.2fMbps", r/1000000);
+    else if (rate >= 1000UL)
+        snprintf(buf, size, "%.2fKbps", r/1000);
+    else
+        snprintf(buf, size, "%ubps", rate);
+
+    return buf;
+}
@@ -41,4 +41,7 @@ const char *af_itoa(int af);
 bool inet_is_addr_any(int af, const union inet_addr *addr);
 int inet_pton_try(int *af, const char *src, union inet_addr *dst);
 
+uint32_t rate_atoi(const char *rate);
+char *rate_itoa(uint32_t rate, char *buf, size_t size);
+
 #endif /* __DPIP_UTILS_H__ */
@@ -0,0 +1,268 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <linux/pkt_sched.h>
+#include "inet.h"
+#include "stats_reader.h"
+
+#define DPVS_STATS_NAME     "dpvs-stats"
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "Usage:\n"
+        "    "DPVS_STATS_NAME" [OPTIONS] [ lcore | port | service | mib | inet | qsch | all ]\n"
+        "Options:\n"
+        "    -n, --name=NAME    shm name of stats region, default "
+                                DPVS_STATS_SHM_NAME_DEF"\n"
+        "    -h, --help\n"
+        );
+}
+
+static const char *addr_itoa(int af, const union inet_addr *addr,
+                             char *buf, size_t size)
+{
+    if (!inet_ntop(af, addr, buf, size))
+        snprintf(buf, size, "?");
+    return buf;
+}
+
+static void show_lcores(const struct dpvs_stats_shm_hdr *hdr)
+{
+    const struct dpvs_stats_shm_lcore *ent;
+    uint32_t i;
+
+    printf("%-6s %-14s %-14s %-14s %-14s %-14s %-12s %-12s\n",
+           "lcore", "ipackets", "ibytes", "opackets", "obytes", "dropped",
+           "conns", "pktburst");
+    for (i = 0; i < hdr->lcore.num; i++) {
+        ent = dpvs_stats_shm_entry(hdr, &hdr->lcore, i);
+        printf("%-6u %-14lu %-14lu %-14lu %-14lu %-14lu %-12lu %-12lu\n",
+               ent->cid, ent->ipackets, ent->ibytes, ent->opackets,
+               ent->obytes, ent->dropped, ent->ipvs.conns, ent->pktburst);
+    }
+}
+
+static void show_ports(const struct dpvs_stats_shm_hdr *hdr)
+{
+    const struct dpvs_stats_shm_port *ent;
+    uint32_t i;
+
+    printf("%-12s %-14s %-14s %-14s %-14s %-10s %-10s %-10s %-10s\n",
+           "port", "ipackets", "ibytes", "opackets", "obytes",
+           "imissed", "ierrors", "oerrors", "rx_nombuf");
+    for (i = 0; i < hdr->port.num; i++) {
+        ent = dpvs_stats_shm_entry(hdr, &hdr->port, i);
+        printf("%-12s %-14lu %-14lu %-14lu %-14lu %-10lu %-10lu %-10lu %-10lu\n",
+               ent->name, ent->ipackets, ent->ibytes, ent->opackets,
+               ent->obytes, ent->imissed, ent->ierrors, ent->oerrors,
+               ent->rx_nombuf);
+    }
+}
+
+static void show_services(const struct dpvs_stats_shm_hdr *hdr)
+{
+    const struct dpvs_stats_shm_svc *svc;
+    const struct dpvs_stats_shm_dest *dest;
+    char addr[INET6_ADDRSTRLEN], ep[INET6_ADDRSTRLEN + 16];
+    uint32_t i, j;
+
+    printf("%-6s %-46s %-10s %-14s %-14s %-14s %-14s\n",
+           "Prot", "LocalAddress:Port", "Conns", "InPkts", "OutPkts",
+           "InBytes", "OutBytes");
+    printf("  %-51s %-10s %-14s %-14s %-14s %-14s\n",
+           "-> RemoteAddress:Port", "Conns", "InPkts", "OutPkts",
+           "InBytes", "OutBytes");
+
+    for (i = 0; i < hdr->svc.num; i++) {
+        svc = dpvs_stats_shm_entry(hdr, &hdr->svc, i);
+        if (svc->fwmark)
+            snprintf(ep, sizeof(ep), "FWM %u", svc->fwmark);
+        else if (svc->match[0])
+            snprintf(ep, sizeof(ep), "MATCH");
+        else
+            snprintf(ep, sizeof(ep), svc->af == AF_INET6 ? "[%s]:%u" : "%s:%u",
+                     addr_itoa(svc->af, &svc->addr, addr, sizeof(addr)),
+                     ntohs(svc->port));
+        printf("%-6s %-46s %-10lu %-14lu %-14lu %-14lu %-14lu\n",
+               inet_proto_name(svc->proto), ep, svc->stats.conns,
+               svc->stats.inpkts, svc->stats.outpkts, svc->stats.inbytes,
+               svc->stats.outbytes);
+        if (svc->match[0])
+            printf("  %.*s\n", (int)sizeof(svc->match), svc->match);
+
+        for (j = 0; j < svc->ndest; j++) {
+            dest = dpvs_stats_shm_entry(hdr, &hdr->dest, svc->dest_first + j);
+            snprintf(ep, sizeof(ep), dest->af == AF_INET6 ? "[%s]:%u" : "%s:%u",
+                     addr_itoa(dest->af, &dest->addr, addr, sizeof(addr)),
+                     ntohs(dest->port));
+            printf("  -> %-48s %-10lu %-14lu %-14lu %-14lu %-14lu\n",
+                   ep, dest->stats.conns, dest->stats.inpkts,
+                   dest->stats.outpkts, dest->stats.inbytes,
+                   dest->stats.outbytes);
+        }
+    }
+
+    if (hdr->flags & DPVS_STATS_SHM_F_TRUNC)
+        printf("(truncated, more services or dests than the region holds)\n");
+}
+
+static void show_mibs(const struct dpvs_stats_shm_hdr *hdr)
+{
+    const struct dpvs_stats_shm_mib *ent;
+    uint32_t i;
+
+    for (i = 0; i < hdr->mib.num; i++) {
+        ent = dpvs_stats_shm_entry(hdr, &hdr->mib, i);
+        printf("%-32s %lu\n", ent->name, ent->value);
+    }
+}
+
+static void show_inet(const struct dpvs_stats_shm_hdr *hdr)
+{
+    const struct dpvs_stats_shm_inet *ent;
+    uint32_t i;
+
+    for (i = 0; i < hdr->inet.num; i++) {
+        ent = dpvs_stats_shm_entry(hdr, &hdr->inet, i);
+        inet_stats_dump(ent->af == AF_INET6 ? "IPv6" : "IPv4", "    ",
+                        &ent->stats);
+    }
+}
+
+/* like tc_handle_itoa of conf/tc.h, which needs dpvs build flags */
+static const char *handle_itoa(uint32_t handle, char *buf, size_t size)
+{
+    if (handle == TC_H_ROOT)
+        snprintf(buf, size, "root");
+    else if (handle == TC_H_INGRESS)
+        snprintf(buf, size, "ingress");
+    else if (TC_H_MIN(handle))
+        snprintf(buf, size, "%x:%x", TC_H_MAJ(handle) >> 16, TC_H_MIN(handle));
+    else
+        snprintf(buf, size, "%x:", TC_H_MAJ(handle) >> 16);
+    return buf;
+}
+
+static void show_qsch(const struct dpvs_stats_shm_hdr *hdr)
+{
+    const struct dpvs_stats_shm_qsch *ent;
+    char handle[16], parent[16];
+    uint32_t i;
+
+    printf("%-12s %-8s %-8s %-10s %-14s %-12s %-10s %-10s %-10s\n",
+           "dev", "handle", "parent", "kind", "bytes", "packets",
+           "drops", "overlimits", "backlog");
+    for (i = 0; i < hdr->qsch.num; i++) {
+        ent = dpvs_stats_shm_entry(hdr, &hdr->qsch, i);
+        printf("%-12s %-8s %-8s %-10s %-14lu %-12lu %-10u %-10u %-10u\n",
+               ent->dev, handle_itoa(ent->handle, handle, sizeof(handle)),
+               handle_itoa(ent->parent, parent, sizeof(parent)),
+               ent->kind, ent->bytes, ent->packets, ent->drops,
+               ent->overlimits, ent->backlog);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct option opts[] = {
+        {"name", required_argument, NULL, 'n'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    struct dpvs_stats_reader *rd;
+    struct dpvs_stats_shm_hdr *hdr;
+    const char *name = NULL, *what = "all";
+    bool all;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:h", opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            name = optarg;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+
+    if (optind < argc)
+        what = argv[optind];
+    if (strcmp(what, "all") && strcmp(what, "lcore") && strcmp(what, "port") &&
+        strcmp(what, "service") && strcmp(what, "mib") &&
+        strcmp(what, "inet") && strcmp(what, "qsch")) {
+        usage();
+        exit(1);
+    }
+    all = strcmp(what, "all") == 0;
+
+    rd = dpvs_stats_open(name);
+    if (!rd) {
+        fprintf(stderr, "fail to open stats region %s: %s\n",
+                name ? : DPVS_STATS_SHM_NAME_DEF, strerror(errno));
+        exit(1);
+    }
+
+    hdr = dpvs_stats_snapshot(rd);
+    if (!hdr) {
+        fprintf(stderr, "fail to read stats region: %s\n", strerror(errno));
+        dpvs_stats_close(rd);
+        exit(1);
+    }
+
+    if (all || !strcmp(what, "lcore"))
+        show_lcores(hdr);
+    if (all || !strcmp(what, "port")) {
+        if (all)
+            printf("\n");
+        show_ports(hdr);
+    }
+    if (all || !strcmp(what, "service")) {
+        if (all)
+            printf("\n");
+        show_services(hdr);
+    }
+    if (all || !strcmp(what, "mib")) {
+        if (all)
+            printf("\n");
+        show_mibs(hdr);
+    }
+    if (all || !strcmp(what, "inet")) {
+        if (all)
+            printf("\n");
+        show_inet(hdr);
+    }
+    if (all || !strcmp(what, "qsch")) {
+        if (all)
+            printf("\n");
+        show_qsch(hdr);
+    }
+
+    free(hdr);
+    dpvs_stats_close(rd);
+    exit(0);
+}
@@ -0,0 +1,181 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stats_reader.h"
+
+#define STATS_READ_RETRY    100
+#define STATS_READ_WAIT_US  100
+
+#define rmb()               __atomic_thread_fence(__ATOMIC_ACQUIRE)
+
+struct dpvs_stats_reader {
+    char        name[64];
+    void        *addr;
+    size_t      size;
+    dev_t       dev;        /* identify the shm object mapped */
+    ino_t       ino;
+};
+
+static void stats_unmap(struct dpvs_stats_reader *rd)
+{
+    if (rd->addr)
+        munmap(rd->addr, rd->size);
+    rd->addr = NULL;
+    rd->size = 0;
+}
+
+static int stats_map(struct dpvs_stats_reader *rd)
+{
+    const struct dpvs_stats_shm_hdr *hdr;
+    struct stat st;
+    void *addr;
+    int fd;
+
+    fd = shm_open(rd->name, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size < sizeof(*hdr)) {
+        close(fd);
+        errno = EAGAIN;     /* being created */
+        return -1;
+    }
+
+    addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return -1;
+
+    hdr = addr;
+    if (hdr->magic != DPVS_STATS_SHM_MAGIC ||
+        hdr->version != DPVS_STATS_SHM_VERSION ||
+        hdr->size > st.st_size) {
+        munmap(addr, st.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+
+    rd->addr = addr;
+    rd->size = st.st_size;
+    rd->dev = st.st_dev;
+    rd->ino = st.st_ino;
+    return 0;
+}
+
+/*
+ * a region unlinked by a stopped dpvs is left behind by a new one,
+ * which may have the same size, so tell them by inode.
+ */
+static int stats_stale(struct dpvs_stats_reader *rd)
+{
+    struct stat st;
+    int fd, stale;
+
+    fd = shm_open(rd->name, O_RDONLY, 0);
+    if (fd < 0)
+        return 1;
+    stale = fstat(fd, &st) < 0 || st.st_ino != rd->ino ||
+            st.st_dev != rd->dev || st.st_size != rd->size;
+    close(fd);
+
+    return stale;
+}
+
+struct dpvs_stats_reader *dpvs_stats_open(const char *name)
+{
+    struct dpvs_stats_reader *rd;
+
+    rd = calloc(1, sizeof(*rd));
+    if (!rd)
+        return NULL;
+
+    snprintf(rd->name, sizeof(rd->name), "%s", name ? : DPVS_STATS_SHM_NAME_DEF);
+
+    if (stats_map(rd) < 0) {
+        free(rd);
+        return NULL;
+    }
+
+    return rd;
+}
+
+void dpvs_stats_close(struct dpvs_stats_reader *rd)
+{
+    if (!rd)
+        return;
+    stats_unmap(rd);
+    free(rd);
+}
+
+struct dpvs_stats_shm_hdr *dpvs_stats_snapshot(struct dpvs_stats_reader *rd)
+{
+    const struct dpvs_stats_shm_hdr *hdr;
+    struct dpvs_stats_shm_hdr *copy;
+    uint32_t seq;
+    size_t size;
+    int i;
+
+    if (!rd) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!rd->addr || stats_stale(rd)) {
+        stats_unmap(rd);
+        if (stats_map(rd) < 0)
+            return NULL;
+    }
+
+    hdr = rd->addr;
+    size = hdr->size;
+    copy = malloc(size);
+    if (!copy)
+        return NULL;
+
+    for (i = 0; i < STATS_READ_RETRY; i++) {
+        seq = hdr->seq;
+        if (seq & 1) {
+            usleep(STATS_READ_WAIT_US);
+            continue;
+        }
+        rmb();
+
+        memcpy(copy, hdr, size);
+
+        rmb();
+        if (hdr->seq == seq) {
+            copy->seq = seq;
+            return copy;
+        }
+    }
+
+    free(copy);
+    errno = EAGAIN;
+    return NULL;
+}
@@ -0,0 +1,40 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * reader of dpvs shared-memory statistics region (conf/stats_shm.h).
+ * it only maps the region read-only, dpvs is never involved.
+ */
+#ifndef __DPVS_STATS_READER_H__
+#define __DPVS_STATS_READER_H__
+#include <stddef.h>
+#include "conf/stats_shm.h"
+
+struct dpvs_stats_reader;
+
+/* @name of shm, NULL for DPVS_STATS_SHM_NAME_DEF */
+struct dpvs_stats_reader *dpvs_stats_open(const char *name);
+void dpvs_stats_close(struct dpvs_stats_reader *rd);
+
+/*
+ * consistent copy of the whole region, freed by caller with free().
+ * the region is mapped again if dpvs restarted. NULL with errno set
+ * on failure, EAGAIN if dpvs keeps updating it.
+ */
+struct dpvs_stats_shm_hdr *dpvs_stats_snapshot(struct dpvs_stats_reader *rd);
+
+#endif /* __DPVS_STATS_READER_H__ */
@@ -766,12 +766,13 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 			{
 			set_option(options, OPT_SYNPROXY);
 
+			ce->svc.flags &= ~(IP_VS_CONN_F_SYNPROXY | IP_VS_SVC_F_SYNPROXY_AUTO);
 			if(!memcmp(optarg , "enable" , strlen("enable")))
 				ce->svc.flags = ce->svc.flags | IP_VS_CONN_F_SYNPROXY;
-			else if(!memcmp(optarg , "disable" , strlen("disable")))
-				ce->svc.flags = ce->svc.flags & (~IP_VS_CONN_F_SYNPROXY);
-			else
-				fail(2 , "synproxy switch must be enable or disable\n");
+			else if(!memcmp(optarg , "auto" , strlen("auto")))
+				ce->svc.flags = ce->svc.flags | IP_VS_SVC_F_SYNPROXY_AUTO;
+			else if(memcmp(optarg , "disable" , strlen("disable")))
+				fail(2 , "synproxy switch must be enable, auto or disable\n");
 
 			break;
 			}
@@ -1485,7 +1486,7 @@ static void usage_exit(const char *program, const int exit_status)
 		"  --ops          -o                   one-packet scheduling\n"
 		"  --numeric      -n                   numeric output of addresses and ports\n"
 		"  --ifname       -F                   nic interface for laddrs\n"
-		"  --synproxy     -j                   TCP syn proxy\n"
+		"  --synproxy     -j SWITCH            TCP syn proxy: enable, auto (on syn flood) or disable\n"
 		"  --match        -H MATCH             select service by MATCH 'proto,srange,drange,iif,oif'\n"
 		"  --hash-target  -Y hashtag           choose target for conhash (support sip or qid for quic)\n",
 		DEF_SCHED);
@@ -1894,6 +1895,10 @@ print_service_entry(ipvs_service_entry_t *se, unsigned int format)
 		}
 		if (se->flags & IP_VS_CONN_F_SYNPROXY)
 			printf(" synproxy");
+		else if (se->flags & IP_VS_SVC_F_SYNPROXY_ACTIVE)
+			printf(" synproxy auto(on)");
+		else if (se->flags & IP_VS_SVC_F_SYNPROXY_AUTO)
+			printf(" synproxy auto");
         if (se->conn_timeout != 0)
             printf(" conn_timeout %u", se->conn_timeout);
 	}
@@ -230,6 +230,19 @@ free_checkers_queue(void)
 	ncheckers = 0;
 }
 
+/* delay_loop with a random jitter, so that checks started in the same
+ * tick drift apart instead of firing in bursts every delay_loop */
+long
+checker_delay(checker_t *checker)
+{
+	long delay = checker->vs->delay_loop;
+	long jitter = delay / CHECKER_JITTER_DIV;
+
+	if (jitter)
+		delay += (long)(2.0 * jitter * rand() / RAND_MAX) - jitter;
+	return delay;
+}
+
 /* register checkers to the global I/O scheduler */
 void
 register_checkers_thread(void)
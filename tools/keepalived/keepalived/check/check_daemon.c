@@ -50,6 +50,12 @@ extern char *checkers_pidfile;
 static void
 stop_check(void)
 {
+#ifdef _KRNL_2_6_
+	/* Send pending IPVS changes */
+	ipvs_coalesce_stop();
+	ipvs_batch_end();
+#endif
+
 	/* Destroy master thread */
 	signal_handler_destroy();
 	thread_destroy_master(master);
@@ -122,6 +128,11 @@ start_check(void)
 		return;
 	}
 
+#ifdef _KRNL_2_6_
+	/* Send IPVS topology changes in batches */
+	ipvs_batch_begin();
+#endif
+
 	/* Processing differential configuration parsing */
 	if (reload) {
 		clear_diff_services();
@@ -141,6 +152,14 @@ start_check(void)
 		return;
 	}
 
+#ifdef _KRNL_2_6_
+	if (ipvs_batch_end() != IPVS_SUCCESS) {
+		stop_check();
+		return;
+	}
+	ipvs_coalesce_start();
+#endif
+
 	/* Dump configuration */
 	if (debug & 4) {
 		dump_global_data(global_data);
@@ -192,6 +211,11 @@ reload_check_thread(thread_t * thread)
 
 	log_message(LOG_INFO, "Got SIGHUP, reloading checker configuration");
 
+#ifdef _KRNL_2_6_
+	/* Send pending IPVS changes before old config is freed */
+	ipvs_coalesce_stop();
+#endif
+
 	/* Signals handling */
 	signal_reset();
 	signal_handler_destroy();
@@ -347,7 +347,7 @@ dump_vs(void *data)
 	log_message(LOG_INFO, "   alpha is %s, omega is %s",
 		    vs->alpha ? "ON" : "OFF", vs->omega ? "ON" : "OFF");
 	log_message(LOG_INFO, "   SYN proxy is %s", 
-		    vs->syn_proxy ? "ON" : "OFF");
+		    vs->syn_proxy == 2 ? "AUTO" : (vs->syn_proxy ? "ON" : "OFF"));
 	log_message(LOG_INFO, "   quorum = %lu, hysteresis = %lu", vs->quorum, vs->hysteresis);
 	if (vs->quorum_up)
 		log_message(LOG_INFO, "   -> Notify script UP = %s",
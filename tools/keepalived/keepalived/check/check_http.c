@@ -61,6 +61,8 @@ free_http_get_check(void *data)
 {
 	http_checker_t *http_get_chk = CHECKER_DATA(data);
 
+	if (http_get_chk->arg->fd != -1)
+		close(http_get_chk->arg->fd);
 	free_list(http_get_chk->url);
 	FREE(http_get_chk->arg);
 	FREE(http_get_chk);
@@ -84,6 +86,8 @@ dump_http_get_check(void *data)
 	log_message(LOG_INFO, "   Nb get retry = %d", http_get_chk->nb_get_retry);
 	log_message(LOG_INFO, "   Delay before retry = %lu",
 	       http_get_chk->delay_before_retry/TIMER_HZ);
+	if (http_get_chk->persistent)
+		log_message(LOG_INFO, "   Persistent connection");
 	dump_list(http_get_chk->url);
 }
 static http_checker_t *
@@ -93,6 +97,7 @@ alloc_http_get(char *proto)
 
 	http_get_chk = (http_checker_t *) MALLOC(sizeof (http_checker_t));
 	http_get_chk->arg = (http_t *) MALLOC(sizeof (http_t));
+	http_get_chk->arg->fd = -1;
 	http_get_chk->proto =
 	    (!strcmp(proto, "HTTP_GET")) ? PROTO_HTTP : PROTO_SSL;
 	http_get_chk->url = alloc_list(free_url, dump_url);
@@ -128,6 +133,13 @@ delay_before_retry_handler(vector_t *strvec)
 	http_get_chk->delay_before_retry = CHECKER_VALUE_INT(strvec) * TIMER_HZ;
 }
 
+void
+persistent_connection_handler(vector_t *strvec)
+{
+	http_checker_t *http_get_chk = CHECKER_GET();
+	http_get_chk->persistent = 1;
+}
+
 void
 url_handler(vector_t *strvec)
 {
@@ -176,6 +188,7 @@ install_http_check_keyword(void)
 	install_keyword("warmup", &warmup_handler);
 	install_keyword("nb_get_retry", &nb_get_retry_handler);
 	install_keyword("delay_before_retry", &delay_before_retry_handler);
+	install_keyword("persistent_connection", &persistent_connection_handler);
 	install_keyword("url", &url_handler);
 	install_sublevel();
 	install_keyword("path", &path_handler);
@@ -280,14 +293,14 @@ epilog(thread_t * thread, int method, int t, int c)
 	switch (method) {
 	case 1:
 		if (req)
-			delay = checker->vs->delay_loop;
+			delay = checker_delay(checker);
 		else
 			delay =
 			    http_get_check->delay_before_retry;
 		break;
 	case 2:
 		if (http->url_it == 0 && http->retry_it == 0)
-			delay = checker->vs->delay_loop;
+			delay = checker_delay(checker);
 		else
 			delay = http_get_check->delay_before_retry;
 		break;
@@ -299,9 +312,13 @@ epilog(thread_t * thread, int method, int t, int c)
 			SSL_free(req->ssl);
 		if (req->buffer)
 			FREE(req->buffer);
+		/* Keep the connection once the whole response was read */
+		if (req->keepalive && req->body_len == req->content_len)
+			http->fd = thread->u.fd;
+		else
+			close(thread->u.fd);
 		FREE(req);
 		http->req = NULL;
-		close(thread->u.fd);
 	}
 
 	/* Register next checker thread */
@@ -330,6 +347,30 @@ timeout_epilog(thread_t * thread, char *smtp_msg, char *debug_msg)
 	return epilog(thread, 1, 0, 0);
 }
 
+/*
+ * The server closed the connection kept from the previous request
+ * before answering, check again on a new connection.
+ */
+static int
+http_reconnect(thread_t * thread)
+{
+	checker_t *checker = THREAD_ARG(thread);
+	http_checker_t *http_get_check = CHECKER_ARG(checker);
+	http_t *http = HTTP_ARG(http_get_check);
+	request_t *req = HTTP_REQ(http);
+
+	DBG("Kept connection to %s closed, reconnecting.", FMT_HTTP_RS(checker));
+
+	if (req->buffer)
+		FREE(req->buffer);
+	FREE(req);
+	http->req = NULL;
+	close(thread->u.fd);
+
+	thread_add_event(thread->master, http_connect_thread, checker, 0);
+	return 0;
+}
+
 /* return the url pointer of the current url iterator  */
 url_t *
 fetch_next_url(http_checker_t * http_get_check)
@@ -464,7 +505,48 @@ http_handle_response(thread_t * thread, unsigned char digest[16]
 	return epilog(thread, 1, 0, 0) + 1;
 }
 
-/* Handle response stream performing MD5 updates */
+/*
+ * Body length of a response the server keeps the connection open
+ * after, -1 if the body ends on EOF.
+ */
+static int
+http_keepalive_length(char *buffer, char *end)
+{
+	char *cur, *eol;
+	int len = -1;
+	int keepalive = 0;
+
+	for (cur = buffer; cur < end; cur = eol + 1) {
+		if (!(eol = memchr(cur, '\n', end - cur)))
+			break;
+		if (!strncasecmp(cur, "Content-Length:", 15))
+			len = atoi(cur + 15);
+		else if (!strncasecmp(cur, "Connection:", 11)) {
+			for (cur += 11; cur < eol && *cur == ' '; cur++) ;
+			keepalive = !strncasecmp(cur, "Keep-Alive", 10);
+		}
+	}
+
+	return (keepalive && len >= 0) ? len : -1;
+}
+
+/* MD5 the body, never past the Content-Length of a kept response */
+static void
+http_digest_body(request_t *req, int len)
+{
+	if (req->content_len != -1 && len > req->content_len - req->body_len) {
+		/* Trailing data, the connection can't be reused */
+		len = req->content_len - req->body_len;
+		req->keepalive = 0;
+	}
+	MD5_Update(&req->context, req->buffer, len);
+	req->body_len += len;
+}
+
+/*
+ * Handle response stream performing MD5 updates.
+ * Return 1 once the body of a kept-alive response is complete.
+ */
 int
 http_process_response(request_t *req, int r)
 {
@@ -473,21 +555,25 @@ http_process_response(request_t *req, int r)
 		if ((req->extracted =
 		     extract_html(req->buffer, req->len))) {
 			req->status_code = extract_status_code(req->buffer, req->len);
+			if (req->keepalive) {
+				req->content_len = http_keepalive_length(req->buffer,
+									 req->extracted);
+				req->keepalive = (req->content_len != -1);
+			}
 			r = req->len - (req->extracted - req->buffer);
 			if (r) {
 				memmove(req->buffer, req->extracted, r);
-				MD5_Update(&req->context, req->buffer, r);
+				http_digest_body(req, r);
 				r = 0;
 			}
 			req->len = r;
 		}
 	} else if (req->len) {
-		MD5_Update(&req->context, req->buffer,
-			   req->len);
+		http_digest_body(req, req->len);
 		req->len = 0;
 	}
 
-	return 0;
+	return req->extracted && req->body_len == req->content_len;
 }
 
 /* Asynchronous HTTP stream reader */
@@ -501,23 +587,15 @@ http_read_thread(thread_t * thread)
 	unsigned timeout = checker->co->connection_to;
 	unsigned char digest[16];
 	int r = 0;
-	int val;
 
 	/* Handle read timeout */
 	if (thread->type == THREAD_READ_TIMEOUT)
 		return timeout_epilog(thread, "=> HTTP CHECK failed on service"
 				      " : recevice data <=\n\n", "HTTP read");
 
-	/* Set descriptor non blocking */
-	val = fcntl(thread->u.fd, F_GETFL, 0);
-	fcntl(thread->u.fd, F_SETFL, val | O_NONBLOCK);
-
-	/* read the HTTP stream */
-	r = read(thread->u.fd, req->buffer + req->len,
-		 MAX_BUFFER_LENGTH - req->len);
-
-	/* restore descriptor flags */
-	fcntl(thread->u.fd, F_SETFL, val);
+	/* read the HTTP stream without blocking */
+	r = recv(thread->u.fd, req->buffer + req->len,
+		 MAX_BUFFER_LENGTH - req->len, MSG_DONTWAIT);
 
 	/* Test if data are ready */
 	if (r == -1 && (errno == EAGAIN || errno == EINTR)) {
@@ -531,6 +609,11 @@ http_read_thread(thread_t * thread)
 
 	if (r == -1 || r == 0) {	/* -1:error , 0:EOF */
 
+		/* Nothing was answered on the kept connection */
+		if (req->reused && !req->extracted && !req->len)
+			return http_reconnect(thread);
+		req->keepalive = 0;
+
 		/* All the HTTP stream has been parsed */
 		MD5_Final(digest, &req->context);
 
@@ -557,7 +640,12 @@ http_read_thread(thread_t * thread)
 	} else {
 
 		/* Handle response stream */
-		http_process_response(req, r);
+		if (http_process_response(req, r)) {
+			/* Whole body read, the server keeps the connection */
+			MD5_Final(digest, &req->context);
+			http_handle_response(thread, digest, 0);
+			return 0;
+		}
 
 		/*
 		 * Register next http stream reader.
@@ -593,15 +681,17 @@ http_response_thread(thread_t * thread)
 	req->extracted = NULL;
 	req->len = 0;
 	req->error = 0;
+	req->keepalive = http_get_check->persistent;
+	req->content_len = -1;
+	req->body_len = 0;
 	MD5_Init(&req->context);
 
-	/* Register asynchronous http/ssl read thread */
+	/* Register asynchronous ssl read thread, http data is already there */
 	if (http_get_check->proto == PROTO_SSL)
 		thread_add_read(thread->master, ssl_read_thread, checker,
 				thread->u.fd, timeout);
 	else
-		thread_add_read(thread->master, http_read_thread, checker,
-				thread->u.fd, timeout);
+		return http_read_thread(thread);
 	return 0;
 }
 
@@ -618,6 +708,7 @@ http_request_thread(thread_t * thread)
 	char *vhost = CHECKER_VHOST(checker);
 	char *request_host = 0;
 	char *request_host_port = 0;
+	char *keepalive = http_get_check->persistent ? KEEPALIVE_HEADER : "";
 	char *str_request;
 	url_t *fetched_url;
 	int ret = 0;
@@ -651,10 +742,12 @@ http_request_thread(thread_t * thread)
 	if(addr->ss_family == AF_INET6 && !vhost){
 		/* if literal ipv6 address, use ipv6 template, see RFC 2732 */
 		snprintf(str_request, GET_BUFFER_LENGTH, REQUEST_TEMPLATE_IPV6,
-			fetched_url->path, request_host, request_host_port);
+			fetched_url->path, request_host, request_host_port,
+			keepalive);
 	} else {
 		snprintf(str_request, GET_BUFFER_LENGTH, REQUEST_TEMPLATE,
-			fetched_url->path, request_host, request_host_port);
+			fetched_url->path, request_host, request_host_port,
+			keepalive);
 	}
 
 	FREE(request_host_port);
@@ -663,24 +756,27 @@ http_request_thread(thread_t * thread)
 	    http->url_it + 1
 	    , FMT_HTTP_RS(checker));
 
-	/* Set descriptor non blocking */
-	val = fcntl(thread->u.fd, F_GETFL, 0);
-	fcntl(thread->u.fd, F_SETFL, val | O_NONBLOCK);
-
 	/* Send the GET request to remote Web server */
 	if (http_get_check->proto == PROTO_SSL) {
+		/* Set descriptor non blocking */
+		val = fcntl(thread->u.fd, F_GETFL, 0);
+		fcntl(thread->u.fd, F_SETFL, val | O_NONBLOCK);
+
 		ret = ssl_send_request(req->ssl, str_request,
 				       strlen(str_request));
+
+		/* restore descriptor flags */
+		fcntl(thread->u.fd, F_SETFL, val);
 	} else {
-		ret = (send(thread->u.fd, str_request, strlen(str_request), 0) !=
-		       -1) ? 1 : 0;
+		ret = (send(thread->u.fd, str_request, strlen(str_request),
+			    MSG_DONTWAIT) != -1) ? 1 : 0;
 	}
 
-	/* restore descriptor flags */
-	fcntl(thread->u.fd, F_SETFL, val);
-
 	FREE(str_request);
 
+	if (!ret && req->reused)
+		return http_reconnect(thread);
+
 	if (!ret) {
 		log_message(LOG_INFO, "Cannot send get request to %s."
 				    , FMT_HTTP_RS(checker));
@@ -845,8 +941,12 @@ http_connect_thread(thread_t * thread)
 	 * if checker is disabled
 	 */
 	if (!CHECKER_ENABLED(checker)) {
+		if (http->fd != -1) {
+			close(http->fd);
+			http->fd = -1;
+		}
 		thread_add_timer(thread->master, http_connect_thread, checker,
-				 checker->vs->delay_loop);
+				 checker_delay(checker));
 		return 0;
 	}
 
@@ -871,11 +971,22 @@ http_connect_thread(thread_t * thread)
 		return epilog(thread, 1, 0, 0) + 1;
 	}
 
+	/* Send the request on the connection kept by the previous one */
+	if (http->fd != -1) {
+		fd = http->fd;
+		http->fd = -1;
+		http->req = (request_t *) MALLOC(sizeof (request_t));
+		http->req->reused = 1;
+		thread_add_write(thread->master, http_request_thread, checker,
+				 fd, co->connection_to);
+		return 0;
+	}
+
 	/* Create the socket */
 	if ((fd = socket(co->dst.ss_family, SOCK_STREAM, IPPROTO_TCP)) == -1) {
 		log_message(LOG_INFO, "WEB connection fail to create socket. Rescheduling.");
 		thread_add_timer(thread->master, http_connect_thread, checker,
-				checker->vs->delay_loop);
+				checker_delay(checker));
 
 		return 0;
 	}
@@ -888,7 +999,7 @@ http_connect_thread(thread_t * thread)
 		close(fd);
 		log_message(LOG_INFO, "WEB socket bind failed. Rescheduling");
 		thread_add_timer(thread->master, http_connect_thread, checker,
-				checker->vs->delay_loop);
+				checker_delay(checker));
 	}
 
 	return 0;
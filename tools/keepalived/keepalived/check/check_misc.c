@@ -121,13 +121,13 @@ misc_check_thread(thread_t * thread)
 	if (!CHECKER_ENABLED(checker)) {
 		/* Register next timer checker */
 		thread_add_timer(thread->master, misc_check_thread, checker,
-				 checker->vs->delay_loop);
+				 checker_delay(checker));
 		return 0;
 	}
 
 	/* Register next timer checker */
 	thread_add_timer(thread->master, misc_check_thread, checker,
-			 checker->vs->delay_loop);
+			 checker_delay(checker));
 
 	/* Daemonization to not degrade our scheduling timer */
 	pid = fork();
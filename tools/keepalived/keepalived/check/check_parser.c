@@ -314,7 +314,12 @@ static void
 syn_proxy_handler(vector_t *strvec)
 {
 	virtual_server_t *vs = LIST_TAIL_DATA(check_data->vs);
-	vs->syn_proxy = 1;
+
+	/* "syn_proxy auto" turns synproxy on only under syn flood */
+	if (vector_size(strvec) > 1 && !strcmp(vector_slot(strvec, 1), "auto"))
+		vs->syn_proxy = 2;
+	else
+		vs->syn_proxy = 1;
 }
 static void
 bind_dev_handler(vector_t *strvec)
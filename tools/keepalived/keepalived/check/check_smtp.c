@@ -312,7 +312,7 @@ smtp_final(thread_t *thread, int error, const char *format, ...)
 		smtp_checker->host_ctr = 0;
 
 		/* Reschedule the main thread using the configured delay loop */;
-		thread_add_timer(thread->master, smtp_connect_thread, checker, checker->vs->delay_loop);
+		thread_add_timer(thread->master, smtp_connect_thread, checker, checker_delay(checker));
 
 		return 0;
 	}	
@@ -742,7 +742,7 @@ smtp_connect_thread(thread_t *thread)
 	 */
 	if (!CHECKER_ENABLED(checker)) {
 		thread_add_timer(thread->master, smtp_connect_thread, checker,
-				 checker->vs->delay_loop);
+				 checker_delay(checker));
 		return 0;
 	}
 
@@ -767,7 +767,7 @@ smtp_connect_thread(thread_t *thread)
 		smtp_checker->host_ctr = 0;
 		smtp_checker->host_ptr = list_element(smtp_checker->host, 0);
 
-		thread_add_timer(thread->master, smtp_connect_thread, checker, checker->vs->delay_loop);
+		thread_add_timer(thread->master, smtp_connect_thread, checker, checker_delay(checker));
 		return 0;
 	}
 
@@ -777,7 +777,7 @@ smtp_connect_thread(thread_t *thread)
 	if ((sd = socket(smtp_host->dst.ss_family, SOCK_STREAM, IPPROTO_TCP)) == -1) {
 		log_message(LOG_INFO, "SMTP_CHECK connection failed to create socket. Rescheduling.");
 		thread_add_timer(thread->master, smtp_connect_thread, checker,
-				 checker->vs->delay_loop);
+				 checker_delay(checker));
 		return 0;
 	}
 
@@ -788,7 +788,7 @@ smtp_connect_thread(thread_t *thread)
 		close(sd);
 		log_message(LOG_INFO, "SMTP_CHECK socket bind failed. Rescheduling.");
 		thread_add_timer(thread->master, smtp_connect_thread, checker,
-			checker->vs->delay_loop);
+			checker_delay(checker));
 	}
  
 	return 0;
@@ -115,7 +115,7 @@ tcp_check_thread(thread_t * thread)
 	/* Register next timer checker */
 	if (status != connect_in_progress)
 		thread_add_timer(thread->master, tcp_connect_thread, checker,
-				 checker->vs->delay_loop);
+				 checker_delay(checker));
 	return 0;
 }
 
@@ -133,14 +133,14 @@ tcp_connect_thread(thread_t * thread)
 	 */
 	if (!CHECKER_ENABLED(checker)) {
 		thread_add_timer(thread->master, tcp_connect_thread, checker,
-				 checker->vs->delay_loop);
+				 checker_delay(checker));
 		return 0;
 	}
 
 	if ((fd = socket(co->dst.ss_family, SOCK_STREAM, IPPROTO_TCP)) == -1) {
 		log_message(LOG_INFO, "TCP connect fail to create socket. Rescheduling.");
 		thread_add_timer(thread->master, tcp_connect_thread, checker,
-				checker->vs->delay_loop);
+				checker_delay(checker));
 
 		return 0;
 	}
@@ -153,7 +153,7 @@ tcp_connect_thread(thread_t * thread)
 		close(fd);
 		log_message(LOG_INFO, "TCP socket bind failed. Rescheduling.");
 		thread_add_timer(thread->master, tcp_connect_thread, checker,
-				checker->vs->delay_loop);
+				checker_delay(checker));
 	}
 
 	return 0;
@@ -369,6 +369,605 @@ static ipvs_laddr_t *laddr_rule;
 static ipvs_blklst_t *blklst_rule;
 static ipvs_tunnel_t *tunnel_rule;
 
+/*
+ * Batched IPVS commands. Between ipvs_batch_begin() and ipvs_batch_end()
+ * set commands are queued by libipvs and sent in one bulk request for
+ * every IPVS_BATCH_MAX items, results are checked per command when a
+ * chunk is committed. A command may queue more than one item (laddr
+ * also queues its interface address), its result is the one of its last
+ * item.
+ * On the config apply path the services are fetched at begin, then their
+ * dests and laddrs and the blklsts in one bulk get. A command changing
+ * nothing against that state is not sent, a dest of another weight or
+ * threshold is edited, and at end the dests IPVS has for a service of the
+ * configuration that the configuration has not are removed.
+ */
+#define IPVS_BATCH_MAX	512
+
+#define IPVS_BATCH_F_SEEN	0x1	/* in the configuration */
+#define IPVS_BATCH_F_GONE	0x2	/* deleted since begin */
+
+typedef struct _ipvs_batch_svc {
+	ipvs_service_entry_t	entry;
+	char			state;
+	struct ip_vs_get_dests	*dests;		/* sorted, NULL if unknown */
+	char			*dest_state;
+	struct ip_vs_get_laddrs	*laddrs;	/* sorted, NULL if unknown */
+	char			*laddr_state;
+} ipvs_batch_svc_t;
+
+static struct {
+	int			on;
+	int			open;		/* libipvs bulk begun */
+	unsigned int		seq;		/* commands queued since begin */
+	unsigned int		committed;	/* commands committed */
+	unsigned int		size;		/* of cmds, items and failed */
+	int			*cmds;
+	int			*items;		/* last bulk item of cmd, -1 if none */
+	unsigned int		nitem;		/* items of the open bulk claimed */
+	char			*failed;
+	unsigned int		nfailed;
+	int			diff;		/* state fetched at begin */
+	int			keep;		/* mark dests in the configuration only */
+	ipvs_batch_svc_t	*svcs;		/* sorted */
+	unsigned int		nsvc;
+	struct dp_vs_blklst_conf_array *blklsts; /* sorted, NULL if unknown */
+	char			*blklst_state;
+} ipvs_batch;
+
+/* Services with match conditions are keyed by these, not by address */
+static int
+ipvs_batch_svc_plain(const ipvs_service_entry_t *svc)
+{
+	return !svc->srange[0] && !svc->drange[0] &&
+	       !svc->iifname[0] && !svc->oifname[0];
+}
+
+static int
+ipvs_batch_svc_cmp(const void *a, const void *b)
+{
+	const ipvs_service_entry_t *s1 = a, *s2 = b;
+	int p1 = ipvs_batch_svc_plain(s1), p2 = ipvs_batch_svc_plain(s2);
+	int r;
+
+	if (p1 != p2)
+		return p1 ? -1 : 1;
+	if (s1->protocol != s2->protocol)
+		return s1->protocol < s2->protocol ? -1 : 1;
+	if (!p1) {
+		if ((r = strcmp(s1->srange, s2->srange)) ||
+		    (r = strcmp(s1->drange, s2->drange)) ||
+		    (r = strcmp(s1->iifname, s2->iifname)))
+			return r;
+		return strcmp(s1->oifname, s2->oifname);
+	}
+	if (s1->af != s2->af)
+		return s1->af < s2->af ? -1 : 1;
+	if (s1->fwmark != s2->fwmark)
+		return s1->fwmark < s2->fwmark ? -1 : 1;
+	if (s1->port != s2->port)
+		return s1->port < s2->port ? -1 : 1;
+	if (s1->af == AF_INET6)
+		return memcmp(&s1->addr.in6, &s2->addr.in6, sizeof(s1->addr.in6));
+	return memcmp(&s1->addr.ip, &s2->addr.ip, sizeof(s1->addr.ip));
+}
+
+static int
+ipvs_batch_dest_cmp(const void *a, const void *b)
+{
+	const ipvs_dest_entry_t *d1 = a, *d2 = b;
+
+	if (d1->af != d2->af)
+		return d1->af < d2->af ? -1 : 1;
+	if (d1->port != d2->port)
+		return d1->port < d2->port ? -1 : 1;
+	if (d1->af == AF_INET6)
+		return memcmp(&d1->addr.in6, &d2->addr.in6, sizeof(d1->addr.in6));
+	return memcmp(&d1->addr.ip, &d2->addr.ip, sizeof(d1->addr.ip));
+}
+
+static int
+ipvs_batch_laddr_cmp(const void *a, const void *b)
+{
+	const ipvs_laddr_entry_t *l1 = a, *l2 = b;
+
+	if (l1->af != l2->af)
+		return l1->af < l2->af ? -1 : 1;
+	if (l1->af == AF_INET6)
+		return memcmp(&l1->addr.in6, &l2->addr.in6, sizeof(l1->addr.in6));
+	return memcmp(&l1->addr.ip, &l2->addr.ip, sizeof(l1->addr.ip));
+}
+
+/* keyed as dpvs does, the family is not part of it */
+static int
+ipvs_batch_blklst_cmp(const void *a, const void *b)
+{
+	const struct dp_vs_blklst_conf *b1 = a, *b2 = b;
+	int r;
+
+	if (b1->proto != b2->proto)
+		return b1->proto < b2->proto ? -1 : 1;
+	if (b1->vport != b2->vport)
+		return b1->vport < b2->vport ? -1 : 1;
+	if ((r = memcmp(&b1->vaddr, &b2->vaddr, sizeof(b1->vaddr))))
+		return r;
+	return memcmp(&b1->blklst, &b2->blklst, sizeof(b1->blklst));
+}
+
+/* Fetch current services, then their state in one bulk get */
+static void
+ipvs_batch_load(void)
+{
+	struct ip_vs_get_services *get;
+	struct ip_vs_get_dests **dests;
+	struct ip_vs_get_laddrs **laddrs;
+	struct dp_vs_blklst_conf_array *blklsts;
+	ipvs_batch_svc_t *svc;
+	unsigned int i, n;
+
+	if (ipvs_getinfo() || !(get = ipvs_get_services()))
+		return;
+
+	if (ipvs_get_services_state(get, &dests, &laddrs, &blklsts)) {
+		log_message(LOG_INFO, "IPVS: fail to get services state: %s"
+				    , ipvs_strerror(errno));
+		free(get);
+		return;
+	}
+
+	n = get->num_services;
+	ipvs_batch.svcs = (ipvs_batch_svc_t *) MALLOC((n ? n : 1) * sizeof(ipvs_batch_svc_t));
+	for (i = 0; i < n; i++) {
+		svc = &ipvs_batch.svcs[i];
+		svc->entry = get->entrytable[i];
+		if ((svc->dests = dests[i])) {
+			qsort(svc->dests->entrytable, svc->dests->num_dests,
+			      sizeof(ipvs_dest_entry_t), ipvs_batch_dest_cmp);
+			svc->dest_state = (char *) MALLOC(svc->dests->num_dests + 1);
+		}
+		if ((svc->laddrs = laddrs[i])) {
+			qsort(svc->laddrs->entrytable, svc->laddrs->num_laddrs,
+			      sizeof(ipvs_laddr_entry_t), ipvs_batch_laddr_cmp);
+			svc->laddr_state = (char *) MALLOC(svc->laddrs->num_laddrs + 1);
+		}
+	}
+	qsort(ipvs_batch.svcs, n, sizeof(ipvs_batch_svc_t), ipvs_batch_svc_cmp);
+	ipvs_batch.nsvc = n;
+
+	if ((ipvs_batch.blklsts = blklsts)) {
+		qsort(blklsts->blklsts, blklsts->naddr,
+		      sizeof(struct dp_vs_blklst_conf), ipvs_batch_blklst_cmp);
+		ipvs_batch.blklst_state = (char *) MALLOC(blklsts->naddr + 1);
+	}
+	ipvs_batch.diff = 1;
+
+	free(dests);
+	free(laddrs);
+	free(get);
+}
+
+static void
+ipvs_batch_unload(void)
+{
+	ipvs_batch_svc_t *svc;
+	unsigned int i;
+
+	for (i = 0; i < ipvs_batch.nsvc; i++) {
+		svc = &ipvs_batch.svcs[i];
+		if (svc->dests) {
+			free(svc->dests);
+			FREE(svc->dest_state);
+		}
+		if (svc->laddrs) {
+			free(svc->laddrs);
+			FREE(svc->laddr_state);
+		}
+	}
+	if (ipvs_batch.svcs)
+		FREE(ipvs_batch.svcs);
+	if (ipvs_batch.blklsts) {
+		free(ipvs_batch.blklsts);
+		FREE(ipvs_batch.blklst_state);
+	}
+}
+
+/* srule in services fetched at begin, NULL if unknown */
+static ipvs_batch_svc_t *
+ipvs_batch_find_svc(void)
+{
+	ipvs_batch_svc_t key;
+
+	if (!ipvs_batch.nsvc)
+		return NULL;
+
+	memset(&key, 0, sizeof(key));
+	key.entry.af = srule->af;
+	key.entry.protocol = srule->protocol;
+	key.entry.fwmark = srule->fwmark;
+	key.entry.port = srule->port;
+	key.entry.addr = srule->addr;
+	snprintf(key.entry.srange, sizeof(key.entry.srange), "%s", srule->srange);
+	snprintf(key.entry.drange, sizeof(key.entry.drange), "%s", srule->drange);
+	snprintf(key.entry.iifname, sizeof(key.entry.iifname), "%s", srule->iifname);
+	snprintf(key.entry.oifname, sizeof(key.entry.oifname), "%s", srule->oifname);
+
+	return bsearch(&key, ipvs_batch.svcs, ipvs_batch.nsvc,
+		       sizeof(ipvs_batch_svc_t), ipvs_batch_svc_cmp);
+}
+
+/* Index of drule in dests of svc fetched at begin, -1 if unknown */
+static int
+ipvs_batch_find_dest(ipvs_batch_svc_t *svc)
+{
+	ipvs_dest_entry_t key, *entry;
+
+	memset(&key, 0, sizeof(key));
+	key.af = drule->af;
+	key.addr = drule->addr;
+	key.port = drule->port;
+
+	entry = bsearch(&key, svc->dests->entrytable, svc->dests->num_dests,
+			sizeof(ipvs_dest_entry_t), ipvs_batch_dest_cmp);
+	return entry ? entry - svc->dests->entrytable : -1;
+}
+
+static int
+ipvs_batch_find_laddr(ipvs_batch_svc_t *svc)
+{
+	ipvs_laddr_entry_t key, *entry;
+
+	memset(&key, 0, sizeof(key));
+	key.af = laddr_rule->af;
+	key.addr = laddr_rule->addr;
+
+	entry = bsearch(&key, svc->laddrs->entrytable, svc->laddrs->num_laddrs,
+			sizeof(ipvs_laddr_entry_t), ipvs_batch_laddr_cmp);
+	return entry ? entry - svc->laddrs->entrytable : -1;
+}
+
+/* same key as libipvs sends for srule and blklst_rule */
+static int
+ipvs_batch_find_blklst(void)
+{
+	struct dp_vs_blklst_conf key, *entry;
+
+	memset(&key, 0, sizeof(key));
+	key.proto = srule->protocol;
+	key.vport = srule->port;
+	if (srule->af == AF_INET) {
+		key.vaddr.in = srule->addr.in;
+		key.blklst.in = blklst_rule->addr.in;
+	} else {
+		key.vaddr.in6 = srule->addr.in6;
+		key.blklst.in6 = blklst_rule->addr.in6;
+	}
+
+	entry = bsearch(&key, ipvs_batch.blklsts->blklsts, ipvs_batch.blklsts->naddr,
+			sizeof(struct dp_vs_blklst_conf), ipvs_batch_blklst_cmp);
+	return entry ? entry - ipvs_batch.blklsts->blklsts : -1;
+}
+
+/* Commit queued commands and check their results */
+static void
+ipvs_batch_flush(void)
+{
+	unsigned int i, n = 0, idx;
+	int *results = NULL;
+	int cmd, res;
+
+	if (!ipvs_batch.open)
+		return;
+	ipvs_batch.open = 0;
+	ipvs_batch.nitem = 0;
+
+	if (ipvs_bulk_commit(&results, &n) && !results) {
+		log_message(LOG_INFO, "IPVS: fail to commit %u batched commands: %s"
+				    , ipvs_batch.seq - ipvs_batch.committed
+				    , ipvs_strerror(errno));
+		for (idx = ipvs_batch.committed; idx < ipvs_batch.seq; idx++)
+			ipvs_batch.failed[idx] = 1;
+		ipvs_batch.nfailed += ipvs_batch.seq - ipvs_batch.committed;
+		ipvs_batch.committed = ipvs_batch.seq;
+		return;
+	}
+
+	for (idx = ipvs_batch.committed; idx < ipvs_batch.seq; idx++) {
+		cmd = ipvs_batch.cmds[idx];
+		if (ipvs_batch.items[idx] < 0)
+			continue;
+		i = ipvs_batch.items[idx];
+		res = (results && i < n) ? results[i] : EDPVS_INVAL;
+
+		/* same as ipvs_talk() */
+		if (!res ||
+		    (res == EDPVS_EXIST && (cmd == IP_VS_SO_SET_ADD || cmd == IP_VS_SO_SET_ADDDEST)) ||
+		    (res == EDPVS_NOTEXIST && (cmd == IP_VS_SO_SET_DEL || cmd == IP_VS_SO_SET_DELDEST)))
+			continue;
+
+		log_message(LOG_INFO, "IPVS: batched command %d failed: dpvs error %d"
+				    , cmd, res);
+		ipvs_batch.failed[idx] = 1;
+		ipvs_batch.nfailed++;
+	}
+	ipvs_batch.committed = ipvs_batch.seq;
+
+	if (results)
+		free(results);
+}
+
+static void
+ipvs_batch_open(void)
+{
+	memset(&ipvs_batch, 0, sizeof(ipvs_batch));
+	ipvs_batch.on = 1;
+}
+
+/* Config apply path, the state of IPVS is fetched here only */
+int
+ipvs_batch_begin(void)
+{
+	if (ipvs_batch.on)
+		return IPVS_SUCCESS;
+
+	ipvs_batch_open();
+	ipvs_batch_load();
+
+	return IPVS_SUCCESS;
+}
+
+/* Is the config apply path diffing against the state of IPVS ? */
+int
+ipvs_batch_diffing(void)
+{
+	return ipvs_batch.on && ipvs_batch.diff;
+}
+
+static int ipvs_talk(int cmd);
+
+/*
+ * Remove the dests IPVS has for a service of the configuration that
+ * were not added, edited or kept since begin.
+ */
+static void
+ipvs_batch_remove_stale(void)
+{
+	ipvs_batch_svc_t *svc;
+	ipvs_dest_entry_t *dest;
+	char addr[INET6_ADDRSTRLEN];
+	unsigned int i, j;
+
+	for (i = 0; i < ipvs_batch.nsvc; i++) {
+		svc = &ipvs_batch.svcs[i];
+		if (svc->state != IPVS_BATCH_F_SEEN || !svc->dests)
+			continue;
+
+		for (j = 0; j < svc->dests->num_dests; j++) {
+			dest = &svc->dests->entrytable[j];
+			/* zeroed if the service has less than it had */
+			if (!dest->af || svc->dest_state[j])
+				continue;
+
+			memset(srule, 0, sizeof(ipvs_service_t));
+			ipvs_service_entry_2_user(&svc->entry, srule);
+			memset(drule, 0, sizeof(ipvs_dest_t));
+			drule->af = dest->af;
+			drule->addr = dest->addr;
+			drule->port = dest->port;
+
+			inet_ntop(dest->af, &dest->addr, addr, sizeof(addr));
+			log_message(LOG_INFO, "IPVS: removing dest [%s]:%d not in configuration"
+					    , addr, ntohs(dest->port));
+			ipvs_talk(IP_VS_SO_SET_DELDEST);
+		}
+	}
+}
+
+int
+ipvs_batch_end(void)
+{
+	unsigned int nfailed;
+
+	if (!ipvs_batch.on)
+		return IPVS_SUCCESS;
+
+	if (ipvs_batch.diff)
+		ipvs_batch_remove_stale();
+	ipvs_batch_flush();
+	nfailed = ipvs_batch.nfailed;
+
+	if (ipvs_batch.cmds)
+		FREE(ipvs_batch.cmds);
+	if (ipvs_batch.items)
+		FREE(ipvs_batch.items);
+	if (ipvs_batch.failed)
+		FREE(ipvs_batch.failed);
+	ipvs_batch_unload();
+	memset(&ipvs_batch, 0, sizeof(ipvs_batch));
+
+	return nfailed ? IPVS_ERROR : IPVS_SUCCESS;
+}
+
+/* Did any committed command in [from, to) fail ? */
+static int
+ipvs_batch_failed(unsigned int from, unsigned int to)
+{
+	for (; from < to && from < ipvs_batch.committed; from++) {
+		if (ipvs_batch.failed[from])
+			return 1;
+	}
+	return 0;
+}
+
+#define IPVS_BATCH_ANY		-1	/* no state, as without it */
+#define IPVS_BATCH_DIRECT	0	/* not batched, send it now */
+#define IPVS_BATCH_QUEUE	1
+#define IPVS_BATCH_SKIP		2	/* nothing to change */
+
+static int
+ipvs_batch_diff_dest(int *cmd, ipvs_batch_svc_t *svc)
+{
+	ipvs_dest_entry_t *dest;
+	int idx;
+
+	if (!svc || (svc->state & IPVS_BATCH_F_GONE) || !svc->dests)
+		return ipvs_batch.keep ? IPVS_BATCH_SKIP : IPVS_BATCH_ANY;
+	/* groups don't add a service known already */
+	svc->state |= IPVS_BATCH_F_SEEN;
+
+	idx = ipvs_batch_find_dest(svc);
+	if (idx < 0 || (svc->dest_state[idx] & IPVS_BATCH_F_GONE))
+		return ipvs_batch.keep ? IPVS_BATCH_SKIP : IPVS_BATCH_ANY;
+	svc->dest_state[idx] |= IPVS_BATCH_F_SEEN;
+	if (ipvs_batch.keep)
+		return IPVS_BATCH_SKIP;
+
+	dest = &svc->dests->entrytable[idx];
+	if (dest->weight == drule->weight &&
+	    dest->u_threshold == drule->u_threshold &&
+	    dest->l_threshold == drule->l_threshold &&
+	    (dest->conn_flags & IP_VS_CONN_F_FWD_MASK) ==
+	    (drule->conn_flags & IP_VS_CONN_F_FWD_MASK))
+		return IPVS_BATCH_SKIP;
+
+	/* it exists, no need to fall back to add */
+	dest->weight = drule->weight;
+	dest->u_threshold = drule->u_threshold;
+	dest->l_threshold = drule->l_threshold;
+	dest->conn_flags = drule->conn_flags;
+	*cmd = IP_VS_SO_SET_EDITDEST;
+	return IPVS_BATCH_QUEUE;
+}
+
+/* Check a command against the state fetched at begin */
+static int
+ipvs_batch_diff(int *cmd)
+{
+	ipvs_batch_svc_t *svc;
+	int idx;
+
+	switch (*cmd) {
+	case IP_VS_SO_SET_ADDBLKLST:
+	case IP_VS_SO_SET_DELBLKLST:
+		if (!ipvs_batch.blklsts)
+			return IPVS_BATCH_ANY;
+		idx = ipvs_batch_find_blklst();
+		if (idx < 0 || (ipvs_batch.blklst_state[idx] & IPVS_BATCH_F_GONE))
+			return IPVS_BATCH_ANY;
+		if (*cmd == IP_VS_SO_SET_ADDBLKLST)
+			return IPVS_BATCH_SKIP;
+		ipvs_batch.blklst_state[idx] |= IPVS_BATCH_F_GONE;
+		return IPVS_BATCH_ANY;
+	case IP_VS_SO_SET_ADD:
+	case IP_VS_SO_SET_DEL:
+	case IP_VS_SO_SET_ADDDEST:
+	case IP_VS_SO_SET_EDITDEST:
+	case IP_VS_SO_SET_DELDEST:
+	case IP_VS_SO_SET_ADDLADDR:
+	case IP_VS_SO_SET_DELLADDR:
+		break;
+	default:
+		return IPVS_BATCH_ANY;
+	}
+
+	svc = ipvs_batch_find_svc();
+	switch (*cmd) {
+	case IP_VS_SO_SET_ADD:
+		if (!svc || (svc->state & IPVS_BATCH_F_GONE))
+			return IPVS_BATCH_ANY;
+		svc->state |= IPVS_BATCH_F_SEEN;
+		return IPVS_BATCH_SKIP;
+	case IP_VS_SO_SET_DEL:
+		if (svc)
+			svc->state |= IPVS_BATCH_F_GONE;
+		return IPVS_BATCH_ANY;
+	case IP_VS_SO_SET_ADDDEST:
+	case IP_VS_SO_SET_EDITDEST:
+		return ipvs_batch_diff_dest(cmd, svc);
+	case IP_VS_SO_SET_DELDEST:
+		if (svc && !(svc->state & IPVS_BATCH_F_GONE) && svc->dests &&
+		    (idx = ipvs_batch_find_dest(svc)) >= 0)
+			svc->dest_state[idx] |= IPVS_BATCH_F_GONE;
+		return IPVS_BATCH_ANY;
+	}
+
+	/* laddrs */
+	if (!svc || (svc->state & IPVS_BATCH_F_GONE) || !svc->laddrs)
+		return IPVS_BATCH_ANY;
+	idx = ipvs_batch_find_laddr(svc);
+	if (idx < 0 || (svc->laddr_state[idx] & IPVS_BATCH_F_GONE))
+		return IPVS_BATCH_ANY;
+	if (*cmd == IP_VS_SO_SET_ADDLADDR)
+		return IPVS_BATCH_SKIP;
+	svc->laddr_state[idx] |= IPVS_BATCH_F_GONE;
+	return IPVS_BATCH_ANY;
+}
+
+static int
+ipvs_batch_prepare(int *cmd)
+{
+	int ret = IPVS_BATCH_ANY;
+
+	if (ipvs_batch.diff)
+		ret = ipvs_batch_diff(cmd);
+	if (ret == IPVS_BATCH_SKIP)
+		return ret;
+
+	switch (*cmd) {
+	case IP_VS_SO_SET_EDITDEST:
+		if (ret == IPVS_BATCH_QUEUE)
+			break;
+		/* fall through */
+	case IP_VS_SO_SET_STARTDAEMON:
+	case IP_VS_SO_SET_STOPDAEMON:
+		/* EDITDEST falls back to ADDDEST on failure, keep order */
+		ipvs_batch_flush();
+		return IPVS_BATCH_DIRECT;
+	}
+
+	if (!ipvs_batch.open) {
+		if (ipvs_bulk_begin(0))
+			return IPVS_BATCH_DIRECT;
+		ipvs_batch.open = 1;
+	}
+
+	if (ipvs_batch.seq == ipvs_batch.size) {
+		ipvs_batch.size = ipvs_batch.size ? ipvs_batch.size * 2 : IPVS_BATCH_MAX;
+		ipvs_batch.cmds = (int *) REALLOC(ipvs_batch.cmds,
+						  ipvs_batch.size * sizeof(int));
+		ipvs_batch.items = (int *) REALLOC(ipvs_batch.items,
+						   ipvs_batch.size * sizeof(int));
+		ipvs_batch.failed = (char *) REALLOC(ipvs_batch.failed,
+						     ipvs_batch.size);
+	}
+
+	return IPVS_BATCH_QUEUE;
+}
+
+/* libipvs queued the command, or failed to */
+static int
+ipvs_batch_queued(int cmd, int result)
+{
+	unsigned int nitem = ipvs_bulk_nitem();
+
+	if (result) {
+		/* items it did queue are left unclaimed, results ignored */
+		ipvs_batch.nitem = nitem;
+		log_message(LOG_INFO, "IPVS: %s", ipvs_strerror(errno));
+		return IPVS_ERROR;
+	}
+
+	ipvs_batch.cmds[ipvs_batch.seq] = cmd;
+	ipvs_batch.items[ipvs_batch.seq] = (nitem > ipvs_batch.nitem) ? (int) nitem - 1 : -1;
+	ipvs_batch.failed[ipvs_batch.seq] = 0;
+	ipvs_batch.seq++;
+	ipvs_batch.nitem = nitem;
+
+	if (nitem >= IPVS_BATCH_MAX)
+		ipvs_batch_flush();
+
+	return IPVS_SUCCESS;
+}
+
 /* Initialization helpers */
 int
 ipvs_start(void)
@@ -408,7 +1007,7 @@ ipvs_stop(void)
 
 /* Send user rules to IPVS module */
 static int
-ipvs_talk(int cmd)
+ipvs_talk_cmd(int cmd)
 {
 	int result = -1;
 
@@ -462,6 +1061,24 @@ ipvs_talk(int cmd)
 			break;
 	}
 
+	return result;
+}
+
+static int
+ipvs_talk(int cmd)
+{
+	int result;
+
+	if (ipvs_batch.on) {
+		switch (ipvs_batch_prepare(&cmd)) {
+		case IPVS_BATCH_SKIP:
+			return IPVS_SUCCESS;
+		case IPVS_BATCH_QUEUE:
+			return ipvs_batch_queued(cmd, ipvs_talk_cmd(cmd));
+		}
+	}
+
+	result = ipvs_talk_cmd(cmd);
 	if (result) {
 		if (result == EDPVS_EXIST && (cmd == IP_VS_SO_SET_ADD || cmd == IP_VS_SO_SET_ADDDEST))
 			result = 0;
@@ -637,7 +1254,9 @@ ipvs_set_rule(int cmd, virtual_server_t * vs, real_server_t * rs)
 		if (vs->granularity_persistence)
 			srule->netmask = vs->granularity_persistence;
 
-	if (vs->syn_proxy)
+	if (vs->syn_proxy == 2)
+		srule->flags |= IP_VS_SVC_F_SYNPROXY_AUTO;
+	else if (vs->syn_proxy)
 		srule->flags |= IP_VS_CONN_F_SYNPROXY;
 
 	if (!strcmp(vs->sched, "conhash")) {
@@ -989,8 +1608,8 @@ int ipvs_tunnel_cmd(int cmd, tunnel_entry *entry)
 }
 
 /* Set/Remove a RS or a local/deny address group from a VS */
-int
-ipvs_cmd(int cmd, list vs_group, virtual_server_t * vs, real_server_t * rs)
+static int
+ipvs_cmd_now(int cmd, list vs_group, virtual_server_t * vs, real_server_t * rs)
 {
 	/* Set/Remove local address */
 	if (cmd == IP_VS_SO_SET_ADDLADDR || cmd == IP_VS_SO_SET_DELLADDR)	
@@ -1049,6 +1668,189 @@ ipvs_cmd(int cmd, list vs_group, virtual_server_t * vs, real_server_t * rs)
 	return IPVS_SUCCESS;
 }
 
+/*
+ * Config apply path: a RS of the configuration left as it is in IPVS,
+ * e.g. an inhibited one, is marked so it's not removed as stale. Nothing
+ * is sent, and the RS flags are left untouched.
+ */
+int
+ipvs_batch_keep_dest(list vs_group, virtual_server_t * vs, real_server_t * rs)
+{
+	int alive = rs->alive, set = rs->set;
+	int err;
+
+	if (!ipvs_batch_diffing())
+		return IPVS_SUCCESS;
+
+	/* groups send ADDDEST for a RS not alive only */
+	UNSET_ALIVE(rs);
+	ipvs_batch.keep = 1;
+	err = ipvs_cmd_now(IP_VS_SO_SET_ADDDEST, vs_group, vs, rs);
+	ipvs_batch.keep = 0;
+	rs->alive = alive;
+	rs->set = set;
+
+	return err;
+}
+
+/*
+ * Coalesced RS changes. Once the configuration is applied, checkers
+ * changes to a RS are held for IPVS_COALESCE_DELAY and then sent in one
+ * batch. A change undone within the delay, i.e. a flapping RS, is not
+ * sent at all.
+ */
+#define IPVS_COALESCE_DELAY	(TIMER_HZ / 10)
+
+typedef struct _ipvs_pending {
+	int			cmd;
+	list			vs_group;
+	virtual_server_t	*vs;
+	real_server_t		*rs;
+	unsigned int		seq;		/* batch commands range */
+	unsigned int		end;
+	int			err;
+} ipvs_pending_t;
+
+static int ipvs_coalesce;
+static list ipvs_pending;
+static thread_t *ipvs_pending_thread;
+
+static void
+free_ipvs_pending(void *data)
+{
+	ipvs_pending_t *pending = data;
+	real_server_t *rs = pending->rs;
+
+	if (rs->ipvs_pending && ELEMENT_DATA(rs->ipvs_pending) == pending)
+		rs->ipvs_pending = NULL;
+	FREE(pending);
+}
+
+static void
+ipvs_pending_flush(void)
+{
+	ipvs_pending_t *pending;
+	element e;
+	list l = ipvs_pending;
+
+	if (LIST_ISEMPTY(l))
+		return;
+	ipvs_pending = alloc_list(free_ipvs_pending, NULL);
+
+	/* dest changes only, no need to fetch services */
+	ipvs_batch_open();
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		pending = ELEMENT_DATA(e);
+		pending->seq = ipvs_batch.seq;
+		pending->err = !ipvs_cmd_now(pending->cmd, pending->vs_group,
+					     pending->vs, pending->rs);
+		pending->end = ipvs_batch.seq;
+	}
+	ipvs_batch_flush();
+
+	/*
+	 * Checkers already switched the RS state. Switch it back on
+	 * failure so that the next check result retries the change.
+	 */
+	for (e = LIST_HEAD(l); e; ELEMENT_NEXT(e)) {
+		pending = ELEMENT_DATA(e);
+		if (!pending->err &&
+		    !ipvs_batch_failed(pending->seq, pending->end))
+			continue;
+
+		log_message(LOG_INFO, "IPVS: fail to %s service %s on VS %s"
+				    , (pending->cmd == IP_VS_SO_SET_DELDEST) ? "remove" :
+				      (pending->cmd == IP_VS_SO_SET_ADDDEST) ? "add" : "edit"
+				    , FMT_RS(pending->rs)
+				    , FMT_VS(pending->vs));
+		if (pending->cmd == IP_VS_SO_SET_ADDDEST)
+			UNSET_ALIVE(pending->rs);
+		else if (pending->cmd == IP_VS_SO_SET_DELDEST)
+			SET_ALIVE(pending->rs);
+	}
+	ipvs_batch_end();
+
+	free_list(l);
+}
+
+static int
+ipvs_pending_thread_fn(thread_t * thread)
+{
+	ipvs_pending_thread = NULL;
+	ipvs_pending_flush();
+	return 0;
+}
+
+static int
+ipvs_pending_add(int cmd, list vs_group, virtual_server_t * vs, real_server_t * rs)
+{
+	ipvs_pending_t *pending;
+
+	if (rs->ipvs_pending) {
+		pending = ELEMENT_DATA(rs->ipvs_pending);
+
+		/* RS flapped, nothing to send */
+		if ((pending->cmd == IP_VS_SO_SET_ADDDEST && cmd == IP_VS_SO_SET_DELDEST) ||
+		    (pending->cmd == IP_VS_SO_SET_DELDEST && cmd == IP_VS_SO_SET_ADDDEST)) {
+			free_list_element(ipvs_pending, rs->ipvs_pending);
+			return IPVS_SUCCESS;
+		}
+
+		/* weight is read when sent */
+		if (pending->cmd == cmd && pending->vs == vs)
+			return IPVS_SUCCESS;
+	}
+
+	pending = (ipvs_pending_t *) MALLOC(sizeof(ipvs_pending_t));
+	pending->cmd = cmd;
+	pending->vs_group = vs_group;
+	pending->vs = vs;
+	pending->rs = rs;
+	list_add(ipvs_pending, pending);
+	rs->ipvs_pending = ipvs_pending->tail;
+
+	if (!ipvs_pending_thread)
+		ipvs_pending_thread = thread_add_timer(master, ipvs_pending_thread_fn,
+						       NULL, IPVS_COALESCE_DELAY);
+	return IPVS_SUCCESS;
+}
+
+void
+ipvs_coalesce_start(void)
+{
+	if (!ipvs_pending)
+		ipvs_pending = alloc_list(free_ipvs_pending, NULL);
+	ipvs_coalesce = 1;
+}
+
+/* Send what is pending and stop coalescing */
+void
+ipvs_coalesce_stop(void)
+{
+	if (!ipvs_coalesce)
+		return;
+	ipvs_coalesce = 0;
+
+	if (ipvs_pending_thread) {
+		thread_cancel(ipvs_pending_thread);
+		ipvs_pending_thread = NULL;
+	}
+	ipvs_pending_flush();
+	free_list(ipvs_pending);
+	ipvs_pending = NULL;
+}
+
+int
+ipvs_cmd(int cmd, list vs_group, virtual_server_t * vs, real_server_t * rs)
+{
+	if (ipvs_coalesce && rs &&
+	    (cmd == IP_VS_SO_SET_ADDDEST || cmd == IP_VS_SO_SET_DELDEST ||
+	     cmd == IP_VS_SO_SET_EDITDEST))
+		return ipvs_pending_add(cmd, vs_group, vs, rs);
+
+	return ipvs_cmd_now(cmd, vs_group, vs, rs);
+}
+
 static void 
 ipvs_rm_lentry_from_vsg(local_addr_entry *laddr_entry, char *vsgname)
 {
@@ -186,6 +186,8 @@ init_service_rs(virtual_server_t * vs)
 		if (vs->alpha) {
 			if (! rs->reloaded)
 				UNSET_ALIVE(rs);
+			else if (!ipvs_batch_keep_dest(check_data->vs_group, vs, rs))
+				return 0;
 			continue;
 		}
 		if (!ISALIVE(rs)) {
@@ -193,7 +195,8 @@ init_service_rs(virtual_server_t * vs)
 				return 0;
 			else
 				SET_ALIVE(rs);
-		} else if (vs->vsgname) {
+		} else if (vs->vsgname || ipvs_batch_diffing()) {
+			/* sent only if it differs from IPVS */
 			UNSET_ALIVE(rs);
 			if (!ipvs_cmd(LVS_CMD_ADD_DEST, check_data->vs_group, vs, rs))
 				return 0;
@@ -208,14 +211,19 @@ init_service_rs(virtual_server_t * vs)
 static int
 init_service_vs(virtual_server_t * vs)
 {
-	/* Init the VS root */
-	if (!ISALIVE(vs) || vs->vsgname) {
+	/* Init the VS root, sent only if IPVS has not it when diffing */
+	if (!ISALIVE(vs) || vs->vsgname || ipvs_batch_diffing()) {
 		if (!ipvs_cmd(LVS_CMD_ADD, check_data->vs_group, vs, NULL))
 			return 0;
 		else
 			SET_ALIVE(vs);
 	}
 
+	/* A sorry server in place is not in the RS queue */
+	if (vs->s_svr && ISALIVE(vs->s_svr) &&
+	    !ipvs_batch_keep_dest(check_data->vs_group, vs, vs->s_svr))
+		return 0;
+
 	/* Set local ip address in "FNAT" mode of IPVS */
 	if (vs->local_addr_gname &&
         (vs->loadbalancing_kind == IP_VS_CONN_F_FULLNAT ||
@@ -55,6 +55,9 @@ typedef struct _checker {
 /* Checkers queue */
 extern list checkers_queue;
 
+/* next check is in delay_loop +/- delay_loop/CHECKER_JITTER_DIV */
+#define CHECKER_JITTER_DIV	10
+
 /* utility macro */
 #define CHECKER_ARG(X) ((X)->data)
 #define CHECKER_CO(X) (((checker_t *)X)->co)
@@ -85,6 +88,7 @@ extern void register_checkers_thread(void);
 extern void install_checkers_keyword(void);
 extern void install_connect_keywords(void);
 extern void warmup_handler(vector_t *);
+extern long checker_delay(checker_t *);
 extern void update_checker_activity(sa_family_t, void *, int);
 extern void checker_set_dst(struct sockaddr_storage *);
 extern void checker_set_dst_port(struct sockaddr_storage *, uint16_t);
@@ -86,6 +86,9 @@ typedef struct _real_server {
 	list				failed_checkers;/* List of failed checkers */
 	int				set;		/* in the IPVS table */
 	int				reloaded;   /* active state was copied from old config while reloading */
+#ifdef _KRNL_2_6_
+	element				ipvs_pending;	/* queued IPVS command, see ipvs_cmd() */
+#endif
 #if defined(_WITH_SNMP_) && defined(_KRNL_2_6_) && defined(_WITH_LVS_)
 	/* Statistics */
 	uint32_t			activeconns;	/* active connections */
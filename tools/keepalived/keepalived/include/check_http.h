@@ -44,6 +44,10 @@ typedef struct _request {
 	int				error;
 	int				status_code;
 	int				len;
+	int				keepalive;	/* server keeps the connection */
+	int				reused;		/* sent on a kept connection */
+	int				content_len;	/* -1 if body ends on EOF */
+	int				body_len;
 	SSL				*ssl;
 	BIO				*bio;
 	MD5_CTX				context;
@@ -54,6 +58,7 @@ typedef struct _http {
 	int				retry_it;	/* current number of get retry */
 	int				url_it;		/* current url checked index */
 	request_t			*req;		/* GET buffer and SSL args */
+	int				fd;		/* kept connection, -1 if none */
 } http_t ;
 
 typedef struct _url {
@@ -66,6 +71,7 @@ typedef struct _http_checker {
 	int				proto;
 	int				nb_get_retry;
 	long				delay_before_retry;
+	int				persistent;	/* reuse connections */
 	list				url;
 	http_t				*arg;
 } http_checker_t;
@@ -80,11 +86,13 @@ typedef struct _http_checker {
 /* GET processing command */
 #define REQUEST_TEMPLATE "GET %s HTTP/1.0\r\n" \
                          "User-Agent:KeepAliveClient\r\n" \
-                         "Host: %s%s\r\n\r\n"
+                         "Host: %s%s\r\n%s\r\n"
 
 #define REQUEST_TEMPLATE_IPV6 "GET %s HTTP/1.0\r\n" \
                          "User-Agent:KeepAliveClient\r\n" \
-                         "Host: [%s]%s\r\n\r\n"
+                         "Host: [%s]%s\r\n%s\r\n"
+
+#define KEEPALIVE_HEADER "Connection: Keep-Alive\r\n"
 
 /* macro utility */
 #define HTTP_ARG(X) ((X)->arg)
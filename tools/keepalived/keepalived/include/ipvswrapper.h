@@ -25,6 +25,7 @@
 
 /* system includes */
 #include <unistd.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <sys/socket.h>
 #include <sys/param.h>
@@ -107,6 +108,12 @@ extern int ipvs_tunnel_cmd(int cmd, tunnel_entry *entry);
 /* Refresh statistics at most every 5 seconds */
 #define STATS_REFRESH 5
 extern void ipvs_update_stats(virtual_server_t * vs);
+extern int ipvs_batch_begin(void);
+extern int ipvs_batch_end(void);
+extern int ipvs_batch_diffing(void);
+extern int ipvs_batch_keep_dest(list, virtual_server_t *, real_server_t *);
+extern void ipvs_coalesce_start(void);
+extern void ipvs_coalesce_stop(void);
 #endif
 
 #endif
@@ -39,6 +39,8 @@
 #define IP_VS_SVC_F_HASHED	0x0002		/* hashed entry */
 #define IP_VS_SVC_F_ONEPACKET	0x0004		/* one-packet scheduling */
 #define IP_VS_CONN_F_SYNPROXY	0x8000		/* synproxy switch flag*/
+#define IP_VS_SVC_F_SYNPROXY_AUTO	0x4000	/* synproxy on syn flood */
+#define IP_VS_SVC_F_SYNPROXY_ACTIVE	0x2000	/* auto synproxy is on */
 #define IP_VS_SVC_F_SCHED1	0x0008		/* scheduler flag 1 */
 #define IP_VS_SVC_F_SCHED2	0x0010		/* scheduler flag 2 */
 #define IP_VS_SVC_F_SCHED3	0x0020		/* scheduler flag 3 */
@@ -109,7 +109,149 @@ typedef struct dpvs_servicedest_s {
 	X->persistconns     = Y->persistconns;			\
 	memcpy(&X->stats, &Y->stats, sizeof(X->stats));}
 
-void ipvs_service_entry_2_user(const ipvs_service_entry_t *entry, ipvs_service_t *user);
+/* set calls queued between ipvs_bulk_begin and ipvs_bulk_commit */
+static struct {
+	int		on;
+	char		*buf;
+	size_t		len;
+	size_t		size;
+} ipvs_bulk;
+
+static int ipvs_setsockopt_flags(sockoptid_t cmd, const void *in, size_t in_len,
+				 unsigned int flags)
+{
+	struct dp_vs_bulk_conf *conf;
+	struct dp_vs_bulk_item *item;
+	size_t need, size;
+	char *buf;
+
+	if (!ipvs_bulk.on)
+		return dpvs_setsockopt(cmd, in, in_len);
+
+	need = ipvs_bulk.len + DPVS_BULK_ALIGN(sizeof(*item) + in_len);
+	if (need > ipvs_bulk.size) {
+		size = ipvs_bulk.size;
+		while (size < need)
+			size <<= 1;
+		buf = realloc(ipvs_bulk.buf, size);
+		if (!buf) {
+			errno = ENOMEM;
+			return -1;
+		}
+		ipvs_bulk.buf = buf;
+		ipvs_bulk.size = size;
+	}
+
+	item = (struct dp_vs_bulk_item *)(ipvs_bulk.buf + ipvs_bulk.len);
+	memset(item, 0, DPVS_BULK_ALIGN(sizeof(*item) + in_len));
+	item->opt = cmd;
+	item->len = in_len;
+	item->flags = flags;
+	if (in_len)
+		memcpy(item->data, in, in_len);
+	ipvs_bulk.len = need;
+
+	conf = (struct dp_vs_bulk_conf *)ipvs_bulk.buf;
+	conf->nitem++;
+	return 0;
+}
+
+static int ipvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len)
+{
+	return ipvs_setsockopt_flags(cmd, in, in_len, 0);
+}
+
+int ipvs_bulk_begin(unsigned int flags)
+{
+	struct dp_vs_bulk_conf *conf;
+
+	if (ipvs_bulk.on) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (!ipvs_bulk.buf) {
+		ipvs_bulk.size = 4096;
+		ipvs_bulk.buf = malloc(ipvs_bulk.size);
+		if (!ipvs_bulk.buf) {
+			ipvs_bulk.size = 0;
+			errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	conf = (struct dp_vs_bulk_conf *)ipvs_bulk.buf;
+	conf->flags = flags;
+	conf->nitem = 0;
+	ipvs_bulk.len = sizeof(*conf);
+	ipvs_bulk.on = 1;
+	return 0;
+}
+
+unsigned int ipvs_bulk_nitem(void)
+{
+	if (!ipvs_bulk.on)
+		return 0;
+	return ((struct dp_vs_bulk_conf *)ipvs_bulk.buf)->nitem;
+}
+
+void ipvs_bulk_abort(void)
+{
+	ipvs_bulk.on = 0;
+	ipvs_bulk.len = 0;
+}
+
+int ipvs_bulk_commit(int **results, unsigned int *nitem)
+{
+	struct dp_vs_bulk_conf *conf;
+	struct dp_vs_bulk_result *res;
+	size_t res_len;
+	unsigned int i;
+	int ret = 0;
+
+	if (results)
+		*results = NULL;
+	if (nitem)
+		*nitem = 0;
+
+	if (!ipvs_bulk.on) {
+		errno = EINVAL;
+		return -1;
+	}
+	ipvs_bulk.on = 0;
+
+	conf = (struct dp_vs_bulk_conf *)ipvs_bulk.buf;
+	if (!conf->nitem)
+		return 0;
+
+	if (dpvs_getsockopt(SOCKOPT_GET_BULK_APPLY, ipvs_bulk.buf, ipvs_bulk.len,
+			    (void **)&res, &res_len))
+		return -1;
+
+	if (res_len < sizeof(*res) ||
+	    res_len < sizeof(*res) + res->nitem * sizeof(int) ||
+	    res->nitem != conf->nitem) {
+		dpvs_sockopt_msg_free(res);
+		errno = EPROTO;
+		return -1;
+	}
+
+	for (i = 0; i < res->nitem; i++) {
+		if (res->results[i])
+			ret = -1;
+	}
+
+	if (results) {
+		*results = malloc(res->nitem * sizeof(int));
+		if (*results)
+			memcpy(*results, res->results, res->nitem * sizeof(int));
+	}
+	if (nitem)
+		*nitem = res->nitem;
+
+	dpvs_sockopt_msg_free(res);
+	return ret;
+}
 
 int ipvs_init(void)
 {
@@ -156,7 +298,7 @@ unsigned int ipvs_version(void)
 
 int ipvs_flush(void)
 {
-	return dpvs_setsockopt(DPVS_SO_SET_FLUSH, NULL, 0);
+	return ipvs_setsockopt(DPVS_SO_SET_FLUSH, NULL, 0);
 }
 
 
@@ -167,7 +309,7 @@ int ipvs_add_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ADD, dpvs_svc_ptr, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_ADD, dpvs_svc_ptr, sizeof(dpvs_svc));
 }
 
 
@@ -178,7 +320,7 @@ int ipvs_update_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_EDIT, dpvs_svc_ptr, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_EDIT, dpvs_svc_ptr, sizeof(dpvs_svc));
 }
 
 int ipvs_update_service_by_options(ipvs_service_t *svc, unsigned int options)
@@ -218,6 +360,11 @@ int ipvs_update_service_by_options(ipvs_service_t *svc, unsigned int options)
 		} else {
 			user.flags &= ~IP_VS_CONN_F_SYNPROXY;
 		}
+		if( svc->flags & IP_VS_SVC_F_SYNPROXY_AUTO ) {
+			user.flags |= IP_VS_SVC_F_SYNPROXY_AUTO;
+		} else {
+			user.flags &= ~IP_VS_SVC_F_SYNPROXY_AUTO;
+		}
 	}
 
 	if( options & OPT_ONEPACKET ) {
@@ -268,7 +415,7 @@ int ipvs_del_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_DEL, dpvs_svc_ptr, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_DEL, dpvs_svc_ptr, sizeof(dpvs_svc));
 }
 
 int ipvs_zero_service(ipvs_service_t *svc)
@@ -278,7 +425,7 @@ int ipvs_zero_service(ipvs_service_t *svc)
 
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ZERO, dpvs_svc_ptr, sizeof(dpvs_svc));
+	return ipvs_setsockopt(DPVS_SO_SET_ZERO, dpvs_svc_ptr, sizeof(dpvs_svc));
 }
 
 int ipvs_add_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
@@ -290,7 +437,7 @@ int ipvs_add_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 	IPRS_2_DPRS(dpvs_dest_ptr, dest);
 
-	return dpvs_setsockopt(DPVS_SO_SET_ADDDEST, &svcdest, sizeof(svcdest));
+	return ipvs_setsockopt(DPVS_SO_SET_ADDDEST, &svcdest, sizeof(svcdest));
 }
 
 int ipvs_update_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
@@ -302,7 +449,7 @@ int ipvs_update_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 	IPRS_2_DPRS(dpvs_dest_ptr, dest);
 
-	return dpvs_setsockopt(DPVS_SO_SET_EDITDEST, &svcdest, sizeof(svcdest));
+	return ipvs_setsockopt(DPVS_SO_SET_EDITDEST, &svcdest, sizeof(svcdest));
 }
 
 int ipvs_del_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
@@ -314,7 +461,7 @@ int ipvs_del_dest(ipvs_service_t *svc, ipvs_dest_t *dest)
 	IPVS_2_DPVS(dpvs_svc_ptr, svc);
 	IPRS_2_DPRS(dpvs_dest_ptr, dest);
 
-	return dpvs_setsockopt(DPVS_SO_SET_DELDEST, &svcdest, sizeof(svcdest)); 
+	return ipvs_setsockopt(DPVS_SO_SET_DELDEST, &svcdest, sizeof(svcdest)); 
 }
 
 static void ipvs_fill_laddr_conf(ipvs_service_t *svc, ipvs_laddr_t *laddr, 
@@ -368,9 +515,11 @@ int ipvs_add_laddr(ipvs_service_t *svc, ipvs_laddr_t *laddr)
 
 	ipvs_fill_laddr_conf(svc, laddr, &conf);
 	ipvs_fill_ipaddr_conf(laddr, &param);
-	ipvs_set_ipaddr(&param, 1);
+	/* the address may be on the device already, e.g., shared by services */
+	ipvs_setsockopt_flags(SOCKOPT_SET_IFADDR_ADD, &param, sizeof(param),
+			      DPVS_BULK_ITEM_F_OPTIONAL);
 
-	return dpvs_setsockopt(SOCKOPT_SET_LADDR_ADD, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_LADDR_ADD, &conf, sizeof(conf));
 }
 
 int ipvs_del_laddr(ipvs_service_t *svc, ipvs_laddr_t *laddr)
@@ -380,9 +529,11 @@ int ipvs_del_laddr(ipvs_service_t *svc, ipvs_laddr_t *laddr)
 
 	ipvs_fill_laddr_conf(svc, laddr, &conf);
 	ipvs_fill_ipaddr_conf(laddr, &param);
-	ipvs_set_ipaddr(&param, 0);
+	/* the address may be in use by other services */
+	ipvs_setsockopt_flags(SOCKOPT_SET_IFADDR_DEL, &param, sizeof(param),
+			      DPVS_BULK_ITEM_F_OPTIONAL);
 
-	return dpvs_setsockopt(SOCKOPT_SET_LADDR_DEL, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_LADDR_DEL, &conf, sizeof(conf));
 }
 
 /*for black list*/
@@ -411,7 +562,7 @@ int ipvs_add_blklst(ipvs_service_t *svc, ipvs_blklst_t *blklst)
 
 	ipvs_fill_blklst_conf(svc, blklst, &conf);
 
-	return dpvs_setsockopt(SOCKOPT_SET_BLKLST_ADD, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_BLKLST_ADD, &conf, sizeof(conf));
 }
 
 int ipvs_del_blklst(ipvs_service_t *svc, ipvs_blklst_t * blklst)
@@ -420,7 +571,7 @@ int ipvs_del_blklst(ipvs_service_t *svc, ipvs_blklst_t * blklst)
 
 	ipvs_fill_blklst_conf(svc, blklst, &conf);
 
-	return dpvs_setsockopt(SOCKOPT_SET_BLKLST_DEL, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_SET_BLKLST_DEL, &conf, sizeof(conf));
 }
 
 /* for tunnel entry */
@@ -442,7 +593,7 @@ int ipvs_add_tunnel(ipvs_tunnel_t* tunnel_entry)
 	struct ip_tunnel_param conf;
 	ipvs_fill_tunnel_conf(tunnel_entry, &conf);
 	ipvs_func = ipvs_add_tunnel;
-	return dpvs_setsockopt(SOCKOPT_TUNNEL_ADD, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_TUNNEL_ADD, &conf, sizeof(conf));
 }
 
 int ipvs_del_tunnel(ipvs_tunnel_t* tunnel_entry)
@@ -450,7 +601,7 @@ int ipvs_del_tunnel(ipvs_tunnel_t* tunnel_entry)
 	struct ip_tunnel_param conf;
 	ipvs_fill_tunnel_conf(tunnel_entry, &conf);
 	ipvs_func = ipvs_del_tunnel;
-	return dpvs_setsockopt(SOCKOPT_TUNNEL_DEL, &conf, sizeof(conf));
+	return ipvs_setsockopt(SOCKOPT_TUNNEL_DEL, &conf, sizeof(conf));
 }
 
 int ipvs_set_timeout(ipvs_timeout_t *to)
@@ -609,37 +760,42 @@ ipvs_sort_services(struct ip_vs_get_services *s, ipvs_service_cmp_t f)
 	      sizeof(ipvs_service_entry_t), (qsort_cmp_t)f);
 }
 
-struct ip_vs_get_laddrs *ipvs_get_laddrs(ipvs_service_entry_t *svc)
+static void ipvs_fill_laddr_get(ipvs_service_entry_t *svc,
+				struct dp_vs_laddr_conf *conf)
 {
-	struct ip_vs_get_laddrs *laddrs;
-	struct dp_vs_laddr_conf conf, *result;
-	size_t res_size, i;
-
-	memset(&conf, 0, sizeof(struct dp_vs_laddr_conf));
-	conf.af_s = svc->af;
-	conf.proto = svc->protocol;
+	memset(conf, 0, sizeof(struct dp_vs_laddr_conf));
+	conf->af_s = svc->af;
+	conf->proto = svc->protocol;
 	if (svc->af == AF_INET)
-		conf.vaddr.in = svc->addr.in;
+		conf->vaddr.in = svc->addr.in;
 	else
-		conf.vaddr.in6 = svc->addr.in6;
-	conf.vport = svc->port;
-	conf.fwmark = svc->fwmark;
+		conf->vaddr.in6 = svc->addr.in6;
+	conf->vport = svc->port;
+	conf->fwmark = svc->fwmark;
 
-	snprintf(conf.srange, sizeof(conf.srange), "%s", svc->srange);
-	snprintf(conf.drange, sizeof(conf.drange), "%s", svc->drange);
-	snprintf(conf.iifname, sizeof(conf.iifname), "%s", svc->iifname);
-	snprintf(conf.iifname, sizeof(conf.oifname), "%s", svc->oifname);
+	snprintf(conf->srange, sizeof(conf->srange), "%s", svc->srange);
+	snprintf(conf->drange, sizeof(conf->drange), "%s", svc->drange);
+	snprintf(conf->iifname, sizeof(conf->iifname), "%s", svc->iifname);
+	snprintf(conf->oifname, sizeof(conf->oifname), "%s", svc->oifname);
+}
 
-	if (dpvs_getsockopt(SOCKOPT_GET_LADDR_GETALL, &conf, sizeof(conf),
-				(void **)&result, &res_size) != 0)
-		return NULL;
+static struct ip_vs_get_laddrs *
+ipvs_laddrs_from_dpvs(const struct dp_vs_laddr_conf *result, size_t res_size)
+{
+	struct ip_vs_get_laddrs *laddrs;
+	size_t i;
 
-	laddrs = malloc(sizeof(*laddrs) + result->nladdrs * sizeof(struct ip_vs_laddr_entry));
-	if (!laddrs) {
-		dpvs_sockopt_msg_free(result);
+	if (res_size < sizeof(*result) || result->nladdrs < 0 ||
+	    res_size < sizeof(*result) +
+		       result->nladdrs * sizeof(struct dp_vs_laddr_entry)) {
+		errno = EPROTO;
 		return NULL;
 	}
 
+	laddrs = calloc(1, sizeof(*laddrs) + result->nladdrs * sizeof(struct ip_vs_laddr_entry));
+	if (!laddrs)
+		return NULL;
+
 	laddrs->protocol = result->proto;
 	laddrs->__addr_v4 = result->vaddr.in.s_addr;
 	laddrs->port = result->vport;
@@ -662,6 +818,22 @@ struct ip_vs_get_laddrs *ipvs_get_laddrs(ipvs_service_entry_t *svc)
 			laddrs->entrytable[i].addr.in6 = result->laddrs[i].addr.in6;
 	}
 
+	return laddrs;
+}
+
+struct ip_vs_get_laddrs *ipvs_get_laddrs(ipvs_service_entry_t *svc)
+{
+	struct ip_vs_get_laddrs *laddrs;
+	struct dp_vs_laddr_conf conf, *result;
+	size_t res_size;
+
+	ipvs_fill_laddr_get(svc, &conf);
+
+	if (dpvs_getsockopt(SOCKOPT_GET_LADDR_GETALL, &conf, sizeof(conf),
+				(void **)&result, &res_size) != 0)
+		return NULL;
+
+	laddrs = ipvs_laddrs_from_dpvs(result, res_size);
 	dpvs_sockopt_msg_free(result);
 	return laddrs;
 }
@@ -672,54 +844,42 @@ void ipvs_free_lddrs(struct ip_vs_get_laddrs* p)
 	free(p);
 }
 
-struct dp_vs_blklst_conf_array *ipvs_get_blklsts(void)
+static struct dp_vs_blklst_conf_array *
+ipvs_blklsts_from_dpvs(const struct dp_vs_blklst_conf_array *result, size_t size)
 {
-	struct dp_vs_blklst_conf_array *array, *result;
-	size_t size;
-	int i, err;
+	struct dp_vs_blklst_conf_array *array;
 
-	err = dpvs_getsockopt(SOCKOPT_GET_BLKLST_GETALL, NULL, 0, 
-				(void **)&result, &size);
-	if (err != 0)
-		return NULL;
-	if (size < sizeof(*result)
+	if (size < sizeof(*result) || result->naddr < 0
 		|| size != sizeof(*result) + \
 		result->naddr * sizeof(struct dp_vs_blklst_conf)) {
-		dpvs_sockopt_msg_free(result);
+		errno = EPROTO;
 		return NULL;
 	}
 	if (!(array = malloc(size)))
 		return NULL;
-	memcpy(array, result, sizeof(struct dp_vs_blklst_conf_array));
-	for (i = 0; i < result->naddr; i++) {
-		memcpy(&array->blklsts[i], &result->blklsts[i],
-			sizeof(struct dp_vs_blklst_conf));
-		
-	}
-	dpvs_sockopt_msg_free(result);
+	memcpy(array, result, size);
 	return array;
 }
 
-struct ip_vs_get_dests *ipvs_get_dests(ipvs_service_entry_t *svc)
+struct dp_vs_blklst_conf_array *ipvs_get_blklsts(void)
 {
-	struct ip_vs_get_dests *d;
-	struct dp_vs_get_dests *dpvs_dests, *dpvs_dests_rcv;
-	struct ip_vs_dest_entry *ipvs_entry;
-	struct dp_vs_dest_entry *dpvs_entry;
-	size_t len = 0, len_rcv = 0;
-	int i;
-
-	len = sizeof(struct ip_vs_get_dests) + 
-		sizeof(ipvs_dest_entry_t) * svc->num_dests;
-	if (!(d = calloc(len, 1)))
-		return NULL;
+	struct dp_vs_blklst_conf_array *array, *result;
+	size_t size;
+	int err;
 
-	len = sizeof(struct dp_vs_get_dests);
-	if (!(dpvs_dests = calloc(len, 1))) {
-		free(d);
+	err = dpvs_getsockopt(SOCKOPT_GET_BLKLST_GETALL, NULL, 0, 
+				(void **)&result, &size);
+	if (err != 0)
 		return NULL;
-	}
+	array = ipvs_blklsts_from_dpvs(result, size);
+	dpvs_sockopt_msg_free(result);
+	return array;
+}
 
+static void ipvs_fill_dests_get(ipvs_service_entry_t *svc,
+				struct dp_vs_get_dests *dpvs_dests)
+{
+	memset(dpvs_dests, 0, sizeof(*dpvs_dests));
 	dpvs_dests->af = svc->af;
 	dpvs_dests->fwmark = svc->fwmark;
 	dpvs_dests->proto = svc->protocol;
@@ -730,13 +890,28 @@ struct ip_vs_get_dests *ipvs_get_dests(ipvs_service_entry_t *svc)
 	snprintf(dpvs_dests->drange, sizeof(dpvs_dests->drange), "%s", svc->drange);
 	snprintf(dpvs_dests->iifname, sizeof(dpvs_dests->iifname), "%s", svc->iifname);
 	snprintf(dpvs_dests->oifname, sizeof(dpvs_dests->oifname), "%s", svc->oifname);
+}
 
-	if (dpvs_getsockopt(DPVS_SO_GET_DESTS, dpvs_dests, len, (void **)&dpvs_dests_rcv, &len_rcv)) {
-		free(d);
-		free(dpvs_dests);
+static struct ip_vs_get_dests *
+ipvs_dests_from_dpvs(const struct dp_vs_get_dests *dpvs_dests_rcv, size_t len_rcv)
+{
+	struct ip_vs_get_dests *d;
+	struct ip_vs_dest_entry *ipvs_entry;
+	const struct dp_vs_dest_entry *dpvs_entry;
+	int i;
+
+	if (len_rcv < sizeof(*dpvs_dests_rcv) ||
+	    len_rcv < sizeof(*dpvs_dests_rcv) +
+		      dpvs_dests_rcv->num_dests * sizeof(struct dp_vs_dest_entry)) {
+		errno = EPROTO;
 		return NULL;
 	}
 
+	d = calloc(1, sizeof(struct ip_vs_get_dests) +
+		      sizeof(ipvs_dest_entry_t) * dpvs_dests_rcv->num_dests);
+	if (!d)
+		return NULL;
+
 	d->af = dpvs_dests_rcv->af;
 	memcpy(&d->addr, &dpvs_dests_rcv->addr, sizeof(d->addr));
 	d->protocol  = dpvs_dests_rcv->proto;
@@ -757,11 +932,137 @@ struct ip_vs_get_dests *ipvs_get_dests(ipvs_service_entry_t *svc)
 		if (d->entrytable[i].af == AF_INET)
 			d->entrytable[i].__addr_v4= d->entrytable[i].addr.ip;
 	}
-	free(dpvs_dests);	
+	return d;
+}
+
+struct ip_vs_get_dests *ipvs_get_dests(ipvs_service_entry_t *svc)
+{
+	struct ip_vs_get_dests *d;
+	struct dp_vs_get_dests dpvs_dests, *dpvs_dests_rcv;
+	size_t len_rcv = 0;
+
+	ipvs_fill_dests_get(svc, &dpvs_dests);
+
+	if (dpvs_getsockopt(DPVS_SO_GET_DESTS, &dpvs_dests, sizeof(dpvs_dests),
+			    (void **)&dpvs_dests_rcv, &len_rcv))
+		return NULL;
+
+	d = ipvs_dests_from_dpvs(dpvs_dests_rcv, len_rcv);
 	dpvs_sockopt_msg_free(dpvs_dests_rcv);
 	return d;
 }
 
+/*
+ * Get the dests and laddrs of the services and the blklsts in one bulk
+ * get. (*dests)[i] and (*laddrs)[i] are of get->entrytable[i], NULL if
+ * its get failed, e.g. the service is deleted meanwhile. Arrays and
+ * entries are freed by the caller.
+ */
+int ipvs_get_services_state(struct ip_vs_get_services *get,
+			    struct ip_vs_get_dests ***dests,
+			    struct ip_vs_get_laddrs ***laddrs,
+			    struct dp_vs_blklst_conf_array **blklsts)
+{
+	struct dp_vs_bulk_conf *conf;
+	struct dp_vs_bulk_item *item;
+	struct dp_vs_bulk_replies *res;
+	struct dp_vs_bulk_reply *rep;
+	size_t len, off, res_len;
+	unsigned int i, nitem;
+	char *buf;
+
+	*dests = NULL;
+	*laddrs = NULL;
+	*blklsts = NULL;
+
+	nitem = get->num_services * 2 + 1;
+	len = sizeof(*conf) +
+	      get->num_services * (DPVS_BULK_ALIGN(sizeof(*item) + sizeof(struct dp_vs_get_dests)) +
+				   DPVS_BULK_ALIGN(sizeof(*item) + sizeof(struct dp_vs_laddr_conf))) +
+	      DPVS_BULK_ALIGN(sizeof(*item));
+	if (!(buf = calloc(1, len)))
+		return -1;
+
+	conf = (struct dp_vs_bulk_conf *)buf;
+	conf->nitem = nitem;
+	off = sizeof(*conf);
+	for (i = 0; i < get->num_services; i++) {
+		item = (struct dp_vs_bulk_item *)(buf + off);
+		item->opt = DPVS_SO_GET_DESTS;
+		item->len = sizeof(struct dp_vs_get_dests);
+		ipvs_fill_dests_get(&get->entrytable[i], (struct dp_vs_get_dests *)item->data);
+		off += DPVS_BULK_ALIGN(sizeof(*item) + item->len);
+
+		item = (struct dp_vs_bulk_item *)(buf + off);
+		item->opt = SOCKOPT_GET_LADDR_GETALL;
+		item->len = sizeof(struct dp_vs_laddr_conf);
+		ipvs_fill_laddr_get(&get->entrytable[i], (struct dp_vs_laddr_conf *)item->data);
+		off += DPVS_BULK_ALIGN(sizeof(*item) + item->len);
+	}
+	item = (struct dp_vs_bulk_item *)(buf + off);
+	item->opt = SOCKOPT_GET_BLKLST_GETALL;
+
+	if (dpvs_getsockopt(SOCKOPT_GET_BULK_GET, buf, len, (void **)&res, &res_len)) {
+		free(buf);
+		return -1;
+	}
+	free(buf);
+
+	if (res_len < sizeof(*res) || res->nitem != nitem)
+		goto proto_err;
+
+	*dests = calloc(get->num_services ? get->num_services : 1, sizeof(**dests));
+	*laddrs = calloc(get->num_services ? get->num_services : 1, sizeof(**laddrs));
+	if (!*dests || !*laddrs)
+		goto err;
+
+	off = sizeof(*res);
+	for (i = 0; i < nitem; i++) {
+		rep = (struct dp_vs_bulk_reply *)((char *)res + off);
+		if (res_len - off < sizeof(*rep) ||
+		    res_len - off - sizeof(*rep) < rep->len)
+			goto proto_err;
+		off += DPVS_BULK_ALIGN(sizeof(*rep) + rep->len);
+		if (off > res_len)
+			off = res_len;
+		if (rep->result)
+			continue;
+
+		if (i == nitem - 1)
+			*blklsts = ipvs_blklsts_from_dpvs((struct dp_vs_blklst_conf_array *)rep->data,
+							  rep->len);
+		else if (i % 2 == 0)
+			(*dests)[i / 2] = ipvs_dests_from_dpvs((struct dp_vs_get_dests *)rep->data,
+							       rep->len);
+		else
+			(*laddrs)[i / 2] = ipvs_laddrs_from_dpvs((struct dp_vs_laddr_conf *)rep->data,
+								 rep->len);
+	}
+
+	dpvs_sockopt_msg_free(res);
+	return 0;
+
+proto_err:
+	errno = EPROTO;
+err:
+	if (*dests) {
+		for (i = 0; i < get->num_services; i++)
+			free((*dests)[i]);
+		free(*dests);
+		*dests = NULL;
+	}
+	if (*laddrs) {
+		for (i = 0; i < get->num_services; i++)
+			free((*laddrs)[i]);
+		free(*laddrs);
+		*laddrs = NULL;
+	}
+	free(*blklsts);
+	*blklsts = NULL;
+	dpvs_sockopt_msg_free(res);
+	return -1;
+}
+
 
 int ipvs_cmp_dests(ipvs_dest_entry_t *d1, ipvs_dest_entry_t *d2)
 {
@@ -834,9 +1135,9 @@ int ipvs_set_route(struct dp_vs_route_conf *rt, int cmd)
 {
     int err = -1;
     if (cmd == IPROUTE_DEL){
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE_DEL, rt, sizeof(struct dp_vs_route_conf));
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE_DEL, rt, sizeof(struct dp_vs_route_conf));
     } else if (cmd == IPROUTE_ADD){
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE_ADD, rt, sizeof(struct dp_vs_route_conf));
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE_ADD, rt, sizeof(struct dp_vs_route_conf));
     }
     return err;
 }
@@ -846,11 +1147,11 @@ int ipvs_set_route6(struct dp_vs_route6_conf *rt6_cfg, int cmd)
     int err = -1;
     if (cmd == IPROUTE_DEL) {
         rt6_cfg->ops = RT6_OPS_DEL;
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg, 
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg, 
                               sizeof(struct dp_vs_route6_conf));
     } else if (cmd == IPROUTE_ADD) {
         rt6_cfg->ops = RT6_OPS_ADD;
-        err = dpvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg,
+        err = ipvs_setsockopt(SOCKOPT_SET_ROUTE6_ADD_DEL, rt6_cfg,
                               sizeof(struct dp_vs_route6_conf));
     }
     return err;
@@ -860,15 +1161,15 @@ int ipvs_set_ipaddr(struct inet_addr_param *param, int cmd)
 {
    int err = -1;
    if (cmd == IPADDRESS_DEL)
-       err = dpvs_setsockopt(SOCKOPT_SET_IFADDR_DEL, param, sizeof(struct inet_addr_param)); 
+       err = ipvs_setsockopt(SOCKOPT_SET_IFADDR_DEL, param, sizeof(struct inet_addr_param)); 
    else if (cmd == IPADDRESS_ADD)
-       err = dpvs_setsockopt(SOCKOPT_SET_IFADDR_ADD, param, sizeof(struct inet_addr_param));
+       err = ipvs_setsockopt(SOCKOPT_SET_IFADDR_ADD, param, sizeof(struct inet_addr_param));
    return err;
 }
 
 int ipvs_send_gratuitous_arp(struct in_addr *in)
 {
-    return dpvs_setsockopt(DPVS_SO_SET_GRATARP, in, sizeof(in));
+    return ipvs_setsockopt(DPVS_SO_SET_GRATARP, in, sizeof(in));
 }
 
 ipvs_timeout_t *ipvs_get_timeout(void)
@@ -989,6 +1290,6 @@ void ipvs_service_entry_2_user(const ipvs_service_entry_t *entry, ipvs_service_t
 	strcpy(user->srange, entry->srange);
 	strcpy(user->drange, entry->drange);
 	strcpy(user->iifname, entry->iifname);
-	strcpy(user->iifname, entry->iifname);
+	strcpy(user->oifname, entry->oifname);
 }
 
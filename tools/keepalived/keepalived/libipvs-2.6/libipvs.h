@@ -89,6 +89,17 @@ extern int ipvs_getinfo(void);
 /* get the version number */
 extern unsigned int ipvs_version(void);
 
+/*
+ * queue the set calls below until ipvs_bulk_commit, which applies them in
+ * one request. with DPVS_BULK_F_ATOMIC it's all or nothing. @results holds
+ * dpvs error code of each queued item in order, freed by caller. a call
+ * may queue more than one item, ipvs_bulk_nitem tells how many are queued.
+ */
+extern int ipvs_bulk_begin(unsigned int flags);
+extern int ipvs_bulk_commit(int **results, unsigned int *nitem);
+extern void ipvs_bulk_abort(void);
+extern unsigned int ipvs_bulk_nitem(void);
+
 /* flush all the rules */
 extern int ipvs_flush(void);
 
@@ -165,6 +176,10 @@ extern int ipvs_cmp_dests(ipvs_dest_entry_t *d1,
 extern void ipvs_sort_dests(struct ip_vs_get_dests *d,
 			    ipvs_dest_cmp_t f);
 
+/* fill a service rule from a service entry */
+extern void ipvs_service_entry_2_user(const ipvs_service_entry_t *entry,
+				      ipvs_service_t *user);
+
 /* get an ipvs service entry */
 extern ipvs_service_entry_t *ipvs_get_service(struct ip_vs_service_user *hint);
 
@@ -189,4 +204,10 @@ extern int ipvs_set_ipaddr(struct inet_addr_param *param, int cmd);
 
 extern struct dp_vs_blklst_conf_array *ipvs_get_blklsts(void);
 
+/* get the dests and laddrs of the services and the blklsts in one request */
+extern int ipvs_get_services_state(struct ip_vs_get_services *get,
+				   struct ip_vs_get_dests ***dests,
+				   struct ip_vs_get_laddrs ***laddrs,
+				   struct dp_vs_blklst_conf_array **blklsts);
+
 #endif /* _LIBIPVS_H */
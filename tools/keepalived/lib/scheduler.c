@@ -34,6 +34,7 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 #include "scheduler.h"
 #include "memory.h"
@@ -51,6 +52,16 @@ thread_make_master(void)
 	thread_master_t *new;
 
 	new = (thread_master_t *) MALLOC(sizeof (thread_master_t));
+	new->epoll_fd = epoll_create(THREAD_EPOLL_EVENTS);
+	if (new->epoll_fd < 0) {
+		log_message(LOG_ERR, "scheduler: epoll_create error (%s)"
+				   , strerror(errno));
+		assert(0);
+	}
+	fcntl(new->epoll_fd, F_SETFD, FD_CLOEXEC);
+	new->events = (struct epoll_event *)
+		MALLOC(THREAD_EPOLL_EVENTS * sizeof (struct epoll_event));
+	new->signal_fd = -1;
 	return new;
 }
 
@@ -82,21 +93,70 @@ thread_list_add_before(thread_list_t * list, thread_t * point, thread_t * thread
 	list->count++;
 }
 
-/* Add a thread in the list sorted by timeval */
-void
-thread_list_add_timeval(thread_list_t * list, thread_t * thread)
+/* Timeout heap helpers, thread->index follows its slot. */
+static void
+thread_heap_up(thread_heap_t * h, int i)
 {
-	thread_t *tt;
+	thread_t *t = h->heap[i];
+	int parent;
 
-	for (tt = list->head; tt; tt = tt->next) {
-		if (timer_cmp(thread->sands, tt->sands) <= 0)
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (timer_cmp(h->heap[parent]->sands, t->sands) <= 0)
 			break;
+		h->heap[i] = h->heap[parent];
+		h->heap[i]->index = i;
+		i = parent;
 	}
+	h->heap[i] = t;
+	t->index = i;
+}
 
-	if (tt)
-		thread_list_add_before(list, tt, thread);
-	else
-		thread_list_add(list, thread);
+static void
+thread_heap_down(thread_heap_t * h, int i)
+{
+	thread_t *t = h->heap[i];
+	int child;
+
+	while ((child = 2 * i + 1) < h->count) {
+		if (child + 1 < h->count &&
+		    timer_cmp(h->heap[child + 1]->sands, h->heap[child]->sands) < 0)
+			child++;
+		if (timer_cmp(t->sands, h->heap[child]->sands) <= 0)
+			break;
+		h->heap[i] = h->heap[child];
+		h->heap[i]->index = i;
+		i = child;
+	}
+	h->heap[i] = t;
+	t->index = i;
+}
+
+static void
+thread_heap_add(thread_heap_t * h, thread_t * thread)
+{
+	if (h->count == h->size) {
+		h->size = h->size ? h->size << 1 : 64;
+		h->heap = (thread_t **) REALLOC(h->heap, h->size * sizeof (thread_t *));
+	}
+
+	h->heap[h->count++] = thread;
+	thread_heap_up(h, h->count - 1);
+}
+
+static void
+thread_heap_delete(thread_heap_t * h, thread_t * thread)
+{
+	int i = thread->index;
+	thread_t *last = h->heap[--h->count];
+
+	if (last != thread) {
+		h->heap[i] = last;
+		last->index = i;
+		thread_heap_down(h, i);
+		thread_heap_up(h, last->index);
+	}
+	thread->index = -1;
 }
 
 /* Delete a thread from the list. */
@@ -137,6 +197,67 @@ thread_clean_unuse(thread_master_t * m)
 	}
 }
 
+/* Make room for fd in the fd thread tables */
+static void
+thread_fd_grow(thread_master_t * m, int fd)
+{
+	int n = m->epoll_nfd ? m->epoll_nfd : 64;
+
+	if (fd < m->epoll_nfd)
+		return;
+
+	while (n <= fd)
+		n <<= 1;
+
+	m->fd_read = (thread_t **) REALLOC(m->fd_read, n * sizeof (thread_t *));
+	m->fd_write = (thread_t **) REALLOC(m->fd_write, n * sizeof (thread_t *));
+	memset(m->fd_read + m->epoll_nfd, 0, (n - m->epoll_nfd) * sizeof (thread_t *));
+	memset(m->fd_write + m->epoll_nfd, 0, (n - m->epoll_nfd) * sizeof (thread_t *));
+	m->epoll_nfd = n;
+}
+
+/* Events polled on fd for its read/write threads */
+static uint32_t
+thread_fd_events(thread_master_t * m, int fd)
+{
+	uint32_t events = 0;
+
+	if (fd < m->epoll_nfd) {
+		if (m->fd_read[fd])
+			events |= EPOLLIN;
+		if (m->fd_write[fd])
+			events |= EPOLLOUT;
+	}
+	return events;
+}
+
+/* Sync epoll with fd thread tables, old_events is what fd was polled for */
+static void
+thread_fd_update(thread_master_t * m, int fd, uint32_t old_events)
+{
+	struct epoll_event ev;
+	uint32_t events = thread_fd_events(m, fd);
+	int op;
+
+	if (events == old_events)
+		return;
+
+	if (!old_events)
+		op = EPOLL_CTL_ADD;
+	else if (!events)
+		op = EPOLL_CTL_DEL;
+	else
+		op = EPOLL_CTL_MOD;
+
+	memset(&ev, 0, sizeof (ev));
+	ev.events = events;
+	ev.data.fd = fd;
+	if (epoll_ctl(m->epoll_fd, op, fd, &ev) < 0 &&
+	    !(op == EPOLL_CTL_DEL && errno == EBADF))
+		log_message(LOG_WARNING, "scheduler: epoll_ctl fd [%d] error (%s)"
+				       , fd, strerror(errno));
+}
+
 /* Move thread to unuse list. */
 static void
 thread_add_unuse(thread_master_t * m, thread_t * thread)
@@ -175,21 +296,42 @@ thread_destroy_list(thread_master_t * m, thread_list_t thread_list)
 	}
 }
 
+/* Move heap element to unuse queue */
+static void
+thread_destroy_heap(thread_master_t * m, thread_heap_t * h)
+{
+	thread_t *t;
+
+	while (h->count) {
+		t = h->heap[h->count - 1];
+		if (t->type == THREAD_READ || t->type == THREAD_WRITE)
+			close(t->u.fd);
+
+		thread_heap_delete(h, t);
+		t->type = THREAD_UNUSED;
+		thread_add_unuse(m, t);
+	}
+}
+
 /* Cleanup master */
 static void
 thread_cleanup_master(thread_master_t * m)
 {
 	/* Unuse current thread lists */
-	thread_destroy_list(m, m->read);
-	thread_destroy_list(m, m->write);
-	thread_destroy_list(m, m->timer);
+	thread_destroy_heap(m, &m->read);
+	thread_destroy_heap(m, &m->write);
+	thread_destroy_heap(m, &m->timer);
+	thread_destroy_heap(m, &m->child);
 	thread_destroy_list(m, m->event);
 	thread_destroy_list(m, m->ready);
 
 	/* Clear all FDs */
-	FD_ZERO(&m->readfd);
-	FD_ZERO(&m->writefd);
-	FD_ZERO(&m->exceptfd);
+	if (m->epoll_nfd) {
+		memset(m->fd_read, 0, m->epoll_nfd * sizeof (thread_t *));
+		memset(m->fd_write, 0, m->epoll_nfd * sizeof (thread_t *));
+	}
+	FD_ZERO(&m->snmp_fds);
+	m->snmp_nfds = 0;
 
 	/* Clean garbage */
 	thread_clean_unuse(m);
@@ -202,6 +344,20 @@ thread_destroy_master(thread_master_t * m)
 	if (!m)
 		return;
 	thread_cleanup_master(m);
+	close(m->epoll_fd);
+	if (m->fd_read)
+		FREE(m->fd_read);
+	if (m->fd_write)
+		FREE(m->fd_write);
+	if (m->read.heap)
+		FREE(m->read.heap);
+	if (m->write.heap)
+		FREE(m->write.heap);
+	if (m->timer.heap)
+		FREE(m->timer.heap);
+	if (m->child.heap)
+		FREE(m->child.heap);
+	FREE(m->events);
 	FREE(m);
 }
 
@@ -239,12 +395,17 @@ thread_add_read(thread_master_t * m, int (*func) (thread_t *)
 {
 	thread_t *thread;
 
+	uint32_t old_events;
+
 	assert(m != NULL);
+	assert(fd >= 0);
 
-	if (FD_ISSET(fd, &m->readfd)) {
+	thread_fd_grow(m, fd);
+	if (m->fd_read[fd]) {
 		log_message(LOG_WARNING, "There is already read fd [%d]", fd);
 		return NULL;
 	}
+	old_events = thread_fd_events(m, fd);
 
 	thread = thread_new(m);
 	thread->type = THREAD_READ;
@@ -252,15 +413,15 @@ thread_add_read(thread_master_t * m, int (*func) (thread_t *)
 	thread->master = m;
 	thread->func = func;
 	thread->arg = arg;
-	FD_SET(fd, &m->readfd);
 	thread->u.fd = fd;
+	m->fd_read[fd] = thread;
+	thread_fd_update(m, fd, old_events);
 
 	/* Compute read timeout value */
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort the thread. */
-	thread_list_add_timeval(&m->read, thread);
+	thread_heap_add(&m->read, thread);
 
 	return thread;
 }
@@ -272,12 +433,17 @@ thread_add_write(thread_master_t * m, int (*func) (thread_t *)
 {
 	thread_t *thread;
 
+	uint32_t old_events;
+
 	assert(m != NULL);
+	assert(fd >= 0);
 
-	if (FD_ISSET(fd, &m->writefd)) {
+	thread_fd_grow(m, fd);
+	if (m->fd_write[fd]) {
 		log_message(LOG_WARNING, "There is already write fd [%d]", fd);
 		return NULL;
 	}
+	old_events = thread_fd_events(m, fd);
 
 	thread = thread_new(m);
 	thread->type = THREAD_WRITE;
@@ -285,15 +451,15 @@ thread_add_write(thread_master_t * m, int (*func) (thread_t *)
 	thread->master = m;
 	thread->func = func;
 	thread->arg = arg;
-	FD_SET(fd, &m->writefd);
 	thread->u.fd = fd;
+	m->fd_write[fd] = thread;
+	thread_fd_update(m, fd, old_events);
 
 	/* Compute write timeout value */
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort the thread. */
-	thread_list_add_timeval(&m->write, thread);
+	thread_heap_add(&m->write, thread);
 
 	return thread;
 }
@@ -318,8 +484,7 @@ thread_add_timer(thread_master_t * m, int (*func) (thread_t *)
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort by timeval. */
-	thread_list_add_timeval(&m->timer, thread);
+	thread_heap_add(&m->timer, thread);
 
 	return thread;
 }
@@ -346,8 +511,7 @@ thread_add_child(thread_master_t * m, int (*func) (thread_t *)
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort by timeval. */
-	thread_list_add_timeval(&m->child, thread);
+	thread_heap_add(&m->child, thread);
 
 	return thread;
 }
@@ -393,6 +557,39 @@ thread_add_terminate_event(thread_master_t * m)
 	return thread;
 }
 
+/* Stop polling fd for a read/write thread */
+static void
+thread_fd_clear(thread_master_t * m, thread_t * thread)
+{
+	int fd = thread->u.fd;
+	uint32_t old_events = thread_fd_events(m, fd);
+
+	if (thread->type == THREAD_READ) {
+		assert(m->fd_read[fd] == thread);
+		m->fd_read[fd] = NULL;
+	} else {
+		assert(m->fd_write[fd] == thread);
+		m->fd_write[fd] = NULL;
+	}
+	thread_fd_update(m, fd, old_events);
+}
+
+/* Move expired threads at the top of a heap to ready list */
+static void
+thread_move_expired(thread_master_t * m, thread_heap_t * h, unsigned char type)
+{
+	thread_t *t;
+
+	while (h->count && timer_cmp(time_now, h->heap[0]->sands) >= 0) {
+		t = h->heap[0];
+		if (t->type == THREAD_READ || t->type == THREAD_WRITE)
+			thread_fd_clear(m, t);
+		thread_heap_delete(h, t);
+		thread_list_add(&m->ready, t);
+		t->type = type;
+	}
+}
+
 /* Cancel thread from scheduler. */
 int
 thread_cancel(thread_t * thread)
@@ -402,24 +599,22 @@ thread_cancel(thread_t * thread)
 
 	switch (thread->type) {
 	case THREAD_READ:
-		assert(FD_ISSET(thread->u.fd, &thread->master->readfd));
-		FD_CLR(thread->u.fd, &thread->master->readfd);
-		thread_list_delete(&thread->master->read, thread);
+		thread_fd_clear(thread->master, thread);
+		thread_heap_delete(&thread->master->read, thread);
 		break;
 	case THREAD_WRITE:
-		assert(FD_ISSET(thread->u.fd, &thread->master->writefd));
-		FD_CLR(thread->u.fd, &thread->master->writefd);
-		thread_list_delete(&thread->master->write, thread);
+		thread_fd_clear(thread->master, thread);
+		thread_heap_delete(&thread->master->write, thread);
 		break;
 	case THREAD_TIMER:
-		thread_list_delete(&thread->master->timer, thread);
+		thread_heap_delete(&thread->master->timer, thread);
 		break;
 	case THREAD_CHILD:
 		/* Does this need to kill the child, or is that the
 		 * caller's job?
 		 * This function is currently unused, so leave it for now.
 		 */
-		thread_list_delete(&thread->master->child, thread);
+		thread_heap_delete(&thread->master->child, thread);
 		break;
 	case THREAD_EVENT:
 		thread_list_delete(&thread->master->event, thread);
@@ -460,15 +655,15 @@ thread_cancel_event(thread_master_t * m, void *arg)
 
 /* Update timer value */
 static void
-thread_update_timer(thread_list_t *list, timeval_t *timer_min)
+thread_update_timer(thread_heap_t *h, timeval_t *timer_min)
 {
-	if (list->head) {
+	if (h->count) {
 		if (!timer_isnull(*timer_min)) {
-			if (timer_cmp(list->head->sands, *timer_min) <= 0) {
-				*timer_min = list->head->sands;
+			if (timer_cmp(h->heap[0]->sands, *timer_min) <= 0) {
+				*timer_min = h->heap[0]->sands;
 			}
 		} else {
-			*timer_min = list->head->sands;
+			*timer_min = h->heap[0]->sands;
 		}
 	}
 }
@@ -504,19 +699,46 @@ thread_compute_timer(thread_master_t * m, timeval_t * timer_wait)
 	}
 }
 
+#ifdef _WITH_SNMP_
+/* Sync SNMP fds given by snmp_select_info() into epoll */
+static void
+thread_snmp_update(thread_master_t * m, fd_set * fds, int nfds)
+{
+	struct epoll_event ev;
+	int fd, max = nfds > m->snmp_nfds ? nfds : m->snmp_nfds;
+
+	for (fd = 0; fd < max; fd++) {
+		int want = fd < nfds && FD_ISSET(fd, fds);
+		int have = fd < m->snmp_nfds && FD_ISSET(fd, &m->snmp_fds);
+
+		if (want == have)
+			continue;
+
+		memset(&ev, 0, sizeof (ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		epoll_ctl(m->epoll_fd, want ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &ev);
+	}
+
+	m->snmp_fds = *fds;
+	m->snmp_nfds = nfds;
+}
+#endif
+
 /* Fetch next ready thread. */
 thread_t *
 thread_fetch(thread_master_t * m, thread_t * fetch)
 {
-	int ret, old_errno;
+	int ret, old_errno, i, fd, timeout;
 	thread_t *thread;
-	fd_set readfd;
-	fd_set writefd;
-	fd_set exceptfd;
 	timeval_t timer_wait;
-	int signal_fd;
+	int signal_fd, signaled;
+	struct epoll_event ev;
+	uint32_t events;
 #ifdef _WITH_SNMP_
 	timeval_t snmp_timer_wait;
+	fd_set snmp_fds;
+	fd_set readfd;
 	int snmpblock = 0;
 	int fdsetsize;
 #endif
@@ -558,43 +780,49 @@ retry:	/* When thread can't fetch try to find next thread again. */
 	set_time_now();
 	thread_compute_timer(m, &timer_wait);
 
-	/* Call select function. */
-	readfd = m->readfd;
-	writefd = m->writefd;
-	exceptfd = m->exceptfd;
-
+	/* The signal pipe is recreated on reload, poll the current one */
 	signal_fd = signal_rfd();
-	FD_SET(signal_fd, &readfd);
+	if (signal_fd != m->signal_fd && signal_fd >= 0) {
+		memset(&ev, 0, sizeof (ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = signal_fd;
+		if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev) < 0 &&
+		    errno != EEXIST)
+			log_message(LOG_WARNING, "scheduler: fail to poll signal fd (%s)"
+					       , strerror(errno));
+		m->signal_fd = signal_fd;
+	}
 
 #ifdef _WITH_SNMP_
-	/* When SNMP is enabled, we may have to select() on additional
-	 * FD. snmp_select_info() will add them to `readfd'. The trick
+	/* When SNMP is enabled, we may have to poll on additional
+	 * FD. snmp_select_info() will add them to `snmp_fds'. The trick
 	 * with this function is its last argument. We need to set it
 	 * to 0 and we need to use the provided new timer only if it
 	 * is still set to 0. */
-	fdsetsize = FD_SETSIZE;
+	FD_ZERO(&snmp_fds);
+	fdsetsize = 0;
 	snmpblock = 0;
 	memcpy(&snmp_timer_wait, &timer_wait, sizeof(timeval_t));
-	snmp_select_info(&fdsetsize, &readfd, &snmp_timer_wait, &snmpblock);
+	snmp_select_info(&fdsetsize, &snmp_fds, &snmp_timer_wait, &snmpblock);
 	if (snmpblock == 0)
 		memcpy(&timer_wait, &snmp_timer_wait, sizeof(timeval_t));
+	thread_snmp_update(m, &snmp_fds, fdsetsize);
 #endif
 
-	ret = select(FD_SETSIZE, &readfd, &writefd, &exceptfd, &timer_wait);
+	/* Round up, not to spin on sub-millisecond waits */
+	timeout = timer_wait.tv_sec * 1000 + (timer_wait.tv_usec + 999) / 1000;
+	ret = epoll_wait(m->epoll_fd, m->events, THREAD_EPOLL_EVENTS, timeout);
 
 	/* we have to save errno here because the next syscalls will set it */
 	old_errno = errno;
 
-       /* Handle SNMP stuff */
-#ifdef _WITH_SNMP_
-	if (ret > 0)
-		snmp_read(&readfd);
-	else if (ret == 0)
-		snmp_timeout();
-#endif
-
 	/* handle signals synchronously, including child reaping */
-	if (FD_ISSET(signal_fd, &readfd))
+	signaled = 0;
+	for (i = 0; i < ret; i++) {
+		if (m->events[i].data.fd == signal_fd)
+			signaled = 1;
+	}
+	if (signaled)
 		signal_run_callback();
 
 	/* Update current time */
@@ -604,89 +832,62 @@ retry:	/* When thread can't fetch try to find next thread again. */
 		if (old_errno == EINTR)
 			goto retry;
 		/* Real error. */
-		DBG("select error: %s", strerror(old_errno));
+		DBG("epoll_wait error: %s", strerror(old_errno));
 		assert(0);
 	}
 
-	/* Timeout children */
-	thread = m->child.head;
-	while (thread) {
-		thread_t *t;
+#ifdef _WITH_SNMP_
+	FD_ZERO(&readfd);
+#endif
 
-		t = thread;
-		thread = t->next;
+	/* Ready fds, only threads with events are touched */
+	for (i = 0; i < ret; i++) {
+		fd = m->events[i].data.fd;
+		events = m->events[i].events;
 
-		if (timer_cmp(time_now, t->sands) >= 0) {
-			thread_list_delete(&m->child, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_CHILD_TIMEOUT;
+		if (fd == signal_fd)
+			continue;
+#ifdef _WITH_SNMP_
+		if (fd < m->snmp_nfds && FD_ISSET(fd, &m->snmp_fds)) {
+			FD_SET(fd, &readfd);
+			continue;
 		}
-	}
-
-	/* Read thead. */
-	thread = m->read.head;
-	while (thread) {
-		thread_t *t;
-
-		t = thread;
-		thread = t->next;
-
-		if (FD_ISSET(t->u.fd, &readfd)) {
-			assert(FD_ISSET(t->u.fd, &m->readfd));
-			FD_CLR(t->u.fd, &m->readfd);
-			thread_list_delete(&m->read, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_READY_FD;
-		} else {
-			if (timer_cmp(time_now, t->sands) >= 0) {
-				FD_CLR(t->u.fd, &m->readfd);
-				thread_list_delete(&m->read, t);
-				thread_list_add(&m->ready, t);
-				t->type = THREAD_READ_TIMEOUT;
-			}
+#endif
+		if (fd >= m->epoll_nfd)
+			continue;
+
+		/* like select(), errors make fd both readable and writable */
+		if (events & (EPOLLERR | EPOLLHUP))
+			events |= EPOLLIN | EPOLLOUT;
+
+		if ((events & EPOLLIN) && (thread = m->fd_read[fd])) {
+			thread_fd_clear(m, thread);
+			thread_heap_delete(&m->read, thread);
+			thread_list_add(&m->ready, thread);
+			thread->type = THREAD_READY_FD;
 		}
-	}
-
-	/* Write thead. */
-	thread = m->write.head;
-	while (thread) {
-		thread_t *t;
 
-		t = thread;
-		thread = t->next;
-
-		if (FD_ISSET(t->u.fd, &writefd)) {
-			assert(FD_ISSET(t->u.fd, &writefd));
-			FD_CLR(t->u.fd, &m->writefd);
-			thread_list_delete(&m->write, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_READY_FD;
-		} else {
-			if (timer_cmp(time_now, t->sands) >= 0) {
-				FD_CLR(t->u.fd, &m->writefd);
-				thread_list_delete(&m->write, t);
-				thread_list_add(&m->ready, t);
-				t->type = THREAD_WRITE_TIMEOUT;
-			}
+		if ((events & EPOLLOUT) && (thread = m->fd_write[fd])) {
+			thread_fd_clear(m, thread);
+			thread_heap_delete(&m->write, thread);
+			thread_list_add(&m->ready, thread);
+			thread->type = THREAD_READY_FD;
 		}
 	}
-	/* Exception thead. */
-	/*... */
-
-	/* Timer update. */
-	thread = m->timer.head;
-	while (thread) {
-		thread_t *t;
 
-		t = thread;
-		thread = t->next;
+       /* Handle SNMP stuff */
+#ifdef _WITH_SNMP_
+	if (ret > 0)
+		snmp_read(&readfd);
+	else if (ret == 0)
+		snmp_timeout();
+#endif
 
-		if (timer_cmp(time_now, t->sands) >= 0) {
-			thread_list_delete(&m->timer, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_READY;
-		}
-	}
+	/* Timeouts. Heaps are ordered by timeval, only expired threads are visited. */
+	thread_move_expired(m, &m->child, THREAD_CHILD_TIMEOUT);
+	thread_move_expired(m, &m->read, THREAD_READ_TIMEOUT);
+	thread_move_expired(m, &m->write, THREAD_WRITE_TIMEOUT);
+	thread_move_expired(m, &m->timer, THREAD_READY);
 
 	/* Return one event. */
 	thread = thread_trim_head(&m->ready);
@@ -715,11 +916,12 @@ thread_child_handler(void * v, int sig)
 
 	/*
 	 * This is O(n^2), but there will only be a few entries on
-	 * this list.
+	 * this heap.
 	 */
-	thread_t *thread;
+	thread_t *t;
 	pid_t pid;
 	int status = 77;
+	int i;
 	while ((pid = waitpid(-1, &status, WNOHANG))) {
 		if (pid == -1) {
 			if (errno == ECHILD)
@@ -727,13 +929,10 @@ thread_child_handler(void * v, int sig)
 			DBG("waitpid error: %s", strerror(errno));
 			assert(0);
 		} else {
-			thread = m->child.head;
-			while (thread) {
-				thread_t *t;
-				t = thread;
-				thread = t->next;
+			for (i = 0; i < m->child.count; i++) {
+				t = m->child.heap[i];
 				if (pid == t->u.c.pid) {
-					thread_list_delete(&m->child, t);
+					thread_heap_delete(&m->child, t);
 					thread_list_add(&m->ready, t);
 					t->u.c.status = status;
 					t->type = THREAD_READY;
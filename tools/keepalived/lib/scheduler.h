@@ -27,6 +27,8 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
 #include <assert.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -43,6 +45,7 @@ typedef struct _thread {
 	int (*func) (struct _thread *);	/* event function */
 	void *arg;			/* event argument */
 	timeval_t sands;		/* rest of time sands value. */
+	int index;			/* in timeout heap */
 	union {
 		int val;		/* second argument of the event. */
 		int fd;			/* file descriptor in case of read/write. */
@@ -60,18 +63,30 @@ typedef struct _thread_list {
 	int count;
 } thread_list_t;
 
+/* Min-heap of threads by sands, timeouts are not added in order. */
+typedef struct _thread_heap {
+	thread_t **heap;
+	int count;
+	int size;
+} thread_heap_t;
+
 /* Master of the theads. */
 typedef struct _thread_master {
-	thread_list_t read;
-	thread_list_t write;
-	thread_list_t timer;
-	thread_list_t child;
+	thread_heap_t read;
+	thread_heap_t write;
+	thread_heap_t timer;
+	thread_heap_t child;
 	thread_list_t event;
 	thread_list_t ready;
 	thread_list_t unuse;
-	fd_set readfd;
-	fd_set writefd;
-	fd_set exceptfd;
+	int epoll_fd;			/* polls all read/write fds */
+	int epoll_nfd;			/* size of fd_read and fd_write */
+	thread_t **fd_read;		/* read thread waiting on each fd */
+	thread_t **fd_write;		/* write thread waiting on each fd */
+	struct epoll_event *events;
+	int signal_fd;			/* signal pipe added to epoll */
+	fd_set snmp_fds;		/* SNMP fds added to epoll */
+	int snmp_nfds;
 	unsigned long alloc;
 } thread_master_t;
 
@@ -89,6 +104,9 @@ typedef struct _thread_master {
 #define THREAD_TERMINATE	10
 #define THREAD_READY_FD		11
 
+/* max fd events returned by one epoll_wait */
+#define THREAD_EPOLL_EVENTS	1024
+
 /* MICRO SEC def */
 #define BOOTSTRAP_DELAY TIMER_HZ
 #define RESPAWN_TIMER	60*TIMER_HZ